@@ -23,6 +23,7 @@
 
 #include "CoordinateConverter.h"
 #include "gdalclient.h"
+#include "GridLockedConverter.h"
 #include "doubleBuilder.h"
 
 #define OLD_SERIALIZE
@@ -112,6 +113,7 @@ HRESULT CCWFGM_Asset::ImportPolylines(const std::filesystem::path& file_path, co
 		}
 		rescanRanges();
 		m_bRequiresSave = true;
+		m_assetCacheValid = false;
 	}
 	if (oSourceSRS)
 		OSRDestroySpatialReference(oSourceSRS);
@@ -208,6 +210,7 @@ HRESULT CCWFGM_Asset::ImportPolylinesWFS(const std::string& url, const std::stri
 
 		rescanRanges();
 		m_bRequiresSave = true;
+		m_assetCacheValid = false;
 	}
 	if (oSourceSRS)
 		OSRDestroySpatialReference(oSourceSRS);
@@ -295,31 +298,43 @@ std::int32_t CCWFGM_Asset::serialVersionUid(const SerializeProtoOptions& options
 
 
 WISE::GridProto::CwfgmAsset* CCWFGM_Asset::serialize(const SerializeProtoOptions& options) {
-	auto filter = new WISE::GridProto::CwfgmAsset();
+	return serialize(options, nullptr);
+}
+
+
+WISE::GridProto::CwfgmAsset* CCWFGM_Asset::serialize(const SerializeProtoOptions& options, google::protobuf::Arena *arena) {
+	auto filter = google::protobuf::Arena::CreateMessage<WISE::GridProto::CwfgmAsset>(arena);
 	filter->set_version(serialVersionUid(options));
 
 	if (m_assetBoundaryWidth != 0.0)
 		filter->set_allocated_assetboundary(DoubleBuilder().withValue(m_assetBoundaryWidth).forProtobuf(options.useVerboseFloats()));
 
-	XY_PolyLLSet set;
-	RefNode<XY_PolyType>* pc = m_polyList.LH_Head();
-	while (pc->LN_Succ()) {
-		XY_PolyLL* p = (XY_PolyLL*)set.NewCopy(*pc->LN_Ptr());
-		p->m_publicFlags &= (~(XY_PolyLL_BaseTempl<double>::Flags::INTERPRET_POLYMASK));
-		p->m_publicFlags |= pc->LN_Ptr()->m_publicFlags;
-		set.AddPoly(p);
-		pc = pc->LN_Succ();
-	}
+	if ((!m_assetCacheValid) || (m_assetCacheVerbose != options.useVerboseFloats())) {
+		XY_PolyLLSet set;
+		RefNode<XY_PolyType>* pc = m_polyList.LH_Head();
+		while (pc->LN_Succ()) {
+			XY_PolyLL* p = (XY_PolyLL*)set.NewCopy(*pc->LN_Ptr());
+			p->m_publicFlags &= (~(XY_PolyLL_BaseTempl<double>::Flags::INTERPRET_POLYMASK));
+			p->m_publicFlags |= pc->LN_Ptr()->m_publicFlags;
+			set.AddPoly(p);
+			pc = pc->LN_Succ();
+		}
 
-	GeoPoly geo(&set);
-	geo.setStoredUnits(GeoPoly::UTM);
-	filter->set_allocated_assets(geo.getProtobuf(options.useVerboseFloats()));
+		GeoPoly geo(&set);
+		geo.setStoredUnits(GeoPoly::UTM);
+		m_assetCache.set_allocated_assets(geo.getProtobuf(options.useVerboseFloats()));
+		m_assetCacheVerbose = options.useVerboseFloats();
+		m_assetCacheValid = true;
+	}
+	filter->mutable_assets()->CopyFrom(m_assetCache.assets());
 
 	return filter;
 }
 
 
 CCWFGM_Asset* CCWFGM_Asset::deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE);
+
 	if (!m_gridEngine) {
 		if (valid)
 			/// <summary>
@@ -409,9 +424,9 @@ CCWFGM_Asset* CCWFGM_Asset::deserialize(const google::protobuf::Message& proto,
 	std::string projection;
 	projection = std::get<std::string>(var);
 
-	boost::scoped_ptr<CCoordinateConverter> convert(new CCoordinateConverter());
-	convert->SetSourceProjection(projection.c_str());
+	GridLockedConverter convert(projection);
 
+	m_assetCacheValid = false;
 	GeoPoly geo(filter->assets(), GeoPoly::TYPE_LINKED_LIST);
 	geo.setStoredUnits(GeoPoly::UTM);
 	geo.setConverter([&convert](std::uint8_t type, double x, double y, double z) -> std::tuple<double, double, double>
@@ -53,6 +53,7 @@ CCWFGM_Asset::CCWFGM_Asset() {
 	m_xmin = m_ymin = m_xmax = m_ymax = -99.0;
 	m_assetBoundaryWidth = 1.0;
 	m_flags = 0;
+	m_assetCacheValid = m_assetCacheVerbose = false;
 }
 
 
@@ -81,6 +82,7 @@ CCWFGM_Asset::CCWFGM_Asset(const CCWFGM_Asset& toCopy) {
 		pn = pn->LN_Succ();
 	}
 
+	m_assetCacheValid = m_assetCacheVerbose = false;
 	m_bRequiresSave = false;
 }
 
@@ -128,6 +130,7 @@ HRESULT CCWFGM_Asset::AddPolyLine(const XY_PolyConst& xy_pairs, std::uint16_t ty
 		poly->m_publicFlags = type;
 		poly->CleanPoly(0.0, ctype);
 		m_bRequiresSave = true;
+		m_assetCacheValid = false;
 	}
 	catch (std::bad_alloc& cme) {
 		if (poly)
@@ -206,6 +209,7 @@ HRESULT CCWFGM_Asset::SetPolyLine(std::uint32_t index, const XY_PolyConst& xy_pa
 		poly->m_publicFlags = type;
 		poly->CleanPoly(0.0, ctype);
 		m_bRequiresSave = true;
+		m_assetCacheValid = false;
 	}
 	catch (std::bad_alloc& cme) {
 		if (poly)
@@ -295,6 +299,7 @@ HRESULT CCWFGM_Asset::ClearPolyLine(std::uint32_t set_break) {
 		delete pn;
 	}
 	m_bRequiresSave = true;
+	m_assetCacheValid = false;
 
 	rescanRanges();
 	clearFirebreak();
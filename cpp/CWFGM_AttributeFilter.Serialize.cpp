@@ -24,22 +24,29 @@
 #include <errno.h>
 #include <stdio.h>
 #include "CoordinateConverter.h"
-#include "GDALExporter.h"
+#include "GridMemoryFile.h"
+#include "GridRasterWriter.h"
 #include "GDALImporter.h"
 #include "gdalclient.h"
 #include "doubleBuilder.h"
-#include "boost_compression.h"
+#include "GridChunkedCompress.h"
+#include "GridAttributeArray.h"
 #include "GDALextras.h"
+#include "str_printf.h"
 #include "filesystem.hpp"
 #include <ctime>
+#include <memory>
+#include <new>
+#include <stdexcept>
 
 using namespace GDALExtras;
 
 /////////////////////////////////////////////////////////////////////////////
 // CWFGM_AttributeFilter
 
-HRESULT CCWFGM_AttributeFilter::ExportAttributeGrid(const std::string &prj_file_name, const std::string &grid_file_name, const std::string &band_name) {
+HRESULT CCWFGM_AttributeFilter::ExportAttributeGrid(const std::string &prj_file_name, const std::string &grid_file_name, const std::string &band_name, std::uint32_t flags) {
 	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+	loadDeferred();
 
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine;
 	if (!(gridEngine = m_gridEngine(nullptr)))					{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
@@ -47,169 +54,142 @@ HRESULT CCWFGM_AttributeFilter::ExportAttributeGrid(const std::string &prj_file_
 	if (grid_file_name.length()==0)
 		return E_INVALIDARG;
 
-	double* d_array = nullptr;
-	int* l_array = nullptr;
-	bool use_double = false;
-	if (m_optionType == VT_R4 || m_optionType == VT_R8)
-		use_double = true;
-
-	if (use_double)
-		d_array = new double[m_xsize * m_ysize];
-	else
-		l_array = new int[m_xsize * m_ysize];
-
-	int* l_pointer = l_array;
-	double* d_pointer = d_array;
-
-	NumericVariant var;
-	grid::AttributeValue var_valid;
-	for(std::uint16_t i = m_ysize - 1; i < m_ysize; i--) {
-		for(std::uint16_t j = 0; j < m_xsize; j++) {
-			XY_Point pt;
-			pt.x = j;
-			pt.y = i;
-			getPoint(pt, &var, &var_valid);
-
-			/*POLYMORPHIC CHECK*/
-			if (var_valid != grid::AttributeValue::NOT_SET) {
-
-				if (std::holds_alternative<std::int8_t>(var)) {
-					*l_pointer = std::get<std::int8_t>(var);
-					l_pointer++;
-
-				}
-				else if (std::holds_alternative<std::int16_t>(var)) {
-					*l_pointer = std::get<std::int16_t>(var);
-					l_pointer++;
-
-				}
-				else if (std::holds_alternative<std::int32_t>(var)) {
-					*l_pointer = std::get<std::int32_t>(var);
-					l_pointer++;
-
-				}
-				else if (std::holds_alternative<std::int64_t>(var)) {
-					*l_pointer = std::get<std::int64_t>(var);
-					l_pointer++;
-
-				}
-				else if (std::holds_alternative<std::uint8_t>(var)) {
+	PolymorphicAttribute v;
+	if (FAILED(gridEngine->GetAttribute(nullptr, CWFGM_GRID_ATTRIBUTE_SPATIALREFERENCE, &v)))
+		return ERROR_GRID_UNINITIALIZED;
+	std::string ref;
 
-					if (m_optionKey == (std::uint16_t)(-1)) {
-						long file_index, export_index;
-						ICWFGM_Fuel *fuel;
-						m_fuelMap->FuelAtIndex(std::get<std::uint8_t>(var), &file_index, &export_index, &fuel);
-						*l_pointer = export_index;
-					}
-					else {
-						*l_pointer = std::get<std::uint8_t>(var);
-					}
-					l_pointer++;
+	/*POLYMORPHIC CHECK*/
+	try { ref = std::get<std::string>(v); }
+	catch (std::bad_variant_access&) { weak_assert(false); return ERROR_PROJECTION_UNKNOWN; };
 
-				}
-				else if (std::holds_alternative<std::uint16_t>(var)) {
-					*l_pointer = std::get<std::uint16_t>(var);
-					l_pointer++;
+	if ((m_xllcorner == -999999999.0) && (m_yllcorner == -999999999.0) && (m_resolution == -1.0)) {
+		weak_assert(false);
+		fixResolution(nullptr, "");
+	}
 
-				}
-				else if (std::holds_alternative<std::uint32_t>(var)) {
-					*l_pointer = std::get<std::uint32_t>(var);
-					l_pointer++;
+	GridRasterWriter writer;
+	writer.addDefaultTags();
+	writer.setProjection(ref);
+	writer.setSize(m_xsize, m_ysize);
+	writer.setPixelResolution(m_resolution);
+	writer.setLowerLeft(m_xllcorner, m_yllcorner);
+	writer.setTiled((flags & CWFGM_GRID_EXPORT_TILED) ? true : false);
+	writer.setOverviews((flags & CWFGM_GRID_EXPORT_OVERVIEWS) ? true : false);
+	std::uint16_t band = writer.addBand(((m_optionType == VT_R4) || (m_optionType == VT_R8)) ? GridRasterWriter::BandType::FLOAT64 : GridRasterWriter::BandType::INT32,
+		band_name.c_str());
+
+	HRESULT hr;
+	if (FAILED(hr = writer.create(grid_file_name)))
+		return hr;
+	hr = exportBand(writer, band);
+	HRESULT hr2 = writer.close();
+	return FAILED(hr) ? hr : hr2;
+}
 
-				}
-				else if (std::holds_alternative<std::uint64_t>(var)) {
-					*l_pointer = std::get<std::uint64_t>(var);
-					l_pointer++;
 
-				}
-				else if (std::holds_alternative<float>(var)) {
-					*d_pointer = std::get<float>(var);
-					d_pointer++;
+HRESULT CCWFGM_AttributeFilter::ExportAttributeGrid(std::vector<std::uint8_t> &buffer, const std::string &extension, const std::string &band_name, std::uint32_t flags) {
+	GridMemoryFile file(extension.length() ? extension : ".tif");
+	HRESULT hr = ExportAttributeGrid(std::string(), file.name(), band_name, flags);
+	if (SUCCEEDED(hr)) {
+		HRESULT hr2 = file.read(buffer);
+		if (FAILED(hr2))
+			hr = hr2;
+	}
+	return hr;
+}
 
-				}
-				else if (std::holds_alternative<double>(var)) {
-					*d_pointer = std::get<double>(var);
-					d_pointer++;
 
-				}
-				else if (std::holds_alternative<bool>(var)) {
-					*l_pointer = (std::get<bool>(var) == false) ? 0 : 1;
-					l_pointer++;
+#ifndef DOXYGEN_IGNORE_CODE
 
-				}
-				else {
-					weak_assert(false);
-					if (use_double)
-					{
-						*d_pointer = -9999;
-						d_pointer++;
-					}
-					else {
-						*l_pointer = -9999;
-						l_pointer++;
-					}
-				}
-				
-			}
-			else {
-				if (use_double) {
-					*d_pointer = -9999;
-					d_pointer++;
-				}
-				else {
-					*l_pointer = -9999;
-					l_pointer++;
-				}
+HRESULT CCWFGM_AttributeFilter::exportBand(GridRasterWriter &writer, std::uint16_t band) {
+	const bool *nodata = m_array_nodata;
+	const std::int8_t *data = m_array_i1;
 
-			}
+	// narrowed or sparse arrays are exported from a temporary dense copy in OptionType
+	std::unique_ptr<std::int8_t[]> widened;
+	std::unique_ptr<bool[]> expanded;
+	if ((m_sparse) || ((data) && (m_storageType != m_optionType))) {
+		const std::size_t count = (std::size_t)m_xsize * (std::size_t)m_ysize;
+		widened.reset(new (std::nothrow) std::int8_t[count * typeSize(m_optionType)]);
+		if ((!widened) || (!widenInto(widened.get())))
+			return E_OUTOFMEMORY;
+		data = widened.get();
+		if ((m_sparse) && (m_sparse->hasNodata())) {
+			expanded.reset(new (std::nothrow) bool[count]);
+			if (!expanded)
+				return E_OUTOFMEMORY;
+			m_sparse->expand(nullptr, expanded.get());
+			nodata = expanded.get();
 		}
 	}
 
-	GDALExporter exporter;
-	exporter.AddTag("TIFFTAG_SOFTWARE", "W.I.S.E.");
-	exporter.AddTag("TIFFTAG_GDAL_NODATA", "-9999");
-	char mbstr[100];
-	std::time_t t = std::time(nullptr);
-	std::strftime(mbstr, sizeof(mbstr), "%Y-%m-%d %H:%M:%S %Z", std::localtime(&t));
-	exporter.AddTag("TIFFTAG_DATETIME", mbstr);
-	PolymorphicAttribute v;
-	HRESULT hr = S_OK;
-	if (SUCCEEDED(gridEngine->GetAttribute(nullptr, CWFGM_GRID_ATTRIBUTE_SPATIALREFERENCE, &v))) {
-		std::string ref;
-
-		/*POLYMORPHIC CHECK*/
-		try { ref = std::get<std::string>(v); }
-		catch (std::bad_variant_access&) { weak_assert(false); return ERROR_PROJECTION_UNKNOWN; };
-
-		exporter.setProjection(ref.c_str());
-		exporter.setSize(m_xsize, m_ysize);
+	auto as_int = [&writer, band, nodata](const auto *array) -> HRESULT {
+		return writer.writeBand<std::int32_t>(band, [array, nodata](std::uint32_t index) -> std::int32_t {
+			if ((nodata) && (nodata[index]))
+				return -9999;
+			return (std::int32_t)array[index];
+		});
+	};
+	auto as_double = [&writer, band, nodata](const auto *array) -> HRESULT {
+		return writer.writeBand<double>(band, [array, nodata](std::uint32_t index) -> double {
+			if ((nodata) && (nodata[index]))
+				return -9999.0;
+			return (double)array[index];
+		});
+	};
+
+	if (!data) {
+		if ((m_optionType == VT_R4) || (m_optionType == VT_R8))
+			return writer.writeBand<double>(band, [](std::uint32_t) -> double { return -9999.0; });
+		return writer.writeBand<std::int32_t>(band, [](std::uint32_t) -> std::int32_t { return -9999; });
+	}
 
-		if ((m_xllcorner == -999999999.0) && (m_yllcorner == -999999999.0) && (m_resolution == -1.0)) {
-			weak_assert(false);
-			fixResolution(nullptr, "");
-		}
-		exporter.setPixelResolution(m_resolution, m_resolution);
-		exporter.setLowerLeft(m_xllcorner, m_yllcorner);
-		GDALExporter::ExportResult res;
-		if (use_double)
-			res = exporter.Export(d_array, grid_file_name.c_str(), band_name.c_str());
-		else
-			res = exporter.Export(l_array, grid_file_name.c_str(), band_name.c_str());
+	switch (m_optionType) {
+		case VT_I1:		return as_int(data);
+		case VT_I2:		return as_int(reinterpret_cast<const std::int16_t *>(data));
+		case VT_I4:		return as_int(reinterpret_cast<const std::int32_t *>(data));
+		case VT_I8:		return as_int(reinterpret_cast<const std::int64_t *>(data));
+		case VT_UI2:	return as_int(reinterpret_cast<const std::uint16_t *>(data));
+		case VT_UI4:	return as_int(reinterpret_cast<const std::uint32_t *>(data));
+		case VT_UI8:	return as_int(reinterpret_cast<const std::uint64_t *>(data));
+		case VT_R4:		return as_double(reinterpret_cast<const float *>(data));
+		case VT_R8:		return as_double(reinterpret_cast<const double *>(data));
+
+		case VT_BOOL: {
+						const std::int8_t *array = data;
+						return writer.writeBand<std::int32_t>(band, [array, nodata](std::uint32_t index) -> std::int32_t {
+							if ((nodata) && (nodata[index]))
+								return -9999;
+							return array[index] ? 1 : 0;
+						});
+					}
 
-		if (res == GDALExporter::ExportResult::ERROR_ACCESS)
-			hr = E_ACCESSDENIED;
+		case VT_UI1: {
+						if (m_optionKey != (std::uint16_t)-1)
+							return as_int(reinterpret_cast<const std::uint8_t *>(data));
+
+						if (!m_fuelMap)				{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+						long table[256];			// fuel index to export index, built once rather than per cell
+						for (std::uint16_t i = 0; i < 256; i++) {
+							long file_index;
+							ICWFGM_Fuel *fuel;
+							m_fuelMap->FuelAtIndex((std::uint8_t)i, &file_index, &table[i], &fuel);
+						}
+						const std::uint8_t *array = m_array_ui1;
+						return writer.writeBand<std::int32_t>(band, [array, nodata, &table](std::uint32_t index) -> std::int32_t {
+							if ((nodata) && (nodata[index]))
+								return -9999;
+							return table[array[index]];
+						});
+					}
 	}
-	else
-		hr = ERROR_GRID_UNINITIALIZED;
-
-	if (use_double && d_array)
-		delete [] d_array;
-	else if (l_array)
-		delete [] l_array;
-	
-	return hr;
+	weak_assert(false);
+	return E_UNEXPECTED;
 }
 
+#endif
+
 
 HRESULT CCWFGM_AttributeFilter::ImportAttributeGrid(const std::string & prj_file_name, const std::string & grid_file_name) {
 	if (!grid_file_name.length())							return E_INVALIDARG;
@@ -217,6 +197,7 @@ HRESULT CCWFGM_AttributeFilter::ImportAttributeGrid(const std::string & prj_file
 	SEM_BOOL engaged;
 	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
 	if (!engaged)											return ERROR_SCENARIO_SIMULATION_RUNNING;
+	loadDeferred();
 
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine;
 	if (!(gridEngine = m_gridEngine(nullptr)))				{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
@@ -314,15 +295,31 @@ HRESULT CCWFGM_AttributeFilter::ImportAttributeGrid(const std::string & prj_file
 
 	if (FAILED(error = gridEngine->GetDimensions(0, &gridXDim, &gridYDim)))
 		return error;
-	if ((gridXDim != importer.xSize()) ||
-		(gridYDim != importer.ySize()))
-		return ERROR_GRID_SIZE_INCORRECT;
-	if ((fabs(gridResolution - importer.xPixelSize()) > 0.0001) ||
-		(fabs(gridResolution - importer.yPixelSize()) > 0.0001))
-		return ERROR_GRID_UNSUPPORTED_RESOLUTION;
-	if ((fabs(gridXLL - importer.lowerLeftX()) > 0.001) ||
-		(fabs(gridYLL - importer.lowerLeftY()) > 0.001))
-		return ERROR_GRID_LOCATION_OUT_OF_RANGE;
+	const bool native = (gridXDim != importer.xSize()) || (gridYDim != importer.ySize()) ||
+		(fabs(gridResolution - importer.xPixelSize()) > 0.0001) || (fabs(gridResolution - importer.yPixelSize()) > 0.0001) ||
+		(fabs(gridXLL - importer.lowerLeftX()) > 0.001) || (fabs(gridYLL - importer.lowerLeftY()) > 0.001);
+	if ((native) && (m_optionKey != (std::uint16_t)-1)) {
+		// kept at its own resolution and sampled on the fly rather than upsampled, as long as it's no finer than the grid and overlaps it
+		if ((fabs(importer.xPixelSize() - importer.yPixelSize()) > 0.0001) ||
+			(importer.xPixelSize() < gridResolution - 0.0001))
+			return ERROR_GRID_UNSUPPORTED_RESOLUTION;
+		if ((importer.lowerLeftX() >= gridXLL + gridXDim * gridResolution) ||
+			(importer.lowerLeftY() >= gridYLL + gridYDim * gridResolution) ||
+			(importer.lowerLeftX() + importer.xSize() * importer.xPixelSize() <= gridXLL) ||
+			(importer.lowerLeftY() + importer.ySize() * importer.yPixelSize() <= gridYLL))
+			return ERROR_GRID_LOCATION_OUT_OF_RANGE;
+	}
+	else {
+		if ((gridXDim != importer.xSize()) ||
+			(gridYDim != importer.ySize()))
+			return ERROR_GRID_SIZE_INCORRECT;
+		if ((fabs(gridResolution - importer.xPixelSize()) > 0.0001) ||
+			(fabs(gridResolution - importer.yPixelSize()) > 0.0001))
+			return ERROR_GRID_UNSUPPORTED_RESOLUTION;
+		if ((fabs(gridXLL - importer.lowerLeftX()) > 0.001) ||
+			(fabs(gridYLL - importer.lowerLeftY()) > 0.001))
+			return ERROR_GRID_LOCATION_OUT_OF_RANGE;
+	}
 
 	//set the size and nodata
 	xsize = importer.xSize();
@@ -343,7 +340,9 @@ HRESULT CCWFGM_AttributeFilter::ImportAttributeGrid(const std::string & prj_file
 			m_array_nodata = m_origNoDataArray;
 			return E_OUTOFMEMORY;
 		}
-							
+		const std::int64_t zero = 0;					// the conversion below is serial, so place the pages first
+		FillAttributeArray(m_array_i1, size, &zero, m_array_nodata, false, xsize, ysize);
+
 		for (i = 0; i < index; i++) {
 			std::int64_t lscan;
 			double dscan;
@@ -397,7 +396,7 @@ HRESULT CCWFGM_AttributeFilter::ImportAttributeGrid(const std::string & prj_file
 			}
 		}
 
-		if (m_origArray) {
+		if ((m_origArray) || (m_sparse)) {
 			free(m_origArray);
 			error = SUCCESS_GRID_DATA_UPDATED;
 		}
@@ -406,10 +405,26 @@ HRESULT CCWFGM_AttributeFilter::ImportAttributeGrid(const std::string & prj_file
 		m_xsize = xsize;
 		m_ysize = ysize;
 
-		m_resolution = gridResolution;
+		m_gridResolution = gridResolution;
+		m_gridXLLCorner = gridXLL;
+		m_gridYLLCorner = gridYLL;
+		if (native) {
+			m_flags |= CCWFGMGRID_NATIVE_RESOLUTION;
+			m_resolution = importer.xPixelSize();
+			m_xllcorner = importer.lowerLeftX();
+			m_yllcorner = importer.lowerLeftY();
+		}
+		else {
+			m_flags &= (~(CCWFGMGRID_NATIVE_RESOLUTION));
+			m_resolution = gridResolution;
+			m_xllcorner = gridXLL;
+			m_yllcorner = gridYLL;
+		}
 		m_iresolution = 1.0 / m_resolution;
-		m_xllcorner = gridXLL;
-		m_yllcorner = gridYLL;
+		discardDeferred();
+		m_sparse.reset();
+		bindAccessors(m_optionType, 1.0);
+		compactStorage();
 		
 		m_bRequiresSave = true;
 	}
@@ -424,11 +439,89 @@ FAILURE:
 }
 
 
+HRESULT CCWFGM_AttributeFilter::ProbeAttributeGrid(const std::string &grid_file_name, std::uint32_t sample_step, GridFileProbe *probe) {
+	if (!probe)												return E_POINTER;
+	if (!grid_file_name.length())							return E_INVALIDARG;
+
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine;
+	if (!(gridEngine = m_gridEngine(nullptr)))				{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+
+	const bool fuel_grid = ((m_optionType == VT_UI1) && (m_optionKey == (std::uint16_t)-1));
+	std::vector<std::int32_t> sampled;
+	HRESULT hr = ProbeRasterFile(grid_file_name, sample_step, probe, ((fuel_grid) && (sample_step)) ? &sampled : nullptr);
+	if (FAILED(hr))
+		return hr;
+
+	if (probe->projection.length()) {
+		CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), SEM_TRUE);
+
+		PolymorphicAttribute v;
+		std::string csProject;
+		if (SUCCEEDED(gridEngine->GetAttribute(nullptr, CWFGM_GRID_ATTRIBUTE_SPATIALREFERENCE, &v))) {
+			/*POLYMORPHIC CHECK*/
+			try { csProject = std::get<std::string>(v); } catch (std::bad_variant_access &) { weak_assert(false); }
+		}
+
+		OGRSpatialReferenceH sourceSRS = CCoordinateConverter::CreateSpatialReferenceFromWkt(probe->projection.c_str());
+		OGRSpatialReferenceH gridSRS = csProject.length() ? CCoordinateConverter::CreateSpatialReferenceFromWkt(csProject.c_str()) : nullptr;
+		if (!gridSRS)
+			probe->compatibility = E_FAIL;
+		else if ((!sourceSRS) || (!OSRIsSame(gridSRS, sourceSRS, false)))
+			probe->compatibility = ERROR_GRID_LOCATION_OUT_OF_RANGE;
+		if (sourceSRS)		OSRDestroySpatialReference(sourceSRS);
+		if (gridSRS)		OSRDestroySpatialReference(gridSRS);
+	}
+
+	if (probe->compatibility == S_OK) {
+		double gridResolution, gridXLL, gridYLL;
+		std::uint16_t gridXDim, gridYDim;
+		PolymorphicAttribute var;
+
+		/*POLYMORPHIC CHECK*/
+		if (FAILED(hr = gridEngine->GetAttribute(nullptr, CWFGM_GRID_ATTRIBUTE_PLOTRESOLUTION, &var))) return hr;
+		VariantToDouble_(var, &gridResolution);
+
+		if (FAILED(hr = gridEngine->GetAttribute(nullptr, CWFGM_GRID_ATTRIBUTE_XLLCORNER, &var))) return hr;
+		VariantToDouble_(var, &gridXLL);
+
+		if (FAILED(hr = gridEngine->GetAttribute(nullptr, CWFGM_GRID_ATTRIBUTE_YLLCORNER, &var))) return hr;
+		VariantToDouble_(var, &gridYLL);
+
+		if (FAILED(hr = gridEngine->GetDimensions(0, &gridXDim, &gridYDim)))
+			return hr;
+		if ((gridXDim != probe->xsize) ||
+			(gridYDim != probe->ysize))
+			probe->compatibility = ERROR_GRID_SIZE_INCORRECT;
+		else if ((fabs(gridResolution - probe->xresolution) > 0.0001) ||
+			(fabs(gridResolution - probe->yresolution) > 0.0001))
+			probe->compatibility = ERROR_GRID_UNSUPPORTED_RESOLUTION;
+		else if ((fabs(gridXLL - probe->xllcorner) > 0.001) ||
+			(fabs(gridYLL - probe->yllcorner) > 0.001))
+			probe->compatibility = ERROR_GRID_LOCATION_OUT_OF_RANGE;
+	}
+
+	if (sampled.size())
+		ProbeFuelHistogram(sampled, m_fuelMap.get(), probe);
+	return S_OK;
+}
+
+
 HRESULT CCWFGM_AttributeFilter::ImportAttributeGridWCS( const std::string & url,  const std::string & layer,  const std::string & username,  const std::string & password) {
 	return E_NOTIMPL;
 }
 
 
+HRESULT CCWFGM_AttributeFilter::ImportAttributeGrid(const std::string & prj_file_name, const std::uint8_t *buffer, std::size_t length) {
+	if ((!buffer) || (!length))
+		return E_INVALIDARG;
+
+	GridMemoryFile file(buffer, length);
+	return ImportAttributeGrid(prj_file_name, file.name());
+}
+
+
 HRESULT CCWFGM_AttributeFilter::ExportAttributeGridWCS( const std::string & url,  const std::string & layer,  const std::string & username,  const std::string & password) {
 	return E_NOTIMPL;
 }
@@ -458,6 +551,14 @@ WISE::GridProto::CwfgmAttributeFilter *CCWFGM_AttributeFilter::serialize(const S
 	binary->set_allocated_xllcorner(DoubleBuilder().withValue(m_xllcorner).forProtobuf(options.useVerboseFloats()));
 	binary->set_allocated_yllcorner(DoubleBuilder().withValue(m_yllcorner).forProtobuf(options.useVerboseFloats()));
 	binary->set_allocated_resolution(DoubleBuilder().withValue(m_resolution).forProtobuf(options.useVerboseFloats()));
+	if (m_flags & CCWFGMGRID_NATIVE_RESOLUTION) {
+		binary->set_nativeresolution(true);
+		binary->set_sampling((m_sampling == CWFGM_GRID_SAMPLING_BILINEAR) ? WISE::GridProto::CwfgmAttributeFilter_Sampling_BILINEAR : WISE::GridProto::CwfgmAttributeFilter_Sampling_NEAREST);
+	}
+	if (m_flags & CCWFGMGRID_NARROW_STORAGE)
+		binary->set_narrowstorage(true);
+	if (m_flags & CCWFGMGRID_SPARSE_STORAGE)
+		binary->set_sparsestorage(true);
 
 	int size;
 	switch (m_optionType) {
@@ -511,30 +612,80 @@ WISE::GridProto::CwfgmAttributeFilter *CCWFGM_AttributeFilter::serialize(const S
 		break;
 	}
 
+	const GridChunkedCompress::Codec codec = GridChunkedCompress::saveCodec();
+	if (m_deferred && !options.useVerboseOutput() && options.zipOutput()) {
+		CThreadSemaphoreEngage deferred(&m_deferredLock, SEM_TRUE);
+		if ((m_deferred) && ((m_dataBlob.empty()) || (m_dataBlob.codec() == codec)) &&
+		    ((m_nodataBlob.empty()) || (m_nodataBlob.codec() == codec))) {
+			// never decoded since it was loaded, so the compressed arrays can be written straight back out
+			binary->set_allocated_iszipped(createProtobufObject(true));
+			binary->set_codec((WISE::GridProto::ZipCodec)codec);
+			if ((binary->type() != WISE::GridProto::CwfgmAttributeFilter_Type_EMPTY) && (!m_dataBlob.empty())) {
+				auto bts = new google::protobuf::BytesValue();
+				m_dataBlob.copy(bts->mutable_value());
+				binary->set_allocated_data(bts);
+			}
+			if (!m_nodataBlob.empty()) {
+				auto bts = new google::protobuf::BytesValue();
+				m_nodataBlob.copy(bts->mutable_value());
+				binary->set_allocated_nodata(bts);
+			}
+			return filter;
+		}
+	}
+	loadDeferred();
+
 	if (binary->type() != WISE::GridProto::CwfgmAttributeFilter_Type_EMPTY) {
+		// a narrowed or sparse array (see compactStorage()) is always written out densely, as OptionType
+		auto widened = [this, size]() -> std::string {
+			std::string data((std::size_t)m_xsize * (std::size_t)m_ysize * size, '\0');
+			if (!widenInto(&data[0]))
+				throw std::bad_alloc();
+			return data;
+		};
+		const bool narrowed = ((m_sparse) || ((m_array_i1) && (m_storageType != m_optionType)));
 		if (options.useVerboseOutput() || !options.zipOutput()) {
 			auto bts = new google::protobuf::BytesValue();
-			bts->set_value(m_array_i1, m_xsize * m_ysize * size);
+			if (narrowed)
+				bts->set_value(widened());
+			else
+				bts->set_value(m_array_i1, m_xsize * m_ysize * size);
 			binary->set_allocated_data(bts);
 		}
 		else {
 			binary->set_allocated_iszipped(createProtobufObject(true));
+			binary->set_codec((WISE::GridProto::ZipCodec)codec);
 			auto bts = new google::protobuf::BytesValue();
-			bts->set_value(Compress::compress(reinterpret_cast<const char*>(m_array_i1), m_xsize * m_ysize * size));
+			if (narrowed)
+				m_dataBlob.compress(widened, codec, bts->mutable_value());
+			else
+				m_dataBlob.compress(reinterpret_cast<const char*>(m_array_i1), m_xsize * m_ysize * size, codec, bts->mutable_value());
 			binary->set_allocated_data(bts);
 		}
 	}
 
-	if (m_array_nodata) {
+	if ((m_array_nodata) || ((m_sparse) && (m_sparse->hasNodata()))) {
+		auto expanded = [this]() -> std::string {
+			std::string data((std::size_t)m_xsize * (std::size_t)m_ysize, '\0');
+			m_sparse->expand(nullptr, reinterpret_cast<bool *>(&data[0]));
+			return data;
+		};
 		if (options.useVerboseOutput() || !options.zipOutput()) {
 			auto bts = new google::protobuf::BytesValue();
-			bts->set_value(m_array_nodata, m_xsize * m_ysize);
+			if (m_sparse)
+				bts->set_value(expanded());
+			else
+				bts->set_value(m_array_nodata, m_xsize * m_ysize);
 			binary->set_allocated_nodata(bts);
 		}
 		else {
 			binary->set_allocated_iszipped(createProtobufObject(true));
+			binary->set_codec((WISE::GridProto::ZipCodec)codec);
 			auto bts = new google::protobuf::BytesValue();
-			bts->set_value(Compress::compress(reinterpret_cast<const char*>(m_array_nodata), m_xsize * m_ysize));
+			if (m_sparse)
+				m_nodataBlob.compress(expanded, codec, bts->mutable_value());
+			else
+				m_nodataBlob.compress(reinterpret_cast<const char*>(m_array_nodata), m_xsize * m_ysize, codec, bts->mutable_value());
 			binary->set_allocated_nodata(bts);
 		}
 	}
@@ -543,7 +694,191 @@ WISE::GridProto::CwfgmAttributeFilter *CCWFGM_AttributeFilter::serialize(const S
 }
 
 
+HRESULT CCWFGM_AttributeFilter::GetTile(GridTile *tile) {
+	if (!tile)
+		return E_POINTER;
+
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+	if (!m_tile.has_value())
+		return S_FALSE;
+	*tile = m_tile.value();
+	tile->xllcorner = m_xllcorner;
+	tile->yllcorner = m_yllcorner;
+	tile->resolution = m_resolution;
+	return S_OK;
+}
+
+
+WISE::GridProto::CwfgmAttributeFilter *CCWFGM_AttributeFilter::serializeTile(const SerializeProtoOptions& options, const GridTile &tile) {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+
+	if ((m_xllcorner == -999999999.0) || (m_yllcorner == -999999999.0) || (m_xsize == (std::uint16_t)-1) || (m_ysize == (std::uint16_t)-1))
+		return nullptr;
+	if ((m_flags & CCWFGMGRID_NATIVE_RESOLUTION) || (fabs(m_resolution - tile.resolution) > 0.000001))
+		return nullptr;
+
+	// the tile in this filter's cells, clipped to the filter
+	const double iresolution = 1.0 / m_resolution;
+	const std::int32_t x = (std::int32_t)floor((tile.xllcorner - m_xllcorner) * iresolution + 0.5),
+					   y = (std::int32_t)floor((tile.yllcorner - m_yllcorner) * iresolution + 0.5);
+	const std::int32_t x0 = std::max(x, 0), y0 = std::max(y, 0),
+					   x1 = std::min(x + (std::int32_t)tile.xsize, (std::int32_t)m_xsize),
+					   y1 = std::min(y + (std::int32_t)tile.ysize, (std::int32_t)m_ysize);
+	if ((x1 <= x0) || (y1 <= y0))
+		return nullptr;
+
+	loadDeferred();
+	const std::uint32_t size = typeSize(m_storageType);
+
+	// a sparse array is cropped from a temporary dense copy
+	const std::int8_t *array = m_array_i1;
+	const bool *nodata = m_array_nodata;
+	std::unique_ptr<std::int8_t[]> values;
+	std::unique_ptr<bool[]> flags;
+	if (m_sparse) {
+		values.reset(new (std::nothrow) std::int8_t[(std::size_t)m_xsize * (std::size_t)m_ysize * size]);
+		if (m_sparse->hasNodata())
+			flags.reset(new (std::nothrow) bool[(std::size_t)m_xsize * (std::size_t)m_ysize]);
+		if ((!values) || ((m_sparse->hasNodata()) && (!flags)))
+			return nullptr;
+		m_sparse->expand(values.get(), flags.get());
+		array = values.get();
+		nodata = flags.get();
+	}
+
+	// a stand-alone filter holding just the tile, so it serializes exactly like a whole filter does
+	boost::intrusive_ptr<CCWFGM_AttributeFilter> t(new CCWFGM_AttributeFilter());
+	t->m_xsize = (std::uint16_t)(x1 - x0);
+	t->m_ysize = (std::uint16_t)(y1 - y0);
+	t->m_resolution = m_resolution;
+	t->m_iresolution = iresolution;
+	t->m_xllcorner = m_xllcorner + x0 * m_resolution;
+	t->m_yllcorner = m_yllcorner + y0 * m_resolution;
+	t->m_optionKey = m_optionKey;
+	t->m_optionType = m_optionType;
+	t->bindAccessors(m_storageType, m_storageScale);
+	if ((array) && (size)) {
+		if (!(t->m_array_i1 = (std::int8_t *)malloc((size_t)t->m_xsize * (size_t)t->m_ysize * size)))
+			return nullptr;
+		CropGridArray(array, m_xsize, m_ysize, (std::uint16_t)x0, (std::uint16_t)y0, t->m_xsize, t->m_ysize, size, t->m_array_i1);
+	}
+	if (nodata) {
+		if (!(t->m_array_nodata = (bool *)malloc((size_t)t->m_xsize * (size_t)t->m_ysize * sizeof(bool))))
+			return nullptr;
+		CropGridArray(nodata, m_xsize, m_ysize, (std::uint16_t)x0, (std::uint16_t)y0, t->m_xsize, t->m_ysize, sizeof(bool), t->m_array_nodata);
+	}
+
+	auto filter = t->serialize(options);
+
+	auto proto = new WISE::GridProto::GridTile();
+	proto->set_column(tile.column);
+	proto->set_row(tile.row);
+	proto->set_xoffset(tile.x + (x0 - x));
+	proto->set_yoffset(tile.y + (y0 - y));
+	proto->set_corexoffset(tile.coreX);
+	proto->set_coreyoffset(tile.coreY);
+	proto->set_corexsize(tile.coreXSize);
+	proto->set_coreysize(tile.coreYSize);
+	proto->set_fullxsize(tile.fullXSize);
+	proto->set_fullysize(tile.fullYSize);
+	filter->mutable_binary()->set_allocated_tile(proto);
+	return filter;
+}
+
+
+// Decompresses a serialized array into a new malloc()'d buffer of length bytes.  Chunked blobs are decompressed in place, so
+// only the compressed and decompressed copies of the array are held at once.  Throws if the blob is corrupt or doesn't hold
+// exactly length bytes.
+static void *decompressArray(const std::string &blob, GridChunkedCompress::Codec codec, size_t length) {
+	void *array = malloc(length ? length : 1);
+	if (!array)
+		throw std::bad_alloc();
+	try {
+		if (GridChunkedCompress::decompress(blob, array, length, codec) != length)
+			throw std::runtime_error("WISE.GridProto.CwfgmAttributeFilter: Array size doesn't match the grid");
+	}
+	catch (...) {
+		free(array);
+		throw;
+	}
+	return array;
+}
+
+
+/*!
+Decompresses the arrays kept by deserialize().  Throws if either blob is corrupt or the wrong size, leaving no arrays behind.
+*/
+void CCWFGM_AttributeFilter::decodeDeferred() {
+	const size_t cells = (size_t)m_xsize * (size_t)m_ysize;
+	try {
+		auto decompress = [](size_t length) {
+			return [length](const std::string &blob, GridChunkedCompress::Codec codec) { return decompressArray(blob, codec, length); };
+		};
+		if (!m_dataBlob.empty())
+			m_array_i1 = (std::int8_t *)m_dataBlob.read(decompress(cells * typeSize(m_optionType)));
+		if (!m_nodataBlob.empty())
+			m_array_nodata = (bool *)m_nodataBlob.read(decompress(cells * sizeof(bool)));
+	}
+	catch (...) {
+		if (m_array_i1) {
+			free(m_array_i1);
+			m_array_i1 = nullptr;
+		}
+		if (m_array_nodata) {
+			free(m_array_nodata);
+			m_array_nodata = nullptr;
+		}
+		throw;
+	}
+	compactStorage();
+}
+
+
+/*!
+Decompresses the arrays kept by deserialize(), on the first call which needs them.  Safe to call concurrently, and cheap once
+the arrays have been decoded.  The compressed blobs are retained so an unchanged filter is not recompressed by serialize().
+*/
+void CCWFGM_AttributeFilter::loadDeferred() {
+	if (!m_deferred.load(std::memory_order_acquire))
+		return;
+
+	CThreadSemaphoreEngage deferred(&m_deferredLock, SEM_TRUE);
+	if (!m_deferred.load(std::memory_order_relaxed))
+		return;
+
+	// deserialize() has already checked the blobs' indexes against the grid size, so this only fails on damaged chunks
+	try {
+		decodeDeferred();
+	}
+	catch (std::bad_alloc &) {
+		m_loadWarning = "Error: WISE.GridProto.CwfgmAttributeFilter: No more memory";
+		m_dataBlob.invalidate();
+		m_nodataBlob.invalidate();
+	}
+	catch (std::exception &) {
+		m_loadWarning = "Error: WISE.GridProto.CwfgmAttributeFilter: Invalid data in imported file.";
+		m_dataBlob.invalidate();
+		m_nodataBlob.invalidate();
+	}
+
+	m_deferred.store(false, std::memory_order_release);
+}
+
+
+/*!
+Drops the retained compressed arrays, for callers which have changed or are about to replace the arrays.
+*/
+void CCWFGM_AttributeFilter::discardDeferred() {
+	CThreadSemaphoreEngage deferred(&m_deferredLock, SEM_TRUE);
+	m_dataBlob.invalidate();
+	m_nodataBlob.invalidate();
+	m_deferred = false;
+}
+
+
 CCWFGM_AttributeFilter *CCWFGM_AttributeFilter::deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE);
+
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine;
 	if (!(gridEngine = m_gridEngine(nullptr))) {
 		if (valid)
@@ -590,28 +925,44 @@ CCWFGM_AttributeFilter *CCWFGM_AttributeFilter::deserialize(const google::protob
 
 		m_xsize = filter->binary().xsize();
 		m_ysize = filter->binary().ysize();
+		size_t dataLength = (size_t)-1, nodataLength = (size_t)-1;		// of arrays which weren't zipped, checked once the type is known
+
+		discardDeferred();
+		if (filter->binary().has_iszipped() && filter->binary().iszipped().value()) {
+			if (!GridChunkedCompress::isCodec(filter->binary().codec())) {
+				if (v2)
+					/// <summary>
+					/// The attribute data was compressed with a codec this version doesn't support.
+					/// </summary>
+					/// <type>user</type>
+					v2->add_child_validation("WISE.GridProto.ZipCodec", "codec", validation::error_level::SEVERE,
+						validation::id::enum_invalid, std::to_string(filter->binary().codec()));
+				m_loadWarning = "Error: WISE.GridProto.CwfgmAttributeFilter: Unsupported compression in imported file.";
+				throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmAttributeFilter: Unsupported compression in imported file.");
+			}
+			const GridChunkedCompress::Codec codec = GridChunkedCompress::toCodec(filter->binary().codec());
 
-		if (filter->binary().has_data()) {
-			if (m_array_i1)
-				free(m_array_i1);
-			if (filter->binary().has_iszipped() && filter->binary().iszipped().value()) {
-				std::string val = Compress::decompress(filter->binary().data().value());
-				m_array_i1 = (std::int8_t *)malloc(val.size());
-				if (!m_array_i1) {
-					if (valid)
-						/// <summary>
-						/// The process is out of memory.
-						/// </summary>
-						/// <type>internal</type>
-						valid->add_child_validation("CWFGM", name, validation::error_level::SEVERE,
-							validation::id::out_of_memory, std::to_string(val.size()));
-					weak_assert(false);
-					m_loadWarning = "Error: WISE.GridProto.CwfgmAttributeFilter: No more memory";
-					throw std::bad_alloc();
+			// the arrays are only decompressed when they are first used, see loadDeferred()
+			if (filter->binary().has_data()) {
+				if (m_array_i1) {
+					free(m_array_i1);
+					m_array_i1 = nullptr;
 				}
-				std::copy(val.begin(), val.end(), m_array_i1);
+				m_dataBlob.retain(filter->binary().data().value(), codec);
 			}
-			else {
+			if (filter->binary().has_nodata()) {
+				if (m_array_nodata) {
+					free(m_array_nodata);
+					m_array_nodata = nullptr;
+				}
+				m_nodataBlob.retain(filter->binary().nodata().value(), codec);
+			}
+			m_deferred = ((!m_dataBlob.empty()) || (!m_nodataBlob.empty()));
+		}
+		else {
+			if (filter->binary().has_data()) {
+				if (m_array_i1)
+					free(m_array_i1);
 				m_array_i1 = (std::int8_t *)malloc(filter->binary().data().value().length());
 				if (!m_array_i1) {
 					if (valid)
@@ -626,30 +977,12 @@ CCWFGM_AttributeFilter *CCWFGM_AttributeFilter::deserialize(const google::protob
 					throw std::bad_alloc();
 				}
 				std::copy(filter->binary().data().value().begin(), filter->binary().data().value().end(), m_array_i1);
+				dataLength = filter->binary().data().value().length();
 			}
-		}
 
-		if (filter->binary().has_nodata()) {
-			if (m_array_nodata)
-				free(m_array_nodata);
-			if (filter->binary().has_iszipped() && filter->binary().iszipped().value()) {
-				std::string val = Compress::decompress(filter->binary().nodata().value());
-				m_array_nodata = (bool *)malloc(val.size() * sizeof(bool));
-				if (!m_array_nodata) {
-					if (valid)
-						/// <summary>
-						/// The process is out of memory.
-						/// </summary>
-						/// <type>internal</type>
-						valid->add_child_validation("CWFGM", name, validation::error_level::SEVERE,
-							validation::id::out_of_memory, std::to_string(val.size()));
-					weak_assert(false);
-					m_loadWarning = "Error: WISE.GridProto.CwfgmAttributeFilter: No more memory";
-					throw std::bad_alloc();
-				}
-				std::copy(val.begin(), val.end(), m_array_nodata);
-			}
-			else {
+			if (filter->binary().has_nodata()) {
+				if (m_array_nodata)
+					free(m_array_nodata);
 				m_array_nodata = (bool *)malloc(filter->binary().nodata().value().length() * sizeof(bool));
 				if (!m_array_nodata) {
 					if (valid)
@@ -664,21 +997,79 @@ CCWFGM_AttributeFilter *CCWFGM_AttributeFilter::deserialize(const google::protob
 					throw std::bad_alloc();
 				}
 				std::copy(filter->binary().nodata().value().begin(), filter->binary().nodata().value().end(), m_array_nodata);
+				nodataLength = filter->binary().nodata().value().length();
 			}
 		}
 
+		m_sampling = (filter->binary().sampling() == WISE::GridProto::CwfgmAttributeFilter_Sampling_BILINEAR) ? CWFGM_GRID_SAMPLING_BILINEAR : CWFGM_GRID_SAMPLING_NEAREST;
+		if (filter->binary().has_narrowstorage()) {			// otherwise keep whatever was set before loading
+			if (filter->binary().narrowstorage())
+				m_flags |= CCWFGMGRID_NARROW_STORAGE;
+			else
+				m_flags &= (~(CCWFGMGRID_NARROW_STORAGE));
+		}
+		if (filter->binary().has_sparsestorage()) {
+			if (filter->binary().sparsestorage())
+				m_flags |= CCWFGMGRID_SPARSE_STORAGE;
+			else
+				m_flags &= (~(CCWFGMGRID_SPARSE_STORAGE));
+		}
 		if (filter->binary().has_xllcorner() && filter->binary().has_yllcorner() && filter->binary().has_resolution()) {
 			m_xllcorner = DoubleBuilder().withProtobuf(filter->binary().xllcorner()).getValue();
 			m_yllcorner = DoubleBuilder().withProtobuf(filter->binary().yllcorner()).getValue();
 			m_resolution = DoubleBuilder().withProtobuf(filter->binary().resolution()).getValue();
 			m_iresolution = 1.0 / m_resolution;
+			if (filter->binary().nativeresolution()) {
+				m_flags |= CCWFGMGRID_NATIVE_RESOLUTION;
+				if (m_gridEngine(nullptr))
+					fixResolution(nullptr, name);			// only picks up the grid's geometry to sample at, PutGridEngine() does it otherwise
+			}
+			else
+				m_flags &= (~(CCWFGMGRID_NATIVE_RESOLUTION));
 		}
 		else {
+			m_flags &= (~(CCWFGMGRID_NATIVE_RESOLUTION));
 			HRESULT hr;
 			if (FAILED(hr = fixResolution(valid, name))) {
 				throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmAttributeFilter: Incomplete initialization");
 			}
 		}
+		if (filter->binary().has_tile()) {
+			const auto &tile = filter->binary().tile();
+			if ((tile.xoffset() + m_xsize > tile.fullxsize()) || (tile.yoffset() + m_ysize > tile.fullysize()) ||
+			    (tile.corexoffset() < tile.xoffset()) || (tile.coreyoffset() < tile.yoffset()) ||
+			    (tile.corexoffset() + tile.corexsize() > tile.xoffset() + m_xsize) ||
+			    (tile.coreyoffset() + tile.coreysize() > tile.yoffset() + m_ysize) || (tile.fullxsize() >= 65535) || (tile.fullysize() >= 65535)) {
+				if (valid)
+					/// <summary>
+					/// The tile doesn't fit in the grid it claims to have been cut from, or its core doesn't fit in the tile.
+					/// </summary>
+					/// <type>user</type>
+					valid->add_child_validation("WISE.GridProto.GridTile", "tile", validation::error_level::SEVERE, validation::id::value_invalid,
+						strprintf("%d, %d", (int)tile.column(), (int)tile.row()));
+				m_loadWarning = "Error: WISE.GridProto.CwfgmAttributeFilter: Invalid tile in imported file.";
+				throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmAttributeFilter: Invalid tile in imported file.");
+			}
+			GridTile t;
+			t.column = (std::uint16_t)tile.column();
+			t.row = (std::uint16_t)tile.row();
+			t.x = (std::uint16_t)tile.xoffset();
+			t.y = (std::uint16_t)tile.yoffset();
+			t.xsize = m_xsize;
+			t.ysize = m_ysize;
+			t.coreX = (std::uint16_t)tile.corexoffset();
+			t.coreY = (std::uint16_t)tile.coreyoffset();
+			t.coreXSize = (std::uint16_t)tile.corexsize();
+			t.coreYSize = (std::uint16_t)tile.coreysize();
+			t.fullXSize = (std::uint16_t)tile.fullxsize();
+			t.fullYSize = (std::uint16_t)tile.fullysize();
+			t.xllcorner = m_xllcorner;
+			t.yllcorner = m_yllcorner;
+			t.resolution = m_resolution;
+			m_tile = t;
+		}
+		else
+			m_tile.reset();
 		if (filter->has_binary()) {
 			if (filter->binary().has_key())
 				m_optionKey = filter->binary().key().value();
@@ -736,6 +1127,57 @@ CCWFGM_AttributeFilter *CCWFGM_AttributeFilter::deserialize(const google::protob
 
 			break;
 		}
+		m_sparse.reset();
+		bindAccessors(m_optionType, 1.0);
+
+		// only the decompression is deferred: the array sizes are checked now, so a damaged or truncated file still fails to load
+		const size_t cells = (size_t)m_xsize * (size_t)m_ysize;
+		bool sized = (((dataLength == (size_t)-1) || (dataLength == cells * typeSize(m_optionType))) &&
+					  ((nodataLength == (size_t)-1) || (nodataLength == cells * sizeof(bool))));
+		if ((sized) && (m_deferred)) {
+			try {
+				auto length = [](const std::string &blob, GridChunkedCompress::Codec) { return blob.length() ? GridChunkedCompress::decompressedLength(blob) : (size_t)0; };
+				const size_t data = m_dataBlob.read(length),
+							 nodata = m_nodataBlob.read(length);
+				if ((data == (size_t)-1) || (nodata == (size_t)-1)) {
+					decodeDeferred();						// a single blob only knows its size once it's decompressed
+					m_deferred = false;
+				}
+				else
+					sized = (((m_dataBlob.empty()) || (data == cells * typeSize(m_optionType))) &&
+							 ((m_nodataBlob.empty()) || (nodata == cells * sizeof(bool))));
+			}
+			catch (std::bad_alloc &) {
+				discardDeferred();
+				m_loadWarning = "Error: WISE.GridProto.CwfgmAttributeFilter: No more memory";
+				throw;
+			}
+			catch (std::exception &) {
+				sized = false;
+			}
+		}
+		else if (sized)
+			compactStorage();
+		if (!sized) {
+			discardDeferred();
+			if (m_array_i1) {
+				free(m_array_i1);
+				m_array_i1 = nullptr;
+			}
+			if (m_array_nodata) {
+				free(m_array_nodata);
+				m_array_nodata = nullptr;
+			}
+			if (v2)
+				/// <summary>
+				/// The attribute data is corrupt, or doesn't match the size of the grid.
+				/// </summary>
+				/// <type>user</type>
+				v2->add_child_validation("WISE.GridProto.CwfgmAttributeFilter.Binary", "data", validation::error_level::SEVERE,
+					validation::id::parse_invalid, std::to_string(m_xsize) + "x" + std::to_string(m_ysize));
+			m_loadWarning = "Error: WISE.GridProto.CwfgmAttributeFilter: Invalid data in imported file.";
+			throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmAttributeFilter: Invalid data in imported file.");
+		}
 	}
 	else if (filter->data_case() == WISE::GridProto::CwfgmAttributeFilter::kFile) {
 	/* done in the client code
@@ -25,6 +25,11 @@
 #include <stdio.h>
 #include <cpl_string.h>
 #include "CoordinateConverter.h"
+#include "GridAttributeArray.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
 
 /////////////////////////////////////////////////////////////////////////////
 // CWFGM_AttributeFilter
@@ -36,11 +41,16 @@ CCWFGM_AttributeFilter::CCWFGM_AttributeFilter() {
 	m_xsize = m_ysize = (std::uint16_t)-1;
 	m_iresolution = m_resolution = -1.0;
 	m_xllcorner = m_yllcorner = -999999999.0;
+	m_gridResolution = -1.0;
+	m_gridXLLCorner = m_gridYLLCorner = -999999999.0;
+	m_sampling = CWFGM_GRID_SAMPLING_NEAREST;
 	m_flags = 0;
 	m_optionKey = (std::uint16_t)-1;
 	m_optionType = VT_EMPTY;
+	bindAccessors(VT_EMPTY, 1.0);
 	m_array_i1 = nullptr;
 	m_array_nodata = nullptr;
+	m_deferred = false;
 	m_bRequiresSave = false;
 }
 
@@ -54,47 +64,44 @@ CCWFGM_AttributeFilter::CCWFGM_AttributeFilter(const CCWFGM_AttributeFilter &toC
 	m_iresolution = toCopy.m_iresolution;
 	m_xllcorner = toCopy.m_xllcorner;
 	m_yllcorner = toCopy.m_yllcorner;
+	m_gridResolution = toCopy.m_gridResolution;
+	m_gridXLLCorner = toCopy.m_gridXLLCorner;
+	m_gridYLLCorner = toCopy.m_gridYLLCorner;
+	m_sampling = toCopy.m_sampling;
 	m_flags = toCopy.m_flags;
 	m_optionKey = toCopy.m_optionKey;
 	m_optionType = toCopy.m_optionType;
+	m_sparse = toCopy.m_sparse;					// shared until either filter changes a cell, see setPointDensify()
+	bindAccessors(toCopy.m_storageType, toCopy.m_storageScale);
 
 	m_gisURL = toCopy.m_gisURL;
 	m_gisLayer = toCopy.m_gisLayer;
 	m_gisUID = toCopy.m_gisUID;
 	m_gisPWD = toCopy.m_gisPWD;
+	m_tile = toCopy.m_tile;
 
 	std::uint16_t size = 0;
-	if (toCopy.m_array_i1) {
-		switch (m_optionType) {
-		case VT_BOOL:
-		case VT_I1:
-		case VT_UI1:	size = 1; break;
-		case VT_I2:
-		case VT_UI2:	size = 2; break;
-		case VT_I4:
-		case VT_UI4:
-		case VT_R4:		size = 4; break;
-		case VT_I8:
-		case VT_UI8:
-		case VT_R8:		size = 8; break;
-		}
-	}
+	if (toCopy.m_array_i1)
+		size = (std::uint16_t)typeSize(m_storageType);
 	if (size) {
 		m_array_i1 = (int8_t *)malloc((size_t)m_xsize * (size_t)m_ysize * (size_t)size);
 		if (m_array_i1) {
-			memcpy(m_array_i1, toCopy.m_array_i1, (size_t)m_xsize * (size_t)m_ysize * (size_t)size);
-			if (toCopy.m_array_nodata) {
+			if (toCopy.m_array_nodata)
 				m_array_nodata = (bool*)malloc((size_t)m_xsize * (size_t)m_ysize * sizeof(bool));
-				if (m_array_nodata)
-					memcpy(m_array_nodata, toCopy.m_array_nodata, (size_t)m_xsize * (size_t)m_ysize * sizeof(bool));
-			} else
+			else
 				m_array_nodata = nullptr;
+			CopyAttributeArray(m_array_i1, toCopy.m_array_i1, size, m_array_nodata, toCopy.m_array_nodata, m_xsize, m_ysize);
 		}
 	}
 	else {
 		m_array_i1 = nullptr;
 		m_array_nodata = nullptr;
 	}
+
+	CThreadSemaphoreEngage deferred((CThreadSemaphore *)&toCopy.m_deferredLock, SEM_TRUE);
+	m_dataBlob = toCopy.m_dataBlob;
+	m_nodataBlob = toCopy.m_nodataBlob;
+	m_deferred = toCopy.m_deferred.load();
 	m_bRequiresSave = false;
 }
 
@@ -154,16 +161,20 @@ HRESULT CCWFGM_AttributeFilter::SetAttributePoint(const XY_Point &pt, const Nume
 	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
 	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
 
+	loadDeferred();
+
 	std::uint16_t x = convertX(pt.x, nullptr);
 	std::uint16_t y = convertY(pt.y, nullptr);
 	if (!m_gridEngine(nullptr))					{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
 	if (x >= m_xsize)							return ERROR_GRID_LOCATION_OUT_OF_RANGE;
 	if (y >= m_ysize)							return ERROR_GRID_LOCATION_OUT_OF_RANGE;
-	if (!m_array_i1)							return ERROR_SEVERITY_WARNING;
+	if ((!m_array_i1) && (!m_sparse))			return ERROR_SEVERITY_WARNING;
 
 	HRESULT hr = setPoint(x, y, value);
-	if (SUCCEEDED(hr))
+	if (SUCCEEDED(hr)) {
+		discardDeferred();
 		m_bRequiresSave = true;
+	}
 	return hr;
 }
 
@@ -184,24 +195,7 @@ HRESULT CCWFGM_AttributeFilter::setPoint(const std::uint16_t x, const std::uint1
 
 
 HRESULT CCWFGM_AttributeFilter::setPoint(const std::uint32_t index, const NumericVariant &value) {
-	bool hr;
-	switch (m_optionType) {
-		case VT_I1:		hr = variantToInt8(value, &m_array_i1[index]); break;
-		case VT_I2:		hr = variantToInt16(value, &m_array_i2[index]); break;
-		case VT_I4:		hr = variantToInt32(value, &m_array_i4[index]); break;
-		case VT_I8:		hr = variantToInt64(value, &m_array_i8[index]); break;
-		case VT_UI1:	hr = variantToUInt8(value, &m_array_ui1[index]); break;
-		case VT_UI2:	hr = variantToUInt16(value, &m_array_ui2[index]); break;
-		case VT_UI4:	hr = variantToUInt32(value, &m_array_ui4[index]); break;
-		case VT_UI8:	hr = variantToUInt64(value, &m_array_ui8[index]); break;
-		case VT_R4:		hr = variantToFloat(value, &m_array_r4[index]); break;
-		case VT_R8:		hr = variantToDouble(value, &m_array_r8[index]); break;
-		case VT_BOOL: { bool b; hr = variantToBoolean(value, &b); if (hr) m_array_i1[index] = b ? 1 : 0; } break;
-		default:		return E_UNEXPECTED;
-	}
-	if (m_array_nodata)
-		m_array_nodata[index] = false;
-	return hr ? S_OK : S_FALSE;
+	return (this->*m_setPoint)(index, value);
 }
 
 
@@ -227,23 +221,541 @@ HRESULT CCWFGM_AttributeFilter::getPoint(const std::uint32_t index, NumericVaria
 			return ERROR_GRID_NO_DATA;
 		}
 	}
-	if (m_array_i1) {
+	if ((m_array_i1) || (m_sparse))
+		return (this->*m_getPoint)(index, value, value_valid);
+	return ERROR_GRID_NO_DATA;
+}
+
+
+/*!
+Returns the value for the grid engine's cell containing pt, when this filter keeps its own resolution (CCWFGMGRID_NATIVE_RESOLUTION).  The filter is
+sampled at the centre of that cell, so point and array queries agree and the value is constant across the cell.
+*/
+HRESULT CCWFGM_AttributeFilter::samplePoint(const XY_Point &pt, NumericVariant *value, grid::AttributeValue *value_valid) {
+	if (m_gridResolution <= 0.0)				{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+	const double x = (floor((pt.x - m_gridXLLCorner) / m_gridResolution) + 0.5) * m_gridResolution + m_gridXLLCorner,
+				 y = (floor((pt.y - m_gridYLLCorner) / m_gridResolution) + 0.5) * m_gridResolution + m_gridYLLCorner;
+	return sampleCell(x, y, value, value_valid);
+}
+
+
+/*!
+Samples the array at (x, y) as set by m_sampling.  Bilinear sampling weighs the (up to) 4 nearest cell centres, leaving out any outside the array or
+with no data, and only applies to floating point types; anything else is sampled nearest.  Cells which have no data themselves stay that way.
+*/
+HRESULT CCWFGM_AttributeFilter::sampleCell(double x, double y, NumericVariant *value, grid::AttributeValue *value_valid) {
+	const double fx = (x - m_xllcorner) / m_resolution, fy = (y - m_yllcorner) / m_resolution;
+	if ((!(fx >= 0.0)) || (!(fy >= 0.0)) || (fx >= (double)m_xsize) || (fy >= (double)m_ysize)) {
+		*value = NumericVariant();
+		*value_valid = grid::AttributeValue::NOT_SET;
+		return ERROR_GRID_LOCATION_OUT_OF_RANGE;
+	}
+
+	HRESULT hr = getPoint((std::uint16_t)fx, (std::uint16_t)fy, value, value_valid);
+	if ((FAILED(hr)) || (*value_valid == grid::AttributeValue::NOT_SET) || (m_sampling != CWFGM_GRID_SAMPLING_BILINEAR) ||
+	    ((m_optionType != VT_R4) && (m_optionType != VT_R8)))
+		return hr;
+
+	const double cx = fx - 0.5, cy = fy - 0.5;
+	const std::int32_t x0 = (std::int32_t)floor(cx), y0 = (std::int32_t)floor(cy);
+	const double tx = cx - x0, ty = cy - y0;
+	double sum = 0.0, weight = 0.0;
+	for (std::int32_t j = 0; j < 2; j++) {
+		const std::int32_t yy = y0 + j;
+		const double wy = j ? ty : (1.0 - ty);
+		if ((yy < 0) || (yy >= m_ysize) || (wy == 0.0))
+			continue;
+		for (std::int32_t i = 0; i < 2; i++) {
+			const std::int32_t xx = x0 + i;
+			const double w = wy * (i ? tx : (1.0 - tx));
+			if ((xx < 0) || (xx >= m_xsize) || (w == 0.0))
+				continue;
+			NumericVariant v;
+			grid::AttributeValue v_valid;
+			double d;
+			if ((SUCCEEDED(getPoint((std::uint16_t)xx, (std::uint16_t)yy, &v, &v_valid))) && (v_valid != grid::AttributeValue::NOT_SET) &&
+			    (variantToDouble(v, &d))) {
+				sum += w * d;
+				weight += w;
+			}
+		}
+	}
+	if (weight > 0.0) {
+		if (m_optionType == VT_R4)
+			*value = (float)(sum / weight);
+		else
+			*value = sum / weight;
+	}
+	return hr;
+}
+
+
+static inline bool variantTo(const NumericVariant &value, std::int8_t *v)		{ return variantToInt8(value, v); }
+static inline bool variantTo(const NumericVariant &value, std::int16_t *v)		{ return variantToInt16(value, v); }
+static inline bool variantTo(const NumericVariant &value, std::int32_t *v)		{ return variantToInt32(value, v); }
+static inline bool variantTo(const NumericVariant &value, std::int64_t *v)		{ return variantToInt64(value, v); }
+static inline bool variantTo(const NumericVariant &value, std::uint8_t *v)		{ return variantToUInt8(value, v); }
+static inline bool variantTo(const NumericVariant &value, std::uint16_t *v)		{ return variantToUInt16(value, v); }
+static inline bool variantTo(const NumericVariant &value, std::uint32_t *v)		{ return variantToUInt32(value, v); }
+static inline bool variantTo(const NumericVariant &value, std::uint64_t *v)		{ return variantToUInt64(value, v); }
+static inline bool variantTo(const NumericVariant &value, float *v)				{ return variantToFloat(value, v); }
+static inline bool variantTo(const NumericVariant &value, double *v)			{ return variantToDouble(value, v); }
+
+
+template<typename S>
+static inline bool variantToElement(const NumericVariant &value, std::uint8_t *element) {
+	S v;
+	if (!variantTo(value, &v))
+		return false;
+	memcpy(element, &v, sizeof(S));
+	return true;
+}
+
+
+/*!
+Converts value to an element of an array of type, as the cell setters store it.
+*/
+static bool variantToElement(std::uint16_t type, const NumericVariant &value, std::uint8_t *element) {
+	switch (type) {
+		case CCWFGM_AttributeFilter::VT_BOOL: {
+										bool b;
+										if (!variantToBoolean(value, &b))
+											return false;
+										*element = b ? 1 : 0;
+										return true;
+									}
+		case CCWFGM_AttributeFilter::VT_I1:		return variantToElement<std::int8_t>(value, element);
+		case CCWFGM_AttributeFilter::VT_I2:		return variantToElement<std::int16_t>(value, element);
+		case CCWFGM_AttributeFilter::VT_I4:		return variantToElement<std::int32_t>(value, element);
+		case CCWFGM_AttributeFilter::VT_I8:		return variantToElement<std::int64_t>(value, element);
+		case CCWFGM_AttributeFilter::VT_UI1:	return variantToElement<std::uint8_t>(value, element);
+		case CCWFGM_AttributeFilter::VT_UI2:	return variantToElement<std::uint16_t>(value, element);
+		case CCWFGM_AttributeFilter::VT_UI4:	return variantToElement<std::uint32_t>(value, element);
+		case CCWFGM_AttributeFilter::VT_UI8:	return variantToElement<std::uint64_t>(value, element);
+		case CCWFGM_AttributeFilter::VT_R4:		return variantToElement<float>(value, element);
+		case CCWFGM_AttributeFilter::VT_R8:		return variantToElement<double>(value, element);
+	}
+	return false;
+}
+
+
+template<typename S, typename L, bool Sparse>
+HRESULT CCWFGM_AttributeFilter::getPointAs(const std::uint32_t index, NumericVariant *value, grid::AttributeValue *value_valid) {
+	const S *v;
+	if constexpr (Sparse) {
+		if (!(v = reinterpret_cast<const S *>(m_sparse->cell(index)))) {
+			*value = NumericVariant();
+			*value_valid = grid::AttributeValue::NOT_SET;
+			return ERROR_GRID_NO_DATA;
+		}
+	}
+	else
+		v = reinterpret_cast<const S *>(m_array_i1) + index;
+
+	*value_valid = grid::AttributeValue::SET;
+	if constexpr (std::is_same_v<L, bool>)
+		*value = *v ? true : false;
+	else
+		*value = WidenAttributeValue<S, L>(*v, m_storageScale);
+	return S_OK;
+}
+
+
+template<typename S>
+HRESULT CCWFGM_AttributeFilter::setPointAs(const std::uint32_t index, const NumericVariant &value) {
+	bool hr = variantTo(value, &reinterpret_cast<S *>(m_array_i1)[index]);
+	if (m_array_nodata)
+		m_array_nodata[index] = false;
+	return hr ? S_OK : S_FALSE;
+}
+
+
+HRESULT CCWFGM_AttributeFilter::setPointAsBool(const std::uint32_t index, const NumericVariant &value) {
+	bool b;
+	bool hr = variantToBoolean(value, &b);
+	if (hr)
+		m_array_i1[index] = b ? 1 : 0;
+	if (m_array_nodata)
+		m_array_nodata[index] = false;
+	return hr ? S_OK : S_FALSE;
+}
+
+
+HRESULT CCWFGM_AttributeFilter::getPointUnexpected(const std::uint32_t /*index*/, NumericVariant * /*value*/, grid::AttributeValue * /*value_valid*/) {
+	return E_UNEXPECTED;
+}
+
+
+HRESULT CCWFGM_AttributeFilter::setPointUnexpected(const std::uint32_t /*index*/, const NumericVariant & /*value*/) {
+	return E_UNEXPECTED;
+}
+
+
+/*!
+Setter for a narrowed array: the new value may not fit in the narrower type, so the array goes back to OptionType first.
+*/
+HRESULT CCWFGM_AttributeFilter::setPointWiden(const std::uint32_t index, const NumericVariant &value) {
+	if (!widenStorage())
+		return E_OUTOFMEMORY;
+	return (this->*m_setPoint)(index, value);
+}
+
+
+/*!
+Setter for a sparse array: only the tile holding the cell is expanded (see GridSparseArray::setCell()), so the rest of the array stays
+sparse.  A sparse array which is also narrowed goes back to a dense array in OptionType first, as in setPointWiden().
+*/
+HRESULT CCWFGM_AttributeFilter::setPointDensify(const std::uint32_t index, const NumericVariant &value) {
+	if (m_storageType != m_optionType) {
+		if (!widenStorage())
+			return E_OUTOFMEMORY;
+		return (this->*m_setPoint)(index, value);
+	}
+
+	std::uint8_t element[8];
+	if (!variantToElement(m_optionType, value, element))
+		return S_FALSE;
+	if (m_sparse.use_count() > 1) {				// shared with a copy of this filter, which keeps the original
+		std::shared_ptr<GridSparseArray> sparse = m_sparse->clone();
+		if (!sparse)
+			return E_OUTOFMEMORY;
+		m_sparse = sparse;
+	}
+	if (!m_sparse->setCell(index, element))
+		return E_OUTOFMEMORY;
+	return S_OK;
+}
+
+
+template<typename L, bool Sparse>
+void CCWFGM_AttributeFilter::bindNarrowedGetter() {
+	switch (m_storageType) {
+		case VT_I1:		m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::int8_t, L, Sparse>; break;
+		case VT_UI1:	m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::uint8_t, L, Sparse>; break;
+		case VT_I2:		m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::int16_t, L, Sparse>; break;
+		case VT_UI2:	m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::uint16_t, L, Sparse>; break;
+		case VT_I4:		m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::int32_t, L, Sparse>; break;
+		default:		weak_assert(false); m_getPoint = &CCWFGM_AttributeFilter::getPointUnexpected; break;
+	}
+}
+
+
+template<bool Sparse>
+void CCWFGM_AttributeFilter::bindGetter() {
+	if (m_storageType != m_optionType) {
 		switch (m_optionType) {
-			case VT_I1:	*value_valid = grid::AttributeValue::SET; *value = m_array_i1[index]; return S_OK;
-			case VT_I2:	*value_valid = grid::AttributeValue::SET; *value = m_array_i2[index]; return S_OK;
-			case VT_I4:	*value_valid = grid::AttributeValue::SET; *value = m_array_i4[index]; return S_OK;
-			case VT_I8:	*value_valid = grid::AttributeValue::SET; *value = m_array_i8[index]; return S_OK;
-			case VT_UI1:*value_valid = grid::AttributeValue::SET; *value = m_array_ui1[index]; return S_OK;
-			case VT_UI2:*value_valid = grid::AttributeValue::SET; *value = m_array_ui2[index]; return S_OK;
-			case VT_UI4:*value_valid = grid::AttributeValue::SET; *value = m_array_ui4[index]; return S_OK;
-			case VT_UI8:*value_valid = grid::AttributeValue::SET; *value = m_array_ui8[index]; return S_OK;
-			case VT_R4:	*value_valid = grid::AttributeValue::SET; *value = m_array_r4[index]; return S_OK;
-			case VT_R8:	*value_valid = grid::AttributeValue::SET; *value = m_array_r8[index]; return S_OK;
-			case VT_BOOL:*value_valid = grid::AttributeValue::SET;*value = m_array_i1[index] ? true : false; return S_OK;
-			default:	return E_UNEXPECTED;
+			case VT_I2:		bindNarrowedGetter<std::int16_t, Sparse>(); break;
+			case VT_I4:		bindNarrowedGetter<std::int32_t, Sparse>(); break;
+			case VT_I8:		bindNarrowedGetter<std::int64_t, Sparse>(); break;
+			case VT_UI2:	bindNarrowedGetter<std::uint16_t, Sparse>(); break;
+			case VT_UI4:	bindNarrowedGetter<std::uint32_t, Sparse>(); break;
+			case VT_UI8:	bindNarrowedGetter<std::uint64_t, Sparse>(); break;
+			case VT_R4:		bindNarrowedGetter<float, Sparse>(); break;
+			case VT_R8:		bindNarrowedGetter<double, Sparse>(); break;
+			default:		weak_assert(false); m_getPoint = &CCWFGM_AttributeFilter::getPointUnexpected; break;
 		}
+		return;
 	}
-	return ERROR_GRID_NO_DATA;
+
+	switch (m_optionType) {
+		case VT_I1:		m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::int8_t, std::int8_t, Sparse>; break;
+		case VT_I2:		m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::int16_t, std::int16_t, Sparse>; break;
+		case VT_I4:		m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::int32_t, std::int32_t, Sparse>; break;
+		case VT_I8:		m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::int64_t, std::int64_t, Sparse>; break;
+		case VT_UI1:	m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::uint8_t, std::uint8_t, Sparse>; break;
+		case VT_UI2:	m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::uint16_t, std::uint16_t, Sparse>; break;
+		case VT_UI4:	m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::uint32_t, std::uint32_t, Sparse>; break;
+		case VT_UI8:	m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::uint64_t, std::uint64_t, Sparse>; break;
+		case VT_R4:		m_getPoint = &CCWFGM_AttributeFilter::getPointAs<float, float, Sparse>; break;
+		case VT_R8:		m_getPoint = &CCWFGM_AttributeFilter::getPointAs<double, double, Sparse>; break;
+		case VT_BOOL:	m_getPoint = &CCWFGM_AttributeFilter::getPointAs<std::int8_t, bool, Sparse>; break;
+		default:		m_getPoint = &CCWFGM_AttributeFilter::getPointUnexpected; break;
+	}
+}
+
+
+/*!
+Binds the cell accessors for the array, held as storage_type (normally m_optionType, see narrowStorage()), densely or in m_sparse
+(see sparsifyStorage()).  Must be called whenever any of them change.
+*/
+void CCWFGM_AttributeFilter::bindAccessors(std::uint16_t storage_type, double storage_scale) {
+	m_storageType = storage_type;
+	m_storageScale = storage_scale;
+
+	if (m_sparse) {
+		bindGetter<true>();
+		m_setPoint = &CCWFGM_AttributeFilter::setPointDensify;
+		return;
+	}
+
+	bindGetter<false>();
+	if (m_storageType != m_optionType) {
+		m_setPoint = &CCWFGM_AttributeFilter::setPointWiden;
+		return;
+	}
+
+	switch (m_optionType) {
+		case VT_I1:		m_setPoint = &CCWFGM_AttributeFilter::setPointAs<std::int8_t>; break;
+		case VT_I2:		m_setPoint = &CCWFGM_AttributeFilter::setPointAs<std::int16_t>; break;
+		case VT_I4:		m_setPoint = &CCWFGM_AttributeFilter::setPointAs<std::int32_t>; break;
+		case VT_I8:		m_setPoint = &CCWFGM_AttributeFilter::setPointAs<std::int64_t>; break;
+		case VT_UI1:	m_setPoint = &CCWFGM_AttributeFilter::setPointAs<std::uint8_t>; break;
+		case VT_UI2:	m_setPoint = &CCWFGM_AttributeFilter::setPointAs<std::uint16_t>; break;
+		case VT_UI4:	m_setPoint = &CCWFGM_AttributeFilter::setPointAs<std::uint32_t>; break;
+		case VT_UI8:	m_setPoint = &CCWFGM_AttributeFilter::setPointAs<std::uint64_t>; break;
+		case VT_R4:		m_setPoint = &CCWFGM_AttributeFilter::setPointAs<float>; break;
+		case VT_R8:		m_setPoint = &CCWFGM_AttributeFilter::setPointAs<double>; break;
+		case VT_BOOL:	m_setPoint = &CCWFGM_AttributeFilter::setPointAsBool; break;
+		default:		m_setPoint = &CCWFGM_AttributeFilter::setPointUnexpected; break;
+	}
+}
+
+
+std::uint32_t CCWFGM_AttributeFilter::typeSize(std::uint16_t type) {
+	switch (type) {
+		case VT_BOOL:
+		case VT_I1:
+		case VT_UI1:	return 1;
+		case VT_I2:
+		case VT_UI2:	return 2;
+		case VT_I4:
+		case VT_UI4:
+		case VT_R4:		return 4;
+		case VT_I8:
+		case VT_UI8:
+		case VT_R8:		return 8;
+	}
+	return 0;
+}
+
+
+template<typename S, typename L>
+static void *narrowArray(const L *src, const bool *nodata, std::size_t count, double scale) {
+	S *dest = (S *)malloc(count * sizeof(S));
+	if (dest)
+		NarrowAttributeArray(src, nodata, count, scale, dest);
+	return dest;
+}
+
+
+template<typename L>
+static void *narrowArray(const void *array, const bool *nodata, std::size_t count, std::uint16_t *storage_type, double *scale) {
+	const L *src = reinterpret_cast<const L *>(array);
+	switch (FindAttributeNarrowing(src, nodata, count, scale)) {
+		case AttributeNarrowing::I1:	*storage_type = CCWFGM_AttributeFilter::VT_I1; return narrowArray<std::int8_t>(src, nodata, count, *scale);
+		case AttributeNarrowing::UI1:	*storage_type = CCWFGM_AttributeFilter::VT_UI1; return narrowArray<std::uint8_t>(src, nodata, count, *scale);
+		case AttributeNarrowing::I2:	*storage_type = CCWFGM_AttributeFilter::VT_I2; return narrowArray<std::int16_t>(src, nodata, count, *scale);
+		case AttributeNarrowing::UI2:	*storage_type = CCWFGM_AttributeFilter::VT_UI2; return narrowArray<std::uint16_t>(src, nodata, count, *scale);
+		case AttributeNarrowing::I4:	*storage_type = CCWFGM_AttributeFilter::VT_I4; return narrowArray<std::int32_t>(src, nodata, count, *scale);
+		default:						return nullptr;
+	}
+}
+
+
+template<typename L>
+static void widenArray(std::uint16_t storage_type, const void *array, std::size_t count, double scale, void *dest) {
+	L *d = reinterpret_cast<L *>(dest);
+	switch (storage_type) {
+		case CCWFGM_AttributeFilter::VT_I1:		WidenAttributeArray(reinterpret_cast<const std::int8_t *>(array), count, scale, d); break;
+		case CCWFGM_AttributeFilter::VT_UI1:	WidenAttributeArray(reinterpret_cast<const std::uint8_t *>(array), count, scale, d); break;
+		case CCWFGM_AttributeFilter::VT_I2:		WidenAttributeArray(reinterpret_cast<const std::int16_t *>(array), count, scale, d); break;
+		case CCWFGM_AttributeFilter::VT_UI2:	WidenAttributeArray(reinterpret_cast<const std::uint16_t *>(array), count, scale, d); break;
+		case CCWFGM_AttributeFilter::VT_I4:		WidenAttributeArray(reinterpret_cast<const std::int32_t *>(array), count, scale, d); break;
+		default:								weak_assert(false); break;
+	}
+}
+
+
+/*!
+If CCWFGMGRID_NARROW_STORAGE is set, replaces the array with one in the narrowest type which holds every value exactly (see
+FindAttributeNarrowing()).  OptionType, query results and serialized data are unaffected; the array is widened again as soon as it's
+modified.
+*/
+void CCWFGM_AttributeFilter::narrowStorage() {
+	if ((!(m_flags & CCWFGMGRID_NARROW_STORAGE)) || (!m_array_i1) || (m_storageType != m_optionType))
+		return;
+	if ((m_xsize == (std::uint16_t)-1) || (m_ysize == (std::uint16_t)-1))
+		return;
+
+	const std::size_t count = (std::size_t)m_xsize * (std::size_t)m_ysize;
+	std::uint16_t storage_type;
+	double scale = 1.0;
+	void *array;
+	switch (m_optionType) {
+		case VT_I2:		array = narrowArray<std::int16_t>(m_array_i1, m_array_nodata, count, &storage_type, &scale); break;
+		case VT_I4:		array = narrowArray<std::int32_t>(m_array_i1, m_array_nodata, count, &storage_type, &scale); break;
+		case VT_I8:		array = narrowArray<std::int64_t>(m_array_i1, m_array_nodata, count, &storage_type, &scale); break;
+		case VT_UI2:	array = narrowArray<std::uint16_t>(m_array_i1, m_array_nodata, count, &storage_type, &scale); break;
+		case VT_UI4:	array = narrowArray<std::uint32_t>(m_array_i1, m_array_nodata, count, &storage_type, &scale); break;
+		case VT_UI8:	array = narrowArray<std::uint64_t>(m_array_i1, m_array_nodata, count, &storage_type, &scale); break;
+		case VT_R4:		array = narrowArray<float>(m_array_i1, m_array_nodata, count, &storage_type, &scale); break;
+		case VT_R8:		array = narrowArray<double>(m_array_i1, m_array_nodata, count, &storage_type, &scale); break;
+		default:		return;
+	}
+	if (array) {
+		free(m_array_i1);
+		m_array_i1 = (std::int8_t *)array;
+		bindAccessors(storage_type, scale);
+	}
+}
+
+
+/*!
+Writes the whole array, densely and in OptionType, into dest.  Returns false if out of memory.
+*/
+bool CCWFGM_AttributeFilter::widenInto(void *dest) const {
+	const std::size_t count = (std::size_t)m_xsize * (std::size_t)m_ysize;
+	const std::int8_t *array = m_array_i1;
+	std::unique_ptr<std::int8_t[]> expanded;
+	if (m_sparse) {
+		if (m_storageType == m_optionType) {
+			m_sparse->expand(dest, nullptr);
+			return true;
+		}
+		expanded.reset(new (std::nothrow) std::int8_t[count * typeSize(m_storageType)]);
+		if (!expanded)
+			return false;
+		m_sparse->expand(expanded.get(), nullptr);
+		array = expanded.get();
+	}
+	else if (m_storageType == m_optionType) {
+		memcpy(dest, array, count * typeSize(m_optionType));
+		return true;
+	}
+
+	switch (m_optionType) {
+		case VT_I2:		widenArray<std::int16_t>(m_storageType, array, count, m_storageScale, dest); break;
+		case VT_I4:		widenArray<std::int32_t>(m_storageType, array, count, m_storageScale, dest); break;
+		case VT_I8:		widenArray<std::int64_t>(m_storageType, array, count, m_storageScale, dest); break;
+		case VT_UI2:	widenArray<std::uint16_t>(m_storageType, array, count, m_storageScale, dest); break;
+		case VT_UI4:	widenArray<std::uint32_t>(m_storageType, array, count, m_storageScale, dest); break;
+		case VT_UI8:	widenArray<std::uint64_t>(m_storageType, array, count, m_storageScale, dest); break;
+		case VT_R4:		widenArray<float>(m_storageType, array, count, m_storageScale, dest); break;
+		case VT_R8:		widenArray<double>(m_storageType, array, count, m_storageScale, dest); break;
+		default:		weak_assert(false); break;
+	}
+	return true;
+}
+
+
+/*!
+Puts a narrowed array back into OptionType (and a sparse one back into a dense array).  Returns false if out of memory, leaving the array
+as it was.
+*/
+bool CCWFGM_AttributeFilter::widenStorage() {
+	if (!densifyStorage())
+		return false;
+	if ((m_storageType == m_optionType) || (!m_array_i1)) {
+		bindAccessors(m_optionType, 1.0);
+		return true;
+	}
+	void *array = malloc((std::size_t)m_xsize * (std::size_t)m_ysize * typeSize(m_optionType));
+	if (!array)
+		return false;
+	widenInto(array);
+	free(m_array_i1);
+	m_array_i1 = (std::int8_t *)array;
+	bindAccessors(m_optionType, 1.0);
+	return true;
+}
+
+
+/*!
+If CCWFGMGRID_SPARSE_STORAGE is set, replaces the dense arrays with a GridSparseArray if that saves at least half their memory.  Setting
+a cell only expands its own tile, while bulk edits expand the whole array again.  Fuel grids are left alone, their lookups read the dense
+array directly.
+*/
+void CCWFGM_AttributeFilter::sparsifyStorage() {
+	if ((!(m_flags & CCWFGMGRID_SPARSE_STORAGE)) || (!m_array_i1) || (m_sparse))
+		return;
+	if ((m_xsize == (std::uint16_t)-1) || (m_ysize == (std::uint16_t)-1))
+		return;
+	if ((m_optionType == VT_UI1) && (m_optionKey == (std::uint16_t)-1))
+		return;
+
+	std::shared_ptr<GridSparseArray> sparse = GridSparseArray::build(m_array_i1, m_array_nodata, m_xsize, m_ysize, typeSize(m_storageType));
+	if (!sparse)
+		return;
+	free(m_array_i1);
+	m_array_i1 = nullptr;
+	if (m_array_nodata) {
+		free(m_array_nodata);
+		m_array_nodata = nullptr;
+	}
+	m_sparse = sparse;
+	bindAccessors(m_storageType, m_storageScale);
+}
+
+
+/*!
+Expands a sparse array back into dense arrays, still in its storage type.  Returns false if out of memory, leaving it sparse.
+*/
+bool CCWFGM_AttributeFilter::densifyStorage() {
+	if (!m_sparse)
+		return true;
+
+	const std::size_t count = (std::size_t)m_xsize * (std::size_t)m_ysize;
+	std::int8_t *array = (std::int8_t *)malloc(count * typeSize(m_storageType));
+	bool *nodata = m_sparse->hasNodata() ? (bool *)malloc(count * sizeof(bool)) : nullptr;
+	if ((!array) || ((m_sparse->hasNodata()) && (!nodata))) {
+		free(array);
+		free(nodata);
+		return false;
+	}
+	m_sparse->expand(array, nodata);
+	m_array_i1 = array;
+	m_array_nodata = nodata;
+	m_sparse.reset();
+	bindAccessors(m_storageType, m_storageScale);
+	return true;
+}
+
+
+/*!
+Applies whichever of the memory saving storage options are turned on, to a freshly loaded or imported array.
+*/
+void CCWFGM_AttributeFilter::compactStorage() {
+	narrowStorage();
+	sparsifyStorage();
+}
+
+
+/*!
+Index of the first cell whose centre is at or after c (in cell units), kept within a range that can't overflow.
+*/
+static std::int32_t editCell(double c) {
+	return (std::int32_t)std::max(-1.0, std::min(std::ceil(c - 0.5), 65536.0));
+}
+
+
+/*!
+Clips the segment (in cell units) to the grid's extent.  Returns false if it's entirely outside.
+*/
+static bool clipSegment(double &x1, double &y1, double &x2, double &y2, double x_max, double y_max) {
+	const double dx = x2 - x1, dy = y2 - y1;
+	const double p[4] = { -dx, dx, -dy, dy };
+	const double q[4] = { x1, x_max - x1, y1, y_max - y1 };
+	double t0 = 0.0, t1 = 1.0;
+	for (int i = 0; i < 4; i++) {
+		if (p[i] == 0.0) {
+			if (q[i] < 0.0)
+				return false;
+		}
+		else {
+			const double r = q[i] / p[i];
+			if (p[i] < 0.0) {
+				if (r > t1)	return false;
+				if (r > t0)	t0 = r;
+			}
+			else {
+				if (r < t0)	return false;
+				if (r < t1)	t1 = r;
+			}
+		}
+	}
+	x2 = x1 + t1 * dx;	y2 = y1 + t1 * dy;
+	x1 = x1 + t0 * dx;	y1 = y1 + t0 * dy;
+	return true;
 }
 
 
@@ -279,6 +791,8 @@ HRESULT CCWFGM_AttributeFilter::SetAttributeLine(XY_Point pt1,XY_Point pt2, cons
 	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
 	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
 
+	loadDeferred();
+
 	std::uint16_t x1 = convertX(pt1.x, nullptr); std::uint16_t y1 = convertY(pt1.y, nullptr);
 	std::uint16_t x2 = convertX(pt2.x, nullptr); std::uint16_t y2 = convertY(pt2.y, nullptr);
 	if (!m_gridEngine(nullptr))					{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
@@ -292,6 +806,7 @@ HRESULT CCWFGM_AttributeFilter::SetAttributeLine(XY_Point pt1,XY_Point pt2, cons
 	br._this = this;
 	br.value = value;
 	br.prev_pt = l.p1;
+	discardDeferred();
 	if (!l.Draw(1.0, break_fcn, &br))
 		return E_FAIL;
 	m_bRequiresSave = true;
@@ -299,17 +814,227 @@ HRESULT CCWFGM_AttributeFilter::SetAttributeLine(XY_Point pt1,XY_Point pt2, cons
 }
 
 
+HRESULT CCWFGM_AttributeFilter::SetAttributePolygon(const XY_PolyConst &xy_pairs, const NumericVariant &value, XY_Rectangle *dirty_bbox) {
+	const std::uint32_t count = xy_pairs.NumPoints();
+	if (count < 3)								return E_INVALIDARG;
+
+	SEM_BOOL engaged;
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
+
+	HRESULT hr;
+	if (FAILED(hr = beginEdit()))				return hr;
+
+	std::vector<XY_Point> vertices;				// in cell units, so cell (x, y) has its centre at (x + 0.5, y + 0.5)
+	try {
+		vertices.reserve(count);
+	}
+	catch (std::bad_alloc &) {
+		return E_OUTOFMEMORY;
+	}
+	double y_lo = std::numeric_limits<double>::max(), y_hi = std::numeric_limits<double>::lowest();
+	for (std::uint32_t i = 0; i < count; i++) {
+		const XY_Point pt = xy_pairs.GetPoint(i);
+		vertices.emplace_back((pt.x - m_xllcorner) * m_iresolution, (pt.y - m_yllcorner) * m_iresolution);
+		y_lo = std::min(y_lo, vertices.back().y);
+		y_hi = std::max(y_hi, vertices.back().y);
+	}
+
+	EditBounds bounds = { 0, 0, -1, -1 };
+	std::vector<double> crossings;
+	const std::int32_t y_first = std::max(editCell(y_lo), (std::int32_t)0);
+	const std::int32_t y_last = std::min(editCell(y_hi) - 1, (std::int32_t)m_ysize - 1);
+	for (std::int32_t y = y_first; y <= y_last; y++) {
+		const double yc = (double)y + 0.5;
+		crossings.clear();
+		for (std::uint32_t i = 0, j = count - 1; i < count; j = i++) {
+			const XY_Point &a = vertices[j], &b = vertices[i];
+			if ((a.y <= yc) != (b.y <= yc))		// half-open, so a vertex exactly on the row is counted once
+				crossings.push_back(a.x + (yc - a.y) * (b.x - a.x) / (b.y - a.y));
+		}
+		std::sort(crossings.begin(), crossings.end());
+		for (std::size_t k = 0; k + 1 < crossings.size(); k += 2)
+			if (FAILED(hr = fillRow(y, editCell(crossings[k]), editCell(crossings[k + 1]) - 1, value, &bounds)))
+				break;
+		if (FAILED(hr))
+			break;
+	}
+
+	endEdit(bounds, dirty_bbox);
+	return hr;
+}
+
+
+HRESULT CCWFGM_AttributeFilter::SetAttributePolyline(const XY_PolyConst &xy_pairs, const NumericVariant &value, XY_Rectangle *dirty_bbox) {
+	const std::uint32_t count = xy_pairs.NumPoints();
+	if (!count)									return E_INVALIDARG;
+
+	SEM_BOOL engaged;
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
+
+	HRESULT hr;
+	if (FAILED(hr = beginEdit()))				return hr;
+
+	EditBounds bounds = { 0, 0, -1, -1 };
+	XY_Point pt = xy_pairs.GetPoint(0);
+	if (count == 1)
+		hr = drawSegment(pt, pt, value, &bounds);
+	for (std::uint32_t i = 1; i < count; i++) {
+		const XY_Point next = xy_pairs.GetPoint(i);
+		if (FAILED(hr = drawSegment(pt, next, value, &bounds)))
+			break;
+		pt = next;
+	}
+
+	endEdit(bounds, dirty_bbox);
+	return hr;
+}
+
+
+HRESULT CCWFGM_AttributeFilter::SetAttributeLines(const std::vector<std::pair<XY_Point, XY_Point>> &lines, const NumericVariant &value, XY_Rectangle *dirty_bbox) {
+	SEM_BOOL engaged;
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
+
+	HRESULT hr;
+	if (FAILED(hr = beginEdit()))				return hr;
+
+	EditBounds bounds = { 0, 0, -1, -1 };
+	for (auto &line : lines)
+		if (FAILED(hr = drawSegment(line.first, line.second, value, &bounds)))
+			break;
+
+	endEdit(bounds, dirty_bbox);
+	return hr;
+}
+
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+/*!
+Common checks before a bulk edit, made once the lock is held.
+*/
+HRESULT CCWFGM_AttributeFilter::beginEdit() {
+	loadDeferred();
+	if (!m_gridEngine(nullptr))					{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+	if ((!m_array_i1) && (!m_sparse))			return ERROR_SEVERITY_WARNING;
+	return S_OK;
+}
+
+
+/*!
+Finishes a bulk edit, even a failed one since it may have changed some cells before stopping.
+*/
+void CCWFGM_AttributeFilter::endEdit(const EditBounds &bounds, XY_Rectangle *dirty_bbox) {
+	if (bounds.x_min > bounds.x_max)
+		return;
+	discardDeferred();
+	m_bRequiresSave = true;
+	if (dirty_bbox) {
+		dirty_bbox->m_min.x = invertX(bounds.x_min);
+		dirty_bbox->m_min.y = invertY(bounds.y_min);
+		dirty_bbox->m_max.x = invertX(bounds.x_max + 1);
+		dirty_bbox->m_max.y = invertY(bounds.y_max + 1);
+	}
+}
+
+
+/*!
+Sets cells x_first to x_last of row y, clipped to the grid.  The first cell goes through the bound setter, which converts the value and widens
+the array if need be; the rest of the run is copied from it, so a sparse array is made dense first.
+*/
+HRESULT CCWFGM_AttributeFilter::fillRow(std::int32_t y, std::int32_t x_first, std::int32_t x_last, const NumericVariant &value, EditBounds *bounds) {
+	if ((y < 0) || (y >= (std::int32_t)m_ysize))
+		return S_OK;
+	x_first = std::max(x_first, (std::int32_t)0);
+	x_last = std::min(x_last, (std::int32_t)m_xsize - 1);
+	if (x_first > x_last)
+		return S_OK;
+
+	if (bounds->x_min > bounds->x_max) {
+		bounds->x_min = bounds->x_max = x_first;
+		bounds->y_min = bounds->y_max = y;
+	}
+	bounds->x_min = std::min(bounds->x_min, x_first);
+	bounds->x_max = std::max(bounds->x_max, x_last);
+	bounds->y_min = std::min(bounds->y_min, y);
+	bounds->y_max = std::max(bounds->y_max, y);
+
+	const std::uint32_t count = (std::uint32_t)(x_last - x_first);
+	if ((count) && (!densifyStorage()))
+		return E_OUTOFMEMORY;
+
+	const std::uint32_t index = arrayIndex((std::uint16_t)x_first, (std::uint16_t)y);
+	HRESULT hr = setPoint(index, value);
+	if (hr != S_OK)
+		return FAILED(hr) ? hr : E_FAIL;
+
+	if (count) {
+		weak_assert((!m_sparse) && (m_storageType == m_optionType));
+		const std::uint32_t size = typeSize(m_optionType);
+		std::uint8_t *cell = reinterpret_cast<std::uint8_t *>(m_array_i1) + (std::size_t)index * size;
+		for (std::uint32_t i = 1; i <= count; i++)
+			memcpy(cell + (std::size_t)i * size, cell, size);
+		if (m_array_nodata)
+			std::fill(m_array_nodata + index + 1, m_array_nodata + index + 1 + count, false);
+	}
+	return S_OK;
+}
+
+
+/*!
+Sets every cell the segment passes through, stepping from cell to cell across whichever grid line the segment reaches next.
+*/
+HRESULT CCWFGM_AttributeFilter::drawSegment(const XY_Point &pt1, const XY_Point &pt2, const NumericVariant &value, EditBounds *bounds) {
+	double x1 = (pt1.x - m_xllcorner) * m_iresolution, y1 = (pt1.y - m_yllcorner) * m_iresolution;
+	double x2 = (pt2.x - m_xllcorner) * m_iresolution, y2 = (pt2.y - m_yllcorner) * m_iresolution;
+	if (!clipSegment(x1, y1, x2, y2, (double)m_xsize, (double)m_ysize))
+		return S_OK;
+
+	std::int32_t x = (std::int32_t)std::floor(x1), y = (std::int32_t)std::floor(y1);
+	const std::int32_t x_end = (std::int32_t)std::floor(x2), y_end = (std::int32_t)std::floor(y2);
+	const double dx = x2 - x1, dy = y2 - y1;
+	const std::int32_t step_x = (dx > 0.0) ? 1 : -1, step_y = (dy > 0.0) ? 1 : -1;
+	const double t_dx = (dx != 0.0) ? std::fabs(1.0 / dx) : std::numeric_limits<double>::infinity();
+	const double t_dy = (dy != 0.0) ? std::fabs(1.0 / dy) : std::numeric_limits<double>::infinity();
+	double t_x = (dx > 0.0) ? ((double)(x + 1) - x1) * t_dx : ((dx < 0.0) ? (x1 - (double)x) * t_dx : std::numeric_limits<double>::infinity());
+	double t_y = (dy > 0.0) ? ((double)(y + 1) - y1) * t_dy : ((dy < 0.0) ? (y1 - (double)y) * t_dy : std::numeric_limits<double>::infinity());
+
+	HRESULT hr;
+	std::uint32_t steps = (std::uint32_t)(std::abs(x_end - x) + std::abs(y_end - y));
+	for (;;) {
+		if (FAILED(hr = fillRow(y, x, x, value, bounds)))
+			return hr;
+		if (!steps--)
+			break;
+		if (t_x < t_y) {
+			x += step_x;
+			t_x += t_dx;
+		}
+		else {
+			y += step_y;
+			t_y += t_dy;
+		}
+	}
+	return S_OK;
+}
+
+#endif
+
+
 HRESULT CCWFGM_AttributeFilter::GetAttributePoint(const XY_Point &pt, NumericVariant *value, grid::AttributeValue *value_valid) {
 	if (!value)								return E_POINTER;
 
 	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+	loadDeferred();
 
 	std::uint16_t x = convertX(pt.x, nullptr);
 	std::uint16_t y = convertY(pt.y, nullptr);
 	if (!m_gridEngine(nullptr))					{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
 	if (x >= m_xsize)							return ERROR_GRID_LOCATION_OUT_OF_RANGE;
 	if (y >= m_ysize)							return ERROR_GRID_LOCATION_OUT_OF_RANGE;
-	if (!m_array_i1)							return ERROR_SEVERITY_WARNING;
+	if ((!m_array_i1) && (!m_sparse))			return ERROR_SEVERITY_WARNING;
 
 	return getPoint(pt, value, value_valid);
 }
@@ -329,6 +1054,22 @@ HRESULT CCWFGM_AttributeFilter::GetAttribute(std::uint16_t option,  /*unsigned*/
 							*value = (m_flags & CCWFGMGRID_ALLOW_GIS) ? true : false;
 							return S_OK;
 
+		case CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE:
+							*value = (m_flags & CCWFGMGRID_NARROW_STORAGE) ? true : false;
+							return S_OK;
+
+		case CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE:
+							*value = (m_flags & CCWFGMGRID_SPARSE_STORAGE) ? true : false;
+							return S_OK;
+
+		case CWFGM_GRID_ATTRIBUTE_SAMPLING:
+							*value = m_sampling;
+							return S_OK;
+
+		case CWFGM_GRID_ATTRIBUTE_NATIVE_RESOLUTION:
+							*value = (m_flags & CCWFGMGRID_NATIVE_RESOLUTION) ? true : false;
+							return S_OK;
+
 		case CWFGM_GRID_ATTRIBUTE_GIS_URL: {
 							*value = m_gisURL;
 							return S_OK;
@@ -402,6 +1143,15 @@ HRESULT CCWFGM_AttributeFilter::ResetAttribute(const NumericVariant &value) {
 
 	m_xsize = x;
 	m_ysize = y;
+	if (m_flags & CCWFGMGRID_NATIVE_RESOLUTION) {
+		m_flags &= (~(CCWFGMGRID_NATIVE_RESOLUTION));		// a reset array covers the grid engine's cells
+		m_resolution = m_gridResolution;
+		m_xllcorner = m_gridXLLCorner;
+		m_yllcorner = m_gridYLLCorner;
+	}
+	m_iresolution = 1.0 / m_resolution;
+
+	discardDeferred();
 
 	if (m_array_i1)
 		free(m_array_i1);
@@ -411,27 +1161,10 @@ HRESULT CCWFGM_AttributeFilter::ResetAttribute(const NumericVariant &value) {
 	}
 	m_array_i1 = (std::int8_t *)mem;
 	m_array_nodata = mem2;
+	m_sparse.reset();
+	bindAccessors(m_optionType, 1.0);
 
-	std::uint32_t i, array_size = x * y;
-
-	if (size == 1) {
-		for (i = 0; i < array_size; i++)
-			m_array_i1[i] = u.vt_c;
-	}
-	else if (size == 2) {
-		for (i = 0; i < array_size; i++)
-			m_array_i2[i] = u.vt_s;
-	}
-	else if (size == 4) {
-		for (i = 0; i < array_size; i++)
-			m_array_i4[i] = u.vt_l;
-	}
-	else if (size == 8) {
-		for (i = 0; i < array_size; i++)
-			m_array_i8[i] = u.vt_ll;
-	}
-
-	memset(m_array_nodata, 0, (size_t)x * (size_t)y * sizeof(bool));
+	FillAttributeArray(m_array_i1, size, &u, m_array_nodata, false, x, y);
 
 	m_bRequiresSave = true;
 	return S_OK;
@@ -456,6 +1189,8 @@ HRESULT CCWFGM_AttributeFilter::MT_Lock(Layer *layerThread, bool exclusive, std:
 
 		hr = gridEngine->MT_Lock(layerThread, exclusive, obtain);
 
+		loadDeferred();
+
 		if (SUCCEEDED(hr) && (m_fuelMap))
 			hr = m_fuelMap->MT_Lock(exclusive, obtain);
 	} else {
@@ -477,6 +1212,7 @@ HRESULT CCWFGM_AttributeFilter::GetFuelData(Layer *layerThread, const XY_Point &
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
 	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
 	if (m_optionKey == (std::uint16_t)-1) {
+		loadDeferred();
 		std::uint16_t x = convertX(pt.x, cache_bbox);
 		std::uint16_t y = convertY(pt.y, cache_bbox);
 		if (!m_fuelMap)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
@@ -506,6 +1242,7 @@ HRESULT CCWFGM_AttributeFilter::GetFuelIndexData(Layer *layerThread, const XY_Po
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
 	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
 	if (m_optionKey == (std::uint16_t)-1) {
+		loadDeferred();
 		std::uint16_t x = convertX(pt.x, cache_bbox);
 		std::uint16_t y = convertY(pt.y, cache_bbox);
 		if (!m_fuelMap)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
@@ -536,6 +1273,7 @@ HRESULT CCWFGM_AttributeFilter::GetFuelDataArray(Layer *layerThread, const XY_Po
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
 	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
 	if (m_optionKey == (std::uint16_t)-1) {
+		loadDeferred();
 		if (!m_fuelMap)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
 		if (m_xsize == (std::uint16_t)-1)		{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
 		if (!m_array_ui1)						{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
@@ -618,6 +1356,7 @@ HRESULT CCWFGM_AttributeFilter::GetFuelIndexDataArray(Layer *layerThread, const
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
 	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
 	if (m_optionKey == (std::uint16_t)-1) {
+		loadDeferred();
 		std::uint16_t x_min = convertX(min_pt.x, nullptr), y_min = convertY(min_pt.y, nullptr);
 		std::uint16_t x_max = convertX(max_pt.x, nullptr), y_max = convertY(max_pt.y, nullptr);
 		if (!m_fuelMap)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
@@ -662,8 +1401,12 @@ HRESULT CCWFGM_AttributeFilter::GetFuelIndexDataArray(Layer *layerThread, const
 HRESULT CCWFGM_AttributeFilter::GetAttributeData(Layer *layerThread, const XY_Point &pt, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, NumericVariant *attribute, grid::AttributeValue *attribute_valid, XY_Rectangle *cache_bbox) {
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
 	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
-	if (option == m_optionKey)
+	if (option == m_optionKey) {
+		loadDeferred();
+		if (m_flags & CCWFGMGRID_NATIVE_RESOLUTION)
+			return samplePoint(pt, attribute, attribute_valid);
 		return getPoint(pt, attribute, attribute_valid);
+	}
 	return gridEngine->GetAttributeData(layerThread, pt, time, timeSpan, option, optionFlags, attribute, attribute_valid, cache_bbox);
 }
 
@@ -674,6 +1417,9 @@ HRESULT CCWFGM_AttributeFilter::GetAttributeDataArray(Layer *layerThread, const
 	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
 
 	if (option == m_optionKey) {
+		loadDeferred();
+		if (m_flags & CCWFGMGRID_NATIVE_RESOLUTION)
+			return getSampledDataArray(min_pt, max_pt, scale, attribute, attribute_valid);
 		std::uint16_t x_min = convertX(min_pt.x, nullptr), y_min = convertY(min_pt.y, nullptr);
 		std::uint16_t x_max = convertX(max_pt.x, nullptr), y_max = convertY(max_pt.y, nullptr);
 		if (!attribute)							return E_POINTER;
@@ -690,28 +1436,231 @@ HRESULT CCWFGM_AttributeFilter::GetAttributeDataArray(Layer *layerThread, const
 		std::uint16_t x, y;
 		NumericVariant v;
 		grid::AttributeValue v_valid;
-		HRESULT hr;
 		for (y = y_min; y <= y_max; y++) {				// for every point that was requested...
 			for (x = x_min; x <= x_max; x++) {
+				if ((x >= m_xsize) || (y >= m_ysize) || (FAILED(getPoint(x, y, &v, &v_valid)))) {
+					v = NumericVariant();
+					v_valid = grid::AttributeValue::NOT_SET;
+				}
 				(*attribute)[x - x_min][y - y_min] = v;
-				(*attribute_valid)[x - x_min][y - y_min] = grid::AttributeValue::NOT_SET;
+				(*attribute_valid)[x - x_min][y - y_min] = v_valid;
 			}
 		}
+		return S_OK;
+	}
+	return gridEngine->GetAttributeDataArray(layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+}
 
-		for (y = y_min; y <= y_max; y++) {				// for every point that was requested...
-			for (x = x_min; x <= x_max; x++) {
-				XY_Point pt;
-				pt.x = x;
-				pt.y = y;
-				if (FAILED(hr = getPoint(pt, &v, &v_valid))) {
-					if (hr != ERROR_GRID_NO_DATA)
-						break;
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+template<typename L, typename T>
+static std::uint32_t copyNarrowedRow(std::uint16_t storage_type, double scale, const std::int8_t *array, std::uint32_t index, const bool *nodata,
+    std::uint32_t count, T *dest, std::ptrdiff_t stride, grid::AttributeValue *valid, std::ptrdiff_t valid_stride) {
+	switch (storage_type) {
+		case CCWFGM_AttributeFilter::VT_I1:		CopyAttributeRow<std::int8_t, T, false, L>(reinterpret_cast<const std::int8_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride, scale); return count;
+		case CCWFGM_AttributeFilter::VT_UI1:	CopyAttributeRow<std::uint8_t, T, false, L>(reinterpret_cast<const std::uint8_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride, scale); return count;
+		case CCWFGM_AttributeFilter::VT_I2:		CopyAttributeRow<std::int16_t, T, false, L>(reinterpret_cast<const std::int16_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride, scale); return count;
+		case CCWFGM_AttributeFilter::VT_UI2:	CopyAttributeRow<std::uint16_t, T, false, L>(reinterpret_cast<const std::uint16_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride, scale); return count;
+		case CCWFGM_AttributeFilter::VT_I4:		CopyAttributeRow<std::int32_t, T, false, L>(reinterpret_cast<const std::int32_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride, scale); return count;
+	}
+	weak_assert(false);
+	return 0;
+}
+
+
+/*!
+Array version of samplePoint(), for filters which keep their own resolution.  The caller's cells are scale in size and aligned with the grid engine's.
+*/
+template<typename T>
+HRESULT CCWFGM_AttributeFilter::getSampledDataArray(const XY_Point &min_pt, const XY_Point &max_pt, double scale, boost::multi_array<T, 2> *attribute, attribute_t_2d *attribute_valid) {
+	if (!attribute)							return E_POINTER;
+	if (!attribute_valid)					return E_POINTER;
+	if (m_gridResolution <= 0.0)			{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+	if (!(scale > 0.0))						return E_INVALIDARG;
+
+	loadDeferred();
+	const double x_min = floor((min_pt.x - m_gridXLLCorner) / scale), y_min = floor((min_pt.y - m_gridYLLCorner) / scale);
+	const double x_max = floor((max_pt.x - m_gridXLLCorner) / scale), y_max = floor((max_pt.y - m_gridYLLCorner) / scale);
+	if (x_min > x_max)						return E_INVALIDARG;
+	if (y_min > y_max)						return E_INVALIDARG;
+	const std::uint32_t xs = (std::uint32_t)(x_max - x_min) + 1, ys = (std::uint32_t)(y_max - y_min) + 1;
+
+	const auto *dims = attribute->shape();
+	if (dims[0] < xs)						return E_INVALIDARG;
+	if (dims[1] < ys)						return E_INVALIDARG;
+
+	dims = attribute_valid->shape();
+	if (dims[0] < xs)						return E_INVALIDARG;
+	if (dims[1] < ys)						return E_INVALIDARG;
+
+	NumericVariant v;
+	grid::AttributeValue v_valid;
+	for (std::uint32_t y = 0; y < ys; y++) {
+		const double py = (y_min + y + 0.5) * scale + m_gridYLLCorner;
+		for (std::uint32_t x = 0; x < xs; x++) {
+			const double px = (x_min + x + 0.5) * scale + m_gridXLLCorner;
+			if (FAILED(sampleCell(px, py, &v, &v_valid)))
+				v_valid = grid::AttributeValue::NOT_SET;
+			if constexpr (std::is_same_v<T, NumericVariant>) {
+				if (v_valid == grid::AttributeValue::NOT_SET)
+					v = NumericVariant();
+				(*attribute)[x][y] = v;
+			}
+			else {
+				double d;
+				if ((v_valid != grid::AttributeValue::NOT_SET) && (variantToDouble(v, &d)) && (AttributeValueFits<T>(d)))
+					(*attribute)[x][y] = (T)d;
+				else {
+					(*attribute)[x][y] = T();
+					v_valid = grid::AttributeValue::NOT_SET;
 				}
-				(*attribute)[x - x_min][y - y_min] = v;
-				(*attribute_valid)[x - x_min][y - y_min] = v_valid;
 			}
+			(*attribute_valid)[x][y] = v_valid;
 		}
-		return S_OK;
+	}
+	return S_OK;
+}
+
+
+template<typename T>
+HRESULT CCWFGM_AttributeFilter::getTypedDataArray(const XY_Point &min_pt, const XY_Point &max_pt, boost::multi_array<T, 2> *attribute, attribute_t_2d *attribute_valid) {
+	if (!attribute)							return E_POINTER;
+	if (!attribute_valid)					return E_POINTER;
+
+	loadDeferred();
+	std::uint16_t x_min = convertX(min_pt.x, nullptr), y_min = convertY(min_pt.y, nullptr);
+	std::uint16_t x_max = convertX(max_pt.x, nullptr), y_max = convertY(max_pt.y, nullptr);
+
+	const auto *dims = attribute->shape();
+	if (dims[0] < (x_max - x_min + 1))		return E_INVALIDARG;
+	if (dims[1] < (y_max - y_min + 1))		return E_INVALIDARG;
+
+	dims = attribute_valid->shape();
+	if (dims[0] < (x_max - x_min + 1))		return E_INVALIDARG;
+	if (dims[1] < (y_max - y_min + 1))		return E_INVALIDARG;
+
+	// the caller's arrays are indexed [x][y], so a row of this filter is a strided column of theirs
+	const std::ptrdiff_t stride = attribute->strides()[0], valid_stride = attribute_valid->strides()[0];
+	const std::uint32_t x_in = (x_min < m_xsize) ? (std::uint32_t)std::min(x_max, (std::uint16_t)(m_xsize - 1)) - x_min + 1 : 0;
+
+	// converts count cells starting at array[index] (in the storage type), returns how many it converted
+	auto copy = [this, stride, valid_stride](const std::int8_t *array, std::uint32_t index, const bool *nodata, std::uint32_t count,
+	    T *dest, grid::AttributeValue *valid) -> std::uint32_t {
+		if (m_storageType != m_optionType) {
+			switch (m_optionType) {
+				case VT_I2:		return copyNarrowedRow<std::int16_t>(m_storageType, m_storageScale, array, index, nodata, count, dest, stride, valid, valid_stride);
+				case VT_I4:		return copyNarrowedRow<std::int32_t>(m_storageType, m_storageScale, array, index, nodata, count, dest, stride, valid, valid_stride);
+				case VT_I8:		return copyNarrowedRow<std::int64_t>(m_storageType, m_storageScale, array, index, nodata, count, dest, stride, valid, valid_stride);
+				case VT_UI2:	return copyNarrowedRow<std::uint16_t>(m_storageType, m_storageScale, array, index, nodata, count, dest, stride, valid, valid_stride);
+				case VT_UI4:	return copyNarrowedRow<std::uint32_t>(m_storageType, m_storageScale, array, index, nodata, count, dest, stride, valid, valid_stride);
+				case VT_UI8:	return copyNarrowedRow<std::uint64_t>(m_storageType, m_storageScale, array, index, nodata, count, dest, stride, valid, valid_stride);
+				case VT_R4:		return copyNarrowedRow<float>(m_storageType, m_storageScale, array, index, nodata, count, dest, stride, valid, valid_stride);
+				case VT_R8:		return copyNarrowedRow<double>(m_storageType, m_storageScale, array, index, nodata, count, dest, stride, valid, valid_stride);
+			}
+			return 0;
+		}
+		switch (m_optionType) {
+			case VT_I1:		CopyAttributeRow(array + index, nodata, count, dest, stride, valid, valid_stride); return count;
+			case VT_I2:		CopyAttributeRow(reinterpret_cast<const std::int16_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride); return count;
+			case VT_I4:		CopyAttributeRow(reinterpret_cast<const std::int32_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride); return count;
+			case VT_I8:		CopyAttributeRow(reinterpret_cast<const std::int64_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride); return count;
+			case VT_UI1:	CopyAttributeRow(reinterpret_cast<const std::uint8_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride); return count;
+			case VT_UI2:	CopyAttributeRow(reinterpret_cast<const std::uint16_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride); return count;
+			case VT_UI4:	CopyAttributeRow(reinterpret_cast<const std::uint32_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride); return count;
+			case VT_UI8:	CopyAttributeRow(reinterpret_cast<const std::uint64_t *>(array) + index, nodata, count, dest, stride, valid, valid_stride); return count;
+			case VT_R4:		CopyAttributeRow(reinterpret_cast<const float *>(array) + index, nodata, count, dest, stride, valid, valid_stride); return count;
+			case VT_R8:		CopyAttributeRow(reinterpret_cast<const double *>(array) + index, nodata, count, dest, stride, valid, valid_stride); return count;
+			case VT_BOOL:	CopyAttributeRow<std::int8_t, T, true>(array + index, nodata, count, dest, stride, valid, valid_stride); return count;
+		}
+		return 0;
+	};
+
+	for (std::uint32_t y = y_min; y <= y_max; y++) {
+		T *dest = &(*attribute)[0][y - y_min];
+		grid::AttributeValue *valid = &(*attribute_valid)[0][y - y_min];
+		std::uint32_t count = 0;
+		if ((y < m_ysize) && (x_in)) {
+			const std::uint32_t index = arrayIndex(x_min, (std::uint16_t)y);
+			if (m_array_i1)
+				count = copy(m_array_i1, index, m_array_nodata ? m_array_nodata + index : nullptr, x_in, dest, valid);
+			else if (m_sparse) {
+				// a tile at a time: NODATA tiles need no lookups, and CONSTANT ones convert their value once
+				while (count < x_in) {
+					const GridSparseArray::Span span = m_sparse->span(index + count, x_in - count);
+					T *d = dest + count * stride;
+					grid::AttributeValue *v = valid + count * valid_stride;
+					switch (span.kind) {
+						case GridSparseArray::TileKind::NODATA:
+							for (std::uint32_t i = 0; i < span.count; i++) {
+								d[i * stride] = T();
+								v[i * valid_stride] = grid::AttributeValue::NOT_SET;
+							}
+							break;
+						case GridSparseArray::TileKind::CONSTANT:
+							copy(reinterpret_cast<const std::int8_t *>(span.values), 0, nullptr, 1, d, v);
+							for (std::uint32_t i = 1; i < span.count; i++) {
+								d[i * stride] = d[0];
+								v[i * valid_stride] = v[0];
+							}
+							break;
+						case GridSparseArray::TileKind::DENSE:
+							copy(reinterpret_cast<const std::int8_t *>(span.values), 0, span.nodata, span.count, d, v);
+							break;
+					}
+					count += span.count;
+				}
+			}
+		}
+		// anything past the edge of the filter (or with no data at all) isn't set
+		for (std::uint32_t x = x_min + count; x <= x_max; x++) {
+			(*attribute)[x - x_min][y - y_min] = T();
+			(*attribute_valid)[x - x_min][y - y_min] = grid::AttributeValue::NOT_SET;
+		}
+	}
+	return S_OK;
+}
+
+#endif
+
+
+HRESULT CCWFGM_AttributeFilter::GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan,
+    std::uint16_t option, std::uint64_t optionFlags, double_2d *attribute, attribute_t_2d *attribute_valid) {
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
+	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+
+	if (option == m_optionKey) {
+		if (m_flags & CCWFGMGRID_NATIVE_RESOLUTION)
+			return getSampledDataArray(min_pt, max_pt, scale, attribute, attribute_valid);
+		return getTypedDataArray(min_pt, max_pt, attribute, attribute_valid);
+	}
+	return gridEngine->GetAttributeDataArray(layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+}
+
+
+HRESULT CCWFGM_AttributeFilter::GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan,
+    std::uint16_t option, std::uint64_t optionFlags, float_2d *attribute, attribute_t_2d *attribute_valid) {
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
+	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+
+	if (option == m_optionKey) {
+		if (m_flags & CCWFGMGRID_NATIVE_RESOLUTION)
+			return getSampledDataArray(min_pt, max_pt, scale, attribute, attribute_valid);
+		return getTypedDataArray(min_pt, max_pt, attribute, attribute_valid);
+	}
+	return gridEngine->GetAttributeDataArray(layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+}
+
+
+HRESULT CCWFGM_AttributeFilter::GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan,
+    std::uint16_t option, std::uint64_t optionFlags, int32_t_2d *attribute, attribute_t_2d *attribute_valid) {
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
+	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+
+	if (option == m_optionKey) {
+		if (m_flags & CCWFGMGRID_NATIVE_RESOLUTION)
+			return getSampledDataArray(min_pt, max_pt, scale, attribute, attribute_valid);
+		return getTypedDataArray(min_pt, max_pt, attribute, attribute_valid);
 	}
 	return gridEngine->GetAttributeDataArray(layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
 }
@@ -767,6 +1716,9 @@ HRESULT CCWFGM_AttributeFilter::put_OptionType(std::uint16_t newVal) {
 		case VT_R4:
 		case VT_R8:
 		case VT_BOOL:	m_optionType = newVal;
+				m_sparse.reset();
+				bindAccessors(newVal, 1.0);
+				discardDeferred();
 				if (m_array_i1) {
 					free(m_array_i1);
 					m_array_i1 = NULL;
@@ -827,6 +1779,79 @@ HRESULT CCWFGM_AttributeFilter::SetAttribute(std::uint16_t option, const Polymor
 									m_bRequiresSave = true;
 								return S_OK;
 
+		case CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE: {
+								try {
+									bval = std::get<bool>(var);
+								}
+								catch (std::bad_variant_access &) {
+									weak_assert(false);
+									break;
+								}
+								SEM_BOOL engaged;
+								CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+								if (!engaged)
+									return ERROR_SCENARIO_SIMULATION_RUNNING;
+								if (((m_flags & CCWFGMGRID_NARROW_STORAGE) ? true : false) != bval)
+									m_bRequiresSave = true;
+								if (bval) {
+									m_flags |= CCWFGMGRID_NARROW_STORAGE;
+									if ((!m_deferred) && (densifyStorage()))	// otherwise done when the arrays are loaded
+										compactStorage();
+								}
+								else {
+									m_flags &= (~(CCWFGMGRID_NARROW_STORAGE));
+									if (!widenStorage())
+										return E_OUTOFMEMORY;
+									sparsifyStorage();
+								}
+								}
+								return S_OK;
+
+		case CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE: {
+								try {
+									bval = std::get<bool>(var);
+								}
+								catch (std::bad_variant_access &) {
+									weak_assert(false);
+									break;
+								}
+								SEM_BOOL engaged;
+								CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+								if (!engaged)
+									return ERROR_SCENARIO_SIMULATION_RUNNING;
+								if (((m_flags & CCWFGMGRID_SPARSE_STORAGE) ? true : false) != bval)
+									m_bRequiresSave = true;
+								if (bval) {
+									m_flags |= CCWFGMGRID_SPARSE_STORAGE;
+									if (!m_deferred)			// otherwise done when the arrays are loaded
+										sparsifyStorage();
+								}
+								else {
+									m_flags &= (~(CCWFGMGRID_SPARSE_STORAGE));
+									if (!densifyStorage())
+										return E_OUTOFMEMORY;
+								}
+								}
+								return S_OK;
+
+		case CWFGM_GRID_ATTRIBUTE_SAMPLING: {
+								std::uint16_t uval;
+								HRESULT hr;
+								if (FAILED(hr = VariantToUInt16_(var, &uval)))
+									return hr;
+								if ((uval != CWFGM_GRID_SAMPLING_NEAREST) && (uval != CWFGM_GRID_SAMPLING_BILINEAR))
+									return E_INVALIDARG;
+								SEM_BOOL engaged;
+								CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+								if (!engaged)
+									return ERROR_SCENARIO_SIMULATION_RUNNING;
+								if (m_sampling != uval) {
+									m_sampling = uval;
+									m_bRequiresSave = true;
+								}
+								}
+								return S_OK;
+
 		case CWFGM_GRID_ATTRIBUTE_GIS_URL: {
 								std::string str;
 								try {
@@ -909,7 +1934,8 @@ HRESULT CCWFGM_AttributeFilter::fixResolution(std::shared_ptr<validation::valida
 	if (!(gridEngine = m_gridEngine(nullptr)))				{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
 
 	/*POLYMORPHIC CHECK*/
-	if (FAILED(hr = gridEngine->GetDimensions(0, &m_xsize, &m_ysize)))
+	std::uint16_t xsize, ysize;
+	if (FAILED(hr = gridEngine->GetDimensions(0, &xsize, &ysize)))
 		return hr;
 	if (FAILED(hr = gridEngine->GetAttribute(nullptr, CWFGM_GRID_ATTRIBUTE_PLOTRESOLUTION, &var))) {
 		if (valid)
@@ -947,9 +1973,17 @@ HRESULT CCWFGM_AttributeFilter::fixResolution(std::shared_ptr<validation::valida
 	}
 	try { gridYLL = std::get<double>(var); } catch (std::bad_variant_access &) { weak_assert(false); return E_FAIL; };
 
-	m_resolution = gridResolution;
-	m_xllcorner = gridXLL;
-	m_yllcorner = gridYLL;
+	m_gridResolution = gridResolution;
+	m_gridXLLCorner = gridXLL;
+	m_gridYLLCorner = gridYLL;
+	if (!(m_flags & CCWFGMGRID_NATIVE_RESOLUTION)) {		// otherwise the array keeps its own geometry, and is sampled at the grid's
+		m_xsize = xsize;
+		m_ysize = ysize;
+		m_resolution = gridResolution;
+		m_iresolution = 1.0 / m_resolution;
+		m_xllcorner = gridXLL;
+		m_yllcorner = gridYLL;
+	}
 
 	return S_OK;
 }
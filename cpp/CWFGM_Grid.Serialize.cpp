@@ -20,6 +20,7 @@
 #include <cassert>
 #endif
 #include <exception>
+#include <memory>
 #include "ICWFGM_Fuel.h"
 #include "ICWFGM_GridEngine.h"
 #include "GridCom_ext.h"
@@ -33,15 +34,17 @@
 #include "gdalclient.h"
 #include "doubleBuilder.h"
 #include "GDALextras.h"
-#include "boost_compression.h"
+#include "GridArrayEncoding.h"
+#include "GridChunkedCompress.h"
 #include "str_printf.h"
 #include <errno.h>
 #include <float.h>
 #include <stdio.h>
-#include <GDALExporter.h>
 #include <ctime>
 #include <fstream>
 #include "GDALImporter.h"
+#include "GridMemoryFile.h"
+#include "GridRasterWriter.h"
 #include "filesystem.hpp"
 #include <boost/algorithm/string/predicate.hpp>
 
@@ -196,6 +199,7 @@ HRESULT CCWFGM_Grid::ImportGrid(const std::string & prj_file_name, const std::st
 
 	m_baseGrid.m_fuelArray = fuelArray;
 	m_baseGrid.m_fuelValidArray = fuelValidArray;
+	invalidateFuelBlobs();
 	m_flags |= CCWFGMGRID_VALID;
 	m_baseGrid.m_xsize = xsize;
 	m_baseGrid.m_ysize = ysize;
@@ -236,6 +240,69 @@ HRESULT CCWFGM_Grid::ImportGrid(const std::string & prj_file_name, const std::st
 }
 
 
+HRESULT CCWFGM_Grid::ImportGrid(const std::string & prj, const std::uint8_t *buffer, std::size_t length, bool forcePrj, long *fail_index) {
+	if ((!buffer) || (!length))
+		return E_INVALIDARG;
+
+	GridMemoryFile file(buffer, length);
+	return ImportGrid(prj, file.name(), forcePrj, fail_index);
+}
+
+
+HRESULT CCWFGM_Grid::ImportElevation(const std::string & prj, const std::uint8_t *buffer, std::size_t length, bool forcePrj, std::uint8_t *calc_bits) {
+	if ((!buffer) || (!length))
+		return E_INVALIDARG;
+
+	GridMemoryFile file(buffer, length);
+	return ImportElevation(prj, file.name(), forcePrj, calc_bits);
+}
+
+
+HRESULT CCWFGM_Grid::ProbeGrid(const std::string & grid_file_name, std::uint32_t sample_step, GridFileProbe *probe) {
+	if (!probe)									return E_POINTER;
+	if (!grid_file_name.length())				return E_INVALIDARG;
+
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+
+	std::vector<std::int32_t> sampled;
+	HRESULT hr = ProbeRasterFile(grid_file_name, sample_step, probe, sample_step ? &sampled : nullptr);
+	if (FAILED(hr))
+		return hr;
+
+	double scale = 1.0;
+	{
+		CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), SEM_TRUE);
+
+		OGRSpatialReferenceH sourceSRS = nullptr;
+		if (probe->projection.length())
+			sourceSRS = CCoordinateConverter::CreateSpatialReferenceFromWkt(probe->projection.c_str());
+		if ((m_sourceSRS) && (sourceSRS) && (!OSRIsSame(m_sourceSRS, sourceSRS, false)))
+			probe->compatibility = ERROR_GRID_LOCATION_OUT_OF_RANGE;
+		if ((sourceSRS) || (m_sourceSRS))
+			scale = OSRGetLinearUnits(sourceSRS ? sourceSRS : m_sourceSRS, nullptr);
+		if (sourceSRS)
+			OSRDestroySpatialReference(sourceSRS);
+	}
+
+	if (!probe->isInteger)
+		probe->compatibility = E_FAIL;
+	else if ((probe->compatibility == S_OK) && (m_baseGrid.m_xsize != (std::uint16_t)-1)) {
+		if ((m_baseGrid.m_xsize != probe->xsize) ||
+			(m_baseGrid.m_ysize != probe->ysize))
+			probe->compatibility = ERROR_GRID_SIZE_INCORRECT;
+		else if (fabs(m_baseGrid.m_resolution - probe->xresolution * scale) > 0.000001)
+			probe->compatibility = ERROR_GRID_UNSUPPORTED_RESOLUTION;
+		else if ((fabs(m_baseGrid.m_xllcorner - probe->xllcorner) > 0.001) ||
+			(fabs(m_baseGrid.m_yllcorner - probe->yllcorner) > 0.001))
+			probe->compatibility = ERROR_GRID_LOCATION_OUT_OF_RANGE;
+	}
+
+	if (sampled.size())
+		ProbeFuelHistogram(sampled, m_fuelMap.get(), probe);
+	return S_OK;
+}
+
+
 HRESULT CCWFGM_Grid::ImportGridWCS(const std::string & url, const std::string & layer, const std::string & username, const std::string & password, XY_Point lowerleft, XY_Point upperright) {
 	return E_NOTIMPL;
 }
@@ -520,6 +587,7 @@ HRESULT CCWFGM_Grid::ImportElevation(const std::string & prj_file_name, const st
 	if (m_baseGrid.m_elevationValidArray)
 		delete[] m_baseGrid.m_elevationValidArray;
 	m_baseGrid.m_elevationValidArray = elevationValid;
+	invalidateElevationBlobs();
 
 	memcpy(m_baseGrid.m_elevationFrequency, elevationFrequency, sizeof(std::uint32_t) * 65536);
 	delete [] elevationFrequency;
@@ -565,65 +633,48 @@ HRESULT CCWFGM_Grid::ImportElevation(const std::string & prj_file_name, const st
 }
 
 
-HRESULT CCWFGM_Grid::ExportGrid(const std::string & grid_file_name, std::uint32_t compression) {
-	std::string grid(grid_file_name);
-
-	if (grid.length() == 0)
+HRESULT CCWFGM_Grid::ExportGrid(const std::string & grid_file_name, std::uint32_t compression, std::uint32_t flags) {
+	if (grid_file_name.length() == 0)
 		return E_INVALIDARG;
 	
 	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
 
-	int* l_array = new int[m_baseGrid.m_xsize * m_baseGrid.m_ysize];
-	int* l_pointer = l_array;
-	std::uint8_t fuel_value;
-	bool f_valid;
-	for(std::uint16_t i = m_baseGrid.m_ysize - 1; i < m_baseGrid.m_ysize; i--) {
-		for(std::uint16_t j = 0; j < m_baseGrid.m_xsize; j++) {
-			XY_Point pt;
-			pt.x = m_baseGrid.invertX(((double)j) + 0.5);
-			pt.y = m_baseGrid.invertY(((double)i) + 0.5);
-			HRESULT hr = GetFuelIndexData(0, pt, WTime(0, &m_timeManager), &fuel_value, &f_valid, nullptr);
-			long file_index, export_index;
-			if ((hr == ERROR_FUELS_FUEL_UNKNOWN) || (!f_valid))
-				export_index = -9999;
-			else {
-				ICWFGM_Fuel *fuel;
-				m_fuelMap->FuelAtIndex(fuel_value, &file_index, &export_index, &fuel);
-			}
-
-			*l_pointer = export_index;
-			l_pointer++;
-		}
+	if ((!m_fuelMap) || (!m_baseGrid.m_fuelArray)) {
+		weak_assert(false);
+		return ERROR_GRID_UNINITIALIZED;
 	}
 
-	GDALExporter exporter;
-	exporter.AddTag("TIFFTAG_SOFTWARE", "W.I.S.E.");
-	exporter.AddTag("TIFFTAG_GDAL_NODATA", "-9999");
-	char mbstr[100];
-	std::time_t t = std::time(nullptr);
-	std::strftime(mbstr, sizeof(mbstr), "%Y-%m-%d %H:%M:%S %Z", std::localtime(&t));
-	exporter.AddTag("TIFFTAG_DATETIME", mbstr);
-	PolymorphicAttribute v;
-	GetAttribute(CWFGM_GRID_ATTRIBUTE_SPATIALREFERENCE, &v);
-	std::string ref;
+	GridRasterWriter writer;
+	HRESULT hr;
+	if (FAILED(hr = prepareExport(writer, flags)))
+		return hr;
+	writer.setExportCompress(compression);
+	std::uint16_t band = writer.addBand(GridRasterWriter::BandType::INT32, "Fuel");
+	if (FAILED(hr = writer.create(grid_file_name)))
+		return hr;
+
+	long table[256];
+	exportFuelTable(table);
+	const std::uint8_t *fuel = m_baseGrid.m_fuelArray;
+	const bool *valid = m_baseGrid.m_fuelValidArray;
+	hr = writer.writeBand<std::int32_t>(band, [fuel, valid, &table](std::uint32_t index) -> std::int32_t {
+		return valid[index] ? table[fuel[index]] : -9999;
+	});
+
+	HRESULT hr2 = writer.close();
+	return FAILED(hr) ? hr : hr2;
+}
 
-	/*POLYMORPHIC CHECK*/
-	try { ref = std::get<std::string>(v); } catch (std::bad_variant_access &) { weak_assert(false); return ERROR_PROJECTION_UNKNOWN; };
 
-	exporter.setExportCompress((GDALExporter::CompressionType)compression);
-	exporter.setProjection(ref.c_str());
-	exporter.setSize(m_baseGrid.m_xsize, m_baseGrid.m_ysize);
-	exporter.setPixelResolution(m_baseGrid.m_resolution, m_baseGrid.m_resolution);
-	exporter.setLowerLeft(m_baseGrid.m_xllcorner, m_baseGrid.m_yllcorner);
-	GDALExporter::ExportResult res = exporter.Export(l_array, grid.c_str(), "Fuel");
-	
-	if (l_array)
-		delete [] l_array;
-	
-	if (res == GDALExporter::ExportResult::ERROR_ACCESS)
-		return E_ACCESSDENIED;
-	
-	return S_OK;
+HRESULT CCWFGM_Grid::ExportGrid(std::vector<std::uint8_t> & buffer, const std::string & extension, std::uint32_t compression, std::uint32_t flags) {
+	GridMemoryFile file(extension.length() ? extension : ".tif");
+	HRESULT hr = ExportGrid(file.name(), compression, flags);
+	if (SUCCEEDED(hr)) {
+		HRESULT hr2 = file.read(buffer);
+		if (FAILED(hr2))
+			hr = hr2;
+	}
+	return hr;
 }
 
 
@@ -700,39 +751,8 @@ bool CCWFGM_Grid::fixWorldLocation() {
 	return false;
 }
 
-#endif
-
-
-HRESULT CCWFGM_Grid::ExportElevation(const std::string & grid_file_name) {
-	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
-
-	std::string grid;
 
-	if (!m_baseGrid.m_elevationArray) {
-		weak_assert(false);
-		return ERROR_GRID_UNINITIALIZED;
-	}
-	grid = grid_file_name;
-
-	if (grid.length() == 0)
-		return E_INVALIDARG;
-	
-	int* l_array = new int[m_baseGrid.m_xsize * m_baseGrid.m_ysize];
-	int* l_pointer = l_array;
-	for(std::uint16_t i = m_baseGrid.m_ysize - 1; i < m_baseGrid.m_ysize; i--) {
-		for(std::uint16_t j = 0; j < m_baseGrid.m_xsize; j++) {
-			*l_pointer = (!m_baseGrid.m_elevationValidArray[m_baseGrid.arrayIndex(j, i)]) ? -9999 : m_baseGrid.m_elevationArray[m_baseGrid.arrayIndex(j, i)];
-			l_pointer++;
-		}
-	}
-
-	GDALExporter exporter;
-	exporter.AddTag("TIFFTAG_SOFTWARE", "W.I.S.E.");
-	exporter.AddTag("TIFFTAG_GDAL_NODATA", "-9999");
-	char mbstr[100];
-	std::time_t t = std::time(nullptr);
-	std::strftime(mbstr, sizeof(mbstr), "%Y-%m-%d %H:%M:%S %Z", std::localtime(&t));
-	exporter.AddTag("TIFFTAG_DATETIME", mbstr);
+HRESULT CCWFGM_Grid::prepareExport(GridRasterWriter &writer, std::uint32_t flags) {
 	PolymorphicAttribute v;
 	GetAttribute(CWFGM_GRID_ATTRIBUTE_SPATIALREFERENCE, &v);
 	std::string ref;
@@ -740,26 +760,32 @@ HRESULT CCWFGM_Grid::ExportElevation(const std::string & grid_file_name) {
 	/*POLYMORPHIC CHECK*/
 	try { ref = std::get<std::string>(v); } catch (std::bad_variant_access &) { weak_assert(false); return ERROR_PROJECTION_UNKNOWN; };
 
-	exporter.setProjection(ref.c_str());
-	exporter.setSize(m_baseGrid.m_xsize, m_baseGrid.m_ysize);
-	exporter.setPixelResolution(m_baseGrid.m_resolution, m_baseGrid.m_resolution);
-	exporter.setLowerLeft(m_baseGrid.m_xllcorner, m_baseGrid.m_yllcorner);
-	GDALExporter::ExportResult res = exporter.Export(l_array, grid.c_str(), "Elevation");
-	
-	if (l_array)
-		delete [] l_array;
-	
-	if (res == GDALExporter::ExportResult::ERROR_ACCESS)
-		return E_ACCESSDENIED;
-
+	writer.addDefaultTags();
+	writer.setProjection(ref);
+	writer.setSize(m_baseGrid.m_xsize, m_baseGrid.m_ysize);
+	writer.setPixelResolution(m_baseGrid.m_resolution);
+	writer.setLowerLeft(m_baseGrid.m_xllcorner, m_baseGrid.m_yllcorner);
+	writer.setTiled((flags & CWFGM_GRID_EXPORT_TILED) ? true : false);
+	writer.setOverviews((flags & CWFGM_GRID_EXPORT_OVERVIEWS) ? true : false);
 	return S_OK;
 }
 
 
-HRESULT CCWFGM_Grid::ExportSlope(const std::string & grid_file_name) {
+void CCWFGM_Grid::exportFuelTable(long table[256]) const {
+	for (std::uint16_t i = 0; i < 256; i++) {
+		long file_index;
+		ICWFGM_Fuel *fuel;
+		m_fuelMap->FuelAtIndex((std::uint8_t)i, &file_index, &table[i], &fuel);
+	}
+}
+
+#endif
+
+
+HRESULT CCWFGM_Grid::ExportElevation(const std::string & grid_file_name, std::uint32_t flags) {
 	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
 
-	if (!m_baseGrid.m_slopeAzimuth) {
+	if ((!m_baseGrid.m_elevationArray) || (!m_baseGrid.m_elevationValidArray)) {
 		weak_assert(false);
 		return ERROR_GRID_UNINITIALIZED;
 	}
@@ -767,49 +793,59 @@ HRESULT CCWFGM_Grid::ExportSlope(const std::string & grid_file_name) {
 	if (grid_file_name.length() == 0)
 		return E_INVALIDARG;
 	
-	int* l_array = new int[m_baseGrid.m_xsize * m_baseGrid.m_ysize];
-	int* l_pointer = l_array;
-	for(std::uint16_t i=m_baseGrid.m_ysize-1;i<m_baseGrid.m_ysize;i--) {
-		for(std::uint16_t j = 0; j < m_baseGrid.m_xsize; j++) {
-			*l_pointer = (!m_baseGrid.m_terrainValidArray[m_baseGrid.arrayIndex(j,i)]) ? -9999 : m_baseGrid.m_slopeFactor[m_baseGrid.arrayIndex(j,i)];
-			l_pointer++;
-		}
-	}
+	GridRasterWriter writer;
+	HRESULT hr;
+	if (FAILED(hr = prepareExport(writer, flags)))
+		return hr;
+	std::uint16_t band = writer.addBand(GridRasterWriter::BandType::INT32, "Elevation", -9999.0, GridRasterWriter::Resample::AVERAGE);
+	if (FAILED(hr = writer.create(grid_file_name)))
+		return hr;
+
+	const std::int16_t *elev = m_baseGrid.m_elevationArray;
+	const bool *valid = m_baseGrid.m_elevationValidArray;
+	hr = writer.writeBand<std::int32_t>(band, [elev, valid](std::uint32_t index) -> std::int32_t {
+		return valid[index] ? elev[index] : -9999;
+	});
+
+	HRESULT hr2 = writer.close();
+	return FAILED(hr) ? hr : hr2;
+}
 
-	GDALExporter exporter;
-	exporter.AddTag("TIFFTAG_SOFTWARE", "W.I.S.E.");
-	exporter.AddTag("TIFFTAG_GDAL_NODATA", "-9999");
-	char mbstr[100];
-	std::time_t t = std::time(nullptr);
-	std::strftime(mbstr, sizeof(mbstr), "%Y-%m-%d %H:%M:%S %Z", std::localtime(&t));
-	exporter.AddTag("TIFFTAG_DATETIME", mbstr);
-	PolymorphicAttribute v;
-	GetAttribute(CWFGM_GRID_ATTRIBUTE_SPATIALREFERENCE, &v);
-	std::string ref;
 
-	/*POLYMORPHIC CHECK*/
-	try { ref = std::get<std::string>(v); } catch (std::bad_variant_access &) { weak_assert(false); return ERROR_PROJECTION_UNKNOWN; };
+HRESULT CCWFGM_Grid::ExportSlope(const std::string & grid_file_name) {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
 
-	exporter.setProjection(ref.c_str());
-	exporter.setSize(m_baseGrid.m_xsize, m_baseGrid.m_ysize);
-	exporter.setPixelResolution(m_baseGrid.m_resolution, m_baseGrid.m_resolution);
-	exporter.setLowerLeft(m_baseGrid.m_xllcorner, m_baseGrid.m_yllcorner);
-	GDALExporter::ExportResult res = exporter.Export(l_array, grid_file_name.c_str(), "Slope");
-	
-	if (l_array)
-		delete [] l_array;
-	
-	if (res == GDALExporter::ExportResult::ERROR_ACCESS)
-		return E_ACCESSDENIED;
+	if ((!m_baseGrid.m_slopeFactor) || (!m_baseGrid.m_terrainValidArray)) {
+		weak_assert(false);
+		return ERROR_GRID_UNINITIALIZED;
+	}
 
-	return S_OK;
+	if (grid_file_name.length() == 0)
+		return E_INVALIDARG;
+	
+	GridRasterWriter writer;
+	HRESULT hr;
+	if (FAILED(hr = prepareExport(writer, 0)))
+		return hr;
+	std::uint16_t band = writer.addBand(GridRasterWriter::BandType::INT32, "Slope");
+	if (FAILED(hr = writer.create(grid_file_name)))
+		return hr;
+
+	const std::uint16_t *slope = m_baseGrid.m_slopeFactor;
+	const bool *valid = m_baseGrid.m_terrainValidArray;
+	hr = writer.writeBand<std::int32_t>(band, [slope, valid](std::uint32_t index) -> std::int32_t {
+		return valid[index] ? slope[index] : -9999;
+	});
+
+	HRESULT hr2 = writer.close();
+	return FAILED(hr) ? hr : hr2;
 }
 
 
 HRESULT CCWFGM_Grid::ExportAspect(const std::string & grid_file_name) {
 	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
 
-	if (!m_baseGrid.m_slopeFactor) {
+	if ((!m_baseGrid.m_slopeAzimuth) || (!m_baseGrid.m_terrainValidArray)) {
 		weak_assert(false);
 		return ERROR_GRID_UNINITIALIZED;
 	}
@@ -817,48 +853,120 @@ HRESULT CCWFGM_Grid::ExportAspect(const std::string & grid_file_name) {
 	if(grid_file_name.length() == 0)
 		return E_INVALIDARG;
 	
-	int* l_array = new int[m_baseGrid.m_xsize * m_baseGrid.m_ysize];
-	int* l_pointer = l_array;
-	for(std::uint16_t i = m_baseGrid.m_ysize - 1; i < m_baseGrid.m_ysize; i--) {
-		for(std::uint16_t j = 0; j < m_baseGrid.m_xsize; j++) {
-			std::uint32_t idx = m_baseGrid.arrayIndex(j, i);
-			if (!m_baseGrid.m_terrainValidArray[idx])
-				*l_pointer = -9999.0;
-			else if (m_baseGrid.m_slopeAzimuth[idx] == (std::uint16_t)-1)
-				*l_pointer = 0.0;
-			else
-				*l_pointer = m_baseGrid.m_slopeAzimuth[idx];
-			l_pointer++;
+	GridRasterWriter writer;
+	HRESULT hr;
+	if (FAILED(hr = prepareExport(writer, 0)))
+		return hr;
+	std::uint16_t band = writer.addBand(GridRasterWriter::BandType::INT32, "Aspect");
+	if (FAILED(hr = writer.create(grid_file_name)))
+		return hr;
+
+	const std::uint16_t *azimuth = m_baseGrid.m_slopeAzimuth;
+	const bool *valid = m_baseGrid.m_terrainValidArray;
+	hr = writer.writeBand<std::int32_t>(band, [azimuth, valid](std::uint32_t index) -> std::int32_t {
+		if (!valid[index])
+			return -9999;
+		if (azimuth[index] == (std::uint16_t)-1)
+			return 0;
+		return azimuth[index];
+	});
+
+	HRESULT hr2 = writer.close();
+	return FAILED(hr) ? hr : hr2;
+}
+
+
+HRESULT CCWFGM_Grid::ExportTerrain(const std::string & grid_file_name, std::uint32_t flags) {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+
+	if ((!m_baseGrid.m_elevationArray) || (!m_baseGrid.m_elevationValidArray) ||
+	    (!m_baseGrid.m_slopeFactor) || (!m_baseGrid.m_slopeAzimuth) || (!m_baseGrid.m_terrainValidArray)) {
+		weak_assert(false);
+		return ERROR_GRID_UNINITIALIZED;
+	}
+
+	if (grid_file_name.length() == 0)
+		return E_INVALIDARG;
+
+	GridRasterWriter writer;
+	HRESULT hr;
+	if (FAILED(hr = prepareExport(writer, flags)))
+		return hr;
+	const std::uint16_t bands[3] = {
+		writer.addBand(GridRasterWriter::BandType::INT32, "Elevation", -9999.0, GridRasterWriter::Resample::AVERAGE),
+		writer.addBand(GridRasterWriter::BandType::INT32, "Slope", -9999.0, GridRasterWriter::Resample::AVERAGE),
+		writer.addBand(GridRasterWriter::BandType::INT32, "Aspect", -9999.0)
+	};
+	if (FAILED(hr = writer.create(grid_file_name)))
+		return hr;
+
+	const std::int16_t *elev = m_baseGrid.m_elevationArray;
+	const bool *elev_valid = m_baseGrid.m_elevationValidArray;
+	const std::uint16_t *slope = m_baseGrid.m_slopeFactor;
+	const std::uint16_t *azimuth = m_baseGrid.m_slopeAzimuth;
+	const bool *terrain_valid = m_baseGrid.m_terrainValidArray;
+	hr = writer.writeBands<std::int32_t>(bands, [elev, elev_valid, slope, azimuth, terrain_valid](std::uint32_t index, std::int32_t *values) {
+		values[0] = elev_valid[index] ? elev[index] : -9999;
+		if (!terrain_valid[index]) {
+			values[1] = -9999;
+			values[2] = -9999;
+		}
+		else {
+			values[1] = slope[index];
+			values[2] = (azimuth[index] == (std::uint16_t)-1) ? 0 : azimuth[index];
 		}
+	});
+
+	HRESULT hr2 = writer.close();
+	return FAILED(hr) ? hr : hr2;
+}
+
+
+HRESULT CCWFGM_Grid::ExportElevation(std::vector<std::uint8_t> & buffer, const std::string & extension, std::uint32_t flags) {
+	GridMemoryFile file(extension.length() ? extension : ".tif");
+	HRESULT hr = ExportElevation(file.name(), flags);
+	if (SUCCEEDED(hr)) {
+		HRESULT hr2 = file.read(buffer);
+		if (FAILED(hr2))
+			hr = hr2;
 	}
+	return hr;
+}
 
-	GDALExporter exporter;
-	exporter.AddTag("TIFFTAG_SOFTWARE", "W.I.S.E.");
-	exporter.AddTag("TIFFTAG_GDAL_NODATA", "-9999");
-	char mbstr[100];
-	std::time_t t = std::time(nullptr);
-	std::strftime(mbstr, sizeof(mbstr), "%Y-%m-%d %H:%M:%S %Z", std::localtime(&t));
-	exporter.AddTag("TIFFTAG_DATETIME", mbstr);
-	PolymorphicAttribute v;
-	GetAttribute(CWFGM_GRID_ATTRIBUTE_SPATIALREFERENCE, &v);
-	std::string ref;
 
-	/*POLYMORPHIC CHECK*/
-	try { ref = std::get<std::string>(v); } catch (std::bad_variant_access &) { weak_assert(false); return ERROR_PROJECTION_UNKNOWN; };
+HRESULT CCWFGM_Grid::ExportSlope(std::vector<std::uint8_t> & buffer, const std::string & extension) {
+	GridMemoryFile file(extension.length() ? extension : ".tif");
+	HRESULT hr = ExportSlope(file.name());
+	if (SUCCEEDED(hr)) {
+		HRESULT hr2 = file.read(buffer);
+		if (FAILED(hr2))
+			hr = hr2;
+	}
+	return hr;
+}
 
-	exporter.setProjection(ref.c_str());
-	exporter.setSize(m_baseGrid.m_xsize, m_baseGrid.m_ysize);
-	exporter.setPixelResolution(m_baseGrid.m_resolution, m_baseGrid.m_resolution);
-	exporter.setLowerLeft(m_baseGrid.m_xllcorner, m_baseGrid.m_yllcorner);
-	GDALExporter::ExportResult res = exporter.Export(l_array, grid_file_name.c_str(), "Aspect");
-	
-	if (l_array)
-		delete [] l_array;
-	
-	if (res == GDALExporter::ExportResult::ERROR_ACCESS)
-		return E_ACCESSDENIED;
 
-	return S_OK;
+HRESULT CCWFGM_Grid::ExportAspect(std::vector<std::uint8_t> & buffer, const std::string & extension) {
+	GridMemoryFile file(extension.length() ? extension : ".tif");
+	HRESULT hr = ExportAspect(file.name());
+	if (SUCCEEDED(hr)) {
+		HRESULT hr2 = file.read(buffer);
+		if (FAILED(hr2))
+			hr = hr2;
+	}
+	return hr;
+}
+
+
+HRESULT CCWFGM_Grid::ExportTerrain(std::vector<std::uint8_t> & buffer, const std::string & extension, std::uint32_t flags) {
+	GridMemoryFile file(extension.length() ? extension : ".tif");
+	HRESULT hr = ExportTerrain(file.name(), flags);
+	if (SUCCEEDED(hr)) {
+		HRESULT hr2 = file.read(buffer);
+		if (FAILED(hr2))
+			hr = hr2;
+	}
+	return hr;
 }
 
 
@@ -869,6 +977,8 @@ std::int32_t CCWFGM_Grid::serialVersionUid(const SerializeProtoOptions& options)
 
 WISE::GridProto::CwfgmGrid* CCWFGM_Grid::serialize(const SerializeProtoOptions& options)
 {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);		// keeps edits, which invalidate the retained blobs, out until the arrays are written
+
 	auto grid = new WISE::GridProto::CwfgmGrid();
 	grid->set_version(serialVersionUid(options));
 
@@ -884,6 +994,7 @@ WISE::GridProto::CwfgmGrid* CCWFGM_Grid::serialize(const SerializeProtoOptions&
 	grid->set_allocated_lllocation(location);
 
 	std::uint64_t size = m_baseGrid.m_xsize * m_baseGrid.m_ysize;
+	const GridChunkedCompress::Codec codec = GridChunkedCompress::saveCodec();
 
 	//fuel map
 	{
@@ -899,8 +1010,17 @@ WISE::GridProto::CwfgmGrid* CCWFGM_Grid::serialize(const SerializeProtoOptions&
 		}
 		else {
 			binary->set_allocated_iszipped(createProtobufObject(true));
-			binary->set_data(Compress::compress(reinterpret_cast<const char*>(m_baseGrid.m_fuelArray), size));
-			binary->set_datavalid(Compress::compress(reinterpret_cast<const char*>(m_baseGrid.m_fuelValidArray), size));
+			binary->set_codec((WISE::GridProto::ZipCodec)codec);
+			if (GridArrayEncoding::saveEncoded()) {
+				binary->set_encoding(WISE::GridProto::ENCODING_FUEL_RLE);
+				m_fuelEncodedBlob.compress([this, size]() {
+					return GridArrayEncoding::encodeFuel(m_baseGrid.m_fuelArray, m_baseGrid.m_fuelValidArray, size);
+				}, codec, binary->mutable_encodeddata());
+			}
+			else {
+				m_fuelBlob.compress(reinterpret_cast<const char*>(m_baseGrid.m_fuelArray), size, codec, binary->mutable_data());
+				m_fuelValidBlob.compress(reinterpret_cast<const char*>(m_baseGrid.m_fuelValidArray), size, codec, binary->mutable_datavalid());
+			}
 		}
 		wcs->set_allocated_binary(binary);
 		fuelmap->set_allocated_contents(wcs);
@@ -921,14 +1041,52 @@ WISE::GridProto::CwfgmGrid* CCWFGM_Grid::serialize(const SerializeProtoOptions&
 		}
 		else {
 			binary->set_allocated_iszipped(createProtobufObject(true));
-			binary->set_data(Compress::compress(reinterpret_cast<const char*>(m_baseGrid.m_elevationArray), size * sizeof(std::uint16_t)));
-			binary->set_datavalid(Compress::compress(reinterpret_cast<const char*>(m_baseGrid.m_elevationValidArray), size));
+			binary->set_codec((WISE::GridProto::ZipCodec)codec);
+			if (GridArrayEncoding::saveEncoded()) {
+				binary->set_encoding(WISE::GridProto::ENCODING_ROW_DELTA);
+				m_elevationEncodedBlob.compress([this]() {
+					return GridArrayEncoding::encodeRowDelta(m_baseGrid.m_elevationArray, m_baseGrid.m_xsize, m_baseGrid.m_ysize);
+				}, codec, binary->mutable_encodeddata());
+			}
+			else
+				m_elevationBlob.compress(reinterpret_cast<const char*>(m_baseGrid.m_elevationArray), size * sizeof(std::uint16_t), codec, binary->mutable_data());
+			m_elevationValidBlob.compress(reinterpret_cast<const char*>(m_baseGrid.m_elevationValidArray), size, codec, binary->mutable_datavalid());
 		}
 		wcs->set_allocated_binary(binary);
 		auto elevation = new WISE::GridProto::CwfgmGrid_ElevationFile();
 		elevation->set_allocated_contents(wcs);
 		grid->set_allocated_elevation(elevation);
 	}
+	//slope and azimuth, only if they are still the ones derived from the elevation grid being saved
+	if ((m_baseGrid.m_slopeFactor) && (m_baseGrid.m_slopeAzimuth) && (m_baseGrid.m_terrainValidArray) && (m_baseGrid.m_terrainChecksum) &&
+	    (!m_baseGrid.m_terrainStale)) {
+		auto terrain = new WISE::GridProto::CwfgmGrid_TerrainCache();
+		terrain->set_elevationchecksum(m_baseGrid.m_terrainChecksum);
+		auto wcsArray = [&](const std::uint16_t *array, GridRetainedBlob &blob, const bool *valid, GridRetainedBlob *validBlob) {
+			auto wcs = new WISE::GridProto::wcsData();
+			wcs->set_version(1);
+			wcs->set_xsize(m_baseGrid.m_xsize);
+			wcs->set_ysize(m_baseGrid.m_ysize);
+			auto binary = new WISE::GridProto::wcsData_binaryData();
+			if (options.useVerboseOutput() || !options.zipOutput()) {
+				binary->set_data(array, size * sizeof(std::uint16_t));
+				if (valid)
+					binary->set_datavalid(valid, size);
+			}
+			else {
+				binary->set_allocated_iszipped(createProtobufObject(true));
+				binary->set_codec((WISE::GridProto::ZipCodec)codec);
+				blob.compress(reinterpret_cast<const char*>(array), size * sizeof(std::uint16_t), codec, binary->mutable_data());
+				if (valid)
+					validBlob->compress(reinterpret_cast<const char*>(valid), size, codec, binary->mutable_datavalid());
+			}
+			wcs->set_allocated_binary(binary);
+			return wcs;
+		};
+		terrain->set_allocated_slopefactor(wcsArray(m_baseGrid.m_slopeFactor, m_slopeBlob, m_baseGrid.m_terrainValidArray, &m_terrainValidBlob));
+		terrain->set_allocated_slopeazimuth(wcsArray(m_baseGrid.m_slopeAzimuth, m_azimuthBlob, nullptr, nullptr));
+		grid->set_allocated_terrain(terrain);
+	}
 
 	auto projection = new WISE::GridProto::CwfgmGrid_ProjectionFile();
 	if (m_projectionContents.length() > 0)
@@ -950,6 +1108,96 @@ WISE::GridProto::CwfgmGrid* CCWFGM_Grid::serialize(const SerializeProtoOptions&
 }
 
 
+HRESULT CCWFGM_Grid::GetTiles(std::uint16_t tile_size, std::uint16_t halo, std::vector<GridTile> *tiles) {
+	if (!tiles)									return E_POINTER;
+	if (!tile_size)								return E_INVALIDARG;
+	if (!(m_flags & CCWFGMGRID_VALID))			return ERROR_GRID_UNINITIALIZED;
+
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+	*tiles = PartitionGridTiles(m_baseGrid.m_xsize, m_baseGrid.m_ysize, m_baseGrid.m_xllcorner, m_baseGrid.m_yllcorner, m_baseGrid.m_resolution, tile_size, halo);
+	return S_OK;
+}
+
+
+HRESULT CCWFGM_Grid::GetTile(GridTile *tile) {
+	if (!tile)									return E_POINTER;
+
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+	if (!m_tile.has_value())
+		return S_FALSE;
+	*tile = m_tile.value();
+	tile->xllcorner = m_baseGrid.m_xllcorner;
+	tile->yllcorner = m_baseGrid.m_yllcorner;
+	tile->resolution = m_baseGrid.m_resolution;
+	return S_OK;
+}
+
+
+WISE::GridProto::CwfgmGrid* CCWFGM_Grid::serializeTile(const SerializeProtoOptions& options, const GridTile &tile)
+{
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+
+	if ((tile.fullXSize != m_baseGrid.m_xsize) || (tile.fullYSize != m_baseGrid.m_ysize) || (!tile.xsize) || (!tile.ysize) ||
+	    ((std::uint32_t)tile.x + tile.xsize > m_baseGrid.m_xsize) || ((std::uint32_t)tile.y + tile.ysize > m_baseGrid.m_ysize))
+		return nullptr;
+
+	// a stand-alone grid holding just the tile, so it serializes exactly like a whole grid does
+	boost::intrusive_ptr<CCWFGM_Grid> t(new CCWFGM_Grid());
+	GridData &gd = t->m_baseGrid;
+	gd.m_xsize = tile.xsize;
+	gd.m_ysize = tile.ysize;
+	gd.m_resolution = m_baseGrid.m_resolution;
+	gd.m_iresolution = m_baseGrid.m_iresolution;
+	gd.m_xllcorner = m_baseGrid.m_xllcorner + tile.x * m_baseGrid.m_resolution;
+	gd.m_yllcorner = m_baseGrid.m_yllcorner + tile.y * m_baseGrid.m_resolution;
+
+	const std::uint64_t size = (std::uint64_t)tile.xsize * (std::uint64_t)tile.ysize;
+	auto crop = [&](const auto *src, auto *&dest) {
+		if (src) {
+			dest = new std::remove_const_t<std::remove_pointer_t<decltype(src)>>[size];
+			CropGridArray(src, m_baseGrid.m_xsize, m_baseGrid.m_ysize, tile.x, tile.y, tile.xsize, tile.ysize, sizeof(*src), dest);
+		}
+	};
+	crop(m_baseGrid.m_fuelArray, gd.m_fuelArray);
+	crop(m_baseGrid.m_fuelValidArray, gd.m_fuelValidArray);
+	crop(m_baseGrid.m_elevationArray, gd.m_elevationArray);
+	crop(m_baseGrid.m_elevationValidArray, gd.m_elevationValidArray);
+	if ((m_baseGrid.m_slopeFactor) && (m_baseGrid.m_slopeAzimuth) && (m_baseGrid.m_terrainValidArray) && (m_baseGrid.m_terrainChecksum) &&
+	    (!m_baseGrid.m_terrainStale)) {
+		crop(m_baseGrid.m_slopeFactor, gd.m_slopeFactor);
+		crop(m_baseGrid.m_slopeAzimuth, gd.m_slopeAzimuth);
+		crop(m_baseGrid.m_terrainValidArray, gd.m_terrainValidArray);
+		gd.m_terrainChecksum = gd.terrainChecksum();
+	}
+
+	t->m_projectionContents = m_projectionContents;
+	t->m_header = m_header;
+	t->m_units = m_units;
+	if (m_sourceSRS) {
+		CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+		t->m_sourceSRS = OSRClone(m_sourceSRS);
+	}
+	if (!t->fixWorldLocation())
+		t->m_worldLocation = m_worldLocation;
+
+	auto grid = t->serialize(options);
+
+	auto proto = new WISE::GridProto::GridTile();
+	proto->set_column(tile.column);
+	proto->set_row(tile.row);
+	proto->set_xoffset(tile.x);
+	proto->set_yoffset(tile.y);
+	proto->set_corexoffset(tile.coreX);
+	proto->set_coreyoffset(tile.coreY);
+	proto->set_corexsize(tile.coreXSize);
+	proto->set_coreysize(tile.coreYSize);
+	proto->set_fullxsize(tile.fullXSize);
+	proto->set_fullysize(tile.fullYSize);
+	grid->set_allocated_tile(proto);
+	return grid;
+}
+
+
 CCWFGM_Grid *CCWFGM_Grid::deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) {
 	auto grid = dynamic_cast_assert<const WISE::GridProto::CwfgmGrid*>(&proto);
 	double value;
@@ -994,6 +1242,42 @@ CCWFGM_Grid *CCWFGM_Grid::deserialize(const google::protobuf::Message& proto, st
 		m_baseGrid.m_resolution = DoubleBuilder().withProtobuf(grid->resolution(), myValid, "resolution").getValue();
 		m_baseGrid.m_iresolution = 1.0 / m_baseGrid.m_resolution;
 	}
+	if (grid->has_tile()) {
+		const auto &tile = grid->tile();
+		if ((tile.xoffset() + m_baseGrid.m_xsize > tile.fullxsize()) || (tile.yoffset() + m_baseGrid.m_ysize > tile.fullysize()) ||
+		    (tile.corexoffset() < tile.xoffset()) || (tile.coreyoffset() < tile.yoffset()) ||
+		    (tile.corexoffset() + tile.corexsize() > tile.xoffset() + m_baseGrid.m_xsize) ||
+		    (tile.coreyoffset() + tile.coreysize() > tile.yoffset() + m_baseGrid.m_ysize) || (tile.fullxsize() >= 65535) || (tile.fullysize() >= 65535)) {
+			if (myValid)
+				/// <summary>
+				/// The tile doesn't fit in the grid it claims to have been cut from, or its core doesn't fit in the tile.
+				/// </summary>
+				/// <type>user</type>
+				myValid->add_child_validation("WISE.GridProto.GridTile", "tile", validation::error_level::SEVERE, validation::id::value_invalid,
+					strprintf("%d, %d", (int)tile.column(), (int)tile.row()));
+			m_loadWarning = "Error: WISE.GridProto.CwfgmGrid: Invalid tile in imported file.";
+			throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmGrid: Invalid tile in imported file.");
+		}
+		GridTile t;
+		t.column = (std::uint16_t)tile.column();
+		t.row = (std::uint16_t)tile.row();
+		t.x = (std::uint16_t)tile.xoffset();
+		t.y = (std::uint16_t)tile.yoffset();
+		t.xsize = m_baseGrid.m_xsize;
+		t.ysize = m_baseGrid.m_ysize;
+		t.coreX = (std::uint16_t)tile.corexoffset();
+		t.coreY = (std::uint16_t)tile.coreyoffset();
+		t.coreXSize = (std::uint16_t)tile.corexsize();
+		t.coreYSize = (std::uint16_t)tile.coreysize();
+		t.fullXSize = (std::uint16_t)tile.fullxsize();
+		t.fullYSize = (std::uint16_t)tile.fullysize();
+		t.xllcorner = m_baseGrid.m_xllcorner;
+		t.yllcorner = m_baseGrid.m_yllcorner;
+		t.resolution = m_baseGrid.m_resolution;
+		m_tile = t;
+	}
+	else
+		m_tile.reset();
 
 	if (grid->has_lllocation()) {
 		value = DEGREE_TO_RADIAN(DoubleBuilder().withProtobuf(grid->lllocation().latitude(), myValid, "ll_latitude").getValue());
@@ -1073,6 +1357,10 @@ CCWFGM_Grid *CCWFGM_Grid::deserialize(const google::protobuf::Message& proto, st
 				OSRDestroySpatialReference(m_sourceSRS);
 
 			m_sourceSRS = CCoordinateConverter::CreateSpatialReferenceFromWkt(grid->projection().wkt().value().c_str());
+			{
+				CThreadSemaphoreEngage token(&m_tokenlock, SEM_TRUE);
+				m_tokens.clear();
+			}
 
 			char *units = nullptr;
 			OSRGetLinearUnits(m_sourceSRS, &units);
@@ -1084,34 +1372,65 @@ CCWFGM_Grid *CCWFGM_Grid::deserialize(const google::protobuf::Message& proto, st
 			m_units = grid->projection().units().value();
 	}
 
+	invalidateFuelBlobs();
+	invalidateElevationBlobs();
+	invalidateTerrainBlobs();
+
 	std::uint64_t size = m_baseGrid.m_xsize * m_baseGrid.m_ysize;
 	if (grid->has_fuelmap()) {
-		auto fuelmap = grid->fuelmap();
+		const auto &fuelmap = grid->fuelmap();
 		if (fuelmap.has_contents()) {
-			if (fuelmap.contents().binary().has_iszipped() && fuelmap.contents().binary().iszipped().value()) {
-				std::string data = Compress::decompress(fuelmap.contents().binary().data());
-				std::string valid = Compress::decompress(fuelmap.contents().binary().datavalid());
-				if (data.length() != valid.length() || data.length() != size) {
+			const auto &binary = fuelmap.contents().binary();
+			if (binary.has_iszipped() && binary.iszipped().value() && ((!GridChunkedCompress::isCodec(binary.codec())) ||
+			    ((binary.encoding() != WISE::GridProto::ENCODING_RAW) && (binary.encoding() != WISE::GridProto::ENCODING_FUEL_RLE)))) {
+				if (myValid)
+					/// <summary>
+					/// The fuel map was compressed or encoded in a way this version doesn't support.
+					/// </summary>
+					/// <type>user</type>
+					myValid->add_child_validation("WISE.GridProto.CwfgmGrid", "fuelmap.contents.codec", validation::error_level::SEVERE,
+						validation::id::enum_invalid, strprintf("%d, %d", (int)binary.codec(), (int)binary.encoding()));
+				m_loadWarning = "Error: WISE.GridProto.CwfgmGrid: Unsupported compression in imported file.";
+				throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmGrid: Unsupported compression in imported file.");
+			}
+			m_baseGrid.m_fuelArray = new std::uint8_t[size];
+			m_baseGrid.m_fuelValidArray = new bool[size];
+			if (binary.has_iszipped() && binary.iszipped().value()) {
+				const GridChunkedCompress::Codec codec = GridChunkedCompress::toCodec(binary.codec());
+				size_t data, valid;
+				if (binary.encoding() == WISE::GridProto::ENCODING_FUEL_RLE) {
+					std::string encoded = GridChunkedCompress::decompress(binary.encodeddata(), codec);
+					data = valid = GridArrayEncoding::decodeFuel(encoded, m_baseGrid.m_fuelArray, m_baseGrid.m_fuelValidArray, size) ? size : 0;
+				}
+				else {
+					data = GridChunkedCompress::decompress(binary.data(), m_baseGrid.m_fuelArray, size, codec);
+					valid = GridChunkedCompress::decompress(binary.datavalid(), m_baseGrid.m_fuelValidArray, size, codec);
+				}
+				if (data != valid || data != size) {
+					delete[] m_baseGrid.m_fuelArray;
+					delete[] m_baseGrid.m_fuelValidArray;
+					m_baseGrid.m_fuelArray = nullptr;
+					m_baseGrid.m_fuelValidArray = nullptr;
 					if (myValid)
 						/// <summary>
 						/// The size of the fuelmap valid archive doesn't match the size of the fuelmap archive.
 						/// </summary>
 						/// <type>user</type>
 						myValid->add_child_validation("WISE.GridProto.CwfgmGrid", "fuelmap.contents", validation::error_level::SEVERE, "Archive.Decompress:Invalid",
-							strprintf("%d != %d", (int)data.length(), (int)valid.length()));
+							strprintf("%d != %d", (int)data, (int)valid));
 					m_loadWarning = "Error: WISE.GridProto.CwfgmGrid: Invalid fuel grid in imported file.";
 					throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmGrid: Invalid fuel grid in imported file.");
 				}
-				m_baseGrid.m_fuelArray = new std::uint8_t[size];
-				m_baseGrid.m_fuelValidArray = new bool[size];
-				std::copy(data.begin(), data.end(), m_baseGrid.m_fuelArray);
-				std::copy(valid.begin(), valid.end(), m_baseGrid.m_fuelValidArray);
+				if (binary.encoding() == WISE::GridProto::ENCODING_FUEL_RLE)
+					m_fuelEncodedBlob.retain(binary.encodeddata(), codec);
+				else {
+					m_fuelBlob.retain(binary.data(), codec);
+					m_fuelValidBlob.retain(binary.datavalid(), codec);
+				}
 			}
 			else {
-				m_baseGrid.m_fuelArray = new std::uint8_t[size];
-				m_baseGrid.m_fuelValidArray = new bool[size];
-				std::copy(fuelmap.contents().binary().data().begin(), fuelmap.contents().binary().data().end(), m_baseGrid.m_fuelArray);
-				std::copy(fuelmap.contents().binary().datavalid().begin(), fuelmap.contents().binary().datavalid().end(), m_baseGrid.m_fuelValidArray);
+				std::copy(binary.data().begin(), binary.data().end(), m_baseGrid.m_fuelArray);
+				std::copy(binary.datavalid().begin(), binary.datavalid().end(), m_baseGrid.m_fuelValidArray);
 			}
 		}
 		else if (fuelmap.has_filename() && projectionFile.length() > 0) {
@@ -1242,7 +1561,7 @@ CCWFGM_Grid *CCWFGM_Grid::deserialize(const google::protobuf::Message& proto, st
 
 	if (grid->has_elevation()) {
 		if (grid->elevation().has_contents()) {
-			WISE::GridProto::wcsData data = grid->elevation().contents();
+			const WISE::GridProto::wcsData &data = grid->elevation().contents();
 			if (grid->has_nodataelevation()) {
 				value = DoubleBuilder().withProtobuf(grid->nodataelevation()).getValue();
 
@@ -1258,28 +1577,52 @@ CCWFGM_Grid *CCWFGM_Grid::deserialize(const google::protobuf::Message& proto, st
 				m_flags |= CCWFGMGRID_DEFAULT_ELEV_SET;
 				m_defaultElevation = value;
 			}
+			if (data.binary().has_iszipped() && data.binary().iszipped().value() && ((!GridChunkedCompress::isCodec(data.binary().codec())) ||
+			    ((data.binary().encoding() != WISE::GridProto::ENCODING_RAW) && (data.binary().encoding() != WISE::GridProto::ENCODING_ROW_DELTA)))) {
+				if (myValid)
+					/// <summary>
+					/// The elevation grid was compressed or encoded in a way this version doesn't support.
+					/// </summary>
+					/// <type>user</type>
+					myValid->add_child_validation("WISE.GridProto.CwfgmGrid", "elevation.contents.codec", validation::error_level::SEVERE,
+						validation::id::enum_invalid, strprintf("%d, %d", (int)data.binary().codec(), (int)data.binary().encoding()));
+				m_loadWarning = "Error: WISE.GridProto.CwfgmGrid: Unsupported compression in imported file.";
+				throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmGrid: Unsupported compression in imported file.");
+			}
+			m_baseGrid.m_elevationArray = new std::int16_t[size];
+			m_baseGrid.m_elevationValidArray = new bool[size];
 			if (data.binary().has_iszipped() && data.binary().iszipped().value()) {
-				std::string arr = Compress::decompress(data.binary().data());
-				std::string valid = Compress::decompress(data.binary().datavalid());
-				if (arr.length() != (valid.length() * sizeof(std::uint16_t)) || valid.length() != size) {
+				const GridChunkedCompress::Codec codec = GridChunkedCompress::toCodec(data.binary().codec());
+				size_t arr;
+				if (data.binary().encoding() == WISE::GridProto::ENCODING_ROW_DELTA) {
+					std::string encoded = GridChunkedCompress::decompress(data.binary().encodeddata(), codec);
+					arr = GridArrayEncoding::decodeRowDelta(encoded, m_baseGrid.m_elevationArray, m_baseGrid.m_xsize, m_baseGrid.m_ysize) ? size * sizeof(std::uint16_t) : 0;
+				}
+				else
+					arr = GridChunkedCompress::decompress(data.binary().data(), m_baseGrid.m_elevationArray, size * sizeof(std::uint16_t), codec);
+				size_t valid = GridChunkedCompress::decompress(data.binary().datavalid(), m_baseGrid.m_elevationValidArray, size, codec);
+				if (arr != (valid * sizeof(std::uint16_t)) || valid != size) {
+					delete[] m_baseGrid.m_elevationArray;
+					delete[] m_baseGrid.m_elevationValidArray;
+					m_baseGrid.m_elevationArray = nullptr;
+					m_baseGrid.m_elevationValidArray = nullptr;
 					if (myValid)
 						/// <summary>
 						/// The size of the elevation grid valid archive doesn't match the size of the elevation grid archive.
 						/// </summary>
 						/// <type>user</type>
 						myValid->add_child_validation("WISE.GridProto.CwfgmGrid", "elevation.contents", validation::error_level::SEVERE, "Archive.Decompress:Invalid",
-							strprintf("%d != %d", (int)arr.length(), (int)valid.length()));
+							strprintf("%d != %d", (int)arr, (int)valid));
 					m_loadWarning = "Error: WISE.GridProto.CwfgmGrid: Invalid elevation grid in imported file.";
 					throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmGrid: Invalid elevation grid in imported file.");
 				}
-				m_baseGrid.m_elevationArray = new std::int16_t[size];
-				m_baseGrid.m_elevationValidArray = new bool[size];
-				std::copy(arr.begin(), arr.end(), reinterpret_cast<std::uint8_t*>(m_baseGrid.m_elevationArray));
-				std::copy(valid.begin(), valid.end(), m_baseGrid.m_elevationValidArray);
+				if (data.binary().encoding() == WISE::GridProto::ENCODING_ROW_DELTA)
+					m_elevationEncodedBlob.retain(data.binary().encodeddata(), codec);
+				else
+					m_elevationBlob.retain(data.binary().data(), codec);
+				m_elevationValidBlob.retain(data.binary().datavalid(), codec);
 			}
 			else {
-				m_baseGrid.m_elevationArray = new std::int16_t[size];
-				m_baseGrid.m_elevationValidArray = new bool[size];
 				std::copy(data.binary().data().begin(), data.binary().data().end(), reinterpret_cast<std::uint8_t*>(m_baseGrid.m_elevationArray));
 				std::copy(data.binary().datavalid().begin(), data.binary().datavalid().end(), m_baseGrid.m_elevationValidArray);
 			}
@@ -1386,9 +1729,11 @@ CCWFGM_Grid *CCWFGM_Grid::deserialize(const google::protobuf::Message& proto, st
 	}
 
 	if (m_baseGrid.m_elevationArray) {
-		std::uint8_t calc_bits;
-		calculateSlopeFactorAndAzimuth(nullptr, &calc_bits);
-		calcWarnings(calc_bits);
+		if (!restoreTerrain(grid)) {
+			std::uint8_t calc_bits = 0;
+			calculateSlopeFactorAndAzimuth(nullptr, &calc_bits);
+			calcWarnings(calc_bits);
+		}
 
 		m_baseGrid.m_minElev = 32767;
 		m_baseGrid.m_maxElev = -32768;
@@ -1438,6 +1783,75 @@ CCWFGM_Grid *CCWFGM_Grid::deserialize(const google::protobuf::Message& proto, st
 }
 
 
+/*!
+Restores the slope factor and azimuth arrays saved with the grid, if they were derived from exactly the elevation and fuel data
+that has just been loaded.  Returns false if they have to be recalculated.
+*/
+bool CCWFGM_Grid::restoreTerrain(const WISE::GridProto::CwfgmGrid *grid) {
+	if ((!grid->has_terrain()) || (!grid->terrain().has_slopefactor()) || (!grid->terrain().has_slopeazimuth()))
+		return false;
+	const auto &terrain = grid->terrain();
+	if ((terrain.slopefactor().xsize() != m_baseGrid.m_xsize) || (terrain.slopefactor().ysize() != m_baseGrid.m_ysize) ||
+	    (terrain.slopeazimuth().xsize() != m_baseGrid.m_xsize) || (terrain.slopeazimuth().ysize() != m_baseGrid.m_ysize))
+		return false;
+	const std::uint64_t checksum = m_baseGrid.terrainChecksum();
+	if (terrain.elevationchecksum() != checksum)
+		return false;
+
+	const std::uint64_t size = m_baseGrid.m_xsize * m_baseGrid.m_ysize;
+	std::unique_ptr<std::uint16_t[]> slope(new std::uint16_t[size]), azimuth(new std::uint16_t[size]);
+	std::unique_ptr<bool[]> valid(new bool[size]);
+
+	auto restore = [](const WISE::GridProto::wcsData_binaryData &binary, void *array, size_t length) {
+		if (binary.has_iszipped() && binary.iszipped().value())
+			return GridChunkedCompress::decompress(binary.data(), array, length, GridChunkedCompress::toCodec(binary.codec())) == length;
+		if (binary.data().length() != length)
+			return false;
+		std::copy(binary.data().begin(), binary.data().end(), reinterpret_cast<char*>(array));
+		return true;
+	};
+	auto restoreValid = [size](const WISE::GridProto::wcsData_binaryData &binary, bool *array) {
+		if (binary.has_iszipped() && binary.iszipped().value())
+			return GridChunkedCompress::decompress(binary.datavalid(), array, size, GridChunkedCompress::toCodec(binary.codec())) == size;
+		if (binary.datavalid().length() != size)
+			return false;
+		std::copy(binary.datavalid().begin(), binary.datavalid().end(), array);
+		return true;
+	};
+
+	try {
+		if ((!restore(terrain.slopefactor().binary(), slope.get(), size * sizeof(std::uint16_t))) ||
+		    (!restoreValid(terrain.slopefactor().binary(), valid.get())) ||
+		    (!restore(terrain.slopeazimuth().binary(), azimuth.get(), size * sizeof(std::uint16_t))))
+			return false;
+	}
+	catch (std::exception &) {
+		return false;									// a damaged cache isn't fatal, it is simply recalculated
+	}
+
+	if (m_baseGrid.m_slopeFactor)
+		delete [] m_baseGrid.m_slopeFactor;
+	if (m_baseGrid.m_slopeAzimuth)
+		delete [] m_baseGrid.m_slopeAzimuth;
+	if (m_baseGrid.m_terrainValidArray)
+		delete [] m_baseGrid.m_terrainValidArray;
+	m_baseGrid.m_slopeFactor = slope.release();
+	m_baseGrid.m_slopeAzimuth = azimuth.release();
+	m_baseGrid.m_terrainValidArray = valid.release();
+	m_baseGrid.calculateTerrainRanges();
+	m_baseGrid.m_terrainChecksum = checksum;
+	m_baseGrid.m_terrainStale = false;
+
+	const auto &slopeBinary = terrain.slopefactor().binary(), &azimuthBinary = terrain.slopeazimuth().binary();
+	if (slopeBinary.has_iszipped() && slopeBinary.iszipped().value() && azimuthBinary.has_iszipped() && azimuthBinary.iszipped().value()) {
+		m_slopeBlob.retain(slopeBinary.data(), GridChunkedCompress::toCodec(slopeBinary.codec()));
+		m_terrainValidBlob.retain(slopeBinary.datavalid(), GridChunkedCompress::toCodec(slopeBinary.codec()));
+		m_azimuthBlob.retain(azimuthBinary.data(), GridChunkedCompress::toCodec(azimuthBinary.codec()));
+	}
+	return true;
+}
+
+
 void CCWFGM_Grid::calcWarnings(const std::uint8_t calc_bits) {
 	if (calc_bits & 0x1) {
 		std::string msg = "The elevation grid file contained NODATA entries.\n";
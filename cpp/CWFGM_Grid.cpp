@@ -32,6 +32,10 @@
 #include <float.h>
 #include <stdio.h>
 #include "gdalclient.h"
+#include "Thread.h"
+#include <omp.h>
+#include <algorithm>
+#include <vector>
 
 #ifdef DEBUG
 #include <assert.h>
@@ -70,6 +74,7 @@ CCWFGM_Grid::CCWFGM_Grid(const CCWFGM_Grid &toCopy) : m_timeManager(m_worldLocat
 	m_loadWarning = toCopy.m_loadWarning;
 	m_sourceSRS = OSRClone(toCopy.m_sourceSRS);
 	m_worldLocation = toCopy.m_worldLocation;
+	m_tile = toCopy.m_tile;
 
 	m_defaultElevation = toCopy.m_defaultElevation;
 	m_defaultFMC = toCopy.m_defaultFMC;
@@ -109,6 +114,8 @@ GridData::GridData() {
 	m_maxSlopeFactor = m_minSlopeFactor = (std::uint16_t)-1;
 	m_maxAzimuth = m_minAzimuth = (std::uint16_t)-1;
 	memset(m_elevationFrequency, 0, sizeof(m_elevationFrequency));
+	m_terrainChecksum = 0;
+	m_terrainStale = false;
 }
 
 
@@ -127,6 +134,8 @@ GridData::GridData(const GridData &toCopy) {
 	m_maxAzimuth = toCopy.m_maxAzimuth;
 	m_minAzimuth = toCopy.m_minAzimuth;
 	memcpy(m_elevationFrequency, toCopy.m_elevationFrequency, sizeof(m_elevationFrequency));
+	m_terrainChecksum = toCopy.m_terrainChecksum;
+	m_terrainStale = toCopy.m_terrainStale;
 
 	if (toCopy.m_fuelArray) {
 		m_fuelArray = new std::uint8_t[m_xsize * m_ysize];
@@ -961,6 +970,8 @@ HRESULT CCWFGM_Grid::Clone(boost::intrusive_ptr<ICWFGM_CommonBase> *newObject) c
 #define MAX_TOTAL_NODES 4
 //if this many valid nodes can't be found within the neighbour depth, set NODATA
 #define MIN_TOTAL_NODES 4
+//version of the slope and azimuth calculation, part of GridData::terrainChecksum()
+#define TERRAIN_CALCULATION_VERSION 1
 
 static_assert(MAX_INTERP_NEIGHBOUR_DEPTH > 0 && MAX_INTERP_NEIGHBOUR_DEPTH < 5, "Invalid interpolation neighbour depth.");
 static_assert(MAX_TOTAL_NODES >= 4, "Too few interpolation nodes.");
@@ -1193,6 +1204,7 @@ HRESULT CCWFGM_Grid::calculateSlopeFactorAndAzimuth(Layer *layerThread, std::uin
 
 	std::uint64_t lastmissing = 0;
 	std::uint64_t missing = 0;
+	bool filled = false;
 	do {
 		lastmissing = missing;
 		missing = 0;
@@ -1205,6 +1217,7 @@ HRESULT CCWFGM_Grid::calculateSlopeFactorAndAzimuth(Layer *layerThread, std::uin
 						gd->m_elevationArray[a_index] = interp;
 						gd->m_elevationValidArray[a_index] = true;
 						*calc_bits |= 0x2;
+						filled = true;
 					} else
 						missing++;
 				}
@@ -1383,12 +1396,42 @@ HRESULT CCWFGM_Grid::calculateSlopeFactorAndAzimuth(Layer *layerThread, std::uin
 	gd->m_maxSlopeFactor = a_max;
 	gd->m_minAzimuth = b_min;
 	gd->m_maxAzimuth = b_max;
+	gd->m_terrainChecksum = gd->terrainChecksum();
 	m_bRequiresSave = true;
+	if (gd == &m_baseGrid) {
+		if (filled)
+			invalidateElevationBlobs();
+		invalidateTerrainBlobs();
+	}
+	gd->m_terrainStale = false;
 
 	delete [] outside;
 	return error;
 }
 
+
+void CCWFGM_Grid::invalidateFuelBlobs() {
+	m_baseGrid.m_terrainStale = true;
+	m_fuelBlob.invalidate();
+	m_fuelValidBlob.invalidate();
+	m_fuelEncodedBlob.invalidate();
+}
+
+
+void CCWFGM_Grid::invalidateElevationBlobs() {
+	m_baseGrid.m_terrainStale = true;
+	m_elevationBlob.invalidate();
+	m_elevationValidBlob.invalidate();
+	m_elevationEncodedBlob.invalidate();
+}
+
+
+void CCWFGM_Grid::invalidateTerrainBlobs() {
+	m_slopeBlob.invalidate();
+	m_terrainValidBlob.invalidate();
+	m_azimuthBlob.invalidate();
+}
+
 #endif
 
 
@@ -1654,7 +1697,7 @@ HRESULT CCWFGM_Grid::GetAttribute(Layer * /*layerThread*/, std::uint16_t option,
 														return S_OK;
 													}
 		case CWFGM_GRID_ATTRIBUTE_SPATIALREFERENCE: {
-														CThreadSemaphoreEngage(&m_tokenlock, SEM_TRUE);
+														CThreadSemaphoreEngage token(&m_tokenlock, SEM_TRUE);
 														if (!m_tokens.length()) {
 															if (m_sourceSRS) {
 																char* tokens = nullptr;
@@ -1728,6 +1771,7 @@ HRESULT CCWFGM_Grid::CreateGrid(std::uint16_t xsize, std::uint16_t ysize, const
 	memset(gd->m_fuelArray, BasicFuel, total);
 	for (std::int32_t i = 0; i < total; i++)
 		gd->m_fuelValidArray[i] = true;
+	invalidateFuelBlobs();
 	m_bRequiresSave = true;
 	fixWorldLocation();
 
@@ -1787,6 +1831,10 @@ HRESULT CCWFGM_Grid::CreateSlopeElevationGrid(std::int16_t elevation, std::uint1
 	gd->m_maxElev = gd->m_minElev = elevation;
 	gd->m_minSlopeFactor = gd->m_maxSlopeFactor = slope;
 	gd->m_minAzimuth =gd-> m_maxAzimuth = aspect;
+	invalidateElevationBlobs();
+	invalidateTerrainBlobs();
+	gd->m_terrainChecksum = gd->terrainChecksum();
+	gd->m_terrainStale = false;
 
 	m_bRequiresSave = true;
 	return S_OK;
@@ -1813,3 +1861,73 @@ std::uint16_t GridData::convertY(double y, XY_Rectangle *bbox) {
 	}
 	return (std::uint16_t)cy;
 }
+
+
+/*!
+Checksum of everything the slope factor and azimuth are derived from: the grid size and resolution, how NODATA elevations are
+filled, and the elevation, elevation valid and fuel valid arrays.  Blocks of the grid are hashed in parallel and the block
+hashes are then combined, so the result does not depend on the number of threads.  Never returns 0.
+*/
+std::uint64_t GridData::terrainChecksum() const {
+	const std::uint64_t fnv_offset = 14695981039346656037ULL, fnv_prime = 1099511628211ULL;
+	const std::int32_t block = 256 * 1024;
+	const std::int32_t total = (std::int32_t)m_xsize * (std::int32_t)m_ysize;
+	const std::int32_t blocks = (total + block - 1) / block;
+	std::vector<std::uint64_t> hashes(blocks);
+
+	auto hash = [fnv_prime](std::uint64_t h, const void *data, size_t length) {
+		const std::uint8_t *d = reinterpret_cast<const std::uint8_t *>(data);
+		for (size_t i = 0; i < length; i++)
+			h = (h ^ d[i]) * fnv_prime;
+		return h;
+	};
+
+#pragma omp parallel for num_threads(CWorkerThreadPool::NumberIdealProcessors())
+	for (std::int32_t b = 0; b < blocks; b++) {
+		const std::int32_t start = b * block;
+		const std::int32_t count = std::min(block, total - start);
+		std::uint64_t h = fnv_offset;
+		if (m_elevationArray)
+			h = hash(h, m_elevationArray + start, count * sizeof(std::int16_t));
+		if (m_elevationValidArray)
+			h = hash(h, m_elevationValidArray + start, count * sizeof(bool));
+		if (m_fuelValidArray)
+			h = hash(h, m_fuelValidArray + start, count * sizeof(bool));
+		hashes[b] = h;
+	}
+
+	// bump TERRAIN_CALCULATION_VERSION whenever calculateSlopeFactorAndAzimuth() changes, so saved terrain is recalculated
+	const std::uint32_t fill[] = { TERRAIN_CALCULATION_VERSION, MAX_INTERP_NEIGHBOUR_DEPTH, MAX_TOTAL_NODES, MIN_TOTAL_NODES };
+	std::uint64_t h = hash(fnv_offset, &m_xsize, sizeof(m_xsize));
+	h = hash(h, &m_ysize, sizeof(m_ysize));
+	h = hash(h, &m_resolution, sizeof(m_resolution));
+	h = hash(h, fill, sizeof(fill));
+	h = hash(h, hashes.data(), hashes.size() * sizeof(std::uint64_t));
+	return h ? h : 1;
+}
+
+
+/*!
+Recalculates the slope factor and azimuth ranges from the slope arrays, for when they are restored rather than calculated.
+*/
+void GridData::calculateTerrainRanges() {
+	std::uint16_t a_min = (std::uint16_t)-1, a_max = 0;
+	std::uint16_t b_min = (std::uint16_t)-1, b_max = 0;
+	const std::uint32_t total = (std::uint32_t)m_xsize * (std::uint32_t)m_ysize;
+
+	for (std::uint32_t i = 0; i < total; i++) {
+		if (!m_terrainValidArray[i])
+			continue;
+		if (m_slopeFactor[i] > a_max)	a_max = m_slopeFactor[i];
+		if (m_slopeFactor[i] < a_min)	a_min = m_slopeFactor[i];
+		if (m_slopeFactor[i] == 0)
+			continue;
+		if (m_slopeAzimuth[i] > b_max)	b_max = m_slopeAzimuth[i];
+		if (m_slopeAzimuth[i] < b_min)	b_min = m_slopeAzimuth[i];
+	}
+
+	m_minSlopeFactor = a_min;
+	m_maxSlopeFactor = a_max;
+	m_minAzimuth = b_min;
+	m_maxAzimuth = b_max;
+}
@@ -0,0 +1,146 @@
+/**
+ * WISE_Grid_Module: CWFGM_MultiAttributeFilter.Serialize.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ICWFGM_Fuel.h"
+#include "GridCom_ext.h"
+#include "FireEngine_ext.h"
+#include "CWFGM_MultiAttributeFilter.h"
+#include "str_printf.h"
+
+#ifdef DEBUG
+#include <assert.h>
+#endif
+
+
+std::int32_t CCWFGM_MultiAttributeFilter::serialVersionUid(const SerializeProtoOptions& options) const noexcept {
+	return options.fileVersion();
+}
+
+
+WISE::GridProto::CwfgmMultiAttributeFilter *CCWFGM_MultiAttributeFilter::serialize(const SerializeProtoOptions& options) {
+	auto filter = new WISE::GridProto::CwfgmMultiAttributeFilter();
+	filter->set_version(serialVersionUid(options));
+
+	for (auto &b : m_bands)
+		filter->mutable_bands()->AddAllocated(b->serialize(options));
+	if (m_flags & CCWFGMGRID_NARROW_STORAGE)
+		filter->set_narrowstorage(true);
+	if (m_flags & CCWFGMGRID_SPARSE_STORAGE)
+		filter->set_sparsestorage(true);
+	if (m_sampling != CWFGM_GRID_SAMPLING_NEAREST)
+		filter->set_sampling(WISE::GridProto::CwfgmAttributeFilter_Sampling_BILINEAR);
+
+	return filter;
+}
+
+
+CCWFGM_MultiAttributeFilter *CCWFGM_MultiAttributeFilter::deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE);
+
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine;
+	if (!(gridEngine = m_gridEngine(nullptr))) {
+		if (valid)
+			/// <summary>
+			/// The gridEngine is not initialized but should be by this time in deserialization.
+			/// </summary>
+			/// <type>internal</type>
+			valid->add_child_validation("WISE.GridProto.CwfgmMultiAttributeFilter", name, validation::error_level::SEVERE,
+				validation::id::initialization_incomplete, "gridEngine");
+		weak_assert(false);
+		m_loadWarning = "Error: WISE.GridProto.CwfgmMultiAttributeFilter: No grid engine";
+		throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmMultiAttributeFilter: Incomplete initialization");
+	}
+
+	auto filter = dynamic_cast_assert<const WISE::GridProto::CwfgmMultiAttributeFilter*>(&proto);
+
+	if (!filter) {
+		if (valid)
+			/// <summary>
+			/// The object passed as a multi-band attribute filter is invalid. An incorrect object type was passed to the parser.
+			/// </summary>
+			/// <type>internal</type>
+			valid->add_child_validation("WISE.GridProto.CwfgmMultiAttributeFilter", name, validation::error_level::SEVERE, validation::id::object_invalid, proto.GetDescriptor()->name());
+		weak_assert(false);
+		throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmMultiAttributeFilter: Protobuf object invalid", ERROR_PROTOBUF_OBJECT_INVALID);
+	}
+	if ((filter->version() != 1) && (filter->version() != 2)) {
+		if (valid)
+			/// <summary>
+			/// The object version is not supported. The multi-band attribute filter is not supported by this version of Prometheus.
+			/// </summary>
+			/// <type>user</type>
+			valid->add_child_validation("WISE.GridProto.CwfgmMultiAttributeFilter", name, validation::error_level::SEVERE, validation::id::version_mismatch, std::to_string(filter->version()));
+		weak_assert(false);
+		throw ISerializeProto::DeserializeError("WISE.GridProto.CwfgmMultiAttributeFilter: Version is invalid", ERROR_PROTOBUF_OBJECT_VERSION_INVALID);
+	}
+
+	auto vt = validation::conditional_make_object(valid, "WISE.GridProto.CwfgmMultiAttributeFilter", name);
+	auto v = vt.lock();
+
+	if (filter->has_narrowstorage()) {
+		if (filter->narrowstorage())
+			m_flags |= CCWFGMGRID_NARROW_STORAGE;
+		else
+			m_flags &= (~(CCWFGMGRID_NARROW_STORAGE));
+	}
+	if (filter->has_sparsestorage()) {
+		if (filter->sparsestorage())
+			m_flags |= CCWFGMGRID_SPARSE_STORAGE;
+		else
+			m_flags &= (~(CCWFGMGRID_SPARSE_STORAGE));
+	}
+	if (filter->has_sampling())
+		m_sampling = (filter->sampling() == WISE::GridProto::CwfgmAttributeFilter_Sampling_BILINEAR) ? CWFGM_GRID_SAMPLING_BILINEAR : CWFGM_GRID_SAMPLING_NEAREST;
+
+	m_bands.clear();
+	for (int i = 0; i < filter->bands_size(); i++) {
+		boost::intrusive_ptr<CCWFGM_AttributeFilter> b(new CCWFGM_AttributeFilter());
+		b->PutGridEngine(nullptr, gridEngine.get());
+		b->m_flags |= m_flags & (CCWFGMGRID_NARROW_STORAGE | CCWFGMGRID_SPARSE_STORAGE);	// used if the band's file predates the storage options
+		b->deserialize(filter->bands(i), v, strprintf("bands[%d]", i));
+		if ((filter->has_sampling()) && (!(b->m_flags & CCWFGMGRID_NATIVE_RESOLUTION)))
+			b->m_sampling = m_sampling;						// a band only saves its sampling while it's at its native resolution
+
+		if ((b->m_optionKey == (std::uint16_t)-1) || (band(b->m_optionKey))) {
+			if (v)
+				/// <summary>
+				/// A band is a fuel grid, or responds to the same attribute as an earlier band. It is ignored.
+				/// </summary>
+				/// <type>user</type>
+				v->add_child_validation("WISE.GridProto.CwfgmAttributeFilter", strprintf("bands[%d]", i), validation::error_level::WARNING,
+					validation::id::value_invalid, std::to_string(b->m_optionKey));
+			continue;
+		}
+		m_bands.push_back(b);
+	}
+	if ((!filter->has_sampling()) && (m_bands.size()))
+		m_sampling = m_bands[0]->m_sampling;			// older files only saved sampling with each band, they're all set together
+
+	m_bRequiresSave = false;
+	return this;
+}
+
+
+std::optional<bool> CCWFGM_MultiAttributeFilter::isdirty(void) const noexcept {
+	if (m_bRequiresSave)
+		return true;
+	for (auto &b : m_bands)
+		if (b->m_bRequiresSave)
+			return true;
+	return false;
+}
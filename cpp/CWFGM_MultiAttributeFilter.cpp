@@ -0,0 +1,411 @@
+/**
+ * WISE_Grid_Module: CWFGM_MultiAttributeFilter.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ICWFGM_Fuel.h"
+#include "CWFGM_MultiAttributeFilter.h"
+#include "GridCom_ext.h"
+#include "FireEngine_ext.h"
+#include "CWFGM_internal.h"
+
+/////////////////////////////////////////////////////////////////////////////
+// CWFGM_MultiAttributeFilter
+
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+CCWFGM_MultiAttributeFilter::CCWFGM_MultiAttributeFilter() {
+	m_flags = 0;
+	m_sampling = CWFGM_GRID_SAMPLING_NEAREST;
+	m_bRequiresSave = false;
+}
+
+
+CCWFGM_MultiAttributeFilter::CCWFGM_MultiAttributeFilter(const CCWFGM_MultiAttributeFilter &toCopy) {
+	CRWThreadSemaphoreEngage engage(*(CRWThreadSemaphore *)&toCopy.m_lock, SEM_FALSE);
+
+	m_flags = toCopy.m_flags;
+	m_sampling = toCopy.m_sampling;
+	m_bands.reserve(toCopy.m_bands.size());
+	for (auto &b : toCopy.m_bands)
+		m_bands.emplace_back(new CCWFGM_AttributeFilter(*b));	// the copies pick up this filter's grid engine when it's assigned
+
+	m_bRequiresSave = false;
+}
+
+
+CCWFGM_MultiAttributeFilter::~CCWFGM_MultiAttributeFilter() {
+}
+
+#endif
+
+
+HRESULT CCWFGM_MultiAttributeFilter::Clone(boost::intrusive_ptr<ICWFGM_CommonBase> *newObject) const {
+	if (!newObject)						return E_POINTER;
+
+	CRWThreadSemaphoreEngage engage(*(CRWThreadSemaphore *)&m_lock, SEM_FALSE);
+
+	try {
+		CCWFGM_MultiAttributeFilter *f = new CCWFGM_MultiAttributeFilter(*this);
+		*newObject = f;
+		return S_OK;
+	}
+	catch (std::exception &e) {
+	}
+	return E_FAIL;
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::AddBand(std::uint16_t option_key, std::uint16_t option_type) {
+	if (option_key == (std::uint16_t)-1)		return E_INVALIDARG;		// that's a fuel grid
+
+	SEM_BOOL engaged;
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
+
+	if (!m_gridEngine(nullptr))					{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+	if (band(option_key))						return E_INVALIDARG;
+
+	boost::intrusive_ptr<CCWFGM_AttributeFilter> b;
+	try {
+		b = new CCWFGM_AttributeFilter();
+		m_bands.reserve(m_bands.size() + 1);
+	}
+	catch (std::exception &e) {
+		return E_OUTOFMEMORY;
+	}
+
+	HRESULT hr;
+	if (FAILED(hr = b->put_OptionType(option_type)))
+		return hr;
+	b->put_OptionKey(option_key);
+	if (FAILED(hr = configureBand(b.get())))
+		return hr;
+
+	m_bands.push_back(b);
+	m_bRequiresSave = true;
+	return S_OK;
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::RemoveBand(std::uint16_t option_key) {
+	SEM_BOOL engaged;
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
+
+	for (auto it = m_bands.begin(); it != m_bands.end(); it++)
+		if ((*it)->m_optionKey == option_key) {
+			m_bands.erase(it);
+			m_bRequiresSave = true;
+			return S_OK;
+		}
+	return E_INVALIDARG;
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::GetBandCount(std::uint32_t *count) {
+	if (!count)								return E_POINTER;
+
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+	*count = (std::uint32_t)m_bands.size();
+	return S_OK;
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::GetBand(std::uint32_t index, std::uint16_t *option_key, std::uint16_t *option_type) {
+	if ((!option_key) || (!option_type))	return E_POINTER;
+
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+	if (index >= m_bands.size())			return E_INVALIDARG;
+	*option_key = m_bands[index]->m_optionKey;
+	*option_type = m_bands[index]->m_optionType;
+	return S_OK;
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::ImportBand(std::uint16_t option_key, const std::string &prj_file_name, const std::string &grid_file_name) {
+	SEM_BOOL engaged;
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
+
+	CCWFGM_AttributeFilter *b = band(option_key);
+	if (!b)										return E_INVALIDARG;
+	return b->ImportAttributeGrid(prj_file_name, grid_file_name);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::ExportBand(std::uint16_t option_key, const std::string &prj_file_name, const std::string &grid_file_name, const std::string &band_name, std::uint32_t flags) {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+
+	CCWFGM_AttributeFilter *b = band(option_key);
+	if (!b)										return E_INVALIDARG;
+	return b->ExportAttributeGrid(prj_file_name, grid_file_name, band_name, flags);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::ResetBand(std::uint16_t option_key, const NumericVariant &value) {
+	SEM_BOOL engaged;
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
+
+	CCWFGM_AttributeFilter *b = band(option_key);
+	if (!b)										return E_INVALIDARG;
+	return b->ResetAttribute(value);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::SetBandPoint(std::uint16_t option_key, const XY_Point &pt, const NumericVariant &value) {
+	SEM_BOOL engaged;
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
+
+	CCWFGM_AttributeFilter *b = band(option_key);
+	if (!b)										return E_INVALIDARG;
+	return b->SetAttributePoint(pt, value);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::GetBandPoint(std::uint16_t option_key, const XY_Point &pt, NumericVariant *value, grid::AttributeValue *value_valid) {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+
+	CCWFGM_AttributeFilter *b = band(option_key);
+	if (!b)										return E_INVALIDARG;
+	return b->GetAttributePoint(pt, value, value_valid);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::GetAttribute(std::uint16_t option, PolymorphicAttribute *value) {
+	if (!value)								return E_POINTER;
+
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_FALSE);
+
+	switch (option) {
+		case CWFGM_ATTRIBUTE_LOAD_WARNING: {
+							std::string warning(m_loadWarning);
+							for (auto &b : m_bands)
+								if (b->m_loadWarning.length()) {
+									if (warning.length())
+										warning += "\n";
+									warning += b->m_loadWarning;
+								}
+							*value = warning;
+							return S_OK;
+						   }
+
+		case CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE:
+							*value = (m_flags & CCWFGMGRID_NARROW_STORAGE) ? true : false;
+							return S_OK;
+
+		case CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE:
+							*value = (m_flags & CCWFGMGRID_SPARSE_STORAGE) ? true : false;
+							return S_OK;
+
+		case CWFGM_GRID_ATTRIBUTE_SAMPLING:
+							*value = m_sampling;
+							return S_OK;
+	}
+	return E_INVALIDARG;
+}
+
+
+/*! Polymorphic.  This routine sets an attribute/option value given the attribute/option index.  Storage and sampling options are
+	remembered for bands added later, and passed on to every existing band.
+	\param option CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE, or CWFGM_GRID_ATTRIBUTE_SAMPLING
+	\param value Value for the attribute/option index
+	\sa CCWFGM_AttributeFilter::SetAttribute
+*/
+HRESULT CCWFGM_MultiAttributeFilter::SetAttribute(std::uint16_t option, const PolymorphicAttribute &var) {
+	bool bval;
+	std::uint16_t uval;
+	unsigned long flag;
+	HRESULT hr;
+
+	switch (option) {
+		case CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE:
+		case CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE:
+								try {
+									bval = std::get<bool>(var);
+								}
+								catch (std::bad_variant_access &) {
+									weak_assert(false);
+									return E_INVALIDARG;
+								}
+								flag = (option == CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE) ? CCWFGMGRID_NARROW_STORAGE : CCWFGMGRID_SPARSE_STORAGE;
+								break;
+
+		case CWFGM_GRID_ATTRIBUTE_SAMPLING:
+								if (FAILED(hr = VariantToUInt16_(var, &uval)))
+									return hr;
+								if ((uval != CWFGM_GRID_SAMPLING_NEAREST) && (uval != CWFGM_GRID_SAMPLING_BILINEAR))
+									return E_INVALIDARG;
+								break;
+
+		default:
+								return E_INVALIDARG;
+	}
+
+	SEM_BOOL engaged;
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+	if (!engaged)								return ERROR_SCENARIO_SIMULATION_RUNNING;
+
+	for (auto &b : m_bands)
+		if (FAILED(hr = b->SetAttribute(option, var)))
+			return hr;
+
+	if (option == CWFGM_GRID_ATTRIBUTE_SAMPLING) {
+		if (m_sampling != uval) {
+			m_sampling = uval;
+			m_bRequiresSave = true;
+		}
+	}
+	else {
+		const unsigned long old = m_flags;
+		if (bval)
+			m_flags |= flag;
+		else
+			m_flags &= (~flag);
+		if (old != m_flags)
+			m_bRequiresSave = true;
+	}
+	return S_OK;
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::MT_Lock(Layer *layerThread, bool exclusive, std::uint16_t obtain) {
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
+	if (!gridEngine)	{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+
+	HRESULT hr;
+	if (obtain == (std::uint16_t)-1) {
+		std::int64_t state = m_lock.CurrentState();
+		if (!state)				return SUCCESS_STATE_OBJECT_UNLOCKED;
+		if (state < 0)			return SUCCESS_STATE_OBJECT_LOCKED_WRITE;
+		if (state >= 1000000LL)	return SUCCESS_STATE_OBJECT_LOCKED_SCENARIO;
+		return						   SUCCESS_STATE_OBJECT_LOCKED_READ;
+	}
+	else if (obtain) {
+		if (exclusive)	m_lock.Lock_Write();
+		else			m_lock.Lock_Read(1000000LL);
+
+		hr = gridEngine->MT_Lock(layerThread, exclusive, obtain);
+
+		for (auto &b : m_bands)					// bands aren't in the layer stack so don't see MT_Lock themselves, and edits to them are
+			b->loadDeferred();					// gated by m_lock
+	}
+	else {
+		hr = gridEngine->MT_Lock(layerThread, exclusive, obtain);
+
+		if (exclusive)	m_lock.Unlock();
+		else		m_lock.Unlock(1000000LL);
+	}
+	return S_OK;
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::GetAttribute(Layer *layerThread, std::uint16_t option, PolymorphicAttribute *value) {
+	if (!layerThread) {
+		HRESULT hr = GetAttribute(option, value);
+		if (SUCCEEDED(hr))
+			return hr;
+	}
+
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
+	if (!gridEngine)							return ERROR_GRID_UNINITIALIZED;
+	return gridEngine->GetAttribute(layerThread, option, value);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::GetAttributeData(Layer *layerThread, const XY_Point &pt, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, NumericVariant *attribute, grid::AttributeValue *attribute_valid, XY_Rectangle *cache_bbox) {
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
+	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+	CCWFGM_AttributeFilter *b = band(option);
+	if (b)
+		return b->GetAttributeData(nullptr, pt, time, timeSpan, option, optionFlags, attribute, attribute_valid, cache_bbox);
+	return gridEngine->GetAttributeData(layerThread, pt, time, timeSpan, option, optionFlags, attribute, attribute_valid, cache_bbox);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan,
+    std::uint16_t option, std::uint64_t optionFlags, NumericVariant_2d *attribute, attribute_t_2d *attribute_valid) {
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
+	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+	CCWFGM_AttributeFilter *b = band(option);
+	if (b)
+		return b->GetAttributeDataArray(nullptr, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+	return gridEngine->GetAttributeDataArray(layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan,
+    std::uint16_t option, std::uint64_t optionFlags, double_2d *attribute, attribute_t_2d *attribute_valid) {
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
+	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+	CCWFGM_AttributeFilter *b = band(option);
+	if (b)
+		return b->GetAttributeDataArray(nullptr, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+	return gridEngine->GetAttributeDataArray(layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan,
+    std::uint16_t option, std::uint64_t optionFlags, float_2d *attribute, attribute_t_2d *attribute_valid) {
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
+	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+	CCWFGM_AttributeFilter *b = band(option);
+	if (b)
+		return b->GetAttributeDataArray(nullptr, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+	return gridEngine->GetAttributeDataArray(layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan,
+    std::uint16_t option, std::uint64_t optionFlags, int32_t_2d *attribute, attribute_t_2d *attribute_valid) {
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread);
+	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+	CCWFGM_AttributeFilter *b = band(option);
+	if (b)
+		return b->GetAttributeDataArray(nullptr, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+	return gridEngine->GetAttributeDataArray(layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+}
+
+
+HRESULT CCWFGM_MultiAttributeFilter::PutGridEngine(Layer *layerThread, ICWFGM_GridEngine *newVal) {
+	HRESULT hr = ICWFGM_GridEngine::PutGridEngine(layerThread, newVal);
+	if (SUCCEEDED(hr) && (!layerThread))
+		for (auto &b : m_bands)
+			b->PutGridEngine(nullptr, newVal);
+	return hr;
+}
+
+
+/*! Gives a new band this filter's grid engine, storage options and sampling.  Bands only ever see the root grid engine: any query
+	they don't answer themselves is forwarded by this filter instead.
+*/
+HRESULT CCWFGM_MultiAttributeFilter::configureBand(CCWFGM_AttributeFilter *band) {
+	HRESULT hr;
+	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(nullptr);
+	if (!gridEngine)							{ weak_assert(false); return ERROR_GRID_UNINITIALIZED; }
+	if (FAILED(hr = band->PutGridEngine(nullptr, gridEngine.get())))
+		return hr;
+	if (m_flags & CCWFGMGRID_NARROW_STORAGE)
+		band->SetAttribute(CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, true);
+	if (m_flags & CCWFGMGRID_SPARSE_STORAGE)
+		band->SetAttribute(CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE, true);
+	if (m_sampling != CWFGM_GRID_SAMPLING_NEAREST)
+		band->SetAttribute(CWFGM_GRID_ATTRIBUTE_SAMPLING, m_sampling);
+	return S_OK;
+}
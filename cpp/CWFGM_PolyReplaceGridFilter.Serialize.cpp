@@ -27,6 +27,7 @@
 
 #include "CoordinateConverter.h"
 #include "gdalclient.h"
+#include "GridLockedConverter.h"
 #include "doubleBuilder.h"
 #include "url.h"
 #include "geo_poly.h"
@@ -235,7 +236,12 @@ std::int32_t CCWFGM_PolyReplaceGridFilter::serialVersionUid(const SerializeProto
 
 
 WISE::GridProto::CwfgmPolyReplaceGridFilter *CCWFGM_PolyReplaceGridFilter::serialize(const SerializeProtoOptions& options) {
-	auto filter = new WISE::GridProto::CwfgmPolyReplaceGridFilter();
+	return serialize(options, nullptr);
+}
+
+
+WISE::GridProto::CwfgmPolyReplaceGridFilter *CCWFGM_PolyReplaceGridFilter::serialize(const SerializeProtoOptions& options, google::protobuf::Arena *arena) {
+	auto filter = google::protobuf::Arena::CreateMessage<WISE::GridProto::CwfgmPolyReplaceGridFilter>(arena);
 	filter->set_version(serialVersionUid(options));
 
 	GeoPoly geo(&m_polySet);
@@ -247,6 +253,8 @@ WISE::GridProto::CwfgmPolyReplaceGridFilter *CCWFGM_PolyReplaceGridFilter::seria
 
 
 CCWFGM_PolyReplaceGridFilter *CCWFGM_PolyReplaceGridFilter::deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE);
+
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine;
 	if (!(gridEngine = m_gridEngine(0))) {
 		if (valid)
@@ -307,8 +315,7 @@ CCWFGM_PolyReplaceGridFilter *CCWFGM_PolyReplaceGridFilter::deserialize(const go
 	std::string projection;
 	projection = std::get<std::string>(var);
 
-	boost::scoped_ptr<CCoordinateConverter> convert(new CCoordinateConverter());
-	convert->SetSourceProjection(projection.c_str());
+	GridLockedConverter convert(projection);
 
 	if (filter->has_polygons()) {
 		GeoPoly geo(filter->polygons(), GeoPoly::TYPE_LINKED_LIST);
@@ -27,6 +27,7 @@
 #include "points.h"
 #include "CoordinateConverter.h"
 #include "gdalclient.h"
+#include "GridLockedConverter.h"
 #include "doubleBuilder.h"
 
 #include <errno.h>
@@ -268,7 +269,12 @@ std::int32_t CCWFGM_Target::serialVersionUid(const SerializeProtoOptions& option
 
 
 WISE::GridProto::CwfgmTarget* CCWFGM_Target::serialize(const SerializeProtoOptions& options) {
-	auto filter = new WISE::GridProto::CwfgmTarget();
+	return serialize(options, nullptr);
+}
+
+
+WISE::GridProto::CwfgmTarget* CCWFGM_Target::serialize(const SerializeProtoOptions& options, google::protobuf::Arena *arena) {
+	auto filter = google::protobuf::Arena::CreateMessage<WISE::GridProto::CwfgmTarget>(arena);
 	filter->set_version(serialVersionUid(options));
 
 	XY_PolyLLSet set;
@@ -290,6 +296,8 @@ WISE::GridProto::CwfgmTarget* CCWFGM_Target::serialize(const SerializeProtoOptio
 
 CCWFGM_Target* CCWFGM_Target::deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name)
 {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE);
+
 	if (!m_gridEngine) {
 		if (valid)
 			/// <summary>
@@ -354,8 +362,7 @@ CCWFGM_Target* CCWFGM_Target::deserialize(const google::protobuf::Message& proto
 	std::string projection;
 	projection = std::get<std::string>(var);
 
-	boost::scoped_ptr<CCoordinateConverter> convert(new CCoordinateConverter());
-	convert->SetSourceProjection(projection.c_str());
+	GridLockedConverter convert(projection);
 
 	GeoPoly geo(filter->targets(), GeoPoly::TYPE_LINKED_LIST);
 	geo.setStoredUnits(GeoPoly::UTM);
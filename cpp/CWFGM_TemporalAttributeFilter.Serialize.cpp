@@ -92,6 +92,9 @@ WISE::GridProto::TemporalCondition* CCWFGM_TemporalAttributeFilter::serialize(co
 		sa = sa->LN_Succ();
 	}
 
+	if (m_solarTileSize > 0.0)
+		tempo->set_allocated_solarcachetile(DoubleBuilder().withValue(m_solarTileSize).forProtobuf(options.useVerboseFloats()));
+
 	return tempo;
 }
 
@@ -137,6 +140,26 @@ CCWFGM_TemporalAttributeFilter *CCWFGM_TemporalAttributeFilter::deserialize(cons
 	auto vt = validation::conditional_make_object(valid, "WISE.GridProto.TemporalCondition", name);
 	auto v = vt.lock();
 
+	if (tempo->has_solarcachetile()) {
+		double dVal = DoubleBuilder().withProtobuf(tempo->solarcachetile(), v, "solarCacheTile").getValue();
+		if (dVal < 0.0) {
+			m_loadWarning = "Error: WISE.GridProto.CwfgmTemporalAttributeFilter: Invalid solar cache tile size";
+			if (v)
+				/// <summary>
+				/// The size of the tiles sun rise and set times are cached over is negative.  They won't be cached.
+				/// </summary>
+				/// <type>user</type>
+				v->add_child_validation("Math.Double", "solarCacheTile",
+					validation::error_level::WARNING, validation::id::parse_invalid, std::to_string(tempo->solarcachetile().value()),
+					{ true, 0.0 }, { false, std::numeric_limits<double>::infinity() });
+			dVal = 0.0;
+		}
+		m_solarTileSize = dVal;
+	}
+	else
+		m_solarTileSize = 0.0;
+	clearSolarCache();
+
 	int i;
 	for (i = 0; i < tempo->daily_size(); i++)
 	{
@@ -465,5 +488,6 @@ CCWFGM_TemporalAttributeFilter *CCWFGM_TemporalAttributeFilter::deserialize(cons
 		}
 	}
 
+	invalidateIndex();
 	return this;
 }
\ No newline at end of file
@@ -23,16 +23,25 @@
 #include "FireEngine_ext.h"
 #include <errno.h>
 #include <stdio.h>
+#include <cmath>
+#include <algorithm>
 #include "CoordinateConverter.h"
 #include "propsysreplacement.h"
 
 
+#define SOLAR_CACHE_DAYS		3			// local days of sun rise/set times each filter keeps
+#define SOLAR_CACHE_ENTRIES		65536		// and the most tiles kept over all of those days
+
+
 IMPLEMENT_OBJECT_CACHE_MT_NO_TEMPLATE(DailyAttribute, DailyAttribute, 16 * 1024 * 1024 / sizeof(DailyAttribute), false, 16)
 IMPLEMENT_OBJECT_CACHE_MT_NO_TEMPLATE(SeasonalAttribute, SeasonalAttribute, 8 * 1024 * 1024 / sizeof(SeasonalAttribute), false, 16)
 
 
 CCWFGM_TemporalAttributeFilter::CCWFGM_TemporalAttributeFilter() : m_timeManager(nullptr) {
 	m_converter.setGrid(-1.0, -1.0, -1.0);
+	m_solarEntries = 0;
+	m_solarTileSize = 0.0;
+	m_indexStale = true;
 	m_bRequiresSave = false;
 
 	SeasonalAttribute *def = new SeasonalAttribute();
@@ -44,6 +53,9 @@ CCWFGM_TemporalAttributeFilter::CCWFGM_TemporalAttributeFilter(const CCWFGM_Temp
 	CRWThreadSemaphoreEngage engage(*(CRWThreadSemaphore *)&toCopy.m_lock, SEM_FALSE);
 
 	m_converter.setGrid(toCopy.m_converter.resolution(), toCopy.m_converter.xllcorner(), toCopy.m_converter.yllcorner());
+	m_solarEntries = 0;
+	m_solarTileSize = toCopy.m_solarTileSize;
+	m_indexStale = true;
 	DailyAttribute *da = toCopy.m_attributes.LH_Head();
 	while (da->LN_Succ()) {
 		DailyAttribute *da_c = new DailyAttribute(*da);
@@ -103,6 +115,10 @@ HRESULT CCWFGM_TemporalAttributeFilter::GetAttribute(unsigned short option, Poly
 							*value = m_loadWarning;
 							return S_OK;
 						   }
+		case CWFGM_GRID_ATTRIBUTE_SOLAR_CACHE_TILE: {
+							*value = m_solarTileSize;
+							return S_OK;
+						   }
 	}
 	return E_INVALIDARG;
 }
@@ -158,11 +174,66 @@ HRESULT CCWFGM_TemporalAttributeFilter::SetWorldLocation(ICWFGM_GridEngine *grid
 	if (FAILED(hr = gridEngine->GetAttribute(nullptr, CWFGM_GRID_ATTRIBUTE_YLLCORNER, &var))) return hr;
 	VariantToDouble_(var, &gridYLL);
 	m_converter.setGrid(gridResolution, gridXLL, gridYLL);
+	clearSolarCache();
 
 	return hr;
 }
 
 
+void CCWFGM_TemporalAttributeFilter::clearSolarCache() {
+	CRWThreadSemaphoreEngage engage(m_solarLock, SEM_TRUE);
+	m_solarCache.clear();
+	m_solarEntries = 0;
+}
+
+
+/*!
+Adds an entry to m_solarCache, which must be locked for writing.  Keeps the cache to SOLAR_CACHE_DAYS local days and
+SOLAR_CACHE_ENTRIES entries by dropping whole days, furthest from key's day first.  A simulation moves steadily through time,
+so those are the days least likely to be asked about again.  Once key's day is the only one left and it's full, its oldest
+entries are dropped instead.
+*/
+void CCWFGM_TemporalAttributeFilter::cacheSolarTimes(const SolarKey &key, const SolarTimes &st) const {
+	const std::int64_t day = std::get<0>(key);
+	const SolarTile tile(std::get<1>(key), std::get<2>(key));
+	auto isDay = [day](const SolarDay &d) { return d.m_noon == day; };
+
+	const bool cached = std::any_of(m_solarCache.begin(), m_solarCache.end(), isDay);
+	while ((m_solarCache.size()) && (((!cached) && (m_solarCache.size() >= SOLAR_CACHE_DAYS)) || (m_solarEntries >= SOLAR_CACHE_ENTRIES))) {
+		if ((cached) && (m_solarCache.size() == 1))
+			break;
+
+		// the days are sorted, so the furthest is at one end, and it's never key's day while there's another left
+		if ((day - m_solarCache.front().m_noon) >= (m_solarCache.back().m_noon - day)) {
+			m_solarEntries -= m_solarCache.front().m_tiles.size();
+			m_solarCache.pop_front();
+		}
+		else {
+			m_solarEntries -= m_solarCache.back().m_tiles.size();
+			m_solarCache.pop_back();
+		}
+	}
+
+	auto it = std::find_if(m_solarCache.begin(), m_solarCache.end(), isDay);
+	if (it == m_solarCache.end()) {
+		it = std::find_if(m_solarCache.begin(), m_solarCache.end(), [day](const SolarDay &d) { return d.m_noon > day; });
+		it = m_solarCache.emplace(it);
+		it->m_noon = day;
+	}
+	else if (it->m_tiles.find(tile) != it->m_tiles.end())
+		return;														// another thread got here first
+
+	while ((m_solarEntries >= SOLAR_CACHE_ENTRIES) && (it->m_order.size())) {
+		it->m_tiles.erase(it->m_order.front());
+		it->m_order.pop_front();
+		m_solarEntries--;
+	}
+	it->m_tiles.emplace(tile, st);
+	it->m_order.push_back(tile);
+	m_solarEntries++;
+}
+
+
 HRESULT CCWFGM_TemporalAttributeFilter::PutGridEngine(Layer *layerThread, ICWFGM_GridEngine *newVal) {
 	HRESULT hr = ICWFGM_GridEngine::PutGridEngine(layerThread, newVal);
 	if (SUCCEEDED(hr) && m_gridEngine(nullptr)) {
@@ -176,6 +247,7 @@ HRESULT CCWFGM_TemporalAttributeFilter::PutCommonData(Layer* layerThread, ICWFGM
 	if (!pVal)
 		return E_POINTER;
 	m_timeManager = pVal->m_timeManager;
+	clearSolarCache();
 	DailyAttribute* da = m_attributes.LH_Head();
 	while (da->LN_Succ()) {
 		da->m_localStartTime.SetTimeManager(m_timeManager);
@@ -202,10 +274,51 @@ std::uint16_t CCWFGM_TemporalAttributeFilter::solarTimes(const XY_Point &pt, con
 	WTime day(from_time, m_timeManager);
 	day.PurgeToDay(WTIME_FORMAT_AS_LOCAL | WTIME_FORMAT_WITHDST);
 	day += WTimeSpan(0, 12, 0, 0);
-	double latitude = pt.y, longitude = pt.x;
-	m_converter.SourceToLatlon(1, &longitude, &latitude, nullptr);
-	std::uint16_t retval = m_timeManager->m_worldLocation.m_sun_rise_set(DEGREE_TO_RADIAN(latitude), DEGREE_TO_RADIAN(longitude), day, &rise, &set, &noon);
-	return retval;
+
+	if (m_solarTileSize <= 0.0) {
+		double latitude = pt.y, longitude = pt.x;
+		m_converter.SourceToLatlon(1, &longitude, &latitude, nullptr);
+		std::uint16_t retval = m_timeManager->m_worldLocation.m_sun_rise_set(DEGREE_TO_RADIAN(latitude), DEGREE_TO_RADIAN(longitude), day, &rise, &set, &noon);
+		return retval;
+	}
+
+	// sun rise/set changes by seconds over a kilometre, so they're calculated once per local day for the centre of each tile
+	// and reused for every point and timestep which falls in it
+	const SolarKey key(day.GetTotalSeconds(), (std::int32_t)floor(pt.x / m_solarTileSize), (std::int32_t)floor(pt.y / m_solarTileSize));
+	SolarTimes st;
+	bool found = false;
+	{
+		CRWThreadSemaphoreEngage engage(m_solarLock, SEM_FALSE);
+		for (const SolarDay &d : m_solarCache)
+			if (d.m_noon == std::get<0>(key)) {
+				auto it = d.m_tiles.find(SolarTile(std::get<1>(key), std::get<2>(key)));
+				if (it != d.m_tiles.end()) {
+					st = it->second;
+					found = true;
+				}
+				break;
+			}
+	}
+
+	if (!found) {
+		double latitude = ((double)std::get<2>(key) + 0.5) * m_solarTileSize, longitude = ((double)std::get<1>(key) + 0.5) * m_solarTileSize;
+		m_converter.SourceToLatlon(1, &longitude, &latitude, nullptr);
+		WTime r(day), s(day), n(day);
+		st.m_calced = m_timeManager->m_worldLocation.m_sun_rise_set(DEGREE_TO_RADIAN(latitude), DEGREE_TO_RADIAN(longitude), day, &r, &s, &n);
+		st.m_rise = r - day;
+		st.m_set = s - day;
+		st.m_noon = n - day;
+
+		CRWThreadSemaphoreEngage engage(m_solarLock, SEM_TRUE);
+		cacheSolarTimes(key, st);
+	}
+
+	if (!(st.m_calced & NO_SUNRISE))		// leave the caller's value alone if there's no event, same as the calculation does
+		rise = day + st.m_rise;
+	if (!(st.m_calced & NO_SUNSET))
+		set = day + st.m_set;
+	noon = day + st.m_noon;
+	return st.m_calced;
 }
 
 void CCWFGM_TemporalAttributeFilter::calculatedTimes(const DailyAttribute* day, const XY_Point &pt, WTime& start, bool& startEffective, WTime& end, bool& endEffective) const {
@@ -545,16 +658,41 @@ HRESULT CCWFGM_TemporalAttributeFilter::GetAttribute(Layer *layerThread, std::ui
 }
 
 
-/*! Polymorphic.  This routine sets an attribute/option value given the attribute/option index.  Currently does not
-	perform any operation and is simply reserved for future functionality.
-	\param option Reserved for future functionality.
+/*! Polymorphic.  This routine sets an attribute/option value given the attribute/option index.
+	\param option The attribute of interest.  Valid attributes are:
+	<ul>
+	<li><code>CWFGM_GRID_ATTRIBUTE_SOLAR_CACHE_TILE</code> 64-bit floating point.  Size (in grid units) of the square tiles sun rise
+	and set times are cached over, or 0 (the default) to calculate them for every point.  Saved with the filter.</li>
+	</ul>
 	\param value Value for the attribute/option index
 	\sa ICWFGM_AttributeFilter::SetAttribute
 
-	\retval E_NOTIMPL This function is reserved for future functionality.
+	\retval S_OK Successful
+	\retval E_INVALIDARG The attribute or its value is invalid
+	\retval ERROR_SCENARIO_SIMULATION_RUNNING Cannot change the attribute while a simulation is running
 */
-HRESULT CCWFGM_TemporalAttributeFilter::SetAttribute(unsigned short /*option*/, const PolymorphicAttribute& /*value*/) {
-	return E_NOTIMPL;
+HRESULT CCWFGM_TemporalAttributeFilter::SetAttribute(unsigned short option, const PolymorphicAttribute &var) {
+	switch (option) {
+		case CWFGM_GRID_ATTRIBUTE_SOLAR_CACHE_TILE: {
+							double dval;
+							HRESULT hr;
+							if (FAILED(hr = VariantToDouble_(var, &dval)))
+								return hr;
+							if (dval < 0.0)
+								return E_INVALIDARG;
+							SEM_BOOL engaged;
+							CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE, &engaged, 1000000LL);
+							if (!engaged)
+								return ERROR_SCENARIO_SIMULATION_RUNNING;
+							if (m_solarTileSize != dval) {
+								m_solarTileSize = dval;
+								clearSolarCache();
+								m_bRequiresSave = true;
+							}
+							}
+							return S_OK;
+	}
+	return E_INVALIDARG;
 }
 
 
@@ -710,6 +848,7 @@ HRESULT CCWFGM_TemporalAttributeFilter::SetOptionKey(unsigned short option, cons
 			return E_FAIL;
 		}
 	}
+	invalidateIndex();					// set or cleared below, which may change which seasonal entries apply
 
 	double dval;
 	WTimeSpan lval;
@@ -887,6 +1026,7 @@ HRESULT CCWFGM_TemporalAttributeFilter::ClearOptionKey(unsigned short option, co
 		}
 	}
 
+	invalidateIndex();
 	if (found) {
 		switch (option) {
 		case CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_RH:					found->m_bits &= (~(TEMPORAL_BITS_RH_EFFECTIVE)); break;
@@ -926,41 +1066,88 @@ HRESULT CCWFGM_TemporalAttributeFilter::ClearOptionKey(unsigned short option, co
 }
 
 
-SeasonalAttribute *CCWFGM_TemporalAttributeFilter::findSeasonOption(const WTimeSpan &wtime, unsigned short option, bool autocreate, bool accept_earlier) {
-	weak_assert(wtime <= WTimeSpan(366 * 24 * 60 * 60));
-
-	SeasonalAttribute *found = nullptr, *lastfound = nullptr;
-	WTimeSpan wtime2(wtime);
-	wtime2.PurgeToDay();
+/*! Rebuilds the sorted arrays used to look up daily and seasonal options, if the lists have changed since they were last
+	built.  Lookups come from simulation threads at every point and timestep, so this is safe to call concurrently, but not
+	while the lists are being changed.
+*/
+void CCWFGM_TemporalAttributeFilter::rebuildIndex() {
+	if (!m_indexStale.load(std::memory_order_acquire))
+		return;
+
+	CThreadSemaphoreEngage engage(&m_indexLock, SEM_TRUE);
+	if (!m_indexStale.load(std::memory_order_relaxed))
+		return;
+
+	m_dailySorted.clear();
+	m_dailyIndex.clear();
+	m_dailyFirstDay = 0;
+	DailyAttribute *da = m_attributes.LH_Head();
+	while (da->LN_Succ()) {
+		m_dailySorted.push_back(da);
+		da = da->LN_Succ();
+	}
 
-	SeasonalAttribute *ao = m_conditions.LH_Head();
-	while (ao->LN_Succ()) {
-		if ((ao->m_localStartDate == wtime) || (ao->m_localStartDate == wtime2)) {
-			found = ao;
-			break;
+	// daily entries start at local midnight, so they're indexed directly by day unless they're spread too thin
+	if (m_dailySorted.size()) {
+		m_dailyFirstDay = m_dailySorted.front()->m_localStartTime.GetTotalSeconds() / (24 * 60 * 60);
+		const std::uint64_t days = m_dailySorted.back()->m_localStartTime.GetTotalSeconds() / (24 * 60 * 60) - m_dailyFirstDay + 1;
+		if (days <= 4 * m_dailySorted.size() + 366) {
+			m_dailyIndex.resize(days, nullptr);
+			for (DailyAttribute *d : m_dailySorted) {
+				DailyAttribute *&slot = m_dailyIndex[d->m_localStartTime.GetTotalSeconds() / (24 * 60 * 60) - m_dailyFirstDay];
+				if (slot) {					// more than one entry for a day, fall back to the binary search
+					m_dailyIndex.clear();
+					break;
+				}
+				slot = d;
+			}
 		}
+	}
 
-		if (ao->m_localStartDate > wtime2) {
+	m_seasonSorted.clear();
+	for (auto &b : m_seasonBreaks)
+		b.clear();
+	SeasonalAttribute *sa = m_conditions.LH_Head();
+	while (sa->LN_Succ()) {
+		m_seasonSorted.push_back(sa);
+		if (sa->m_optionFlagsSet & (1 << CWFGM_SCENARIO_OPTION_GRASSPHENOLOGY))
+			m_seasonBreaks[0].push_back(sa);
+		if (sa->m_optionFlagsSet & (1 << CWFGM_SCENARIO_OPTION_GREENUP))
+			m_seasonBreaks[1].push_back(sa);
+		if (sa->m_bits & TEMPORAL_BITS_CURING_DEGREE_EFFECTIVE)
+			m_seasonBreaks[2].push_back(sa);
+		sa = sa->LN_Succ();
+	}
 
-#ifdef _DEBUG
-			while (ao->LN_Succ()) {
-				weak_assert(ao->m_localStartDate != wtime2);
-				ao = ao->LN_Succ();
-			}
-#endif
+	m_indexStale.store(false, std::memory_order_release);
+}
 
-			break;
-		}
 
-		if ((option == CWFGM_SCENARIO_OPTION_GRASSPHENOLOGY) || (option == CWFGM_SCENARIO_OPTION_GREENUP)) {
-			if (ao->m_optionFlagsSet & (1 << option))
-				lastfound = ao;
-		} else if (option == FUELCOM_ATTRIBUTE_CURINGDEGREE) {
-			if (ao->m_bits & TEMPORAL_BITS_CURING_DEGREE_EFFECTIVE)
-				lastfound = ao;
-		}
+SeasonalAttribute *CCWFGM_TemporalAttributeFilter::findSeasonOption(const WTimeSpan &wtime, unsigned short option, bool autocreate, bool accept_earlier) {
+	weak_assert(wtime <= WTimeSpan(366 * 24 * 60 * 60));
+
+	rebuildIndex();
+
+	SeasonalAttribute *found = nullptr, *lastfound = nullptr;
+	WTimeSpan wtime2(wtime);
+	wtime2.PurgeToDay();
 
-		ao = ao->LN_Succ();
+	auto before = [](const SeasonalAttribute *sa, const WTimeSpan &ws) { return sa->m_localStartDate < ws; };
+	auto it = std::lower_bound(m_seasonSorted.begin(), m_seasonSorted.end(), wtime2, before);
+	if ((it != m_seasonSorted.end()) && (((*it)->m_localStartDate == wtime) || ((*it)->m_localStartDate == wtime2)))
+		found = *it;
+
+	const std::vector<SeasonalAttribute *> *breaks = nullptr;
+	if (option == CWFGM_SCENARIO_OPTION_GRASSPHENOLOGY)
+		breaks = &m_seasonBreaks[0];
+	else if (option == CWFGM_SCENARIO_OPTION_GREENUP)
+		breaks = &m_seasonBreaks[1];
+	else if (option == FUELCOM_ATTRIBUTE_CURINGDEGREE)
+		breaks = &m_seasonBreaks[2];
+	if (breaks) {
+		auto bit = std::lower_bound(breaks->begin(), breaks->end(), wtime2, before);
+		if (bit != breaks->begin())
+			lastfound = *(bit - 1);
 	}
 
 	if (found) {
@@ -981,13 +1168,13 @@ SeasonalAttribute *CCWFGM_TemporalAttributeFilter::findSeasonOption(const WTimeS
 		found = new SeasonalAttribute();
 		found->m_localStartDate = wtime2;
 
-		SeasonalAttribute *_where = m_conditions.LH_Head();
-		while (_where->LN_Succ()) {
-			if (_where->m_localStartDate > found->m_localStartDate)
-				break;
-			_where = _where->LN_Succ();
-		}
-		m_conditions.Insert(found, _where->LN_Pred());
+		auto _where = std::upper_bound(m_seasonSorted.begin(), m_seasonSorted.end(), wtime2,
+			[](const WTimeSpan &ws, const SeasonalAttribute *sa) { return ws < sa->m_localStartDate; });
+		if (_where == m_seasonSorted.end())
+			m_conditions.AddTail(found);
+		else
+			m_conditions.Insert(found, (*_where)->LN_Pred());
+		invalidateIndex();
 	}
 
 	return found;
@@ -1020,37 +1207,33 @@ DailyAttribute *CCWFGM_TemporalAttributeFilter::findOption(const WTime &_time, b
 		time.SetTime(lstime);
 	}
 
-	DailyAttribute *ao = m_attributes.LH_Head();
-	while (ao->LN_Succ()) {
-		if (ao->m_localStartTime == time) {
-			found = ao;
-			break;
-		}
-		if (ao->m_localStartTime > time) {
-
-#ifdef _DEBUG
-			while (ao->LN_Succ()) {
-				weak_assert(ao->m_localStartTime != time);
-				ao = ao->LN_Succ();
-			}
-#endif
+	rebuildIndex();
 
-			break;
+	if (m_dailyIndex.size()) {
+		const std::uint64_t day = time.GetTotalSeconds() / (24 * 60 * 60);
+		if ((day >= m_dailyFirstDay) && (day - m_dailyFirstDay < m_dailyIndex.size())) {
+			DailyAttribute *ao = m_dailyIndex[day - m_dailyFirstDay];
+			if ((ao) && (ao->m_localStartTime == time))
+				found = ao;
 		}
-		ao = ao->LN_Succ();
+	} else {
+		auto it = std::lower_bound(m_dailySorted.begin(), m_dailySorted.end(), time,
+			[](const DailyAttribute *da, const WTime &t) { return da->m_localStartTime < t; });
+		if ((it != m_dailySorted.end()) && ((*it)->m_localStartTime == time))
+			found = *it;
 	}
 
 	if ((!found) && (autocreate)) {
 		found = new DailyAttribute(m_timeManager);
 		found->m_localStartTime.SetTime(time);
 
-		DailyAttribute *_where = m_attributes.LH_Head();
-		while (_where->LN_Succ()) {
-			if (_where->m_localStartTime > found->m_localStartTime)
-				break;
-			_where = _where->LN_Succ();
-		}
-		m_attributes.Insert(found, _where->LN_Pred());
+		auto _where = std::upper_bound(m_dailySorted.begin(), m_dailySorted.end(), time,
+			[](const WTime &t, const DailyAttribute *da) { return t < da->m_localStartTime; });
+		if (_where == m_dailySorted.end())
+			m_attributes.AddTail(found);
+		else
+			m_attributes.Insert(found, (*_where)->LN_Pred());
+		invalidateIndex();
 	}
 
 	return found;
@@ -1140,6 +1323,7 @@ HRESULT CCWFGM_TemporalAttributeFilter::DeleteIndex(unsigned short option, /*[in
 
 		m_conditions.Remove(sa);
 		delete sa;
+		invalidateIndex();
 	} else if ((option == CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_RH) ||
 		(option == CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_FWI) ||
 		(option == CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_ISI) ||
@@ -1158,6 +1342,7 @@ HRESULT CCWFGM_TemporalAttributeFilter::DeleteIndex(unsigned short option, /*[in
 			return E_INVALIDARG;
 		m_attributes.Remove(oa);
 		delete oa;
+		invalidateIndex();
 	} else
 		return E_INVALIDARG;
 	m_bRequiresSave = TRUE;
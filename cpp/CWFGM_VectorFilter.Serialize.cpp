@@ -23,6 +23,7 @@
 
 #include "CoordinateConverter.h"
 #include "gdalclient.h"
+#include "GridLockedConverter.h"
 #include "doubleBuilder.h"
 
 #define OLD_SERIALIZE
@@ -103,6 +104,7 @@ HRESULT CCWFGM_VectorFilter::ImportPolylines(const std::filesystem::path & file_
 			p = p->LN_Succ();
 		}
 		m_bRequiresSave = true;
+		m_polygonCacheValid = false;
 	}
 	if (oSourceSRS)
 		OSRDestroySpatialReference(oSourceSRS);
@@ -181,6 +183,7 @@ HRESULT CCWFGM_VectorFilter::ImportPolylinesWFS(const std::string & url, const s
 		m_gisPWD = csPassword;
 
 		m_bRequiresSave = true;
+		m_polygonCacheValid = false;
 	}
 	if (oSourceSRS)
 		OSRDestroySpatialReference(oSourceSRS);
@@ -250,31 +253,43 @@ std::int32_t CCWFGM_VectorFilter::serialVersionUid(const SerializeProtoOptions&
 
 
 WISE::GridProto::CwfgmVectorFilter* CCWFGM_VectorFilter::serialize(const SerializeProtoOptions& options) {
-	auto filter = new WISE::GridProto::CwfgmVectorFilter();
+	return serialize(options, nullptr);
+}
+
+
+WISE::GridProto::CwfgmVectorFilter* CCWFGM_VectorFilter::serialize(const SerializeProtoOptions& options, google::protobuf::Arena *arena) {
+	auto filter = google::protobuf::Arena::CreateMessage<WISE::GridProto::CwfgmVectorFilter>(arena);
 	filter->set_version(serialVersionUid(options));
 
 	if (m_firebreakWidth != 0.0)
 		filter->set_allocated_firebreakwidth(DoubleBuilder().withValue(m_firebreakWidth).forProtobuf(options.useVerboseFloats()));
 
-	XY_PolyLLSet set;
-	RefNode<XY_PolyType> *pc = m_polyList.LH_Head();
-	while (pc->LN_Succ()) {
-		XY_PolyLL *p = (XY_PolyLL *)set.NewCopy(*pc->LN_Ptr());
-		p->m_publicFlags &= (~(XY_PolyLL_BaseTempl<double>::Flags::INTERPRET_POLYMASK));
-		p->m_publicFlags |= pc->LN_Ptr()->m_publicFlags;
-		set.AddPoly(p);
-		pc = pc->LN_Succ();
-	}
+	if ((!m_polygonCacheValid) || (m_polygonCacheVerbose != options.useVerboseFloats())) {
+		XY_PolyLLSet set;
+		RefNode<XY_PolyType> *pc = m_polyList.LH_Head();
+		while (pc->LN_Succ()) {
+			XY_PolyLL *p = (XY_PolyLL *)set.NewCopy(*pc->LN_Ptr());
+			p->m_publicFlags &= (~(XY_PolyLL_BaseTempl<double>::Flags::INTERPRET_POLYMASK));
+			p->m_publicFlags |= pc->LN_Ptr()->m_publicFlags;
+			set.AddPoly(p);
+			pc = pc->LN_Succ();
+		}
 
-	GeoPoly geo(&set);
-	geo.setStoredUnits(GeoPoly::UTM);
-	filter->set_allocated_polygons(geo.getProtobuf(options.useVerboseFloats()));
+		GeoPoly geo(&set);
+		geo.setStoredUnits(GeoPoly::UTM);
+		m_polygonCache.set_allocated_polygons(geo.getProtobuf(options.useVerboseFloats()));
+		m_polygonCacheVerbose = options.useVerboseFloats();
+		m_polygonCacheValid = true;
+	}
+	filter->mutable_polygons()->CopyFrom(m_polygonCache.polygons());
 
 	return filter;
 }
 
 
 CCWFGM_VectorFilter* CCWFGM_VectorFilter::deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) {
+	CRWThreadSemaphoreEngage engage(m_lock, SEM_TRUE);
+
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine;
 	if (!(gridEngine = m_gridEngine)) {
 		if (valid)
@@ -368,9 +383,9 @@ CCWFGM_VectorFilter* CCWFGM_VectorFilter::deserialize(const google::protobuf::Me
 	std::string projection;
 	projection = std::get<std::string>(var);
 
-	boost::scoped_ptr<CCoordinateConverter> convert(new CCoordinateConverter());
-	convert->SetSourceProjection(projection.c_str());
+	GridLockedConverter convert(projection);
 
+	m_polygonCacheValid = false;
 	GeoPoly geo(filter->polygons(), GeoPoly::TYPE_LINKED_LIST);
 	geo.setStoredUnits(GeoPoly::UTM);
 	geo.setConverter([&convert](std::uint8_t type, double x, double y, double z) -> std::tuple<double, double, double>
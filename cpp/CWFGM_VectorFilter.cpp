@@ -55,6 +55,7 @@ CCWFGM_VectorFilter::CCWFGM_VectorFilter() {
 	m_resolution = -1.0;
 	m_xllcorner = m_yllcorner = -999999999.0;
 	m_flags = 0;
+	m_polygonCacheValid = m_polygonCacheVerbose = false;
 }
 
 
@@ -86,6 +87,7 @@ CCWFGM_VectorFilter::CCWFGM_VectorFilter(const CCWFGM_VectorFilter &toCopy) {
 		pn = pn->LN_Succ();
 	}
 
+	m_polygonCacheValid = m_polygonCacheVerbose = false;
 	m_bRequiresSave = false;
 }
 
@@ -152,6 +154,7 @@ HRESULT CCWFGM_VectorFilter::AddPolyLine(const XY_PolyConst &xy_pairs, std::uint
 		poly->m_publicFlags = type;
 		poly->CleanPoly(0.0, ctype);
 		m_bRequiresSave = true;
+		m_polygonCacheValid = false;
 	} catch (std::bad_alloc &cme) {
 		if (poly)	delete poly;
 		if (pn)		delete pn;
@@ -213,6 +216,7 @@ HRESULT CCWFGM_VectorFilter::SetPolyLine(std::uint32_t index, const XY_PolyConst
 		poly->m_publicFlags = type;
 		poly->CleanPoly(0.0, ctype);
 		m_bRequiresSave = true;
+		m_polygonCacheValid = false;
 	} catch(std::bad_alloc &cme) {
 		if (poly)	delete poly;
 		return E_OUTOFMEMORY;
@@ -289,6 +293,7 @@ HRESULT CCWFGM_VectorFilter::ClearPolyLine(std::uint32_t set_break) {
 		delete pn;
 	}
 	m_bRequiresSave = true;
+	m_polygonCacheValid = false;
 
 	rescanRanges();
 	clearFirebreak();
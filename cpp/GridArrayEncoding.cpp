@@ -0,0 +1,143 @@
+/**
+ * WISE_Grid_Module: GridArrayEncoding.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridArrayEncoding.h"
+#include "Thread.h"
+#include <omp.h>
+#include <cstring>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+thread_local bool GridArrayEncoding::m_saveEncoded = false;
+
+
+static void putVarint(std::string &out, std::uint64_t value) {
+	while (value >= 0x80) {
+		out.push_back((char)((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+	out.push_back((char)value);
+}
+
+
+static bool getVarint(const std::string &in, std::size_t &offset, std::uint64_t &value) {
+	value = 0;
+	for (std::uint16_t shift = 0; (offset < in.length()) && (shift < 64); shift += 7) {
+		const std::uint8_t b = (std::uint8_t)in[offset++];
+		value |= (std::uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80))
+			return true;
+	}
+	return false;
+}
+
+
+std::string GridArrayEncoding::encodeFuel(const std::uint8_t *fuel, const bool *valid, std::uint64_t size) {
+	std::string out;
+	std::uint64_t i = 0;
+	while (i < size) {
+		const bool v = valid[i];
+		const std::uint8_t f = fuel[i];
+		std::uint64_t run = 1;
+		if (v)
+			while ((i + run < size) && (valid[i + run]) && (fuel[i + run] == f))
+				run++;
+		else
+			while ((i + run < size) && (!valid[i + run]))
+				run++;
+
+		putVarint(out, ((run - 1) << 1) | (v ? 0 : 1));
+		if (v)
+			out.push_back((char)f);
+		i += run;
+	}
+	return out;
+}
+
+
+bool GridArrayEncoding::decodeFuel(const std::string &encoded, std::uint8_t *fuel, bool *valid, std::uint64_t size) {
+	std::size_t offset = 0;
+	std::uint64_t i = 0;
+	while (offset < encoded.length()) {
+		std::uint64_t token;
+		if (!getVarint(encoded, offset, token))
+			return false;
+		const std::uint64_t run = (token >> 1) + 1;
+		if (run > size - i)
+			return false;
+
+		if (token & 1) {
+			memset(fuel + i, (std::uint8_t)-1, run);
+			memset(valid + i, 0, run * sizeof(bool));
+		}
+		else {
+			if (offset >= encoded.length())
+				return false;
+			memset(fuel + i, (std::uint8_t)encoded[offset++], run);
+			for (std::uint64_t j = 0; j < run; j++)
+				valid[i + j] = true;
+		}
+		i += run;
+	}
+	return (i == size);
+}
+
+
+std::string GridArrayEncoding::encodeRowDelta(const std::int16_t *elevation, std::uint16_t xsize, std::uint16_t ysize) {
+	const std::uint64_t size = (std::uint64_t)xsize * (std::uint64_t)ysize;
+	std::string out(size * 2, '\0');
+	std::uint8_t *lo = reinterpret_cast<std::uint8_t *>(&out[0]), *hi = lo + size;
+
+#pragma omp parallel for num_threads(CWorkerThreadPool::NumberIdealProcessors())
+	for (std::int32_t y = 0; y < (std::int32_t)ysize; y++) {
+		const std::uint64_t row = (std::uint64_t)y * xsize;
+		for (std::uint32_t x = 0; x < xsize; x++) {
+			const std::uint64_t i = row + x;
+			const std::int16_t pred = y ? elevation[i - xsize] : (x ? elevation[i - 1] : 0);
+			const std::uint16_t d = (std::uint16_t)((std::uint16_t)elevation[i] - (std::uint16_t)pred);
+			lo[i] = (std::uint8_t)(d & 0xff);
+			hi[i] = (std::uint8_t)(d >> 8);
+		}
+	}
+	return out;
+}
+
+
+bool GridArrayEncoding::decodeRowDelta(const std::string &encoded, std::int16_t *elevation, std::uint16_t xsize, std::uint16_t ysize) {
+	const std::uint64_t size = (std::uint64_t)xsize * (std::uint64_t)ysize;
+	if (encoded.length() != size * 2)
+		return false;
+
+	const std::uint8_t *lo = reinterpret_cast<const std::uint8_t *>(encoded.data()), *hi = lo + size;
+	std::uint16_t prev = 0;
+	for (std::uint32_t x = 0; x < xsize; x++) {
+		prev = (std::uint16_t)(prev + (std::uint16_t)(lo[x] | (hi[x] << 8)));
+		elevation[x] = (std::int16_t)prev;
+	}
+	// after the first row, each cell only depends on the cell above it
+	for (std::uint64_t i = xsize; i < size; i++)
+		elevation[i] = (std::int16_t)((std::uint16_t)elevation[i - xsize] + (std::uint16_t)(lo[i] | (hi[i] << 8)));
+	return true;
+}
+
+
+bool GridArrayEncoding::saveEncoded() {
+	return m_saveEncoded;
+}
+
+#endif
@@ -0,0 +1,269 @@
+/**
+ * WISE_Grid_Module: GridChunkedCompress.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridChunkedCompress.h"
+#include "Thread.h"
+#include "boost_compression.h"
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filter/bzip2.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <omp.h>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+static const char chunkMagic[4] = { 'W', 'G', 'C', 'Z' };
+static constexpr std::uint32_t chunkVersion = 1;
+static constexpr std::size_t headerSize = sizeof(chunkMagic) + sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t);
+static constexpr std::size_t entrySize = sizeof(std::uint32_t) * 2;
+
+thread_local GridChunkedCompress::Codec GridChunkedCompress::m_saveCodec = GridChunkedCompress::Codec::DEFAULT;
+
+
+static void put(std::string &out, std::uint64_t value, std::uint16_t bytes) {
+	for (std::uint16_t i = 0; i < bytes; i++, value >>= 8)
+		out.push_back((char)(value & 0xff));
+}
+
+
+static std::uint64_t get(const std::string &in, std::size_t offset, std::uint16_t bytes) {
+	std::uint64_t value = 0;
+	for (std::uint16_t i = bytes; i > 0; i--)
+		value = (value << 8) | (std::uint8_t)in[offset + i - 1];
+	return value;
+}
+
+
+bool GridChunkedCompress::isChunked(const std::string &blob) {
+	return (blob.length() >= headerSize) && (std::equal(chunkMagic, chunkMagic + sizeof(chunkMagic), blob.begin()));
+}
+
+
+bool GridChunkedCompress::isCodec(std::int32_t value) {
+	switch (value) {
+	case (std::int32_t)Codec::DEFAULT:
+	case (std::int32_t)Codec::FAST:
+	case (std::int32_t)Codec::HIGH_RATIO:
+		return true;
+	}
+	return false;
+}
+
+
+GridChunkedCompress::Codec GridChunkedCompress::toCodec(std::int32_t value) {
+	if (!isCodec(value))
+		throw std::runtime_error("GridChunkedCompress: unsupported codec");
+	return (Codec)value;
+}
+
+
+GridChunkedCompress::Codec GridChunkedCompress::saveCodec() {
+	return m_saveCodec;
+}
+
+
+static std::string compressChunk(const char *data, std::size_t length, GridChunkedCompress::Codec codec) {
+	if (codec == GridChunkedCompress::Codec::DEFAULT)
+		return Compress::compress(data, length);
+
+	std::string out;
+	{
+		boost::iostreams::filtering_ostream os;
+		if (codec == GridChunkedCompress::Codec::FAST)
+			os.push(boost::iostreams::zlib_compressor(boost::iostreams::zlib_params(boost::iostreams::zlib::best_speed)));
+		else
+			os.push(boost::iostreams::bzip2_compressor());
+		os.push(boost::iostreams::back_inserter(out));
+		os.write(data, length);
+	}												// the stream is flushed and closed when it goes out of scope
+	return out;
+}
+
+
+static void decompressChunk(const char *data, std::size_t length, GridChunkedCompress::Codec codec, char *dest, std::size_t rawLength) {
+	if (codec == GridChunkedCompress::Codec::DEFAULT) {
+		std::string chunk = Compress::decompress(std::string(data, length));
+		if (chunk.length() != rawLength)
+			throw std::runtime_error("GridChunkedCompress: chunk length mismatch");
+		std::copy(chunk.begin(), chunk.end(), dest);
+		return;
+	}
+
+	boost::iostreams::filtering_istream is;
+	if (codec == GridChunkedCompress::Codec::FAST)
+		is.push(boost::iostreams::zlib_decompressor());
+	else
+		is.push(boost::iostreams::bzip2_decompressor());
+	is.push(boost::iostreams::array_source(data, length));
+	is.read(dest, rawLength);
+	if (((std::size_t)is.gcount() != rawLength) || (is.peek() != std::char_traits<char>::eof()))
+		throw std::runtime_error("GridChunkedCompress: chunk length mismatch");
+}
+
+
+std::string GridChunkedCompress::compress(const char *data, std::size_t length, Codec codec) {
+	if ((length <= CHUNK_SIZE) && (codec == Codec::DEFAULT))
+		return Compress::compress(data, length);
+
+	const std::int32_t count = std::max((std::int32_t)((length + CHUNK_SIZE - 1) / CHUNK_SIZE), 1);
+	std::vector<std::string> chunks(count);
+	std::exception_ptr error;
+
+#pragma omp parallel for num_threads(CWorkerThreadPool::NumberIdealProcessors())
+	for (std::int32_t i = 0; i < count; i++) {
+		const std::size_t offset = (std::size_t)i * CHUNK_SIZE;
+		try {
+			chunks[i] = compressChunk(data + offset, std::min((std::size_t)CHUNK_SIZE, length - offset), codec);
+		}
+		catch (...) {
+#pragma omp critical
+			if (!error)
+				error = std::current_exception();
+		}
+	}
+	if (error)
+		std::rethrow_exception(error);
+
+	std::size_t total = headerSize + entrySize * count;
+	for (auto &c : chunks)
+		total += c.length();
+
+	std::string out;
+	out.reserve(total);
+	out.append(chunkMagic, sizeof(chunkMagic));
+	put(out, chunkVersion, sizeof(std::uint32_t));
+	put(out, count, sizeof(std::uint32_t));
+	put(out, length, sizeof(std::uint64_t));
+	for (std::int32_t i = 0; i < count; i++) {
+		const std::size_t offset = (std::size_t)i * CHUNK_SIZE;
+		put(out, std::min((std::size_t)CHUNK_SIZE, length - offset), sizeof(std::uint32_t));
+		put(out, chunks[i].length(), sizeof(std::uint32_t));
+	}
+	for (auto &c : chunks) {
+		out.append(c);
+		std::string().swap(c);		// release each chunk as it is copied so the compressed data is only held once more
+	}
+	return out;
+}
+
+
+struct ChunkIndex {
+	std::uint64_t				length;
+	std::vector<std::size_t>	rawOffset, rawLength, zipOffset, zipLength;
+};
+
+
+static void readIndex(const std::string &blob, ChunkIndex &index) {
+	std::size_t offset = sizeof(chunkMagic);
+	if (get(blob, offset, sizeof(std::uint32_t)) != chunkVersion)
+		throw std::runtime_error("GridChunkedCompress: unsupported chunk version");
+	offset += sizeof(std::uint32_t);
+	const std::uint64_t count = get(blob, offset, sizeof(std::uint32_t));
+	offset += sizeof(std::uint32_t);
+	index.length = get(blob, offset, sizeof(std::uint64_t));
+	offset += sizeof(std::uint64_t);
+
+	if ((count > (blob.length() - headerSize) / entrySize) || (index.length > count * GridChunkedCompress::CHUNK_SIZE))
+		throw std::runtime_error("GridChunkedCompress: corrupt chunk index");
+
+	// locate every chunk up front so they can be decompressed independently
+	index.rawOffset.resize(count);
+	index.rawLength.resize(count);
+	index.zipOffset.resize(count);
+	index.zipLength.resize(count);
+	std::size_t raw = 0, zip = headerSize + entrySize * count;
+	for (std::uint64_t i = 0; i < count; i++, offset += entrySize) {
+		index.rawOffset[i] = raw;
+		index.rawLength[i] = get(blob, offset, sizeof(std::uint32_t));
+		index.zipOffset[i] = zip;
+		index.zipLength[i] = get(blob, offset + sizeof(std::uint32_t), sizeof(std::uint32_t));
+		raw += index.rawLength[i];
+		zip += index.zipLength[i];
+	}
+	if ((raw != index.length) || (zip > blob.length()))
+		throw std::runtime_error("GridChunkedCompress: corrupt chunk index");
+}
+
+
+static void decompressChunks(const std::string &blob, const ChunkIndex &index, GridChunkedCompress::Codec codec, char *dest) {
+	std::exception_ptr error;
+
+#pragma omp parallel for num_threads(CWorkerThreadPool::NumberIdealProcessors())
+	for (std::int32_t i = 0; i < (std::int32_t)index.rawOffset.size(); i++) {
+		try {
+			decompressChunk(blob.data() + index.zipOffset[i], index.zipLength[i], codec, dest + index.rawOffset[i], index.rawLength[i]);
+		}
+		catch (...) {
+#pragma omp critical
+			if (!error)
+				error = std::current_exception();
+		}
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+
+std::string GridChunkedCompress::decompress(const std::string &blob, Codec codec) {
+	if (!isChunked(blob)) {
+		if (codec != Codec::DEFAULT)
+			throw std::runtime_error("GridChunkedCompress: missing chunk index");
+		return Compress::decompress(blob);
+	}
+
+	ChunkIndex index;
+	readIndex(blob, index);
+	std::string out(index.length, '\0');
+	decompressChunks(blob, index, codec, &out[0]);
+	return out;
+}
+
+
+std::size_t GridChunkedCompress::decompressedLength(const std::string &blob) {
+	if (!isChunked(blob))
+		return (std::size_t)-1;
+
+	ChunkIndex index;
+	readIndex(blob, index);
+	return index.length;
+}
+
+
+std::size_t GridChunkedCompress::decompress(const std::string &blob, void *dest, std::size_t length, Codec codec) {
+	if (!isChunked(blob)) {
+		if (codec != Codec::DEFAULT)
+			throw std::runtime_error("GridChunkedCompress: missing chunk index");
+		std::string out = Compress::decompress(blob);
+		if (out.length() == length)
+			std::copy(out.begin(), out.end(), reinterpret_cast<char *>(dest));
+		return out.length();
+	}
+
+	ChunkIndex index;
+	readIndex(blob, index);
+	if (index.length == length)
+		decompressChunks(blob, index, codec, reinterpret_cast<char *>(dest));
+	return index.length;
+}
+
+#endif
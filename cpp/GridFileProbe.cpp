@@ -0,0 +1,114 @@
+/**
+ * WISE_Grid_Module: GridFileProbe.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridFileProbe.h"
+#include "CWFGM_FuelMap.h"
+#include "gdalclient.h"
+#include <gdal.h>
+#include <cpl_error.h>
+#include <cmath>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+HRESULT ProbeRasterFile(const std::string &file_name, std::uint32_t sample_step, GridFileProbe *probe, std::vector<std::int32_t> *sampled) {
+	if (!probe)									return E_POINTER;
+	if (!file_name.length())					return E_INVALIDARG;
+
+	CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+
+	CPLErrorReset();
+	GDALDatasetH ds = GDALOpen(file_name.c_str(), GA_ReadOnly);
+	if (!ds)
+		return E_FAIL;
+
+	int xs = GDALGetRasterXSize(ds), ys = GDALGetRasterYSize(ds), bands = GDALGetRasterCount(ds);
+	if ((!bands) || (xs <= 0) || (ys <= 0) || (xs >= 65535) || (ys >= 65535)) {
+		GDALClose(ds);
+		return E_FAIL;
+	}
+
+	double transform[6] = { 0.0, 1.0, 0.0, 0.0, 0.0, -1.0 };
+	GDALGetGeoTransform(ds, transform);
+
+	probe->xsize = (std::uint16_t)xs;
+	probe->ysize = (std::uint16_t)ys;
+	probe->bands = (std::uint16_t)bands;
+	probe->xllcorner = transform[0];
+	probe->yllcorner = transform[3] + ys * transform[5];
+	probe->xresolution = transform[1];
+	probe->yresolution = fabs(transform[5]);
+	const char *ref = GDALGetProjectionRef(ds);
+	probe->projection = ref ? ref : "";
+
+	GDALRasterBandH band = GDALGetRasterBand(ds, 1);
+	GDALDataType type = GDALGetRasterDataType(band);
+	probe->dataType = GDALGetDataTypeName(type);
+	probe->isInteger = (!GDALDataTypeIsFloating(type)) && (!GDALDataTypeIsComplex(type));
+	int has_nodata = FALSE;
+	probe->noData = GDALGetRasterNoDataValue(band, &has_nodata);
+	probe->hasNoData = (has_nodata) ? true : false;
+
+	probe->compatibility = S_OK;
+	probe->samples = 0;
+	probe->fuelHistogram.clear();
+	probe->unknownFuels.clear();
+
+	HRESULT hr = S_OK;
+	if ((sampled) && (sample_step)) {
+		int bx = (int)((xs + sample_step - 1) / sample_step), by = (int)((ys + sample_step - 1) / sample_step);
+		sampled->resize((size_t)bx * (size_t)by);
+		if (GDALRasterIO(band, GF_Read, 0, 0, xs, ys, sampled->data(), bx, by, GDT_Int32, 0, 0) == CE_None)
+			probe->samples = (std::uint32_t)sampled->size();
+		else {
+			sampled->clear();
+			hr = E_FAIL;
+		}
+	}
+
+	GDALClose(ds);
+	return hr;
+}
+
+
+void ProbeFuelHistogram(const std::vector<std::int32_t> &sampled, const CCWFGM_FuelMap *fuelMap, GridFileProbe *probe) {
+	const bool has_nodata = probe->hasNoData;
+	const std::int32_t nodata = (std::int32_t)probe->noData;
+
+	auto it = probe->fuelHistogram.end();
+	for (std::int32_t value : sampled) {
+		if ((has_nodata) && (value == nodata))
+			continue;
+		if ((it == probe->fuelHistogram.end()) || (it->first != value))		// fuel grids tend to have long runs of the same value
+			it = probe->fuelHistogram.emplace(value, 0).first;
+		it->second++;
+	}
+
+	if (!fuelMap)
+		return;
+	for (auto &entry : probe->fuelHistogram) {
+		std::uint8_t fuel_index;
+		long export_index;
+		ICWFGM_Fuel *fuel;
+		if (FAILED(fuelMap->FuelAtFileIndex(entry.first, &fuel_index, &export_index, &fuel)))
+			probe->unknownFuels.push_back(entry.first);
+	}
+	if ((probe->unknownFuels.size()) && (probe->compatibility == S_OK))
+		probe->compatibility = ERROR_FUELS_FUEL_UNKNOWN;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * WISE_Grid_Module: GridMemoryFile.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridMemoryFile.h"
+#include "results.h"
+#include "gdalclient.h"
+#include <cpl_conv.h>
+#include <cpl_string.h>
+#include <cpl_vsi.h>
+#include <atomic>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+static std::string uniqueName(const void *owner, const std::string &extension) {
+	static std::atomic<std::uint32_t> counter(0);
+	std::string ext(extension);
+	if ((ext.length()) && (ext[0] != '.'))
+		ext = "." + ext;
+	return std::string(CPLSPrintf("/vsimem/wise_grid_%p_%u", owner, counter++)) + ext;
+}
+
+
+GridMemoryFile::GridMemoryFile(const std::string &extension) {
+	m_name = uniqueName(this, extension);
+}
+
+
+GridMemoryFile::GridMemoryFile(const std::uint8_t *buffer, std::size_t length, const std::string &extension) {
+	m_name = uniqueName(this, extension);
+
+	CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+
+	VSILFILE *f = VSIFileFromMemBuffer(m_name.c_str(), const_cast<GByte *>(buffer), (vsi_l_offset)length, FALSE);
+	if (f)
+		VSIFCloseL(f);
+}
+
+
+GridMemoryFile::~GridMemoryFile() {
+	CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+
+	VSIUnlink(m_name.c_str());
+	VSIUnlink(CPLResetExtension(m_name.c_str(), "prj"));		// side-car files some drivers (e.g. AAIGrid) create
+	VSIUnlink(CPLSPrintf("%s.aux.xml", m_name.c_str()));
+}
+
+
+HRESULT GridMemoryFile::read(std::vector<std::uint8_t> &buffer) const {
+	CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+
+	vsi_l_offset length = 0;
+	GByte *data = VSIGetMemFileBuffer(m_name.c_str(), &length, FALSE);
+	if (!data)
+		return E_FAIL;
+	buffer.assign(data, data + length);
+	return S_OK;
+}
+
+#endif
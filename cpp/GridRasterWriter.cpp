@@ -0,0 +1,313 @@
+/**
+ * WISE_Grid_Module: GridRasterWriter.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridRasterWriter.h"
+#include "results.h"
+#include "gdalclient.h"
+#include <cpl_error.h>
+#include <cpl_string.h>
+#include <boost/algorithm/string/predicate.hpp>
+#include <ctime>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+// GeoTIFF COMPRESS values, in GDALExporter::CompressionType order so existing callers of ExportGrid() keep their meaning.
+static const char * const compressionNames[] = { nullptr, "JPEG", "LZW", "PACKBITS", "DEFLATE", "CCITTRLE", "CCITTFAX3", "CCITTFAX4",
+	"LZMA", "ZSTD", "LERC", "LERC_DEFLATE", "LERC_ZSTD", "WEBP" };
+
+// target size of a strip, in cells, before it's handed off to GDAL
+#define GRIDRASTERWRITER_STRIP_CELLS	(1 << 20)
+// tile edge for tiled GeoTIFFs, overviews are generated until the raster fits in a single tile
+#define GRIDRASTERWRITER_BLOCK_SIZE		256
+
+
+static GDALDriverH driverForFile(const std::string &file_name) {
+	std::string::size_type sep = file_name.find_last_of("/\\");
+	std::string::size_type dot = file_name.find_last_of('.');
+	if ((dot == std::string::npos) || ((sep != std::string::npos) && (dot < sep)))
+		return GDALGetDriverByName("GTiff");
+
+	std::string ext = file_name.substr(dot + 1);
+	if ((boost::iequals(ext, "tif")) || (boost::iequals(ext, "tiff")))
+		return GDALGetDriverByName("GTiff");
+
+	for (int i = 0; i < GDALGetDriverCount(); i++) {
+		GDALDriverH driver = GDALGetDriver(i);
+		if (!GDALGetMetadataItem(driver, GDAL_DCAP_RASTER, nullptr))
+			continue;
+		if ((!GDALGetMetadataItem(driver, GDAL_DCAP_CREATE, nullptr)) && (!GDALGetMetadataItem(driver, GDAL_DCAP_CREATECOPY, nullptr)))
+			continue;
+		const char *extensions = GDALGetMetadataItem(driver, GDAL_DMD_EXTENSIONS, nullptr);
+		if (!extensions)
+			continue;
+		char **tokens = CSLTokenizeString2(extensions, " ", 0);
+		bool found = false;
+		for (char **t = tokens; (t) && (*t) && (!found); t++)
+			found = boost::iequals(ext, *t);
+		CSLDestroy(tokens);
+		if (found)
+			return driver;
+	}
+	return nullptr;
+}
+
+
+GridRasterWriter::GridRasterWriter() {
+	m_xsize = m_ysize = 0;
+	m_resolution = 0.0;
+	m_xllcorner = m_yllcorner = 0.0;
+	m_compression = 0;
+	m_tiled = m_overviews = false;
+	m_overviewLevels = -1;
+	m_driver = nullptr;
+	m_dataset = nullptr;
+	m_options = nullptr;
+	m_copyOnClose = false;
+}
+
+
+GridRasterWriter::~GridRasterWriter() {
+	close();
+}
+
+
+void GridRasterWriter::addTag(const char *name, const char *value) {
+	m_tags.emplace_back(name, value);
+}
+
+
+void GridRasterWriter::addDefaultTags() {
+	addTag("TIFFTAG_SOFTWARE", "W.I.S.E.");
+	char mbstr[100];
+	std::time_t t = std::time(nullptr);
+	std::strftime(mbstr, sizeof(mbstr), "%Y-%m-%d %H:%M:%S %Z", std::localtime(&t));
+	addTag("TIFFTAG_DATETIME", mbstr);
+}
+
+
+std::uint16_t GridRasterWriter::addBand(BandType type, const char *name, double nodata, Resample resample) {
+	Band b;
+	b.type = type;
+	b.resample = resample;
+	b.name = name;
+	b.nodata = nodata;
+	m_bands.push_back(b);
+	return (std::uint16_t)m_bands.size();
+}
+
+
+std::uint16_t GridRasterWriter::stripRows() const {
+	if (!m_xsize)
+		return 1;
+	std::uint32_t rows = GRIDRASTERWRITER_STRIP_CELLS / m_xsize;
+	if (!rows)
+		rows = 1;
+	if ((m_tiled) && (rows > GRIDRASTERWRITER_BLOCK_SIZE))
+		rows -= rows % GRIDRASTERWRITER_BLOCK_SIZE;	// whole rows of tiles, so no tile is compressed and written twice
+	else if (m_tiled)
+		rows = GRIDRASTERWRITER_BLOCK_SIZE;
+	if (rows > m_ysize)
+		rows = m_ysize;
+	return (std::uint16_t)rows;
+}
+
+
+HRESULT GridRasterWriter::accessError() const {
+	switch (CPLGetLastErrorNo()) {
+		case CPLE_OpenFailed:
+		case CPLE_FileIO:
+		case CPLE_NoWriteAccess:	return E_ACCESSDENIED;
+	}
+	return E_FAIL;
+}
+
+
+HRESULT GridRasterWriter::create(const std::string &file_name) {
+	if (m_dataset)													{ weak_assert(false); return E_UNEXPECTED; }
+	if ((!file_name.length()) || (!m_xsize) || (!m_ysize))			return E_INVALIDARG;
+	if (!m_bands.size())											{ weak_assert(false); return E_UNEXPECTED; }
+
+	CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+
+	if (!(m_driver = driverForFile(file_name)))
+		return E_INVALIDARG;
+
+	GDALDataType type = GDT_Int32;
+	for (auto &b : m_bands)
+		if (b.type == BandType::FLOAT64)
+			type = GDT_Float64;
+
+	if (EQUAL(GDALGetDriverShortName(m_driver), "GTiff")) {
+		if ((m_compression < (sizeof(compressionNames) / sizeof(compressionNames[0]))) && (compressionNames[m_compression]))
+			m_options = CSLSetNameValue(m_options, "COMPRESS", compressionNames[m_compression]);
+		if (m_tiled) {
+			m_options = CSLSetNameValue(m_options, "TILED", "YES");
+			m_options = CSLSetNameValue(m_options, "BLOCKXSIZE", CPLSPrintf("%d", GRIDRASTERWRITER_BLOCK_SIZE));
+			m_options = CSLSetNameValue(m_options, "BLOCKYSIZE", CPLSPrintf("%d", GRIDRASTERWRITER_BLOCK_SIZE));
+			if (!m_compression) {
+				m_options = CSLSetNameValue(m_options, "COMPRESS", "DEFLATE");
+				m_options = CSLSetNameValue(m_options, "PREDICTOR", (type == GDT_Float64) ? "3" : "2");
+			}
+			m_options = CSLSetNameValue(m_options, "BIGTIFF", "IF_SAFER");
+		}
+	}
+	else {
+		m_tiled = false;
+		m_overviews = false;
+	}
+
+	m_copyOnClose = (GDALGetMetadataItem(m_driver, GDAL_DCAP_CREATE, nullptr) == nullptr);
+	m_fileName = file_name;
+
+	CPLErrorReset();
+	if (m_copyOnClose)
+		m_dataset = GDALCreate(GDALGetDriverByName("MEM"), "", m_xsize, m_ysize, (int)m_bands.size(), type, nullptr);
+	else
+		m_dataset = GDALCreate(m_driver, m_fileName.c_str(), m_xsize, m_ysize, (int)m_bands.size(), type, m_options);
+	if (!m_dataset)
+		return accessError();
+
+	double transform[6] = { m_xllcorner, m_resolution, 0.0, m_yllcorner + m_ysize * m_resolution, 0.0, -m_resolution };
+	GDALSetGeoTransform(m_dataset, transform);
+	if (m_projection.length())
+		GDALSetProjection(m_dataset, m_projection.c_str());
+	for (auto &tag : m_tags)
+		GDALSetMetadataItem(m_dataset, tag.first.c_str(), tag.second.c_str(), nullptr);
+
+	for (std::uint16_t i = 0; i < m_bands.size(); i++) {
+		GDALRasterBandH band = GDALGetRasterBand(m_dataset, i + 1);
+		GDALSetRasterNoDataValue(band, m_bands[i].nodata);
+		GDALSetDescription(band, m_bands[i].name.c_str());
+	}
+	return S_OK;
+}
+
+
+HRESULT GridRasterWriter::writeRows(std::uint16_t band, std::uint16_t row, std::uint16_t rows, const std::int32_t *buffer) {
+	return writeRows(band, row, rows, buffer, GDT_Int32);
+}
+
+
+HRESULT GridRasterWriter::writeRows(std::uint16_t band, std::uint16_t row, std::uint16_t rows, const double *buffer) {
+	return writeRows(band, row, rows, buffer, GDT_Float64);
+}
+
+
+HRESULT GridRasterWriter::writeRows(std::uint16_t band, std::uint16_t row, std::uint16_t rows, const void *buffer, GDALDataType type) {
+	if (!m_dataset)													{ weak_assert(false); return E_UNEXPECTED; }
+	if ((!band) || (band > m_bands.size()))							return E_INVALIDARG;
+	if ((std::uint32_t)row + rows > m_ysize)						return E_INVALIDARG;
+
+	CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+
+	CPLErrorReset();
+	GDALRasterBandH b = GDALGetRasterBand(m_dataset, band);
+	if (GDALRasterIO(b, GF_Write, 0, row, m_xsize, rows, const_cast<void *>(buffer), m_xsize, rows, type, 0, 0) != CE_None)
+		return accessError();
+	return S_OK;
+}
+
+
+std::uint16_t GridRasterWriter::overviewCount() {
+	if (m_overviewLevels >= 0)
+		return (std::uint16_t)m_overviewLevels;
+
+	m_overviewLevels = 0;
+	if ((!m_overviews) || (!m_dataset) || (m_copyOnClose))
+		return 0;
+
+	int levels[16], count = 0;
+	std::int32_t size = std::max(m_xsize, m_ysize);
+	while ((size > GRIDRASTERWRITER_BLOCK_SIZE) && (count < 16)) {
+		size = (size + 1) / 2;
+		levels[count] = 2 << count;
+		count++;
+	}
+	if (!count)
+		return 0;
+
+	CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+
+	// "NONE" only lays out the overview levels, their content is written by writeOverviews()
+	if (GDALBuildOverviews(m_dataset, "NONE", count, levels, 0, nullptr, nullptr, nullptr) == CE_None)
+		m_overviewLevels = count;
+	return (std::uint16_t)m_overviewLevels;
+}
+
+
+void GridRasterWriter::overviewSize(std::uint16_t band, std::uint16_t level, std::int32_t *xsize, std::int32_t *ysize) const {
+	CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+
+	GDALRasterBandH overview = GDALGetOverview(GDALGetRasterBand(m_dataset, band), level);
+	*xsize = GDALGetRasterBandXSize(overview);
+	*ysize = GDALGetRasterBandYSize(overview);
+}
+
+
+HRESULT GridRasterWriter::writeOverview(std::uint16_t band, std::uint16_t level, std::int32_t xsize, std::int32_t ysize, const std::int32_t *buffer) {
+	return writeOverview(band, level, xsize, ysize, buffer, GDT_Int32);
+}
+
+
+HRESULT GridRasterWriter::writeOverview(std::uint16_t band, std::uint16_t level, std::int32_t xsize, std::int32_t ysize, const double *buffer) {
+	return writeOverview(band, level, xsize, ysize, buffer, GDT_Float64);
+}
+
+
+HRESULT GridRasterWriter::writeOverview(std::uint16_t band, std::uint16_t level, std::int32_t xsize, std::int32_t ysize, const void *buffer, GDALDataType type) {
+	CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+
+	CPLErrorReset();
+	GDALRasterBandH overview = GDALGetOverview(GDALGetRasterBand(m_dataset, band), level);
+	if (!overview)													{ weak_assert(false); return E_UNEXPECTED; }
+	if (GDALRasterIO(overview, GF_Write, 0, 0, xsize, ysize, const_cast<void *>(buffer), xsize, ysize, type, 0, 0) != CE_None)
+		return accessError();
+	return S_OK;
+}
+
+
+HRESULT GridRasterWriter::close() {
+	if (!m_dataset)
+		return S_OK;
+
+	CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+
+	HRESULT hr = S_OK;
+	CPLErrorReset();
+	if (m_copyOnClose) {
+		GDALDatasetH copy = GDALCreateCopy(m_driver, m_fileName.c_str(), m_dataset, FALSE, m_options, nullptr, nullptr);
+		if (copy)
+			GDALClose(copy);
+		if ((!copy) || (CPLGetLastErrorType() == CE_Failure))
+			hr = accessError();
+		CPLErrorReset();
+	}
+	GDALClose(m_dataset);
+	if ((SUCCEEDED(hr)) && (CPLGetLastErrorType() == CE_Failure))
+		hr = accessError();
+
+	m_dataset = nullptr;
+	m_overviewLevels = -1;
+	if (m_options) {
+		CSLDestroy(m_options);
+		m_options = nullptr;
+	}
+	return hr;
+}
+
+#endif
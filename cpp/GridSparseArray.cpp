@@ -0,0 +1,275 @@
+/**
+ * WISE_Grid_Module: GridSparseArray.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridSparseArray.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+GridSparseArray::GridSparseArray(std::uint16_t xsize, std::uint16_t ysize, std::uint32_t element_size) {
+	m_xsize = xsize;
+	m_ysize = ysize;
+	m_elementSize = element_size;
+	m_tileColumns = ((std::uint32_t)xsize + TILE_SIZE - 1) / TILE_SIZE;
+	m_tileRows = ((std::uint32_t)ysize + TILE_SIZE - 1) / TILE_SIZE;
+	m_hasNodata = false;
+}
+
+
+std::shared_ptr<GridSparseArray> GridSparseArray::build(const void *values, const bool *nodata, std::uint16_t xsize, std::uint16_t ysize,
+    std::uint32_t element_size) {
+	if ((!values) || (!xsize) || (!ysize) || (xsize == (std::uint16_t)-1) || (ysize == (std::uint16_t)-1) || (!element_size) || (element_size > 8))
+		return nullptr;
+
+	std::shared_ptr<GridSparseArray> sparse(new (std::nothrow) GridSparseArray(xsize, ysize, element_size));
+	if (!sparse)
+		return nullptr;
+	const std::uint8_t *v = reinterpret_cast<const std::uint8_t *>(values);
+
+	// classify every tile first, so nothing is allocated if it isn't worth it
+	std::size_t dense_bytes = 0;
+	try {
+		sparse->m_tiles.resize((std::size_t)sparse->m_tileColumns * sparse->m_tileRows);
+	}
+	catch (std::bad_alloc &) {
+		return nullptr;
+	}
+	for (std::uint32_t tr = 0; tr < sparse->m_tileRows; tr++) {
+		for (std::uint32_t tc = 0; tc < sparse->m_tileColumns; tc++) {
+			Tile &tile = sparse->m_tiles[tr * sparse->m_tileColumns + tc];
+			tile.width = (std::uint16_t)std::min((std::uint32_t)TILE_SIZE, (std::uint32_t)xsize - tc * TILE_SIZE);
+			tile.height = (std::uint16_t)std::min((std::uint32_t)TILE_SIZE, (std::uint32_t)ysize - tr * TILE_SIZE);
+
+			std::uint32_t nodata_cells = 0;
+			const std::uint8_t *first = nullptr;
+			bool constant = true;
+			for (std::uint32_t r = 0; r < tile.height; r++) {
+				const std::size_t index = (std::size_t)(tr * TILE_SIZE + r) * xsize + tc * TILE_SIZE;
+				for (std::uint32_t c = 0; c < tile.width; c++) {
+					if ((nodata) && (nodata[index + c])) {
+						nodata_cells++;
+						continue;
+					}
+					const std::uint8_t *e = v + (index + c) * element_size;
+					if (!first)
+						first = e;
+					else if ((constant) && (memcmp(first, e, element_size)))
+						constant = false;
+				}
+			}
+
+			const std::uint32_t cells = (std::uint32_t)tile.width * tile.height;
+			if (nodata_cells == cells)
+				tile.kind = TileKind::NODATA;
+			else if ((!nodata_cells) && (constant)) {
+				tile.kind = TileKind::CONSTANT;
+				memcpy(tile.value, first, element_size);
+			}
+			else {
+				tile.kind = TileKind::DENSE;
+				dense_bytes += cells * element_size;
+				if (nodata_cells) {
+					dense_bytes += cells * sizeof(bool);
+					sparse->m_hasNodata = true;
+				}
+			}
+			if (tile.kind == TileKind::NODATA)
+				sparse->m_hasNodata = true;
+		}
+	}
+
+	const std::size_t full_bytes = (std::size_t)xsize * (std::size_t)ysize * (element_size + (nodata ? sizeof(bool) : 0));
+	if (dense_bytes + sparse->m_tiles.size() * sizeof(Tile) >= full_bytes / 2)
+		return nullptr;
+
+	for (std::uint32_t tr = 0; tr < sparse->m_tileRows; tr++) {
+		for (std::uint32_t tc = 0; tc < sparse->m_tileColumns; tc++) {
+			Tile &tile = sparse->m_tiles[tr * sparse->m_tileColumns + tc];
+			if (tile.kind != TileKind::DENSE)
+				continue;
+
+			bool has_nodata = false;
+			tile.values.reset(new (std::nothrow) std::uint8_t[(std::size_t)tile.width * tile.height * element_size]);
+			if (!tile.values)
+				return nullptr;
+			for (std::uint32_t r = 0; r < tile.height; r++) {
+				const std::size_t index = (std::size_t)(tr * TILE_SIZE + r) * xsize + tc * TILE_SIZE;
+				memcpy(tile.values.get() + (std::size_t)r * tile.width * element_size, v + index * element_size, (std::size_t)tile.width * element_size);
+				if ((nodata) && (!has_nodata) && (std::any_of(nodata + index, nodata + index + tile.width, [](bool b) { return b; })))
+					has_nodata = true;
+			}
+			if (has_nodata) {
+				tile.nodata.reset(new (std::nothrow) bool[(std::size_t)tile.width * tile.height]);
+				if (!tile.nodata)
+					return nullptr;
+				for (std::uint32_t r = 0; r < tile.height; r++) {
+					const std::size_t index = (std::size_t)(tr * TILE_SIZE + r) * xsize + tc * TILE_SIZE;
+					memcpy(tile.nodata.get() + (std::size_t)r * tile.width, nodata + index, tile.width * sizeof(bool));
+				}
+			}
+		}
+	}
+	return sparse;
+}
+
+
+std::shared_ptr<GridSparseArray> GridSparseArray::clone() const {
+	std::shared_ptr<GridSparseArray> copy(new (std::nothrow) GridSparseArray(m_xsize, m_ysize, m_elementSize));
+	if (!copy)
+		return nullptr;
+	copy->m_hasNodata = m_hasNodata;
+	try {
+		copy->m_tiles.resize(m_tiles.size());
+	}
+	catch (std::bad_alloc &) {
+		return nullptr;
+	}
+	for (std::size_t i = 0; i < m_tiles.size(); i++) {
+		const Tile &tile = m_tiles[i];
+		Tile &t = copy->m_tiles[i];
+		t.kind = tile.kind;
+		memcpy(t.value, tile.value, sizeof(t.value));
+		t.width = tile.width;
+		t.height = tile.height;
+		const std::size_t cells = (std::size_t)tile.width * tile.height;
+		if (tile.values) {
+			t.values.reset(new (std::nothrow) std::uint8_t[cells * m_elementSize]);
+			if (!t.values)
+				return nullptr;
+			memcpy(t.values.get(), tile.values.get(), cells * m_elementSize);
+		}
+		if (tile.nodata) {
+			t.nodata.reset(new (std::nothrow) bool[cells]);
+			if (!t.nodata)
+				return nullptr;
+			memcpy(t.nodata.get(), tile.nodata.get(), cells * sizeof(bool));
+		}
+	}
+	return copy;
+}
+
+
+bool GridSparseArray::setCell(std::uint32_t index, const void *value) {
+	const std::uint32_t row = index / m_xsize, column = index - row * m_xsize;
+	Tile &tile = m_tiles[(row / TILE_SIZE) * m_tileColumns + column / TILE_SIZE];
+	const std::uint32_t local = (row % TILE_SIZE) * tile.width + column % TILE_SIZE;
+
+	if (tile.kind != TileKind::DENSE) {
+		const std::size_t cells = (std::size_t)tile.width * tile.height;
+		std::unique_ptr<std::uint8_t[]> values(new (std::nothrow) std::uint8_t[cells * m_elementSize]);
+		if (!values)
+			return false;
+		std::unique_ptr<bool[]> nodata;
+		if (tile.kind == TileKind::NODATA) {
+			nodata.reset(new (std::nothrow) bool[cells]);
+			if (!nodata)
+				return false;
+			memset(values.get(), 0, cells * m_elementSize);
+			std::fill(nodata.get(), nodata.get() + cells, true);
+		}
+		else
+			for (std::size_t i = 0; i < cells; i++)
+				memcpy(values.get() + i * m_elementSize, tile.value, m_elementSize);
+		tile.values = std::move(values);
+		tile.nodata = std::move(nodata);
+		tile.kind = TileKind::DENSE;
+	}
+
+	memcpy(tile.values.get() + (std::size_t)local * m_elementSize, value, m_elementSize);
+	if (tile.nodata)
+		tile.nodata[local] = false;
+	return true;
+}
+
+
+GridSparseArray::Span GridSparseArray::span(std::uint32_t index, std::uint32_t max_count) const {
+	const std::uint32_t row = index / m_xsize, column = index - row * m_xsize;
+	const Tile &tile = m_tiles[(row / TILE_SIZE) * m_tileColumns + column / TILE_SIZE];
+	const std::uint32_t local_column = column % TILE_SIZE;
+
+	Span s;
+	s.kind = tile.kind;
+	s.count = std::min(max_count, (std::uint32_t)tile.width - local_column);
+	s.nodata = nullptr;
+	switch (tile.kind) {
+		case TileKind::CONSTANT:	s.values = tile.value; break;
+		case TileKind::DENSE: {
+									const std::uint32_t local = (row % TILE_SIZE) * tile.width + local_column;
+									s.values = tile.values.get() + local * m_elementSize;
+									if (tile.nodata)
+										s.nodata = tile.nodata.get() + local;
+									break;
+								}
+		default:					s.values = nullptr; break;
+	}
+	return s;
+}
+
+
+void GridSparseArray::expand(void *values, bool *nodata) const {
+	std::uint8_t *v = reinterpret_cast<std::uint8_t *>(values);
+	for (std::uint32_t tr = 0; tr < m_tileRows; tr++) {
+		for (std::uint32_t tc = 0; tc < m_tileColumns; tc++) {
+			const Tile &tile = m_tiles[tr * m_tileColumns + tc];
+			for (std::uint32_t r = 0; r < tile.height; r++) {
+				const std::size_t index = (std::size_t)(tr * TILE_SIZE + r) * m_xsize + tc * TILE_SIZE;
+				switch (tile.kind) {
+					case TileKind::NODATA:
+						if (v)
+							memset(v + index * m_elementSize, 0, (std::size_t)tile.width * m_elementSize);
+						if (nodata)
+							std::fill(nodata + index, nodata + index + tile.width, true);
+						break;
+					case TileKind::CONSTANT:
+						if (v)
+							for (std::uint32_t c = 0; c < tile.width; c++)
+								memcpy(v + (index + c) * m_elementSize, tile.value, m_elementSize);
+						if (nodata)
+							std::fill(nodata + index, nodata + index + tile.width, false);
+						break;
+					case TileKind::DENSE:
+						if (v)
+							memcpy(v + index * m_elementSize, tile.values.get() + (std::size_t)r * tile.width * m_elementSize, (std::size_t)tile.width * m_elementSize);
+						if (nodata) {
+							if (tile.nodata)
+								memcpy(nodata + index, tile.nodata.get() + (std::size_t)r * tile.width, tile.width * sizeof(bool));
+							else
+								std::fill(nodata + index, nodata + index + tile.width, false);
+						}
+						break;
+				}
+			}
+		}
+	}
+}
+
+
+std::size_t GridSparseArray::bytes() const {
+	std::size_t total = sizeof(GridSparseArray) + m_tiles.size() * sizeof(Tile);
+	for (const Tile &tile : m_tiles) {
+		if (tile.values)
+			total += (std::size_t)tile.width * tile.height * m_elementSize;
+		if (tile.nodata)
+			total += (std::size_t)tile.width * tile.height * sizeof(bool);
+	}
+	return total;
+}
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * WISE_Grid_Module: GridTile.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTile.h"
+#include <algorithm>
+#include <cstring>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+std::vector<GridTile> PartitionGridTiles(std::uint16_t xsize, std::uint16_t ysize, double xllcorner, double yllcorner, double resolution,
+    std::uint16_t tile_size, std::uint16_t halo) {
+	std::vector<GridTile> tiles;
+	if ((!tile_size) || (!xsize) || (!ysize) || (xsize == (std::uint16_t)-1) || (ysize == (std::uint16_t)-1))
+		return tiles;
+
+	const std::uint32_t columns = ((std::uint32_t)xsize + tile_size - 1) / tile_size,
+						rows = ((std::uint32_t)ysize + tile_size - 1) / tile_size;
+	tiles.reserve(columns * rows);
+	for (std::uint32_t row = 0; row < rows; row++) {
+		for (std::uint32_t column = 0; column < columns; column++) {
+			GridTile tile;
+			tile.column = (std::uint16_t)column;
+			tile.row = (std::uint16_t)row;
+			tile.coreX = (std::uint16_t)(column * tile_size);
+			tile.coreY = (std::uint16_t)(row * tile_size);
+			tile.coreXSize = (std::uint16_t)std::min((std::uint32_t)tile_size, (std::uint32_t)xsize - tile.coreX);
+			tile.coreYSize = (std::uint16_t)std::min((std::uint32_t)tile_size, (std::uint32_t)ysize - tile.coreY);
+
+			tile.x = (std::uint16_t)std::max((std::int32_t)tile.coreX - (std::int32_t)halo, 0);
+			tile.y = (std::uint16_t)std::max((std::int32_t)tile.coreY - (std::int32_t)halo, 0);
+			tile.xsize = (std::uint16_t)(std::min((std::uint32_t)tile.coreX + tile.coreXSize + halo, (std::uint32_t)xsize) - tile.x);
+			tile.ysize = (std::uint16_t)(std::min((std::uint32_t)tile.coreY + tile.coreYSize + halo, (std::uint32_t)ysize) - tile.y);
+
+			tile.fullXSize = xsize;
+			tile.fullYSize = ysize;
+			tile.resolution = resolution;
+			tile.xllcorner = xllcorner + tile.x * resolution;
+			tile.yllcorner = yllcorner + tile.y * resolution;
+			tiles.push_back(tile);
+		}
+	}
+	return tiles;
+}
+
+
+void CropGridArray(const void *src, std::uint16_t src_xsize, std::uint16_t src_ysize, std::uint16_t x, std::uint16_t y,
+    std::uint16_t xsize, std::uint16_t ysize, std::size_t element_size, void *dest) {
+	const std::uint8_t *s = reinterpret_cast<const std::uint8_t *>(src);
+	std::uint8_t *d = reinterpret_cast<std::uint8_t *>(dest);
+	// the arrays are stored top row first, so the window's top row is the first one to copy
+	const std::size_t top = (std::size_t)src_ysize - y - ysize;
+	for (std::size_t r = 0; r < ysize; r++)
+		memcpy(d + r * xsize * element_size, s + ((top + r) * src_xsize + x) * element_size, xsize * element_size);
+}
+
+#endif
@@ -31,6 +31,8 @@
 #include <stdio.h>
 
 #include "propsysreplacement.h"
+#include "GridAttributeArray.h"
+#include <algorithm>
 
 #ifdef DEBUG
 #include <assert.h>
@@ -236,6 +238,57 @@ HRESULT ICWFGM_GridEngine::GetAttributeDataArray(Layer *layerThread, const XY_Po
 }
 
 
+/*!
+Serves the typed GetAttributeDataArray() calls for objects which don't provide their own, by converting the NumericVariant version's output.
+*/
+template<typename T>
+static HRESULT attributeDataArrayFromVariants(ICWFGM_GridEngine *engine, Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale,
+    const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, boost::multi_array<T, 2> *attribute,
+    attribute_t_2d *attribute_valid) {
+	if (!attribute)							return E_POINTER;
+	if (!attribute_valid)					return E_POINTER;
+
+	const auto *dims = attribute->shape();
+	NumericVariant_2d variants(boost::extents[dims[0]][dims[1]]);
+	HRESULT hr = engine->GetAttributeDataArray(layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, &variants, attribute_valid);
+	if (FAILED(hr))
+		return hr;
+
+	const auto *vdims = attribute_valid->shape();
+	const NumericVariant_2d::size_type xs = std::min(dims[0], vdims[0]), ys = std::min(dims[1], vdims[1]);
+	for (NumericVariant_2d::size_type x = 0; x < xs; x++) {
+		for (NumericVariant_2d::size_type y = 0; y < ys; y++) {
+			double d;
+			if (((*attribute_valid)[x][y] != grid::AttributeValue::NOT_SET) && (variantToDouble(variants[x][y], &d)) && (AttributeValueFits<T>(d)))
+				(*attribute)[x][y] = (T)d;
+			else {
+				(*attribute)[x][y] = T();
+				(*attribute_valid)[x][y] = grid::AttributeValue::NOT_SET;
+			}
+		}
+	}
+	return hr;
+}
+
+
+HRESULT ICWFGM_GridEngine::GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan,
+	std::uint16_t option, std::uint64_t optionFlags, double_2d *attribute, attribute_t_2d *attribute_valid) {
+	return attributeDataArrayFromVariants(this, layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+}
+
+
+HRESULT ICWFGM_GridEngine::GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan,
+	std::uint16_t option, std::uint64_t optionFlags, float_2d *attribute, attribute_t_2d *attribute_valid) {
+	return attributeDataArrayFromVariants(this, layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+}
+
+
+HRESULT ICWFGM_GridEngine::GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan,
+	std::uint16_t option, std::uint64_t optionFlags, int32_t_2d *attribute, attribute_t_2d *attribute_valid) {
+	return attributeDataArrayFromVariants(this, layerThread, min_pt, max_pt, scale, time, timeSpan, option, optionFlags, attribute, attribute_valid);
+}
+
+
 HRESULT ICWFGM_GridEngine::PreCalculationEvent(Layer *layerThread, const HSS_Time::WTime &time, std::uint32_t mode, CalculationEventParms *parms) {
 	std::uint32_t *cnt;
 	boost::intrusive_ptr<ICWFGM_GridEngine> gridEngine = m_gridEngine(layerThread, &cnt);
@@ -22,11 +22,19 @@
 #include "semaphore.h"
 #include "results.h"
 #include <map>
+#include "poly.h"
 #include "ICWFGM_GridEngine.h"
 #include "CWFGM_FuelMap.h"
 #include "CWFGM_internal.h"
+#include "GridChunkedCompress.h"
+#include "GridFileProbe.h"
+#include "GridSparseArray.h"
+#include "GridTile.h"
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <vector>
 #include <boost/intrusive_ptr.hpp>
 #include <boost/atomic.hpp>
 #include "ISerializeProto.h"
@@ -36,6 +44,7 @@
 #pragma pack(push, 8)
 #endif
 
+class GridRasterWriter;
 
 
 /**
@@ -43,6 +52,7 @@
  */
 class GRIDCOM_API CCWFGM_AttributeFilter : public ICWFGM_GridEngine, public ISerializeProto {
     friend class CWFGM_AttributeFilterHelper;
+    friend class CCWFGM_MultiAttributeFilter;
 public:
 
 	CCWFGM_AttributeFilter();
@@ -87,6 +97,8 @@ public:
 	/**
 		Imports a grid file.  Rules regarding expected contents/format of the imported file are partially determined by the OptionType property.
 		If the import projection file is unspecified, then it is assumed to match the projection for the associated main ICWFGM_GridEngine object.
+		A grid whose size, origin or (coarser) resolution doesn't match the main ICWFGM_GridEngine object is kept as it is and sampled on the fly, see
+		CWFGM_GRID_ATTRIBUTE_NATIVE_RESOLUTION.  Fuel grids must match.
 		\param	prj_file_name	Projection file name.
 		\param	grid_file_name	Name of the file to import.
 		\sa ICWFGM_AttributeFilter::ImportAttributeGrid
@@ -108,10 +120,20 @@ public:
 		\retval	S_OK	Successful.
 	*/
 	NO_THROW HRESULT ImportAttributeGrid(const std::string &prj_file_name, const std::string &grid_file_name);
+	/**
+		Imports the contents of a grid file held in memory.  Otherwise identical to ImportAttributeGrid(const std::string &, const std::string &).
+		\param	prj_file_name	Projection file name.
+		\param	buffer	Contents of the grid file.  It is not copied and only needs to remain valid for the duration of the call.
+		\param	length	Size of buffer, in bytes.
+		\retval	E_INVALIDARG	Invalid arguments.
+	*/
+	NO_THROW HRESULT ImportAttributeGrid(const std::string &prj_file_name, const std::uint8_t *buffer, std::size_t length);
 	/**
 		Exports a grid file.  Rules regarding the format of the exported file are partially determined by the OptionType property.  Specification of the output projection file name is optional.
 		\param	prj_file_name	Projection file name.
 		\param	grid_file_name	File name to be exported to.
+		\param	band_name	Description given to the exported band.
+		\param	flags	CWFGM_GRID_EXPORT_TILED and/or CWFGM_GRID_EXPORT_OVERVIEWS, defined in "GridCom_ext.h".
 		\sa ICWFGM_AttributeFilter::ExportAttributeGrid
 		\sa ICWFGM_AttributeFilter::OptionType
 		\retval	E_POINTER	Address provided is invalid.
@@ -126,7 +148,38 @@ public:
 		\retval	ERROR_FILE_NOT_FOUND	The file cannot be found.
 		\retval	ERROR_HANDLE_DISK_FULL	The disk that the file is being written to cannot store the file.
 	*/
-	NO_THROW HRESULT ExportAttributeGrid(const std::string &prj_file_name, const std::string &grid_file_name, const std::string& band_name);
+	NO_THROW HRESULT ExportAttributeGrid(const std::string &prj_file_name, const std::string &grid_file_name, const std::string& band_name, std::uint32_t flags = 0);
+	/**
+		Exports the grid to a memory buffer rather than a file.  Otherwise identical to ExportAttributeGrid(const std::string &, const std::string &, const std::string &, std::uint32_t).
+		\param	buffer	Receives the contents of the exported file.
+		\param	extension	File extension (e.g. ".tif", ".asc") selecting the output format.
+		\param	band_name	Description given to the exported band.
+		\param	flags	CWFGM_GRID_EXPORT_TILED and/or CWFGM_GRID_EXPORT_OVERVIEWS, defined in "GridCom_ext.h".
+		\retval	S_OK	Successful.
+		\retval	E_FAIL	The raster could not be generated.
+	*/
+	NO_THROW HRESULT ExportAttributeGrid(std::vector<std::uint8_t> &buffer, const std::string &extension, const std::string& band_name, std::uint32_t flags = 0);
+	/**
+		Reads only the headers of a grid file (plus an optional sparse sample of its cells, when this filter stores fuels) and
+		reports whether ImportAttributeGrid() would accept it, without importing anything.
+		\param	grid_file_name	Name of the file to probe.
+		\param	sample_step	0 to only read headers, otherwise every sample_step'th cell in each direction is read.  Only used when this object is configured to store a fuel grid.
+		\param	probe	Receives the file description.  probe->compatibility is S_OK or the error ImportAttributeGrid() would return.
+		\retval	S_OK	Successful.
+		\retval	E_POINTER	probe is invalid.
+		\retval	E_INVALIDARG	Invalid arguments.
+		\retval	E_FAIL	The file could not be opened as a raster.
+		\retval	ERROR_GRID_UNINITIALIZED	No grid engine has been assigned.
+	*/
+	NO_THROW HRESULT ProbeAttributeGrid(const std::string &grid_file_name, std::uint32_t sample_step, GridFileProbe *probe);
+	/**
+		Retrieves where this filter sits in the layer it was cut from, if it was loaded from a tile written by serializeTile().
+		\param	tile	Receives the tile.  xllcorner, yllcorner and resolution are the placement of this filter.
+		\retval	S_OK	Successful.
+		\retval	S_FALSE	The filter wasn't loaded from a tile.
+		\retval	E_POINTER	tile is invalid.
+	*/
+	NO_THROW HRESULT GetTile(GridTile *tile);
 	NO_THROW HRESULT ImportAttributeGridWCS(const std::string & url, const std::string & layer, const std::string & username, const std::string & password);
 	NO_THROW HRESULT ExportAttributeGridWCS(const std::string & url, const std::string & layer, const std::string & username, const std::string & password);
 	/**
@@ -211,6 +264,40 @@ public:
 		\retval	E_FAIL	The provided variant value cannot be converted to the grid storage datatype.
 	*/
 	NO_THROW HRESULT SetAttributeLine(XY_Point pt1,XY_Point pt2, const NumericVariant &value);
+	/**
+		Polymorphic.  Sets every cell whose centre lies inside the polygon to 'value', using a scanline fill (even-odd rule, so
+		self-intersecting polygons leave their doubly-covered areas unchanged).  Parts of the polygon outside the grid are ignored.
+		All cells are set under one lock, so this is much faster than repeated calls to SetAttributePoint().
+		\param	xy_pairs	Polygon vertices.  The polygon is implicitly closed.
+		\param	value	Polymorphic.  Value for each cell in the polygon.
+		\param	dirty_bbox	Optional.  Set to the bounding box of the cells which were set.  Left unchanged if no cells were set.
+		\retval	ERROR_SCENARIO_SIMULATION_RUNNING	Action cannot be performed while running the scenario.
+		\retval	S_OK	Success
+		\retval	E_INVALIDARG	The polygon has fewer than 3 vertices.
+		\retval	ERROR_GRID_UNINITIALIZED	Grid object not initialized.
+		\retval	E_FAIL	The provided variant value cannot be converted to the grid storage datatype.
+		\retval	ERROR_SEVERITY_WARNING	This attribute object has not been completely initialized.
+	*/
+	NO_THROW HRESULT SetAttributePolygon(const XY_PolyConst &xy_pairs, const NumericVariant &value, XY_Rectangle *dirty_bbox = nullptr);
+	/**
+		Polymorphic.  Sets every cell crossed by the polyline to 'value', walking each segment cell by cell (so diagonal segments
+		are 4-connected, as with SetAttributeLine()).  Parts of the polyline outside the grid are ignored.  All cells are set under
+		one lock.
+		\param	xy_pairs	Polyline vertices.
+		\param	value	Polymorphic.  Value for each cell on the polyline.
+		\param	dirty_bbox	Optional.  Set to the bounding box of the cells which were set.  Left unchanged if no cells were set.
+		\retval	E_INVALIDARG	The polyline has no vertices.
+		\sa SetAttributePolygon
+	*/
+	NO_THROW HRESULT SetAttributePolyline(const XY_PolyConst &xy_pairs, const NumericVariant &value, XY_Rectangle *dirty_bbox = nullptr);
+	/**
+		Polymorphic.  As SetAttributePolyline(), for a set of independent line segments.
+		\param	lines	Start and end coordinates of each line.
+		\param	value	Polymorphic.  Value for each cell on the lines.
+		\param	dirty_bbox	Optional.  Set to the bounding box of the cells which were set.  Left unchanged if no cells were set.
+		\sa SetAttributePolygon
+	*/
+	NO_THROW HRESULT SetAttributeLines(const std::vector<std::pair<XY_Point, XY_Point>> &lines, const NumericVariant &value, XY_Rectangle *dirty_bbox = nullptr);
 	/**
 		Polymorphic.  Retrieves the attribute at (x, y) to the 'value'.  If there is NODATA at (x, y), then the return datatype is set to VT_EMPTY.
 		\param	pt	Coordinate.
@@ -233,6 +320,16 @@ public:
 		\param option	The attribute of interest.  Valid attributes are:
 		<ul>
 		<li><code>CWFGM_ATTRIBUTE_LOAD_WARNING</code>	BSTR.  Any warnings generated by the COM object when deserializating.
+		<li><code>CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE</code>	bool.  Whether the grid is held in memory in the narrowest type (possibly fixed-point) which stores every
+		value exactly, rather than in OptionType.  Values are unaffected and the data is still serialized as OptionType; the setting itself is saved.
+		Applied when data is imported or loaded, or immediately if set through SetAttribute().
+		<li><code>CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE</code>	bool.  Whether the grid is held in memory as tiles, where tiles that are all NODATA or
+		all one value store no cells.  Only used when it at least halves the memory needed, and setting a cell only expands the tile holding it.  Values
+		are unaffected and the data is still serialized densely; the setting itself is saved.  Applied like CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE.
+		<li><code>CWFGM_GRID_ATTRIBUTE_SAMPLING</code>	std::uint16_t.  CWFGM_GRID_SAMPLING_NEAREST or CWFGM_GRID_SAMPLING_BILINEAR: how a grid kept at its own resolution
+		is sampled at the centre of each fuel grid cell.  Bilinear sampling only applies to floating point grids, and skips neighbouring cells with no data.
+		<li><code>CWFGM_GRID_ATTRIBUTE_NATIVE_RESOLUTION</code>	bool.  Read-only, whether the imported grid didn't match the fuel grid and is kept at its own,
+		coarser, resolution and origin rather than being upsampled.
 		</ul>
 		\param value	Location for the retrieved value to be placed.
 		\sa ICWFGM_GridEngine::GetAttribute
@@ -379,6 +476,15 @@ public:
 		\retval	ERROR_GRID_UNINITIALIZED	No object in the grid layering to forward the request to.
 	*/
 	virtual NO_THROW HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt,const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, NumericVariant_2d *attribute, attribute_t_2d *attribute_valid) override;
+	/**
+		Typed versions of GetAttributeDataArray().  When option matches this object's OptionKey, each row is converted straight from the stored
+		array into attribute, without building a NumericVariant per cell.  Cells with no data, outside this filter, or which don't fit in the
+		requested type are marked NOT_SET in attribute_valid.
+		\sa ICWFGM_GridEngine::GetAttributeDataArray
+	*/
+	virtual NO_THROW HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt,const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, double_2d *attribute, attribute_t_2d *attribute_valid) override;
+	virtual NO_THROW HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt,const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, float_2d *attribute, attribute_t_2d *attribute_valid) override;
+	virtual NO_THROW HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt,const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, int32_t_2d *attribute, attribute_t_2d *attribute_valid) override;
 
 #ifndef DOXYGEN_IGNORE_CODE
 public:
@@ -399,6 +505,11 @@ public:
 public:
 	virtual std::int32_t serialVersionUid(const SerializeProtoOptions& options) const noexcept override;
 	virtual WISE::GridProto::CwfgmAttributeFilter* serialize(const SerializeProtoOptions& options) override;
+	/**
+		Serializes the part of the filter covered by tile (from CCWFGM_Grid::GetTiles(), halo included, clipped to this filter) as a
+		filter of its own, placed where the tile sits.  Returns nullptr if the filter has no data there, or its resolution or origin differs.
+	*/
+	WISE::GridProto::CwfgmAttributeFilter* serializeTile(const SerializeProtoOptions& options, const GridTile &tile);
 	virtual CCWFGM_AttributeFilter *deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) override;
 	virtual std::optional<bool> isdirty(void) const noexcept override { return m_bRequiresSave; }
 
@@ -429,8 +540,22 @@ protected:
 	};
 
 	bool				*m_array_nodata;
+	HRESULT (CCWFGM_AttributeFilter::*m_getPoint)(const std::uint32_t index, NumericVariant *value, grid::AttributeValue *value_valid);
+	HRESULT (CCWFGM_AttributeFilter::*m_setPoint)(const std::uint32_t index, const NumericVariant &value);
+												// cell accessors for m_optionType, bound by bindAccessors() whenever the type changes
+	std::uint16_t		m_storageType;			// type the array is actually held in, narrower than m_optionType if narrowStorage() found one
+	double				m_storageScale;			// fixed-point scale when a floating point m_optionType is held in an integer m_storageType
+	std::shared_ptr<GridSparseArray>	m_sparse;		// holds the data instead of m_array_i1 and m_array_nodata, see sparsifyStorage()
+	GridRetainedBlob	m_dataBlob,
+						m_nodataBlob;			// compressed arrays, reused by serialize() until the arrays change
+	std::atomic<bool>	m_deferred;				// the arrays have not been decoded from the blobs yet
+	CThreadSemaphore	m_deferredLock;
 	std::string			m_loadWarning;
 	double				m_xllcorner, m_yllcorner, m_resolution, m_iresolution;
+	double				m_gridXLLCorner, m_gridYLLCorner, m_gridResolution;
+												// the grid engine's, which the above match unless CCWFGMGRID_NATIVE_RESOLUTION is set
+	std::uint16_t		m_sampling;				// CWFGM_GRID_SAMPLING_*, only used with CCWFGMGRID_NATIVE_RESOLUTION
+	std::optional<GridTile>	m_tile;				// set when the filter was loaded from a tile
 	std::string			m_gisURL, m_gisLayer, m_gisUID, m_gisPWD;
 	unsigned long		m_flags;					// see CWFGM_internal.h for valid options
 
@@ -449,7 +574,46 @@ protected:
 	HRESULT getPoint(const XY_Point &pt, NumericVariant *value, grid::AttributeValue *value_valid);
 	HRESULT getPoint(const std::uint16_t x, const std::uint16_t y, NumericVariant *value, grid::AttributeValue *value_valid);
 	HRESULT getPoint(const std::uint32_t index, NumericVariant*value, grid::AttributeValue *value_valid);
+	HRESULT samplePoint(const XY_Point &pt, NumericVariant *value, grid::AttributeValue *value_valid);
+	HRESULT sampleCell(double x, double y, NumericVariant *value, grid::AttributeValue *value_valid);
+	template<typename S, typename L, bool Sparse>
+	HRESULT getPointAs(const std::uint32_t index, NumericVariant *value, grid::AttributeValue *value_valid);
+	HRESULT getPointUnexpected(const std::uint32_t index, NumericVariant *value, grid::AttributeValue *value_valid);
+	template<typename S>
+	HRESULT setPointAs(const std::uint32_t index, const NumericVariant &value);
+	HRESULT setPointAsBool(const std::uint32_t index, const NumericVariant &value);
+	HRESULT setPointUnexpected(const std::uint32_t index, const NumericVariant &value);
+	HRESULT setPointWiden(const std::uint32_t index, const NumericVariant &value);
+	HRESULT setPointDensify(const std::uint32_t index, const NumericVariant &value);
+	template<typename L, bool Sparse>
+	void bindNarrowedGetter();
+	template<bool Sparse>
+	void bindGetter();
+	void bindAccessors(std::uint16_t storage_type, double storage_scale);
+	void compactStorage();
+	void narrowStorage();
+	bool widenStorage();
+	bool widenInto(void *dest) const;
+	void sparsifyStorage();
+	bool densifyStorage();
+	static std::uint32_t typeSize(std::uint16_t type);
+	template<typename T>
+	HRESULT getTypedDataArray(const XY_Point &min_pt, const XY_Point &max_pt, boost::multi_array<T, 2> *attribute, attribute_t_2d *attribute_valid);
+	template<typename T>
+	HRESULT getSampledDataArray(const XY_Point &min_pt, const XY_Point &max_pt, double scale, boost::multi_array<T, 2> *attribute, attribute_t_2d *attribute_valid);
 	HRESULT fixResolution(std::shared_ptr<validation::validation_object> valid, const std::string& name);
+	HRESULT exportBand(GridRasterWriter &writer, std::uint16_t band);
+	void loadDeferred();
+	void decodeDeferred();
+	void discardDeferred();
+
+	struct EditBounds {
+		std::int32_t x_min, y_min, x_max, y_max;		// cells changed by a bulk edit, empty while x_min > x_max
+	};
+	HRESULT beginEdit();
+	void endEdit(const EditBounds &bounds, XY_Rectangle *dirty_bbox);
+	HRESULT fillRow(std::int32_t y, std::int32_t x_first, std::int32_t x_last, const NumericVariant &value, EditBounds *bounds);
+	HRESULT drawSegment(const XY_Point &pt1, const XY_Point &pt2, const NumericVariant &value, EditBounds *bounds);
 
 	friend bool __cdecl break_fcn(APTR parameter, const XY_Point *loc);
 
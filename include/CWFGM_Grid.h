@@ -24,14 +24,20 @@
 #include "ICWFGM_GridEngine.h"
 #include "CWFGM_FuelMap.h"
 #include "CWFGM_internal.h"
+#include "GridChunkedCompress.h"
+#include "GridFileProbe.h"
+#include "GridTile.h"
 #include "linklist.h"
 #include "ISerializeProto.h"
 #include <map>
+#include <vector>
 #include <ogr_api.h>
 #include "cwfgmGrid.pb.h"
 
 using namespace HSS_Time;
 
+class GridRasterWriter;
+
 #ifdef HSS_SHOULD_PRAGMA_PACK
 #pragma pack(push, 8)
 #endif
@@ -58,6 +64,8 @@ public:
 	std::uint16_t		m_minSlopeFactor, m_maxSlopeFactor;
 	std::uint16_t		m_minAzimuth, m_maxAzimuth;
 	std::uint32_t		m_elevationFrequency[65536];
+	std::uint64_t		m_terrainChecksum;		// terrainChecksum() of the arrays the slope and azimuth were derived from, 0 if unknown
+	bool				m_terrainStale;			// the fuel or elevation arrays have changed since m_terrainChecksum was taken
 
 	GridData();
 	GridData(const GridData &toCopy);
@@ -73,6 +81,8 @@ public:
 		return (m_ysize - (y + 1)) * m_xsize + x;
 	};
 	XY_Rectangle Bounds() const;
+	std::uint64_t terrainChecksum() const;
+	void calculateTerrainRanges();
 };
 
 #endif
@@ -159,6 +169,8 @@ public:
 	/**
 		This method exports grid FBP data to files.
 		\param grid_file_name	Grid file name.
+		\param compression	GeoTIFF compression, as a GDALExporter::CompressionType value.
+		\param flags	CWFGM_GRID_EXPORT_TILED and/or CWFGM_GRID_EXPORT_OVERVIEWS, defined in "GridCom_ext.h".  Tiled output without an explicit compression uses DEFLATE.
 		\retval	E_POINTER	Invalid pointer.
 		\retval	E_INVALIDARG	Invalid arguments.
 		\retval	ERROR_ACCESS_DENIED	Access denied.
@@ -173,7 +185,18 @@ public:
 		\retval	ERROR_FUELS_FUEL_UNKNOWN	Fueltype is unknown.
 		\retval	S_OK	Successful.
 	*/
-	NO_THROW HRESULT ExportGrid(const std::string & grid_file_name, std::uint32_t compression = 0);
+	NO_THROW HRESULT ExportGrid(const std::string & grid_file_name, std::uint32_t compression = 0, std::uint32_t flags = 0);
+	/**
+		This method exports grid FBP data to a memory buffer rather than a file.  Otherwise identical to ExportGrid(const std::string &, std::uint32_t, std::uint32_t).
+		\param buffer	Receives the contents of the exported file.
+		\param extension	File extension (e.g. ".tif", ".asc") selecting the output format.
+		\param compression	GeoTIFF compression, as a GDALExporter::CompressionType value.
+		\param flags	CWFGM_GRID_EXPORT_TILED and/or CWFGM_GRID_EXPORT_OVERVIEWS, defined in "GridCom_ext.h".
+		\retval	S_OK	Successful.
+		\retval	E_INVALIDARG	Invalid arguments.
+		\retval	E_FAIL	The raster could not be generated.
+	*/
+	NO_THROW HRESULT ExportGrid(std::vector<std::uint8_t> & buffer, const std::string & extension, std::uint32_t compression = 0, std::uint32_t flags = 0);
 	NO_THROW HRESULT ExportGridWCS(const std::string & url, const std::string & layer, const std::string & username, const std::string & password);
 	NO_THROW HRESULT ExportElevationWCS(const std::string & url, const std::string & layer, const std::string & username, const std::string & password);
 	NO_THROW HRESULT ExportAspectWCS(const std::string & url, const std::string & layer, const std::string & username, const std::string & password);
@@ -206,6 +229,16 @@ public:
 		\retval	ERROR_HANDLE_DISK_FULL Disk full
 	*/
 	NO_THROW HRESULT ImportElevation(const std::string & prj, const std::string & grid_file_name, bool forcePrj, std::uint8_t *calc_bits);
+	/**
+		This method imports elevation data from the contents of a grid file held in memory.  Otherwise identical to ImportElevation(const std::string &, const std::string &, bool, std::uint8_t *).
+		\param prj	A default projection (WKT) to use if the grid does not have one associated with it.
+		\param buffer	Contents of the grid file.  It is not copied and only needs to remain valid for the duration of the call.
+		\param length	Size of buffer, in bytes.
+		\param forcePrj	Force the importer to use the prj instead of any other projections found for the import file.
+		\param calc_bits	Returns bits describing which terrain values were calculated.
+		\retval	E_INVALIDARG	Invalid arguments.
+	*/
+	NO_THROW HRESULT ImportElevation(const std::string & prj, const std::uint8_t *buffer, std::size_t length, bool forcePrj, std::uint8_t *calc_bits);
 	/**
 		This method will (re)import the FBP grid layer.  Both the PRJ (projection) and the Grid files are needed to complete this operation.  'fail_index' may be NULL.
 		\param prj	A default projection to use if the grid does not have one associated with it.
@@ -233,8 +266,50 @@ public:
 		\retval	ERROR_HANDLE_DISK_FULL Disk full
 	*/
 	NO_THROW HRESULT ImportGrid(const std::string & prj, const std::string & grid_file_name, bool forcePrj, long *fail_index);
+	/**
+		This method imports a fuel grid from the contents of a grid file held in memory.  Otherwise identical to ImportGrid(const std::string &, const std::string &, bool, long *).
+		\param prj	A default projection (WKT) to use if the grid does not have one associated with it.
+		\param buffer	Contents of the grid file.  It is not copied and only needs to remain valid for the duration of the call.
+		\param length	Size of buffer, in bytes.
+		\param forcePrj	Force the importer to use the prj instead of any other projections found for the import file.
+		\param fail_index	Fuel import index that was unrecognized, which caused the operation to fail (if it did).
+		\retval	E_INVALIDARG	Invalid arguments.
+	*/
+	NO_THROW HRESULT ImportGrid(const std::string & prj, const std::uint8_t *buffer, std::size_t length, bool forcePrj, long *fail_index);
+	/**
+		Reads only the headers of a fuel grid file (plus an optional sparse sample of its cells) and reports whether ImportGrid()
+		would accept it, without importing anything.
+		\param grid_file_name	Grid file name.
+		\param sample_step	0 to only read headers, otherwise every sample_step'th cell in each direction is read and the fuel indices found are checked against the fuel map.
+		\param probe	Receives the file description.  probe->compatibility is S_OK or the error ImportGrid() would return for the file's geometry, projection, data type or (sampled) fuels.
+		\retval	S_OK	Successful.
+		\retval	E_POINTER	probe is invalid.
+		\retval	E_INVALIDARG	Invalid arguments.
+		\retval	E_FAIL	The file could not be opened as a raster.
+	*/
+	NO_THROW HRESULT ProbeGrid(const std::string & grid_file_name, std::uint32_t sample_step, GridFileProbe *probe);
 	NO_THROW HRESULT ImportGridWCS(const std::string & url, const std::string & layer, const std::string & username, const std::string & password, XY_Point lowerleft, XY_Point upperright);
 	NO_THROW HRESULT ImportElevationWCS(const std::string & url, const std::string & layer, const std::string & username, const std::string & password);
+	/**
+		Splits the grid into tiles so the landscape can be sharded across workers.  Each tile can be written with serializeTile()
+		(here and on each attribute filter) and loaded on its own with deserialize().
+		\param tile_size	Maximum width and height of the core of each tile, in cells.
+		\param halo	Number of cells each tile overlaps its neighbours by, on each side.
+		\param tiles	Receives the tiles, row by row from the lower-left tile.
+		\retval	S_OK	Successful.
+		\retval	E_POINTER	tiles is invalid.
+		\retval	E_INVALIDARG	tile_size is 0.
+		\retval	ERROR_GRID_UNINITIALIZED	The grid has not been loaded.
+	*/
+	NO_THROW HRESULT GetTiles(std::uint16_t tile_size, std::uint16_t halo, std::vector<GridTile> *tiles);
+	/**
+		Retrieves where this grid sits in the grid it was cut from, if it was loaded from a tile written by serializeTile().
+		\param tile	Receives the tile.  xllcorner, yllcorner and resolution are the placement of this grid.
+		\retval	S_OK	Successful.
+		\retval	S_FALSE	The grid wasn't loaded from a tile.
+		\retval	E_POINTER	tile is invalid.
+	*/
+	NO_THROW HRESULT GetTile(GridTile *tile);
 	/**
 		Creates a new grid object with all the same properties of the object being called, returns a handle to the new object in 'newGrid'.
 		No data is shared between these two objects, an exact copy is created.  The FuelMap property should be set on the copied object immediately after successful completion of this call.
@@ -579,13 +654,14 @@ public:
 	/**
 		This method exports elevation data from the grid to a file
 		\param	grid_file_name	File name where the data should be exported.
+		\param	flags	CWFGM_GRID_EXPORT_TILED and/or CWFGM_GRID_EXPORT_OVERVIEWS, defined in "GridCom_ext.h".  Overviews average the valid elevations.
 		\sa ICWFGM_Grid::ExportElevation
 		\retval	S_OK	Successful.
 		\retval E_POINTER	Bad pointer.
 		\retval	ERROR_GRID_UNINITIALIZED	Grid not initialized.
 		\retval E_INVALIDARG	Invalid argument(s).
 	*/
-	virtual NO_THROW HRESULT ExportElevation(const std::string & grid_file_name);
+	virtual NO_THROW HRESULT ExportElevation(const std::string & grid_file_name, std::uint32_t flags = 0);
 	/**
 		This method exports Slope data from the grid to a file
 		\param	grid_file_name	File name where the data should be exported.
@@ -606,6 +682,35 @@ public:
 		\retval E_INVALIDARG	Invalid argument(s).
 	*/
 	virtual NO_THROW HRESULT ExportAspect(const std::string & grid_file_name);
+	/**
+		This method exports elevation, slope and aspect data from the grid to a single three band file (bands 1, 2 and 3
+		respectively) in one pass over the grid.  Each band carries its own NODATA value of -9999.
+		\param	grid_file_name	File name where the data should be exported.
+		\param	flags	CWFGM_GRID_EXPORT_TILED and/or CWFGM_GRID_EXPORT_OVERVIEWS, defined in "GridCom_ext.h".
+		\sa ICWFGM_Grid::ExportElevation
+		\sa ICWFGM_Grid::ExportSlope
+		\sa ICWFGM_Grid::ExportAspect
+		\retval	S_OK	Successful.
+		\retval	ERROR_GRID_UNINITIALIZED	Grid not initialized.
+		\retval	ERROR_PROJECTION_UNKNOWN	The grid's projection is unknown.
+		\retval E_INVALIDARG	Invalid argument(s).
+		\retval E_ACCESSDENIED	The file could not be written.
+	*/
+	virtual NO_THROW HRESULT ExportTerrain(const std::string & grid_file_name, std::uint32_t flags = 0);
+	/**
+		These methods export elevation, slope, aspect or combined terrain data to a memory buffer rather than a file.  Otherwise
+		identical to their file based counterparts.
+		\param	buffer	Receives the contents of the exported file.
+		\param	extension	File extension (e.g. ".tif", ".asc") selecting the output format.
+		\param	flags	CWFGM_GRID_EXPORT_TILED and/or CWFGM_GRID_EXPORT_OVERVIEWS, defined in "GridCom_ext.h".
+		\retval	S_OK	Successful.
+		\retval	ERROR_GRID_UNINITIALIZED	Grid not initialized.
+		\retval	E_FAIL	The raster could not be generated.
+	*/
+	NO_THROW HRESULT ExportElevation(std::vector<std::uint8_t> & buffer, const std::string & extension, std::uint32_t flags = 0);
+	NO_THROW HRESULT ExportSlope(std::vector<std::uint8_t> & buffer, const std::string & extension);
+	NO_THROW HRESULT ExportAspect(std::vector<std::uint8_t> & buffer, const std::string & extension);
+	NO_THROW HRESULT ExportTerrain(std::vector<std::uint8_t> & buffer, const std::string & extension, std::uint32_t flags = 0);
 
 protected:
 	NO_THROW HRESULT calculateSlopeFactorAndAzimuth(Layer *layerThread, std::uint8_t *calc_bits);
@@ -616,6 +721,16 @@ protected:
 public:
 	virtual std::int32_t serialVersionUid(const SerializeProtoOptions& options) const noexcept override;
 	virtual WISE::GridProto::CwfgmGrid* serialize(const SerializeProtoOptions& options) override;
+	/**
+		Serializes the part of the grid covered by tile (halo included) as a grid of its own, placed where the tile sits.  The terrain
+		cache is cut from this grid's so slopes along the edges of the tile still account for the cells outside it.  Returns nullptr
+		if tile doesn't come from this grid.
+	*/
+	WISE::GridProto::CwfgmGrid* serializeTile(const SerializeProtoOptions& options, const GridTile &tile);
+	/**
+		The grid has to be deserialized before any of the filters which reference it.  After that, the filters only read the grid (and
+		each only writes its own state, under its own lock), so independent filters may be deserialized concurrently.
+	*/
 	virtual CCWFGM_Grid *deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) override;
 	virtual std::optional<bool> isdirty(void) const noexcept override { return m_bRequiresSave; }
 
@@ -637,6 +752,12 @@ protected:
 	WTimeManager		m_timeManager;				// works hand-in-hand with WorldLocation
 	ICWFGM_CommonData	m_commonData;
 	GridData			m_baseGrid;
+	GridRetainedBlob	m_fuelBlob, m_fuelValidBlob,
+						m_elevationBlob, m_elevationValidBlob;
+	GridRetainedBlob	m_fuelEncodedBlob,			// fuels and validity, GridArrayEncoding::FUEL_RLE
+						m_elevationEncodedBlob;		// GridArrayEncoding::ROW_DELTA
+	GridRetainedBlob	m_slopeBlob, m_terrainValidBlob, m_azimuthBlob;	// follow m_baseGrid.m_terrainChecksum
+	std::optional<GridTile>	m_tile;					// set when the grid was loaded from a tile
 
 	double			m_defaultElevation;			// to be used when no DEM is provided
 	double			m_defaultFMC;				// used for areas outside of Canada where the FMC calculations are no good
@@ -649,6 +770,12 @@ protected:
 
 	bool fixWorldLocation();
 	void calcWarnings(const std::uint8_t calc_bits);
+	bool restoreTerrain(const WISE::GridProto::CwfgmGrid *grid);
+	void invalidateFuelBlobs();
+	void invalidateElevationBlobs();
+	void invalidateTerrainBlobs();
+	HRESULT prepareExport(GridRasterWriter &writer, std::uint32_t flags);
+	void exportFuelTable(long table[256]) const;
 
 	HRESULT sizeGrid(Layer *layerThread, CalculationEventParms *parms);
 
@@ -0,0 +1,206 @@
+/**
+ * WISE_Grid_Module: CWFGM_MultiAttributeFilter.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "WTime.h"
+#include "semaphore.h"
+#include "results.h"
+#include "ICWFGM_GridEngine.h"
+#include "CWFGM_AttributeFilter.h"
+
+#include <string>
+#include <vector>
+#include <boost/intrusive_ptr.hpp>
+#include "ISerializeProto.h"
+#include "cwfgmFilter.pb.h"
+
+#ifdef HSS_SHOULD_PRAGMA_PACK
+#pragma pack(push, 8)
+#endif
+
+
+/**
+ * Holds several attribute grids (bands), each answering GetAttributeData and GetAttributeDataArray for its own option key, in one layer of the
+ * grid stack.  Each band behaves exactly like a CCWFGM_AttributeFilter with that option key and type (including its storage options), but
+ * queries for any other option, or any other kind of data, only pass through this one layer rather than one per attribute.  Fuel grids can't be
+ * bands.
+ */
+class GRIDCOM_API CCWFGM_MultiAttributeFilter : public ICWFGM_GridEngine, public ISerializeProto {
+public:
+	CCWFGM_MultiAttributeFilter();
+	CCWFGM_MultiAttributeFilter(const CCWFGM_MultiAttributeFilter &toCopy);
+	~CCWFGM_MultiAttributeFilter();
+
+public:
+	/**
+		Creates a new MultiAttributeFilter object with all the same properties and bands of the object being called, returns a handle to the new object in 'newObject'.
+		\param	newObject	Handle to a new filter.
+		\retval	E_POINTER	The address provided for newObject is invalid.
+		\retval	S_OK	Successful.
+		\retval	E_FAIL	Insufficient memory.
+	*/
+	NO_THROW HRESULT Clone(boost::intrusive_ptr<ICWFGM_CommonBase> *newObject) const;
+	/**
+		Adds an empty band which will respond to the option key, storing data in the given type.
+		\param	option_key	Option key (e.g. CWFGM_FUELGRID_ATTRIBUTE_CBH) the band responds to.  Must not be (std::uint16_t)-1 or already used by another band.
+		\param	option_type	Type to hold the band's data in, see CCWFGM_AttributeFilter::put_OptionType().
+		\retval	S_OK	Successful.
+		\retval	E_INVALIDARG	option_key is invalid or in use, or option_type is invalid.
+		\retval	ERROR_GRID_UNINITIALIZED	No grid engine has been assigned.
+		\retval	ERROR_SCENARIO_SIMULATION_RUNNING	Cannot be done while a scenario is running.
+	*/
+	NO_THROW HRESULT AddBand(std::uint16_t option_key, std::uint16_t option_type);
+	/**
+		Removes the band responding to option_key.
+		\retval	S_OK	Successful.
+		\retval	E_INVALIDARG	There is no band for option_key.
+		\retval	ERROR_SCENARIO_SIMULATION_RUNNING	Cannot be done while a scenario is running.
+	*/
+	NO_THROW HRESULT RemoveBand(std::uint16_t option_key);
+	/**
+		Retrieves the number of bands.
+		\retval	E_POINTER	count is invalid.
+		\retval	S_OK	Successful.
+	*/
+	NO_THROW HRESULT GetBandCount(std::uint32_t *count);
+	/**
+		Retrieves the option key and type of the index'th band.
+		\retval	E_POINTER	option_key or option_type is invalid.
+		\retval	E_INVALIDARG	index is out of range.
+		\retval	S_OK	Successful.
+	*/
+	NO_THROW HRESULT GetBand(std::uint32_t index, std::uint16_t *option_key, std::uint16_t *option_type);
+	/**
+		Imports a grid file into the band responding to option_key.  See CCWFGM_AttributeFilter::ImportAttributeGrid().
+		\retval	E_INVALIDARG	There is no band for option_key.
+	*/
+	NO_THROW HRESULT ImportBand(std::uint16_t option_key, const std::string &prj_file_name, const std::string &grid_file_name);
+	/**
+		Exports the band responding to option_key to a grid file.  See CCWFGM_AttributeFilter::ExportAttributeGrid().
+		\retval	E_INVALIDARG	There is no band for option_key.
+	*/
+	NO_THROW HRESULT ExportBand(std::uint16_t option_key, const std::string &prj_file_name, const std::string &grid_file_name, const std::string &band_name, std::uint32_t flags = 0);
+	/**
+		Resets every cell of the band responding to option_key to value.  See CCWFGM_AttributeFilter::ResetAttribute().
+		\retval	E_INVALIDARG	There is no band for option_key.
+	*/
+	NO_THROW HRESULT ResetBand(std::uint16_t option_key, const NumericVariant &value);
+	/**
+		Sets the cell at pt in the band responding to option_key.  See CCWFGM_AttributeFilter::SetAttributePoint().
+		\retval	E_INVALIDARG	There is no band for option_key.
+	*/
+	NO_THROW HRESULT SetBandPoint(std::uint16_t option_key, const XY_Point &pt, const NumericVariant &value);
+	/**
+		Retrieves the cell at pt in the band responding to option_key.  See CCWFGM_AttributeFilter::GetAttributePoint().
+		\retval	E_INVALIDARG	There is no band for option_key.
+	*/
+	NO_THROW HRESULT GetBandPoint(std::uint16_t option_key, const XY_Point &pt, NumericVariant *value, grid::AttributeValue *value_valid);
+	/**
+		Polymorphic.  This routine retrieves an attribute/option value given the attribute/option index.
+		\param option Supported / valid attribute/option index supported are:
+		<ul>
+		<li><code>CWFGM_ATTRIBUTE_LOAD_WARNING</code>	BSTR.  Any warnings generated by the COM object when deserializating.
+		<li><code>CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE</code>, <code>CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE</code>, <code>CWFGM_GRID_ATTRIBUTE_SAMPLING</code>
+		As for CCWFGM_AttributeFilter::GetAttribute(), applied to every band.
+		</ul>
+		\param value Return value for the attribute/option index
+		\retval	S_OK	Success
+		\retval	E_POINTER	Address provided for value is invalid.
+		\retval	E_INVALIDARG	No valid parameters.
+	*/
+	NO_THROW HRESULT GetAttribute(std::uint16_t option, PolymorphicAttribute *value);
+	NO_THROW HRESULT SetAttribute(std::uint16_t option, const PolymorphicAttribute &value);
+	/**
+		Changes the state of the object with respect to access rights.  When the object is used by an active simulation, it must not be modified.
+		Locking request is forwarded to the next lower object in the 'layerThread' layering.  Bands are locked along with this object.
+		\param	layerThread		Handle for scenario layering/stack access, allocated from an ICWFGM_LayerManager COM object.  Needed.  It is designed to allow nested layering analogous to the GIS layers.
+		\param	exclusive	TRUE if the requester wants a write lock, false for read/shared access
+		\param	obtain	TRUE to obtain the lock, FALSE to release the lock.  If this is FALSE, then the 'exclusive' parameter must match the initial call used to obtain the lock.
+		\sa ICWFGM_GridEngine::MT_Lock
+		\retval	SUCCESS_STATE_OBJECT_UNLOCKED	Lock was released.
+		\retval	SUCCESS_STATE_OBJECT_LOCKED_WRITE	Exclusive/write lock obtained.
+		\retval	SUCCESS_STATE_OBJECT_LOCKED_SCENARIO	A scenario successfully required a lock for purposes of simulating.
+		\retval	SUCCESS_STATE_OBJECT_LOCKED_READ	Shared/read lock obtained.
+		\retval	S_OK	Successful
+		\retval	ERROR_GRID_UNINITIALIZED	No path via layerThread can be determined to further determine successful locks.
+	*/
+	virtual NO_THROW HRESULT MT_Lock(Layer *layerThread, bool exclusive, std::uint16_t obtain) override;
+	/**
+		Polymorphic.  If layerThread is non-zero, then this filter object simply forwards the call to the next lower GIS
+		layer determined by layerThread.  If layerthread is zero, then this object will interpret the call.
+		\param	layerThread		Handle for scenario layering/stack access, allocated from an ICWFGM_LayerManager COM object.  Needed.  It is designed to allow nested layering analogous to the GIS layers.
+		\param option	The attribute of interest, see GetAttribute(std::uint16_t, PolymorphicAttribute *).
+		\param value	Location for the retrieved value to be placed.
+		\retval E_POINTER	value is NULL
+		\retval	ERROR_GRID_UNINITIALIZED	No object in the grid layering to forward the request to.
+		\retval S_OK Success
+	*/
+	virtual NO_THROW HRESULT GetAttribute(Layer *layerThread, std::uint16_t option, PolymorphicAttribute *value) override;
+	/**
+		If option matches a band's option key, then that band's value at pt is returned, otherwise the call is forwarded to the next lower GIS layer
+		determined by layerThread.
+		\sa CCWFGM_AttributeFilter::GetAttributeData
+	*/
+	virtual NO_THROW HRESULT GetAttributeData(Layer *layerThread, const XY_Point &pt,const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, NumericVariant *attribute, grid::AttributeValue *attribute_valid, XY_Rectangle *cache_bbox) override;
+	/**
+		If option matches a band's option key, then that band's values are returned, otherwise the call is forwarded to the next lower GIS layer
+		determined by layerThread.
+		\sa CCWFGM_AttributeFilter::GetAttributeDataArray
+	*/
+	virtual NO_THROW HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt,const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, NumericVariant_2d *attribute, attribute_t_2d *attribute_valid) override;
+	virtual NO_THROW HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt,const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, double_2d *attribute, attribute_t_2d *attribute_valid) override;
+	virtual NO_THROW HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt,const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, float_2d *attribute, attribute_t_2d *attribute_valid) override;
+	virtual NO_THROW HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt,const XY_Point &max_pt, double scale, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, int32_t_2d *attribute, attribute_t_2d *attribute_valid) override;
+
+#ifndef DOXYGEN_IGNORE_CODE
+public:
+	virtual std::int32_t serialVersionUid(const SerializeProtoOptions& options) const noexcept override;
+	virtual WISE::GridProto::CwfgmMultiAttributeFilter* serialize(const SerializeProtoOptions& options) override;
+	virtual CCWFGM_MultiAttributeFilter *deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) override;
+	virtual std::optional<bool> isdirty(void) const noexcept override;
+
+public:
+	virtual HRESULT PutGridEngine(Layer *layerThread, ICWFGM_GridEngine *newVal) override;
+
+protected:
+	CRWThreadSemaphore		m_lock;
+
+	std::vector<boost::intrusive_ptr<CCWFGM_AttributeFilter>>	m_bands;
+												// each band is a complete attribute filter which only ever sees this filter's root grid engine
+	std::string				m_loadWarning;
+	unsigned long			m_flags;			// CCWFGMGRID_NARROW_STORAGE and CCWFGMGRID_SPARSE_STORAGE, given to each new band
+	std::uint16_t			m_sampling;			// given to each new band
+
+	CCWFGM_AttributeFilter *band(std::uint16_t option_key) const {
+															for (auto &b : m_bands)
+																if (b->m_optionKey == option_key)
+																	return b.get();
+															return nullptr;
+														}
+	HRESULT configureBand(CCWFGM_AttributeFilter *band);
+
+protected:
+	bool m_bRequiresSave;
+
+#endif
+};
+
+#ifdef HSS_SHOULD_PRAGMA_PACK
+#pragma pack(pop)
+#endif
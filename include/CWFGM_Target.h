@@ -129,6 +129,11 @@ public:
 
 	virtual std::int32_t serialVersionUid(const SerializeProtoOptions& options) const noexcept override;
 	virtual WISE::GridProto::CwfgmTarget* serialize(const SerializeProtoOptions& options) override;
+	/**
+		As serialize(options), but only the returned message is created on arena (when it isn't null).  The targets are built on
+		the heap and the arena takes ownership of them, freeing them with the arena.
+	*/
+	WISE::GridProto::CwfgmTarget* serialize(const SerializeProtoOptions& options, google::protobuf::Arena *arena);
 	virtual CCWFGM_Target* deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) override;
 	virtual std::optional<bool> isdirty(void) const noexcept override { return m_bRequiresSave; }
 
@@ -23,6 +23,10 @@
 #include "semaphore.h"
 #include "results.h"
 #include <map>
+#include <deque>
+#include <tuple>
+#include <vector>
+#include <atomic>
 #include "ICWFGM_GridEngine.h"
 #include "ISerializeProto.h"
 #include "objectcache_mt.h"
@@ -221,6 +225,48 @@ protected:
 	std::string			m_loadWarning;
 
 	HRESULT SetWorldLocation(ICWFGM_GridEngine *gridEngine, Layer *layerThread);
+
+	/**
+		Sun rise/set/noon for one local day and one spatial tile, stored as offsets from that day's local noon so the entry
+		doesn't depend on the time that was asked about.
+	*/
+	struct SolarTimes {
+		WTimeSpan			m_rise, m_set, m_noon;
+		std::uint16_t		m_calced;
+	};
+	typedef std::tuple<std::int64_t, std::int32_t, std::int32_t> SolarKey;	// local noon (GMT seconds), tile column, tile row
+	typedef std::pair<std::int32_t, std::int32_t> SolarTile;				// tile column, tile row
+
+	/**
+		Cached times for every tile asked about on one local day.  m_order lists the tiles oldest first, so a day which fills
+		the cache can make room by dropping its own oldest entries.
+	*/
+	struct SolarDay {
+		std::int64_t		m_noon;
+		std::map<SolarTile, SolarTimes> m_tiles;
+		std::deque<SolarTile> m_order;
+	};
+
+	mutable CRWThreadSemaphore	m_solarLock;
+	mutable std::deque<SolarDay> m_solarCache;			// sorted by day, bounded, see cacheSolarTimes()
+	mutable std::size_t		m_solarEntries;				// tiles cached over all days
+	double					m_solarTileSize;			// 0 to not cache
+
+	void clearSolarCache();
+	void cacheSolarTimes(const SolarKey &key, const SolarTimes &st) const;
+
+	// sorted copies of m_attributes and m_conditions for findOption() and findSeasonOption(), the lists are still what's
+	// edited and saved
+	std::vector<DailyAttribute *>		m_dailySorted;
+	std::vector<DailyAttribute *>		m_dailyIndex;		// by local day number from m_dailyFirstDay, empty if too sparse to be worth it
+	std::uint64_t						m_dailyFirstDay;
+	std::vector<SeasonalAttribute *>	m_seasonSorted;
+	std::vector<SeasonalAttribute *>	m_seasonBreaks[3];	// entries which set grass phenology, greenup, curing degree
+	std::atomic<bool>					m_indexStale;		// the lists have changed since the index was built
+	CThreadSemaphore					m_indexLock;
+
+	void invalidateIndex()							{ m_indexStale.store(true, std::memory_order_release); }
+	void rebuildIndex();
 #endif
 
 	WTimeManager			*m_timeManager;
@@ -383,6 +383,11 @@ public:
 public:
 	virtual std::int32_t serialVersionUid(const SerializeProtoOptions& options) const noexcept override;
 	virtual WISE::GridProto::CwfgmVectorFilter* serialize(const SerializeProtoOptions& options) override;
+	/**
+		As serialize(options), but the returned message is created on arena (when it isn't null).  The polygons are copied into a
+		submessage the arena allocates; the firebreak width is still heap allocated, and the arena takes ownership of it.
+	*/
+	WISE::GridProto::CwfgmVectorFilter* serialize(const SerializeProtoOptions& options, google::protobuf::Arena *arena);
 	virtual CCWFGM_VectorFilter *deserialize(const google::protobuf::Message& proto, std::shared_ptr<validation::validation_object> valid, const std::string& name) override;
 	virtual std::optional<bool> isdirty(void) const noexcept override { return m_bRequiresSave; }
 
@@ -404,6 +409,9 @@ protected:
 	unsigned long				m_flags;					// see CWFGM_internal.h for available options
 	bool						m_bRequiresSave;
 
+	WISE::GridProto::CwfgmVectorFilter	m_polygonCache;		// polygons from the last serialize(), reused until m_polyList changes
+	bool						m_polygonCacheValid, m_polygonCacheVerbose;
+
 	void rescanRanges();
 
 	HRESULT getPolyRange(std::uint32_t index, double *x_min, double *y_min, double *x_max, double *y_max) const;
@@ -22,4 +22,7 @@
 #define CCWFGMGRID_ELEV_NODATA_EXISTS		0x00000008	// set if there's an elevation grid, AND it contains NODATA
 #define CCWFGMGRID_SPECIFIED_FMC_ACTIVE		0x00000010
 #define CCWFGMGRID_ALLOW_GIS				0x00000020	// set if we are allowed to load data from a GIS automatically, for existing FGM's this is left off
+#define CCWFGMGRID_NARROW_STORAGE			0x00000040	// set if an attribute filter may hold its data in a narrower type than its OptionType
+#define CCWFGMGRID_SPARSE_STORAGE			0x00000080	// set if an attribute filter may hold its data as sparse tiles
+#define CCWFGMGRID_NATIVE_RESOLUTION		0x00000100	// set if an attribute filter keeps the resolution and origin of the grid it imported
 #define CCWFGMGRID_VALID					0x80000000	// replaces check on m_xsize == (std::uint16_t)-1
@@ -0,0 +1,92 @@
+/**
+ * WISE_Grid_Module: GridArrayEncoding.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+#include <cstdint>
+#include <string>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+/**
+ * Reversible transforms applied to the grid arrays before they are compressed (see GridChunkedCompress), which turn the
+ * regular structure of fuel and elevation data into something the general purpose codecs compress far better, and faster.
+ *
+ * Fuels are run-length encoded with the validity array folded in: each run is a varint holding (run length - 1) << 1, with
+ * the low bit set for a run of NODATA cells, followed by the fuel index for a run of valid cells.  Runs continue across rows.
+ *
+ * Elevations are replaced by the difference from the cell in the row above (or the cell to the left, in the first row), and
+ * the differences are stored as two byte planes, all the low bytes then all the high bytes.  The validity array is unchanged
+ * and stored separately.
+ *
+ * Both are lossless, apart from the fuel index of NODATA cells, which is always decoded as (std::uint8_t)-1 (the value the
+ * import routines give those cells).
+ */
+class GridArrayEncoding {
+public:
+	/**
+		Encoding used for an array, with the same values as the ArrayEncoding protobuf enum.
+	*/
+	enum class Encoding : std::uint8_t {
+		RAW = 0,
+		FUEL_RLE = 1,
+		ROW_DELTA = 2
+	};
+
+	static std::string encodeFuel(const std::uint8_t *fuel, const bool *valid, std::uint64_t size);
+	/**
+		Decodes size cells into fuel and valid.  Returns false if encoded doesn't hold exactly size cells.
+	*/
+	static bool decodeFuel(const std::string &encoded, std::uint8_t *fuel, bool *valid, std::uint64_t size);
+
+	static std::string encodeRowDelta(const std::int16_t *elevation, std::uint16_t xsize, std::uint16_t ysize);
+	/**
+		Decodes xsize * ysize cells into elevation.  Returns false if encoded is the wrong length.
+	*/
+	static bool decodeRowDelta(const std::string &encoded, std::int16_t *elevation, std::uint16_t xsize, std::uint16_t ysize);
+
+	/**
+		Returns true if saves on the calling thread write the encoded arrays, see GridArrayEncodingScope.
+	*/
+	static bool saveEncoded();
+
+private:
+	friend class GridArrayEncodingScope;
+	static thread_local bool m_saveEncoded;
+};
+
+
+/**
+ * Has every serialize() called on this thread while the scope is alive write the zipped fuel and elevation arrays encoded.
+ * Encoded arrays can't be read by versions before the encodedData field was added, so files are only written that way when
+ * the caller asks for it; outside of a scope, files are unchanged from previous versions.
+ */
+class GridArrayEncodingScope {
+public:
+	GridArrayEncodingScope(bool encode = true) : m_previous(GridArrayEncoding::m_saveEncoded) { GridArrayEncoding::m_saveEncoded = encode; }
+	~GridArrayEncodingScope()								{ GridArrayEncoding::m_saveEncoded = m_previous; }
+
+	GridArrayEncodingScope(const GridArrayEncodingScope &) = delete;
+	GridArrayEncodingScope &operator=(const GridArrayEncodingScope &) = delete;
+
+private:
+	bool						m_previous;
+};
+
+#endif
@@ -0,0 +1,246 @@
+/**
+ * WISE_Grid_Module: GridAttributeArray.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "GridCom_ext.h"
+#include "Thread.h"
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+/**
+	Whether value can be stored in a T without wrapping: only integer destinations can fail, for values (or NaN's) outside their range.
+*/
+template<typename T, typename S>
+inline bool AttributeValueFits(S value) {
+	if constexpr (!std::is_integral_v<T>)
+		return true;
+	else if constexpr (std::is_floating_point_v<S>)
+		return (value >= (S)std::numeric_limits<T>::min()) && (value < (S)std::numeric_limits<T>::max() + (S)1);
+	else if constexpr (std::is_signed_v<S>)
+		return (value >= (std::int64_t)std::numeric_limits<T>::min()) && (value <= (std::int64_t)std::numeric_limits<T>::max());
+	else
+		return value <= (std::uint64_t)std::numeric_limits<T>::max();
+}
+
+
+/**
+	Converts a value from narrowed storage (see FindAttributeNarrowing()) back to the attribute's type L.  Integer storage of a floating
+	point attribute is fixed-point, holding value * scale.
+*/
+template<typename S, typename L>
+inline L WidenAttributeValue(S value, double scale) {
+	if constexpr ((std::is_floating_point_v<L>) && (!std::is_floating_point_v<S>))
+		return (L)((double)value / scale);
+	else
+		return (L)value;
+}
+
+
+/**
+	Copies count cells of a plain attribute array into a caller's typed array and validity mask, which may be strided (e.g. a column of a
+	boost::multi_array).  Cells flagged in nodata (if provided) or which don't fit in a T are NOT_SET.  Boolean arrays are stored one byte per
+	cell and are normalized to 0 or 1.  If the array is narrowed, L is the attribute's type and scale is its fixed-point scale.
+*/
+template<typename S, typename T, bool Boolean = false, typename L = S>
+inline void CopyAttributeRow(const S *src, const bool *nodata, std::size_t count, T *dest, std::ptrdiff_t dest_stride,
+    grid::AttributeValue *valid, std::ptrdiff_t valid_stride, double scale = 1.0) {
+	for (std::size_t i = 0; i < count; i++, dest += dest_stride, valid += valid_stride) {
+		if ((nodata) && (nodata[i])) {
+			*dest = T();
+			*valid = grid::AttributeValue::NOT_SET;
+		}
+		else if constexpr (Boolean) {
+			*dest = src[i] ? (T)1 : (T)0;
+			*valid = grid::AttributeValue::SET;
+		}
+		else {
+			const L value = WidenAttributeValue<S, L>(src[i], scale);
+			if (AttributeValueFits<T>(value)) {
+				*dest = (T)value;
+				*valid = grid::AttributeValue::SET;
+			}
+			else {
+				*dest = T();
+				*valid = grid::AttributeValue::NOT_SET;
+			}
+		}
+	}
+}
+
+
+/**
+	Narrower storage types an attribute array can be held in, in the order they're tried.
+*/
+enum class AttributeNarrowing : std::uint8_t {
+	NONE,
+	I1,
+	UI1,
+	I2,
+	UI2,
+	I4
+};
+
+
+/**
+	Finds the narrowest integer type which holds every value in array (other than cells flagged in nodata) exactly, and is smaller
+	than L.  Floating point values are tried as fixed-point with 0 to 3 decimal places, and are only accepted if converting back with
+	WidenAttributeValue() gives the identical value.  Returns NONE if there's no saving to be had.
+*/
+template<typename L>
+inline AttributeNarrowing FindAttributeNarrowing(const L *array, const bool *nodata, std::size_t count, double *scale) {
+	static const double scales[] = { 1.0, 10.0, 100.0, 1000.0 };
+	for (double s : scales) {
+		std::int64_t lo = std::numeric_limits<std::int64_t>::max(), hi = std::numeric_limits<std::int64_t>::min();
+		bool exact = true;
+		for (std::size_t i = 0; i < count; i++) {
+			if ((nodata) && (nodata[i]))
+				continue;
+			std::int64_t q;
+			if constexpr (std::is_floating_point_v<L>) {
+				const double d = (double)array[i] * s;
+				if (!(std::fabs(d) < 2147483648.0)) {			// also catches NaN's
+					exact = false;
+					break;
+				}
+				q = (std::int64_t)std::llround(d);
+				if ((WidenAttributeValue<std::int64_t, L>(q, s) != array[i]) || ((!q) && (std::signbit(array[i])))) {
+					exact = false;
+					break;
+				}
+			}
+			else {
+				if (!AttributeValueFits<std::int32_t>(array[i])) {
+					exact = false;
+					break;
+				}
+				q = (std::int64_t)array[i];
+			}
+			if (q < lo)	lo = q;
+			if (q > hi)	hi = q;
+		}
+		if (!exact) {
+			if constexpr (std::is_floating_point_v<L>)
+				continue;
+			else
+				return AttributeNarrowing::NONE;
+		}
+		if (lo > hi)
+			lo = hi = 0;										// nothing but nodata
+
+		*scale = s;
+		if ((sizeof(L) > 1) && (lo >= std::numeric_limits<std::int8_t>::min()) && (hi <= std::numeric_limits<std::int8_t>::max()))
+			return AttributeNarrowing::I1;
+		if ((sizeof(L) > 1) && (lo >= 0) && (hi <= std::numeric_limits<std::uint8_t>::max()))
+			return AttributeNarrowing::UI1;
+		if ((sizeof(L) > 2) && (lo >= std::numeric_limits<std::int16_t>::min()) && (hi <= std::numeric_limits<std::int16_t>::max()))
+			return AttributeNarrowing::I2;
+		if ((sizeof(L) > 2) && (lo >= 0) && (hi <= std::numeric_limits<std::uint16_t>::max()))
+			return AttributeNarrowing::UI2;
+		if (sizeof(L) > 4)
+			return AttributeNarrowing::I4;
+		return AttributeNarrowing::NONE;
+	}
+	return AttributeNarrowing::NONE;
+}
+
+
+/**
+	Stores count values from src in the narrower array dest, as found by FindAttributeNarrowing().  Cells flagged in nodata are stored
+	as 0.
+*/
+template<typename L, typename S>
+inline void NarrowAttributeArray(const L *src, const bool *nodata, std::size_t count, double scale, S *dest) {
+	for (std::size_t i = 0; i < count; i++) {
+		if ((nodata) && (nodata[i]))
+			dest[i] = 0;
+		else if constexpr (std::is_floating_point_v<L>)
+			dest[i] = (S)std::llround((double)src[i] * scale);
+		else
+			dest[i] = (S)src[i];
+	}
+}
+
+
+/**
+	The reverse of NarrowAttributeArray().
+*/
+template<typename S, typename L>
+inline void WidenAttributeArray(const S *src, std::size_t count, double scale, L *dest) {
+	for (std::size_t i = 0; i < count; i++)
+		dest[i] = WidenAttributeValue<S, L>(src[i], scale);
+}
+
+
+/**
+	Sets every cell of a grid array (xsize * ysize elements, row by row) to value, and of its nodata array (if provided) to flag, on the worker
+	threads.  Each thread is given a contiguous block of rows (a static schedule), which is how the array queries and other per-row loops over
+	the grid are split, so on a NUMA machine each page of a freshly allocated array is first touched by, and placed on the node of, the thread
+	which will later read it.
+*/
+template<typename T>
+inline void FillAttributeArray(T *array, T value, bool *nodata, bool flag, std::uint16_t xsize, std::uint16_t ysize) {
+#pragma omp parallel for schedule(static) num_threads(CWorkerThreadPool::NumberIdealProcessors())
+	for (std::int32_t y = 0; y < (std::int32_t)ysize; y++) {
+		const std::size_t row = (std::size_t)y * xsize;
+		if (array)
+			std::fill(array + row, array + row + xsize, value);
+		if (nodata)
+			std::fill(nodata + row, nodata + row + xsize, flag);
+	}
+}
+
+
+/**
+	As above, for an array of element_size byte elements, with value pointing to one element.
+*/
+inline void FillAttributeArray(void *array, std::uint32_t element_size, const void *value, bool *nodata, bool flag, std::uint16_t xsize, std::uint16_t ysize) {
+	switch (element_size) {
+		case 1:		FillAttributeArray(reinterpret_cast<std::int8_t *>(array), *reinterpret_cast<const std::int8_t *>(value), nodata, flag, xsize, ysize); break;
+		case 2:		FillAttributeArray(reinterpret_cast<std::int16_t *>(array), *reinterpret_cast<const std::int16_t *>(value), nodata, flag, xsize, ysize); break;
+		case 4:		FillAttributeArray(reinterpret_cast<std::int32_t *>(array), *reinterpret_cast<const std::int32_t *>(value), nodata, flag, xsize, ysize); break;
+		case 8:		FillAttributeArray(reinterpret_cast<std::int64_t *>(array), *reinterpret_cast<const std::int64_t *>(value), nodata, flag, xsize, ysize); break;
+		default:	FillAttributeArray<std::int8_t>(nullptr, 0, nodata, flag, xsize, ysize); break;
+	}
+}
+
+
+/**
+	Copies a grid array of element_size byte elements (and its nodata array, if both are provided), with the same split of rows between threads as
+	FillAttributeArray().
+*/
+inline void CopyAttributeArray(void *dest, const void *src, std::uint32_t element_size, bool *dest_nodata, const bool *src_nodata, std::uint16_t xsize, std::uint16_t ysize) {
+	const std::size_t row_bytes = (std::size_t)xsize * element_size;
+#pragma omp parallel for schedule(static) num_threads(CWorkerThreadPool::NumberIdealProcessors())
+	for (std::int32_t y = 0; y < (std::int32_t)ysize; y++) {
+		if ((dest) && (src))
+			memcpy(reinterpret_cast<std::uint8_t *>(dest) + (std::size_t)y * row_bytes, reinterpret_cast<const std::uint8_t *>(src) + (std::size_t)y * row_bytes, row_bytes);
+		if ((dest_nodata) && (src_nodata))
+			memcpy(dest_nodata + (std::size_t)y * xsize, src_nodata + (std::size_t)y * xsize, (std::size_t)xsize * sizeof(bool));
+	}
+}
+
+#endif
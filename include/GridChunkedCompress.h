@@ -0,0 +1,205 @@
+/**
+ * WISE_Grid_Module: GridChunkedCompress.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+#include "semaphore.h"
+#include <cstdint>
+#include <string>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+/**
+ * Compression of the grid and filter arrays stored in serialized (protobuf) files.  Arrays larger than one chunk are split
+ * into independently compressed chunks which are compressed and decompressed in parallel.  The chunks are stored, after a
+ * small index, in the same bytes field that used to hold a single Compress::compress() blob:
+ *
+ *	"WGCZ" magic, uint32 version, uint32 chunk count, uint64 uncompressed length,
+ *	then for each chunk: uint32 uncompressed length, uint32 compressed length,
+ *	then the compressed chunks, in order.
+ *
+ * All integers are little endian.  Arrays which fit in a single chunk are still written as a plain Compress::compress() blob
+ * so small files stay readable by older versions, and blobs without the magic are decompressed the old way.
+ *
+ * The chunks are compressed with Compress::compress() unless another codec is selected for the save (see
+ * GridCompressCodecScope).  The codec isn't recorded in the blob, it is stored next to it in the protobuf message (the
+ * codec field of wcsData.binaryData and CwfgmAttributeFilter.BinaryData) and has to be passed back in to decompress.  Blobs
+ * written with a non-default codec always have a chunk index, even if they only hold one chunk.
+ */
+class GridChunkedCompress {
+public:
+	static constexpr std::uint32_t CHUNK_SIZE = 1024 * 1024;
+
+	/**
+		Codecs used for the chunks, with the same values as the ZipCodec protobuf enum.
+	*/
+	enum class Codec : std::uint8_t {
+		DEFAULT = 0,			// Compress::compress(), the format written by every previous version
+		FAST = 1,				// zlib at its fastest level, for autosaves and checkpoints
+		HIGH_RATIO = 2			// bzip2, for archived projects where size matters more than time
+	};
+
+	/**
+		Compresses length bytes from data.
+	*/
+	static std::string compress(const char *data, std::size_t length, Codec codec = Codec::DEFAULT);
+	/**
+		Decompresses a blob written by compress(), or a single blob written by Compress::compress().  Throws if the blob is
+		corrupt.
+	*/
+	static std::string decompress(const std::string &blob, Codec codec = Codec::DEFAULT);
+	/**
+		Decompresses blob directly into dest, which has room for length bytes, without an intermediate copy of a chunked blob.
+		Returns the decompressed length of blob; dest is only written to if this matches length.  Throws if the blob is corrupt.
+	*/
+	static std::size_t decompress(const std::string &blob, void *dest, std::size_t length, Codec codec = Codec::DEFAULT);
+	/**
+		Returns the decompressed length of a chunked blob, read from its index, or (size_t)-1 for a single Compress::compress()
+		blob whose length is only known once it has been decompressed.
+	*/
+	static std::size_t decompressedLength(const std::string &blob);
+	/**
+		Returns true if blob has a chunk index, false if it is a single Compress::compress() blob.
+	*/
+	static bool isChunked(const std::string &blob);
+	/**
+		Returns true if value, read from a protobuf message, is a codec known to this version.
+	*/
+	static bool isCodec(std::int32_t value);
+	/**
+		Converts a codec value read from a protobuf message, throws if it isn't known to this version.
+	*/
+	static Codec toCodec(std::int32_t value);
+	/**
+		Returns the codec selected for saves on the calling thread, see GridCompressCodecScope.
+	*/
+	static Codec saveCodec();
+
+private:
+	friend class GridCompressCodecScope;
+	static thread_local Codec m_saveCodec;
+};
+
+
+/**
+ * Selects the codec used by every serialize() called on this thread while the scope is alive, e.g. by an autosave which
+ * favours speed over size.  Files written with the default codec are unchanged from previous versions.
+ */
+class GridCompressCodecScope {
+public:
+	GridCompressCodecScope(GridChunkedCompress::Codec codec) : m_previous(GridChunkedCompress::m_saveCodec) { GridChunkedCompress::m_saveCodec = codec; }
+	~GridCompressCodecScope()									{ GridChunkedCompress::m_saveCodec = m_previous; }
+
+	GridCompressCodecScope(const GridCompressCodecScope &) = delete;
+	GridCompressCodecScope &operator=(const GridCompressCodecScope &) = delete;
+
+private:
+	GridChunkedCompress::Codec	m_previous;
+};
+
+
+/**
+ * Compressed copy of an array, kept from the last time it was saved or loaded so that saving an unchanged array doesn't
+ * compress it again.  The owner must invalidate() it whenever the array changes.  Every method is safe to call concurrently,
+ * so objects can be saved from several threads at once.
+ */
+class GridRetainedBlob {
+public:
+	GridRetainedBlob() : m_valid(false), m_codec(GridChunkedCompress::Codec::DEFAULT)		{ }
+	GridRetainedBlob(const GridRetainedBlob &toCopy) {
+		CThreadSemaphoreEngage engage(&toCopy.m_lock, SEM_TRUE);
+		m_blob = toCopy.m_blob;
+		m_valid = toCopy.m_valid;
+		m_codec = toCopy.m_codec;
+	}
+	GridRetainedBlob &operator=(const GridRetainedBlob &toCopy) {
+		if (this != &toCopy) {
+			std::string blob;
+			bool valid;
+			GridChunkedCompress::Codec codec;
+			{
+				CThreadSemaphoreEngage engage(&toCopy.m_lock, SEM_TRUE);
+				blob = toCopy.m_blob;
+				valid = toCopy.m_valid;
+				codec = toCopy.m_codec;
+			}
+			CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);
+			m_blob.swap(blob);
+			m_valid = valid;
+			m_codec = codec;
+		}
+		return *this;
+	}
+
+	bool valid() const											{ CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE); return m_valid; }
+	bool empty() const											{ CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE); return m_blob.empty(); }
+	GridChunkedCompress::Codec codec() const					{ CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE); return m_codec; }
+	void copy(std::string *out) const							{ CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE); out->assign(m_blob); }
+
+	/**
+		Calls fcn(blob, codec) with the retained blob and returns its result, holding the lock so the blob can't change
+		underneath it.
+	*/
+	template<typename Fcn>
+	auto read(Fcn &&fcn) const {
+		CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);
+		return fcn(static_cast<const std::string &>(m_blob), m_codec);
+	}
+	void retain(const std::string &blob, GridChunkedCompress::Codec codec = GridChunkedCompress::Codec::DEFAULT)
+																{ CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE); m_blob = blob; m_codec = codec; m_valid = true; }
+	void invalidate()											{ CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE); std::string().swap(m_blob); m_valid = false; }
+
+	/**
+		Writes the retained blob to out (normally the protobuf field being saved) if it was compressed with codec, otherwise
+		compresses length bytes from data, retains the result and writes that.
+	*/
+	void compress(const char *data, std::size_t length, GridChunkedCompress::Codec codec, std::string *out) {
+		CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);
+		if ((!m_valid) || (m_codec != codec)) {
+			m_blob = GridChunkedCompress::compress(data, length, codec);
+			m_codec = codec;
+			m_valid = true;
+		}
+		out->assign(m_blob);
+	}
+
+	/**
+		As above, for an array which is pre-encoded (see GridArrayEncoding) before it is compressed.  encode() returns the
+		encoded array and is only called if the retained blob can't be used.
+	*/
+	template<typename Fcn>
+	void compress(Fcn &&encode, GridChunkedCompress::Codec codec, std::string *out) {
+		CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);
+		if ((!m_valid) || (m_codec != codec)) {
+			const std::string encoded = encode();
+			m_blob = GridChunkedCompress::compress(encoded.data(), encoded.length(), codec);
+			m_codec = codec;
+			m_valid = true;
+		}
+		out->assign(m_blob);
+	}
+
+private:
+	mutable CThreadSemaphore	m_lock;
+	std::string					m_blob;
+	bool						m_valid;
+	GridChunkedCompress::Codec	m_codec;
+};
+
+#endif
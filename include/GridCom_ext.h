@@ -76,6 +76,17 @@
 #define CWFGM_GRID_ATTRIBUTE_INITIALSIZE					10455	// initial buffer size to place around the ignition(s)
 #define CWFGM_GRID_ATTRIBUTE_GROWTHSIZE						10456	// size that a buffer should grow when it needs to grow
 #define CWFGM_GRID_ATTRIBUTE_BUFFERSIZE						10457	// size of the buffer to place around a simulation state to determine when it's time to acquire more data
+#define CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE					10458	// hold attribute grids in the narrowest type which stores them exactly
+#define CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE					10459	// hold attribute grids as tiles, storing nothing for NODATA or constant tiles
+#define CWFGM_GRID_ATTRIBUTE_SAMPLING						10460	// how an attribute grid at its own resolution is sampled at the fuel grid's, see below
+#define CWFGM_GRID_ATTRIBUTE_NATIVE_RESOLUTION				10461	// (read-only) whether an attribute grid is kept at its own resolution and origin
+#define CWFGM_GRID_ATTRIBUTE_SOLAR_CACHE_TILE				10462	// size (grid units) of the tiles a temporal filter caches sun rise/set times over, 0 to not cache
+
+#define CWFGM_GRID_SAMPLING_NEAREST							0
+#define CWFGM_GRID_SAMPLING_BILINEAR						1
+
+#define CWFGM_GRID_EXPORT_TILED						0x00000001	// write an internally tiled, compressed GeoTIFF
+#define CWFGM_GRID_EXPORT_OVERVIEWS					0x00000002	// add internal overview levels, computed from the in-memory grid
 
 #define CWFGM_GETEVENTTIME_FLAG_SEARCH_FORWARD		0x00000000
 #define CWFGM_GETEVENTTIME_FLAG_SEARCH_BACKWARD		0x00000001
@@ -0,0 +1,68 @@
+/**
+ * WISE_Grid_Module: GridFileProbe.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+#include "results.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class CCWFGM_FuelMap;
+
+/**
+ * Description of a raster file gathered from its headers (and optionally a sparse sample of its cells) without importing it.
+ * Filled by CCWFGM_Grid::ProbeGrid() and CCWFGM_AttributeFilter::ProbeAttributeGrid().
+ */
+struct GridFileProbe {
+	std::uint16_t	xsize,
+					ysize;
+	std::uint16_t	bands;
+	double			xllcorner,
+					yllcorner;
+	double			xresolution,
+					yresolution;			// in the file's own linear units
+	std::string		projection;				// WKT, empty if the file doesn't carry one
+	std::string		dataType;				// GDAL name for the type of band 1, e.g. "Int16"
+	bool			isInteger;
+	bool			hasNoData;
+	double			noData;
+
+	HRESULT			compatibility;			// S_OK, or the error the matching import would fail with
+
+	std::uint32_t	samples;				// number of cells sampled, 0 when sampling wasn't requested
+	std::map<std::int32_t, std::uint32_t> fuelHistogram;	// sampled file fuel index (NODATA excluded) to count
+	std::vector<std::int32_t> unknownFuels;	// sampled file fuel indices the fuel map doesn't know about
+};
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+/**
+	Opens file_name read-only and fills the header fields of probe.  If sampled is provided and sample_step is non-zero, band 1
+	is also read at 1/sample_step of its resolution in each direction (nearest neighbour) into sampled.
+*/
+HRESULT ProbeRasterFile(const std::string &file_name, std::uint32_t sample_step, GridFileProbe *probe, std::vector<std::int32_t> *sampled);
+
+/**
+	Builds the fuel histogram of probe from sampled and checks every fuel index found against fuelMap.
+*/
+void ProbeFuelHistogram(const std::vector<std::int32_t> &sampled, const CCWFGM_FuelMap *fuelMap, GridFileProbe *probe);
+
+#endif
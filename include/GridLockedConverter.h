@@ -0,0 +1,58 @@
+/**
+ * WISE_Grid_Module: GridLockedConverter.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "CoordinateConverter.h"
+#include "gdalclient.h"
+#include <memory>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+/**
+ * Coordinate converter which is created and destroyed while holding the GDAL mutex, however the scope is left (including by an
+ * exception out of a deserializer).  Conversions through it don't take the mutex, so they can still run in parallel.
+ */
+class GridLockedConverter {
+public:
+	GridLockedConverter(const std::string &sourceProjection) {
+		CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+		m_convert = std::make_unique<CCoordinateConverter>();
+		try {
+			m_convert->SetSourceProjection(sourceProjection.c_str());
+		}
+		catch (...) {
+			m_convert.reset();
+			throw;
+		}
+	}
+	~GridLockedConverter() {
+		CSemaphoreEngage lock(GDALClient::GDALClient::getGDALMutex(), TRUE);
+		m_convert.reset();
+	}
+
+	GridLockedConverter(const GridLockedConverter &) = delete;
+	GridLockedConverter &operator=(const GridLockedConverter &) = delete;
+
+	CCoordinateConverter *operator->() const					{ return m_convert.get(); }
+
+private:
+	std::unique_ptr<CCoordinateConverter>	m_convert;
+};
+
+#endif
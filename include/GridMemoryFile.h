@@ -0,0 +1,55 @@
+/**
+ * WISE_Grid_Module: GridMemoryFile.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+/**
+ * Scoped GDAL /vsimem/ file, so the file based import and export routines can be used on caller-provided memory without
+ * touching disk.  The name is unique per instance and the virtual file is unlinked on destruction.
+ */
+class GridMemoryFile {
+public:
+	/**
+		Creates a name for an empty virtual file, for exports.  The extension (e.g. ".tif", ".asc") selects the output format.
+	*/
+	GridMemoryFile(const std::string &extension);
+	/**
+		Exposes buffer as a virtual file, for imports.  The buffer is not copied and must outlive this object.
+	*/
+	GridMemoryFile(const std::uint8_t *buffer, std::size_t length, const std::string &extension = std::string());
+	~GridMemoryFile();
+
+	const std::string &name() const								{ return m_name; }
+
+	/**
+		Copies the contents of the virtual file into buffer.
+	*/
+	HRESULT read(std::vector<std::uint8_t> &buffer) const;
+
+private:
+	std::string		m_name;
+};
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * WISE_Grid_Module: GridRasterWriter.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+#include "Thread.h"
+#include <gdal.h>
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+/**
+ * Internal raster writer shared by the grid and filter export routines.  Unlike GDALExporter, it does not need the whole
+ * raster up front: the caller describes the bands, creates the dataset, then hands over horizontal strips (top row first, the
+ * same order as the in-memory arrays) which are filled in parallel and written straight to GDAL.  Drivers which cannot write
+ * incrementally (e.g. ASCII grids) are written to a GDAL MEM dataset and copied out on close().
+ *
+ * GeoTIFFs may optionally be internally tiled and carry overview levels.  Overviews are not built by a second GDAL pass over
+ * the file; each level is decimated (in parallel) from the same cell function used for the full resolution data, then from
+ * the level before it.
+ */
+class GridRasterWriter {
+public:
+	enum class BandType : std::uint8_t {
+		INT32 = 0,
+		FLOAT64 = 1
+	};
+
+	enum class Resample : std::uint8_t {
+		NEAREST = 0,			// categorical data (fuels, attribute codes)
+		AVERAGE = 1				// continuous data (elevation), NODATA cells are ignored
+	};
+
+	GridRasterWriter();
+	~GridRasterWriter();
+
+	void setProjection(const std::string &projection)			{ m_projection = projection; }
+	void setSize(std::uint16_t xsize, std::uint16_t ysize)		{ m_xsize = xsize; m_ysize = ysize; }
+	void setPixelResolution(double resolution)					{ m_resolution = resolution; }
+	void setLowerLeft(double xllcorner, double yllcorner)		{ m_xllcorner = xllcorner; m_yllcorner = yllcorner; }
+	void setExportCompress(std::uint32_t compression)			{ m_compression = compression; }
+	void setTiled(bool tiled)									{ m_tiled = tiled; }
+	void setOverviews(bool overviews)							{ m_overviews = overviews; }
+	void addTag(const char *name, const char *value);
+	void addDefaultTags();
+	std::uint16_t addBand(BandType type, const char *name, double nodata = -9999.0, Resample resample = Resample::NEAREST);
+
+	std::uint16_t xsize() const									{ return m_xsize; }
+	std::uint16_t ysize() const									{ return m_ysize; }
+	std::uint16_t stripRows() const;
+
+	HRESULT create(const std::string &file_name);
+	HRESULT writeRows(std::uint16_t band, std::uint16_t row, std::uint16_t rows, const std::int32_t *buffer);
+	HRESULT writeRows(std::uint16_t band, std::uint16_t row, std::uint16_t rows, const double *buffer);
+	HRESULT close();
+
+	/**
+		Fills and writes a band, one strip at a time.  fcn(index) is called for every cell with the cell's offset into a
+		top-row-first array (the layout used by GridData and CCWFGM_AttributeFilter) and returns the value to write.  Cells in a
+		strip are evaluated in parallel, so fcn must be safe to call concurrently.
+	*/
+	template<typename T, typename Fcn>
+	HRESULT writeBand(std::uint16_t band, Fcn &&fcn) {
+		const std::uint16_t strip = stripRows();
+		const std::int32_t xsize = m_xsize;
+		std::vector<T> buffer((size_t)strip * (size_t)xsize);
+		T *b = buffer.data();
+
+		for (std::int32_t row = 0; row < (std::int32_t)m_ysize; row += strip) {
+			const std::uint16_t rows = (std::uint16_t)std::min((std::int32_t)strip, (std::int32_t)m_ysize - row);
+			const std::int32_t count = (std::int32_t)rows * xsize;
+			const std::uint32_t base = (std::uint32_t)row * (std::uint32_t)xsize;
+
+#pragma omp parallel for num_threads(CWorkerThreadPool::NumberIdealProcessors())
+			for (std::int32_t i = 0; i < count; i++)
+				b[i] = fcn(base + (std::uint32_t)i);
+
+			HRESULT hr = writeRows(band, (std::uint16_t)row, rows, b);
+			if (FAILED(hr))
+				return hr;
+		}
+		return writeOverviews<T>(band, fcn);
+	}
+
+	/**
+		Multi-band form of writeBand(), for rasters where every band is derived from the same cell.  fcn(index, values) is
+		called once per cell and fills values[0..N-1], one entry for each of bands[], so the source arrays are traversed a single
+		time regardless of the number of bands.
+	*/
+	template<typename T, std::size_t N, typename Fcn>
+	HRESULT writeBands(const std::uint16_t (&bands)[N], Fcn &&fcn) {
+		const std::uint16_t strip = stripRows();
+		const std::int32_t xsize = m_xsize;
+		const size_t strip_cells = (size_t)strip * (size_t)xsize;
+		std::vector<T> buffer(strip_cells * N);
+		T *b = buffer.data();
+
+		for (std::int32_t row = 0; row < (std::int32_t)m_ysize; row += strip) {
+			const std::uint16_t rows = (std::uint16_t)std::min((std::int32_t)strip, (std::int32_t)m_ysize - row);
+			const std::int32_t count = (std::int32_t)rows * xsize;
+			const std::uint32_t base = (std::uint32_t)row * (std::uint32_t)xsize;
+
+#pragma omp parallel for num_threads(CWorkerThreadPool::NumberIdealProcessors())
+			for (std::int32_t i = 0; i < count; i++) {
+				T values[N];
+				fcn(base + (std::uint32_t)i, values);
+				for (std::size_t j = 0; j < N; j++)
+					b[j * strip_cells + i] = values[j];
+			}
+
+			for (std::size_t j = 0; j < N; j++) {
+				HRESULT hr = writeRows(bands[j], (std::uint16_t)row, rows, b + j * strip_cells);
+				if (FAILED(hr))
+					return hr;
+			}
+		}
+
+		for (std::size_t j = 0; j < N; j++) {
+			HRESULT hr = writeOverviews<T>(bands[j], [&fcn, j](std::uint32_t index) -> T {
+				T values[N];
+				fcn(index, values);
+				return values[j];
+			});
+			if (FAILED(hr))
+				return hr;
+		}
+		return S_OK;
+	}
+
+private:
+	struct Band {
+		BandType	type;
+		Resample	resample;
+		std::string	name;
+		double		nodata;
+	};
+
+	/**
+		Fills and writes every overview level of a band.  The first level is sampled from fcn() at full resolution, each
+		following level is halved again from the previous level's buffer.
+	*/
+	template<typename T, typename Fcn>
+	HRESULT writeOverviews(std::uint16_t band, Fcn &&fcn) {
+		const std::uint16_t levels = overviewCount();
+		if (!levels)
+			return S_OK;
+
+		const T nodata = (T)m_bands[band - 1].nodata;
+		const bool average = (m_bands[band - 1].resample == Resample::AVERAGE);
+		std::vector<T> src, dst;
+		std::int32_t sx = m_xsize, sy = m_ysize;
+
+		for (std::uint16_t level = 0; level < levels; level++) {
+			std::int32_t dx, dy;
+			overviewSize(band, level, &dx, &dy);
+			dst.resize((size_t)dx * (size_t)dy);
+			T *d = dst.data();
+			const T *s = src.data();
+			const bool first = (level == 0);
+
+#pragma omp parallel for num_threads(CWorkerThreadPool::NumberIdealProcessors())
+			for (std::int32_t oy = 0; oy < dy; oy++) {
+				const std::int32_t y0 = std::min(oy * 2, sy - 1), y1 = std::min(oy * 2 + 1, sy - 1);
+				for (std::int32_t ox = 0; ox < dx; ox++) {
+					const std::int32_t x0 = std::min(ox * 2, sx - 1), x1 = std::min(ox * 2 + 1, sx - 1);
+					auto value = [&](std::int32_t x, std::int32_t y) -> T {
+						const std::uint32_t index = (std::uint32_t)y * (std::uint32_t)sx + (std::uint32_t)x;
+						return first ? fcn(index) : s[index];
+					};
+
+					T result;
+					if (!average)
+						result = value(x1, y1);
+					else {
+						const T v[4] = { value(x0, y0), value(x1, y0), value(x0, y1), value(x1, y1) };
+						double sum = 0.0;
+						std::uint16_t cnt = 0;
+						for (std::uint16_t k = 0; k < 4; k++)
+							if (v[k] != nodata) {
+								sum += (double)v[k];
+								cnt++;
+							}
+						if (!cnt)
+							result = nodata;
+						else if constexpr (std::is_integral<T>::value)
+							result = (T)std::lround(sum / cnt);
+						else
+							result = (T)(sum / cnt);
+					}
+					d[(size_t)oy * (size_t)dx + ox] = result;
+				}
+			}
+
+			HRESULT hr = writeOverview(band, level, dx, dy, d);
+			if (FAILED(hr))
+				return hr;
+			src.swap(dst);
+			sx = dx;
+			sy = dy;
+		}
+		return S_OK;
+	}
+
+	HRESULT writeRows(std::uint16_t band, std::uint16_t row, std::uint16_t rows, const void *buffer, GDALDataType type);
+	std::uint16_t overviewCount();
+	void overviewSize(std::uint16_t band, std::uint16_t level, std::int32_t *xsize, std::int32_t *ysize) const;
+	HRESULT writeOverview(std::uint16_t band, std::uint16_t level, std::int32_t xsize, std::int32_t ysize, const std::int32_t *buffer);
+	HRESULT writeOverview(std::uint16_t band, std::uint16_t level, std::int32_t xsize, std::int32_t ysize, const double *buffer);
+	HRESULT writeOverview(std::uint16_t band, std::uint16_t level, std::int32_t xsize, std::int32_t ysize, const void *buffer, GDALDataType type);
+	HRESULT accessError() const;
+
+	std::string					m_fileName;
+	std::string					m_projection;
+	std::vector<std::pair<std::string, std::string>> m_tags;
+	std::vector<Band>			m_bands;
+	std::uint16_t				m_xsize, m_ysize;
+	double						m_resolution, m_xllcorner, m_yllcorner;
+	std::uint32_t				m_compression;
+	bool						m_tiled, m_overviews;
+	std::int32_t				m_overviewLevels;		// -1 until the overview structure has been created
+
+	GDALDriverH					m_driver;
+	GDALDatasetH				m_dataset;
+	char						**m_options;
+	bool						m_copyOnClose;
+};
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * WISE_Grid_Module: GridSparseArray.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+/**
+ * Tiled copy of a grid array (and its nodata array), used by CCWFGM_AttributeFilter for layers which only cover part of the
+ * landscape or are constant over large areas.  Tiles which are all NODATA or all one value store no cells; the rest store their
+ * cells (and nodata flags, only if the tile has any) densely.  Cells are addressed with the same array index as the dense array,
+ * which is stored top row first, and tiles are laid out over that index space.  Elements are opaque, element_size bytes each, so
+ * the array can hold any of the filter's storage types.  Changing a cell (see setCell()) only expands the tile holding it.
+ */
+class GridSparseArray {
+public:
+	static constexpr std::uint16_t TILE_SIZE = 64;
+
+	enum class TileKind : std::uint8_t {
+		NODATA,
+		CONSTANT,
+		DENSE
+	};
+
+	/**
+		Run of cells along one row of the array, all within one tile.  For a CONSTANT tile values points to the single value
+		(and doesn't advance); for a DENSE tile it points to count consecutive elements, and nodata (if not null) to their flags.
+	*/
+	struct Span {
+		TileKind			kind;
+		const std::uint8_t	*values;
+		const bool			*nodata;
+		std::uint32_t		count;
+	};
+
+	/**
+		Builds the tiled copy of values (xsize * ysize elements) and nodata (may be null).  Returns null if the tiled copy
+		wouldn't use less than half the memory of the dense arrays, or there's no memory for it.
+	*/
+	static std::shared_ptr<GridSparseArray> build(const void *values, const bool *nodata, std::uint16_t xsize, std::uint16_t ysize,
+	    std::uint32_t element_size);
+
+	/**
+		Returns a copy of the array, or null if there's no memory for it.
+	*/
+	std::shared_ptr<GridSparseArray> clone() const;
+
+	/**
+		Returns the element at array index, or null if the cell has no data.
+	*/
+	const std::uint8_t *cell(std::uint32_t index) const {
+		const std::uint32_t row = index / m_xsize, column = index - row * m_xsize;
+		const Tile &tile = m_tiles[(row / TILE_SIZE) * m_tileColumns + column / TILE_SIZE];
+		switch (tile.kind) {
+			case TileKind::CONSTANT:	return tile.value;
+			case TileKind::DENSE: {
+										const std::uint32_t local = (row % TILE_SIZE) * tile.width + column % TILE_SIZE;
+										if ((tile.nodata) && (tile.nodata[local]))
+											return nullptr;
+										return tile.values.get() + local * m_elementSize;
+									}
+			default:					return nullptr;
+		}
+	}
+
+	/**
+		Returns the run of at most max_count cells starting at array index, up to the end of its tile.
+	*/
+	Span span(std::uint32_t index, std::uint32_t max_count) const;
+
+	/**
+		Sets the element at array index to value (element_size bytes) and marks it as having data.  A NODATA or CONSTANT tile is
+		made DENSE first, leaving the other tiles alone.  Returns false if there's no memory for the tile, leaving the array unchanged.
+	*/
+	bool setCell(std::uint32_t index, const void *value);
+
+	/**
+		Writes the array back out densely.  Either pointer may be null to skip that array.
+	*/
+	void expand(void *values, bool *nodata) const;
+
+	bool hasNodata() const										{ return m_hasNodata; }
+	std::uint32_t elementSize() const							{ return m_elementSize; }
+
+	/**
+		Memory used by the tiled copy.
+	*/
+	std::size_t bytes() const;
+
+private:
+	struct Tile {
+		TileKind					kind;
+		std::uint8_t				value[8];			// the value of a CONSTANT tile
+		std::uint16_t				width, height;
+		std::unique_ptr<std::uint8_t[]>	values;			// cells of a DENSE tile, width * height elements
+		std::unique_ptr<bool[]>		nodata;				// flags of a DENSE tile, only if it has nodata cells
+	};
+
+	GridSparseArray(std::uint16_t xsize, std::uint16_t ysize, std::uint32_t element_size);
+
+	std::uint16_t		m_xsize, m_ysize;
+	std::uint32_t		m_tileColumns, m_tileRows;
+	std::uint32_t		m_elementSize;
+	bool				m_hasNodata;
+	std::vector<Tile>	m_tiles;
+};
+
+#endif
@@ -0,0 +1,66 @@
+/**
+ * WISE_Grid_Module: GridTile.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * One rectangular piece of a grid, used to shard a landscape across workers.  The core is the part of the grid the tile is
+ * responsible for; the tile itself is the core grown by a halo of cells on each side (clipped to the grid), so that anything
+ * near the edge of the core can still see its neighbours.  All cell offsets are in the full grid, from the lower-left cell.
+ * Filled by CCWFGM_Grid::GetTiles(), passed to CCWFGM_Grid::serializeTile() and CCWFGM_AttributeFilter::serializeTile(), and
+ * returned by GetTile() on an object which was loaded from a tile.
+ */
+struct GridTile {
+	std::uint16_t	column,
+					row;					// position of the tile in the tiling, from the lower-left tile
+	std::uint16_t	x,
+					y,
+					xsize,
+					ysize;					// cells covered by the tile, halo included
+	std::uint16_t	coreX,
+					coreY,
+					coreXSize,
+					coreYSize;				// cells the tile is responsible for
+	std::uint16_t	fullXSize,
+					fullYSize;				// size of the grid the tile was cut from
+	double			xllcorner,
+					yllcorner,
+					resolution;				// world placement of the tile, halo included
+};
+
+#ifndef DOXYGEN_IGNORE_CODE
+
+/**
+	Splits a grid of xsize by ysize cells into tiles with cores of at most tile_size by tile_size cells, each grown by halo cells.
+*/
+std::vector<GridTile> PartitionGridTiles(std::uint16_t xsize, std::uint16_t ysize, double xllcorner, double yllcorner, double resolution,
+    std::uint16_t tile_size, std::uint16_t halo);
+
+/**
+	Copies the xsize by ysize window of cells with lower-left cell (x, y) out of src (src_xsize by src_ysize cells, stored top row
+	first like all the grid arrays) into dest, which is stored the same way.
+*/
+void CropGridArray(const void *src, std::uint16_t src_xsize, std::uint16_t src_ysize, std::uint16_t x, std::uint16_t y,
+    std::uint16_t xsize, std::uint16_t ysize, std::size_t element_size, void *dest);
+
+#endif
@@ -72,6 +72,12 @@ typedef boost::const_multi_array_ref<std::uint16_t, 2> const_uint16_t_2d_ref;
 typedef boost::multi_array<double, 2> double_2d;
 typedef boost::multi_array_ref<double, 2> double_2d_ref;
 typedef boost::const_multi_array_ref<double, 2> const_double_2d_ref;
+typedef boost::multi_array<float, 2> float_2d;
+typedef boost::multi_array_ref<float, 2> float_2d_ref;
+typedef boost::const_multi_array_ref<float, 2> const_float_2d_ref;
+typedef boost::multi_array<std::int32_t, 2> int32_t_2d;
+typedef boost::multi_array_ref<std::int32_t, 2> int32_t_2d_ref;
+typedef boost::const_multi_array_ref<std::int32_t, 2> const_int32_t_2d_ref;
 
 typedef boost::multi_array<IWXData, 2> IWXData_2d;
 typedef boost::multi_array_ref<IWXData, 2> IWXData_2d_ref;
@@ -299,6 +305,17 @@ public:
 	*/
 	virtual HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time,
 			const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, NumericVariant_2d *attribute, attribute_t_2d *attribute_valid);
+	/**
+		Typed versions of the above, which fill the caller's buffer directly rather than a NumericVariant per cell.  Any cell whose value can't be represented in
+		the requested type (e.g. out of range of std::int32_t) is marked NOT_SET in attribute_valid.  The default implementations call the NumericVariant version and
+		convert, so they return the same data for every object; objects which hold their data as plain arrays override them to skip the variants entirely.
+	*/
+	virtual HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time,
+			const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, double_2d *attribute, attribute_t_2d *attribute_valid);
+	virtual HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time,
+			const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, float_2d *attribute, attribute_t_2d *attribute_valid);
+	virtual HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time,
+			const HSS_Time::WTimeSpan& timeSpan, std::uint16_t option, std::uint64_t optionFlags, int32_t_2d *attribute, attribute_t_2d *attribute_valid);
 
 	/**
 		This method allows the simulation engine to scan forward or back (based on flags) from a given time for the next time-based event.  This is important for the event-driven nature of the simulation.
@@ -0,0 +1,97 @@
+/**
+ * WISE_Grid_Module: AttributeFilterDeferredTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include <memory>
+
+// Attribute filters loaded from zipped data only decompress it when it's first used.  The array sizes are still checked at
+// load, so a damaged file fails to load rather than failing later in a simulation.
+
+static const std::uint16_t key = WISE::GridProto::CwfgmAttributeFilter_DataKey_PC;
+
+
+static void roundTrip(GridTestEngine *engine, bool zip) {
+	auto filter = gridTestFilter(engine, key, 7);
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(0, 0), NumericVariant((std::int32_t)1))));
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(11, 9), NumericVariant((std::int32_t)2))));
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(5, 3), NumericVariant((std::int32_t)-3))));
+
+	std::unique_ptr<WISE::GridProto::CwfgmAttributeFilter> proto(filter->serialize(gridTestOptions(zip)));
+	GRID_CHECK(proto.get() != nullptr);
+	GRID_CHECK(proto->binary().has_iszipped() == zip);
+
+	auto loaded = gridTestLoad<CCWFGM_AttributeFilter>(engine, *proto);
+
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(0, 0)) == 1);
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(11, 9)) == 2);
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(5, 3)) == -3);
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(6, 3)) == 7);
+
+	// saving the still-deferred filter writes the retained data back out
+	std::unique_ptr<WISE::GridProto::CwfgmAttributeFilter> again(loaded->serialize(gridTestOptions(zip)));
+	GRID_CHECK(again->binary().data().value() == proto->binary().data().value());
+}
+
+
+static void editAfterLoad(GridTestEngine *engine) {
+	auto filter = gridTestFilter(engine, key, 7);
+	std::unique_ptr<WISE::GridProto::CwfgmAttributeFilter> proto(filter->serialize(gridTestOptions(true)));
+
+	auto loaded = gridTestLoad<CCWFGM_AttributeFilter>(engine, *proto);
+
+	// an edit drops the retained data, so the next save holds the edit
+	GRID_CHECK(SUCCEEDED(loaded->SetAttributePoint(engine->cell(2, 2), NumericVariant((std::int32_t)4))));
+	std::unique_ptr<WISE::GridProto::CwfgmAttributeFilter> edited(loaded->serialize(gridTestOptions(true)));
+	GRID_CHECK(edited->binary().data().value() != proto->binary().data().value());
+
+	auto reloaded = gridTestLoad<CCWFGM_AttributeFilter>(engine, *edited);
+	GRID_CHECK(gridTestValue(reloaded.get(), engine->cell(2, 2)) == 4);
+	GRID_CHECK(gridTestValue(reloaded.get(), engine->cell(3, 2)) == 7);
+}
+
+
+static void rejectsWrongSize(GridTestEngine *engine) {
+	auto filter = gridTestFilter(engine, key, 7);
+	std::unique_ptr<WISE::GridProto::CwfgmAttributeFilter> proto(filter->serialize(gridTestOptions(true)));
+	proto->mutable_binary()->set_xsize(proto->binary().xsize() + 1);
+
+	GRID_CHECK_THROWS(gridTestLoad<CCWFGM_AttributeFilter>(engine, *proto), ISerializeProto::DeserializeError);
+}
+
+
+static void rejectsTruncatedData(GridTestEngine *engine) {
+	auto filter = gridTestFilter(engine, key, 7);
+	std::unique_ptr<WISE::GridProto::CwfgmAttributeFilter> proto(filter->serialize(gridTestOptions(true)));
+	const std::string data = proto->binary().data().value();
+	proto->mutable_binary()->mutable_data()->set_value(data.substr(0, data.length() / 2));
+
+	GRID_CHECK_THROWS(gridTestLoad<CCWFGM_AttributeFilter>(engine, *proto), ISerializeProto::DeserializeError);
+}
+
+
+int main(int argc, char *argv[]) {
+	boost::intrusive_ptr<GridTestEngine> engine(new GridTestEngine(12, 10, 25.0, 500000.0, 6000000.0));
+
+	roundTrip(engine.get(), true);
+	roundTrip(engine.get(), false);
+	editAfterLoad(engine.get());
+	rejectsWrongSize(engine.get());
+	rejectsTruncatedData(engine.get());
+
+	return gridTestFailures() ? 1 : 0;
+}
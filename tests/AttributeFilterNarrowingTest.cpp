@@ -0,0 +1,189 @@
+/**
+ * WISE_Grid_Module: AttributeFilterNarrowingTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include "GridAttributeArray.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// With narrow storage turned on, an attribute filter holds its array in the narrowest type which keeps every value exact, goes
+// back to OptionType as soon as a cell is set, and answers every query the same as it would from the full width array.
+
+static const std::uint16_t key = WISE::GridProto::CwfgmAttributeFilter_DataKey_PC;
+
+
+template<typename L>
+static AttributeNarrowing narrowing(std::vector<L> values, double *scale, std::vector<bool> nodata = {}) {
+	std::unique_ptr<bool[]> flags;
+	if (!nodata.empty()) {
+		flags.reset(new bool[values.size()]);
+		for (std::size_t i = 0; i < values.size(); i++)
+			flags[i] = nodata[i];
+	}
+	*scale = -1.0;
+	return FindAttributeNarrowing(values.data(), flags.get(), values.size(), scale);
+}
+
+
+static void findNarrowing() {
+	double scale;
+
+	GRID_CHECK(narrowing<std::int32_t>({ -5, 100, 0 }, &scale) == AttributeNarrowing::I1);
+	GRID_CHECK(scale == 1.0);
+	GRID_CHECK(narrowing<std::int32_t>({ 0, 200 }, &scale) == AttributeNarrowing::UI1);
+	GRID_CHECK(narrowing<std::int32_t>({ -300, 300 }, &scale) == AttributeNarrowing::I2);
+	GRID_CHECK(narrowing<std::int32_t>({ 0, 60000 }, &scale) == AttributeNarrowing::UI2);
+	GRID_CHECK(narrowing<std::int32_t>({ -70000, 5 }, &scale) == AttributeNarrowing::NONE);		// no narrower type holds it
+	GRID_CHECK(narrowing<std::int64_t>({ -70000, 5 }, &scale) == AttributeNarrowing::I4);
+	GRID_CHECK(narrowing<std::int64_t>({ 1LL << 40 }, &scale) == AttributeNarrowing::NONE);
+	GRID_CHECK(narrowing<std::uint16_t>({ 250 }, &scale) == AttributeNarrowing::UI1);
+	GRID_CHECK(narrowing<std::int16_t>({ -300 }, &scale) == AttributeNarrowing::NONE);			// only types smaller than L
+
+	// cells with no data don't count
+	GRID_CHECK(narrowing<std::int32_t>({ 5, 1000000 }, &scale, { false, true }) == AttributeNarrowing::I1);
+	GRID_CHECK(narrowing<std::int32_t>({ 1000000, 1000000 }, &scale, { true, true }) == AttributeNarrowing::I1);
+
+	// floating point values are held fixed-point, with the fewest decimal places which keep them exact
+	GRID_CHECK(narrowing<double>({ 1.0, -7.0 }, &scale) == AttributeNarrowing::I1);
+	GRID_CHECK(scale == 1.0);
+	GRID_CHECK(narrowing<double>({ 0.5, 2.0, -1.5 }, &scale) == AttributeNarrowing::I1);
+	GRID_CHECK(scale == 10.0);
+	GRID_CHECK(narrowing<double>({ 1.25, -3.5, 12.75 }, &scale) == AttributeNarrowing::I2);
+	GRID_CHECK(scale == 100.0);
+	GRID_CHECK(narrowing<double>({ 40.001 }, &scale) == AttributeNarrowing::UI2);
+	GRID_CHECK(scale == 1000.0);
+	GRID_CHECK(narrowing<double>({ 30.001, -30.0 }, &scale) == AttributeNarrowing::I2);
+	GRID_CHECK(scale == 1000.0);
+	GRID_CHECK(narrowing<double>({ 1234567.875 }, &scale) == AttributeNarrowing::I4);
+	GRID_CHECK(scale == 1000.0);
+	GRID_CHECK(narrowing<float>({ 0.5f, 2.25f }, &scale) == AttributeNarrowing::UI1);
+	GRID_CHECK(scale == 100.0);
+
+	// and anything which wouldn't come back identical isn't narrowed at all
+	GRID_CHECK(narrowing<double>({ 1.0 / 3.0 }, &scale) == AttributeNarrowing::NONE);
+	GRID_CHECK(narrowing<double>({ 0.0001 }, &scale) == AttributeNarrowing::NONE);
+	GRID_CHECK(narrowing<double>({ -0.0 }, &scale) == AttributeNarrowing::NONE);
+	GRID_CHECK(narrowing<double>({ 3.0e9 }, &scale) == AttributeNarrowing::NONE);
+	GRID_CHECK(narrowing<double>({ std::numeric_limits<double>::quiet_NaN() }, &scale) == AttributeNarrowing::NONE);
+	GRID_CHECK(narrowing<float>({ 4.0e6f, 0.5f }, &scale) == AttributeNarrowing::NONE);			// a float is no wider than I4
+}
+
+
+static double doubleValue(CCWFGM_AttributeFilter *filter, const XY_Point &pt) {
+	NumericVariant value;
+	grid::AttributeValue valid;
+	double d;
+	if (FAILED(filter->GetAttributePoint(pt, &value, &valid)) || (valid != grid::AttributeValue::SET) || (!variantToDouble(value, &d)))
+		return -9999.0;
+	return d;
+}
+
+
+// a VT_R8 grid of 2.5's, with a few other values and one cell with no data
+static boost::intrusive_ptr<GridTestAttributeFilter> doubles(GridTestEngine *engine, bool narrow) {
+	auto filter = gridTestProbe(engine, key, CCWFGM_AttributeFilter::VT_R8, NumericVariant(2.5));
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(3, 4), NumericVariant(-3.75))));
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(11, 9), NumericVariant(100.25))));
+	filter->clearCell(0, 0);
+	if (narrow)
+		GRID_CHECK(SUCCEEDED(filter->SetAttribute(CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, true)));
+	return filter;
+}
+
+
+static void narrowsFilter(GridTestEngine *engine) {
+	auto filter = doubles(engine, true);
+	GRID_CHECK(filter->storageType() == CCWFGM_AttributeFilter::VT_I2);
+	GRID_CHECK(filter->storageScale() == 100.0);
+	GRID_CHECK(doubleValue(filter.get(), engine->cell(3, 4)) == -3.75);
+	GRID_CHECK(doubleValue(filter.get(), engine->cell(11, 9)) == 100.25);
+	GRID_CHECK(doubleValue(filter.get(), engine->cell(6, 6)) == 2.5);
+	GRID_CHECK(doubleValue(filter.get(), engine->cell(0, 0)) == -9999.0);
+
+	// a value which doesn't fit puts the array back into OptionType, and every other cell is kept
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(5, 5), NumericVariant(1.0 / 3.0))));
+	GRID_CHECK(filter->storageType() == CCWFGM_AttributeFilter::VT_R8);
+	GRID_CHECK(filter->storageScale() == 1.0);
+	GRID_CHECK(doubleValue(filter.get(), engine->cell(5, 5)) == 1.0 / 3.0);
+	GRID_CHECK(doubleValue(filter.get(), engine->cell(3, 4)) == -3.75);
+	GRID_CHECK(doubleValue(filter.get(), engine->cell(11, 9)) == 100.25);
+	GRID_CHECK(doubleValue(filter.get(), engine->cell(6, 6)) == 2.5);
+	GRID_CHECK(doubleValue(filter.get(), engine->cell(0, 0)) == -9999.0);
+
+	// the same for integers, with a value outside the narrowed range rather than one with too many decimal places
+	auto ints = gridTestProbe(engine, key, CCWFGM_AttributeFilter::VT_I4, NumericVariant((std::int32_t)7));
+	GRID_CHECK(SUCCEEDED(ints->SetAttributePoint(engine->cell(2, 2), NumericVariant((std::int32_t)200))));
+	GRID_CHECK(SUCCEEDED(ints->SetAttribute(CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, true)));
+	GRID_CHECK(ints->storageType() == CCWFGM_AttributeFilter::VT_UI1);
+	GRID_CHECK(gridTestValue(ints.get(), engine->cell(2, 2)) == 200);
+	GRID_CHECK(SUCCEEDED(ints->SetAttributePoint(engine->cell(4, 1), NumericVariant((std::int32_t)-70000))));
+	GRID_CHECK(ints->storageType() == CCWFGM_AttributeFilter::VT_I4);
+	GRID_CHECK(gridTestValue(ints.get(), engine->cell(4, 1)) == -70000);
+	GRID_CHECK(gridTestValue(ints.get(), engine->cell(2, 2)) == 200);
+	GRID_CHECK(gridTestValue(ints.get(), engine->cell(9, 8)) == 7);
+
+	// and an array nothing narrower can hold is left alone
+	auto wide = gridTestProbe(engine, key, CCWFGM_AttributeFilter::VT_I4, NumericVariant((std::int32_t)7));
+	GRID_CHECK(SUCCEEDED(wide->SetAttributePoint(engine->cell(2, 2), NumericVariant((std::int32_t)-70000))));
+	GRID_CHECK(SUCCEEDED(wide->SetAttribute(CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, true)));
+	GRID_CHECK(wide->storageType() == CCWFGM_AttributeFilter::VT_I4);
+}
+
+
+template<typename T>
+static void sameArrays(GridTestEngine *engine, CCWFGM_AttributeFilter *narrowed, CCWFGM_AttributeFilter *wide) {
+	boost::multi_array<T, 2> a, b;
+	attribute_t_2d a_valid, b_valid;
+	GRID_CHECK(SUCCEEDED(gridTestArray(narrowed, engine, key, 0, 0, engine->m_xsize - 1, engine->m_ysize - 1, &a, &a_valid)));
+	GRID_CHECK(SUCCEEDED(gridTestArray(wide, engine, key, 0, 0, engine->m_xsize - 1, engine->m_ysize - 1, &b, &b_valid)));
+	for (std::uint16_t x = 0; x < engine->m_xsize; x++)
+		for (std::uint16_t y = 0; y < engine->m_ysize; y++) {
+			GRID_CHECK(a_valid[x][y] == b_valid[x][y]);
+			GRID_CHECK(a[x][y] == b[x][y]);
+		}
+	GRID_CHECK(a_valid[0][0] == grid::AttributeValue::NOT_SET);
+	GRID_CHECK(a_valid[3][4] == grid::AttributeValue::SET);
+	GRID_CHECK(a[3][4] == (T)-3.75);
+	GRID_CHECK(a[11][9] == (T)100.25);
+}
+
+
+static void typedArrays(GridTestEngine *engine) {
+	auto narrowed = doubles(engine, true), wide = doubles(engine, false);
+	GRID_CHECK(narrowed->storageType() == CCWFGM_AttributeFilter::VT_I2);
+	GRID_CHECK(wide->storageType() == CCWFGM_AttributeFilter::VT_R8);
+
+	sameArrays<double>(engine, narrowed.get(), wide.get());
+	sameArrays<float>(engine, narrowed.get(), wide.get());
+	sameArrays<std::int32_t>(engine, narrowed.get(), wide.get());
+
+	// reading doesn't widen it
+	GRID_CHECK(narrowed->storageType() == CCWFGM_AttributeFilter::VT_I2);
+}
+
+
+int main(int argc, char *argv[]) {
+	boost::intrusive_ptr<GridTestEngine> engine(new GridTestEngine(12, 10, 25.0, 500000.0, 6000000.0));
+
+	findNarrowing();
+	narrowsFilter(engine.get());
+	typedArrays(engine.get());
+
+	return gridTestFailures() ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * WISE_Grid_Module: AttributeFilterRasterizeTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include <cmath>
+#include <initializer_list>
+
+// Polygons and polylines are rasterized onto the filter's cells.  The filters here take their geometry from the grid engine
+// (nothing is imported), so this also covers the resolution they're given that way.
+
+static const std::uint16_t key = WISE::GridProto::CwfgmAttributeFilter_DataKey_PC;
+
+
+// fills poly with the given points, in cells of engine
+static void cellPoly(GridTestEngine *engine, std::initializer_list<std::pair<double, double>> cells, XY_Poly *poly) {
+	poly->SetNumPoints((std::uint32_t)cells.size());
+	std::uint32_t i = 0;
+	for (auto &c : cells)
+		poly->SetPoint(i++, XY_Point(engine->m_xllcorner + c.first * engine->m_resolution, engine->m_yllcorner + c.second * engine->m_resolution));
+}
+
+
+static void polygon(GridTestEngine *engine) {
+	auto filter = gridTestFilter(engine, key, 7);
+
+	// covers the centres of cells 2..5 across and 3..6 up
+	XY_Poly square;
+	cellPoly(engine, { { 2.25, 3.25 }, { 5.75, 3.25 }, { 5.75, 6.75 }, { 2.25, 6.75 } }, &square);
+	XY_Rectangle bbox;
+	GRID_CHECK(filter->SetAttributePolygon(square, NumericVariant((std::int32_t)3), &bbox) == S_OK);
+
+	for (std::uint16_t y = 0; y < engine->m_ysize; y++)
+		for (std::uint16_t x = 0; x < engine->m_xsize; x++) {
+			const bool inside = (x >= 2) && (x <= 5) && (y >= 3) && (y <= 6);
+			GRID_CHECK(gridTestValue(filter.get(), engine->cell(x, y)) == (inside ? 3 : 7));
+		}
+
+	GRID_CHECK(fabs(bbox.m_min.x - (engine->m_xllcorner + 2 * engine->m_resolution)) < 0.000001);
+	GRID_CHECK(fabs(bbox.m_min.y - (engine->m_yllcorner + 3 * engine->m_resolution)) < 0.000001);
+	GRID_CHECK(fabs(bbox.m_max.x - (engine->m_xllcorner + 6 * engine->m_resolution)) < 0.000001);
+	GRID_CHECK(fabs(bbox.m_max.y - (engine->m_yllcorner + 7 * engine->m_resolution)) < 0.000001);
+
+	// a polygon over the whole grid and past its edges is clipped to it
+	XY_Poly big;
+	cellPoly(engine, { { -5.0, -5.0 }, { 20.0, -5.0 }, { 20.0, 20.0 }, { -5.0, 20.0 } }, &big);
+	GRID_CHECK(filter->SetAttributePolygon(big, NumericVariant((std::int32_t)9)) == S_OK);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(0, 0)) == 9);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(11, 9)) == 9);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(4, 5)) == 9);
+
+	XY_Poly line;
+	cellPoly(engine, { { 1.0, 1.0 }, { 2.0, 2.0 } }, &line);
+	GRID_CHECK(filter->SetAttributePolygon(line, NumericVariant((std::int32_t)1)) == E_INVALIDARG);
+}
+
+
+static void polyline(GridTestEngine *engine) {
+	auto filter = gridTestFilter(engine, key, 7);
+
+	// along row 8 from cell 1 to cell 9, then down column 9 to row 1
+	XY_Poly path;
+	cellPoly(engine, { { 1.5, 8.5 }, { 9.5, 8.5 }, { 9.5, 1.5 } }, &path);
+	GRID_CHECK(filter->SetAttributePolyline(path, NumericVariant((std::int32_t)5)) == S_OK);
+
+	for (std::uint16_t y = 0; y < engine->m_ysize; y++)
+		for (std::uint16_t x = 0; x < engine->m_xsize; x++) {
+			const bool on = ((y == 8) && (x >= 1) && (x <= 9)) || ((x == 9) && (y >= 1) && (y <= 8));
+			GRID_CHECK(gridTestValue(filter.get(), engine->cell(x, y)) == (on ? 5 : 7));
+		}
+
+	// a single vertex sets just its cell
+	XY_Poly point;
+	cellPoly(engine, { { 3.5, 4.5 } }, &point);
+	GRID_CHECK(filter->SetAttributePolyline(point, NumericVariant((std::int32_t)6)) == S_OK);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(3, 4)) == 6);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(4, 4)) == 7);
+}
+
+
+int main(int argc, char *argv[]) {
+	boost::intrusive_ptr<GridTestEngine> engine(new GridTestEngine(12, 10, 25.0, 500000.0, 6000000.0));
+	polygon(engine.get());
+	polyline(engine.get());
+
+	// and again at a resolution that isn't a whole number of metres
+	engine.reset(new GridTestEngine(12, 10, 12.5, 310000.0, 5400000.0));
+	polygon(engine.get());
+	polyline(engine.get());
+
+	return gridTestFailures() ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+/**
+ * WISE_Grid_Module: AttributeFilterSamplingTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+
+// A filter kept at its own, coarser, resolution and origin is sampled at the centre of each of the grid engine's cells, the same
+// way by point and array queries, and keeps its geometry when it's moved to another grid engine.
+//
+// The coarse layers here have 100m cells, 4 times the size of the grid engine's, and 7 x 6 of them cover the whole grid.  Cell
+// (i, j) holds 10 * i + j, which bilinear sampling reproduces exactly between the cell centres.
+
+static const std::uint16_t key = WISE::GridProto::CwfgmAttributeFilter_DataKey_PC;
+static const double coarseResolution = 100.0;
+static const std::uint16_t coarseX = 7, coarseY = 6;
+
+
+static double coarseValue(std::int32_t i, std::int32_t j) {
+	return 10.0 * i + j;
+}
+
+
+// what nearest sampling gives at pt, for a layer with its lower-left corner at (xll, yll)
+static double nearestAt(const XY_Point &pt, double xll, double yll) {
+	return coarseValue((std::int32_t)floor((pt.x - xll) / coarseResolution), (std::int32_t)floor((pt.y - yll) / coarseResolution));
+}
+
+
+// and bilinear sampling, which past the outer cell centres only has the outer cells to go by
+static double bilinearAt(const XY_Point &pt, double xll, double yll) {
+	const double cx = std::min(std::max((pt.x - xll) / coarseResolution - 0.5, 0.0), (double)(coarseX - 1));
+	const double cy = std::min(std::max((pt.y - yll) / coarseResolution - 0.5, 0.0), (double)(coarseY - 1));
+	return 10.0 * cx + cy;
+}
+
+
+static boost::intrusive_ptr<CCWFGM_AttributeFilter> coarse(GridTestEngine *engine, double xll, double yll, std::uint16_t type,
+    WISE::GridProto::CwfgmAttributeFilter_Sampling sampling, bool hole) {
+	boost::intrusive_ptr<GridTestEngine> layer(new GridTestEngine(coarseX, coarseY, coarseResolution, xll, yll));
+	auto value = [type](double v) { return (type == CCWFGM_AttributeFilter::VT_R8) ? NumericVariant(v) : NumericVariant((std::int32_t)v); };
+	auto filter = gridTestProbe(layer.get(), key, type, value(0.0));
+	for (std::uint16_t j = 0; j < coarseY; j++)
+		for (std::uint16_t i = 0; i < coarseX; i++)
+			GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(layer->cell(i, j), value(coarseValue(i, j)))));
+	if (hole)
+		filter->clearCell(2, 2);
+
+	std::unique_ptr<WISE::GridProto::CwfgmAttributeFilter> proto(filter->serialize(gridTestOptions(true)));
+	proto->mutable_binary()->set_nativeresolution(true);
+	proto->mutable_binary()->set_sampling(sampling);
+	auto loaded = gridTestLoad<CCWFGM_AttributeFilter>(engine, *proto);
+
+	PolymorphicAttribute native;
+	GRID_CHECK(SUCCEEDED(loaded->GetAttribute(CWFGM_GRID_ATTRIBUTE_NATIVE_RESOLUTION, &native)));
+	GRID_CHECK(std::get<bool>(native));
+	return loaded;
+}
+
+
+// the filter's answer at pt, or -9999 if it has no data there
+static double sampled(CCWFGM_AttributeFilter *filter, const XY_Point &pt) {
+	NumericVariant value;
+	grid::AttributeValue valid;
+	double d;
+	const HSS_Time::WTime time(HSS_Time::WTime::GlobalMin());
+	if (FAILED(filter->GetAttributeData(nullptr, pt, time, HSS_Time::WTimeSpan(0LL), key, 0, &value, &valid, nullptr)) ||
+	    (valid == grid::AttributeValue::NOT_SET) || (!variantToDouble(value, &d)))
+		return -9999.0;
+	return d;
+}
+
+
+// checks every cell of engine, by point and array queries, against fcn
+template<typename T, typename Fcn>
+static void checkCells(GridTestEngine *engine, CCWFGM_AttributeFilter *filter, Fcn &&fcn, double tolerance) {
+	boost::multi_array<T, 2> attribute;
+	attribute_t_2d valid;
+	GRID_CHECK(SUCCEEDED(gridTestArray(filter, engine, key, 0, 0, engine->m_xsize - 1, engine->m_ysize - 1, &attribute, &valid)));
+	for (std::uint16_t x = 0; x < engine->m_xsize; x++)
+		for (std::uint16_t y = 0; y < engine->m_ysize; y++) {
+			const double e = fcn(engine->cell(x, y));
+			GRID_CHECK(fabs(sampled(filter, engine->cell(x, y)) - e) <= tolerance);
+			if (e == -9999.0)
+				GRID_CHECK(valid[x][y] == grid::AttributeValue::NOT_SET);
+			else {
+				GRID_CHECK(valid[x][y] == grid::AttributeValue::SET);
+				GRID_CHECK(fabs((double)attribute[x][y] - (double)(T)e) <= tolerance);
+			}
+		}
+}
+
+
+static void nearest(GridTestEngine *engine) {
+	const double xll = engine->m_xllcorner - 30.0, yll = engine->m_yllcorner - 20.0;
+	auto filter = coarse(engine, xll, yll, CCWFGM_AttributeFilter::VT_R8, WISE::GridProto::CwfgmAttributeFilter_Sampling_NEAREST, false);
+
+	GRID_CHECK(sampled(filter.get(), engine->cell(0, 0)) == 0.0);
+	GRID_CHECK(sampled(filter.get(), engine->cell(2, 0)) == 0.0);			// 92.5m into the layer
+	GRID_CHECK(sampled(filter.get(), engine->cell(3, 0)) == 10.0);			// and 117.5m
+	GRID_CHECK(sampled(filter.get(), engine->cell(2, 3)) == 1.0);
+	GRID_CHECK(sampled(filter.get(), engine->cell(23, 19)) == 65.0);
+
+	auto at = [xll, yll](const XY_Point &pt) { return nearestAt(pt, xll, yll); };
+	checkCells<double>(engine, filter.get(), at, 0.0);
+	checkCells<float>(engine, filter.get(), at, 0.0);
+	checkCells<std::int32_t>(engine, filter.get(), at, 0.0);
+
+	// bilinear sampling only applies to floating point layers
+	auto ints = coarse(engine, xll, yll, CCWFGM_AttributeFilter::VT_I4, WISE::GridProto::CwfgmAttributeFilter_Sampling_BILINEAR, false);
+	checkCells<std::int32_t>(engine, ints.get(), at, 0.0);
+}
+
+
+static void bilinear(GridTestEngine *engine) {
+	for (double offset : { 0.0, -30.0 }) {
+		const double xll = engine->m_xllcorner + offset, yll = engine->m_yllcorner + offset * 2.0 / 3.0;
+		auto filter = coarse(engine, xll, yll, CCWFGM_AttributeFilter::VT_R8, WISE::GridProto::CwfgmAttributeFilter_Sampling_BILINEAR, false);
+		auto at = [xll, yll](const XY_Point &pt) { return bilinearAt(pt, xll, yll); };
+		checkCells<double>(engine, filter.get(), at, 1e-9);
+		checkCells<float>(engine, filter.get(), at, 1e-4);
+	}
+
+	const double xll = engine->m_xllcorner - 30.0, yll = engine->m_yllcorner - 20.0;
+	auto filter = coarse(engine, xll, yll, CCWFGM_AttributeFilter::VT_R8, WISE::GridProto::CwfgmAttributeFilter_Sampling_BILINEAR, false);
+	GRID_CHECK(fabs(sampled(filter.get(), engine->cell(0, 0)) - 0.0) < 1e-9);			// outside every centre, so just the corner cell
+	GRID_CHECK(fabs(sampled(filter.get(), engine->cell(5, 7)) - 13.325) < 1e-9);		// 1.175 and 1.575 cells from the first centre
+	GRID_CHECK(fabs(sampled(filter.get(), engine->cell(23, 19)) - 61.325) < 1e-9);
+}
+
+
+static void bilinearHole(GridTestEngine *engine) {
+	const double xll = engine->m_xllcorner - 30.0, yll = engine->m_yllcorner - 20.0;
+	auto filter = coarse(engine, xll, yll, CCWFGM_AttributeFilter::VT_R8, WISE::GridProto::CwfgmAttributeFilter_Sampling_BILINEAR, true);
+
+	// cells 7 to 10 each way lie in the coarse cell with no data, and have none either
+	for (std::uint16_t x = 7; x <= 10; x++)
+		for (std::uint16_t y = 7; y <= 10; y++)
+			GRID_CHECK(sampled(filter.get(), engine->cell(x, y)) == -9999.0);
+
+	// cell (11, 8) is 2.675 and 1.825 cells from the first centre, so it would weigh coarse cells (2, 1), (3, 1), (2, 2) and (3, 2),
+	// and the one with no data is left out
+	const double w21 = 0.325 * 0.175, w31 = 0.675 * 0.175, w32 = 0.675 * 0.825;
+	const double e = (coarseValue(2, 1) * w21 + coarseValue(3, 1) * w31 + coarseValue(3, 2) * w32) / (w21 + w31 + w32);
+	GRID_CHECK(fabs(sampled(filter.get(), engine->cell(11, 8)) - e) < 1e-9);
+
+	// and away from it, nothing changes
+	auto at = [xll, yll](const XY_Point &pt) {
+		const double cx = (pt.x - xll) / coarseResolution, cy = (pt.y - yll) / coarseResolution;
+		if ((cx >= 2.0) && (cx < 3.0) && (cy >= 2.0) && (cy < 3.0))
+			return -9999.0;
+		if ((cx > 1.5) && (cx < 3.5) && (cy > 1.5) && (cy < 3.5))
+			return std::numeric_limits<double>::quiet_NaN();						// next to it, checked above
+		return bilinearAt(pt, xll, yll);
+	};
+	boost::multi_array<double, 2> attribute;
+	attribute_t_2d valid;
+	GRID_CHECK(SUCCEEDED(gridTestArray(filter.get(), engine, key, 0, 0, engine->m_xsize - 1, engine->m_ysize - 1, &attribute, &valid)));
+	for (std::uint16_t x = 0; x < engine->m_xsize; x++)
+		for (std::uint16_t y = 0; y < engine->m_ysize; y++) {
+			const double expected = at(engine->cell(x, y)), point = sampled(filter.get(), engine->cell(x, y));
+			if (expected == -9999.0)
+				GRID_CHECK(valid[x][y] == grid::AttributeValue::NOT_SET);
+			else {
+				GRID_CHECK(valid[x][y] == grid::AttributeValue::SET);
+				GRID_CHECK(attribute[x][y] == point);
+				if (!std::isnan(expected))
+					GRID_CHECK(fabs(point - expected) < 1e-9);
+			}
+		}
+}
+
+
+static void otherGrid(GridTestEngine *engine) {
+	const double xll = engine->m_xllcorner - 30.0, yll = engine->m_yllcorner - 20.0;
+	auto filter = coarse(engine, xll, yll, CCWFGM_AttributeFilter::VT_R8, WISE::GridProto::CwfgmAttributeFilter_Sampling_NEAREST, false);
+
+	// moved to a grid engine with other cells, the layer keeps its own and is sampled at the new ones
+	boost::intrusive_ptr<GridTestEngine> other(new GridTestEngine(10, 8, 50.0, engine->m_xllcorner + 10.0, engine->m_yllcorner + 5.0));
+	GRID_CHECK(SUCCEEDED(filter->PutGridEngine(nullptr, other.get())));
+	PolymorphicAttribute native;
+	GRID_CHECK(SUCCEEDED(filter->GetAttribute(CWFGM_GRID_ATTRIBUTE_NATIVE_RESOLUTION, &native)));
+	GRID_CHECK(std::get<bool>(native));
+
+	auto at = [xll, yll](const XY_Point &pt) { return nearestAt(pt, xll, yll); };
+	checkCells<double>(other.get(), filter.get(), at, 0.0);
+	GRID_CHECK(sampled(filter.get(), other->cell(1, 1)) == 11.0);			// 115m and 100m into the layer
+}
+
+
+int main(int argc, char *argv[]) {
+	boost::intrusive_ptr<GridTestEngine> engine(new GridTestEngine(24, 20, 25.0, 500000.0, 6000000.0));
+
+	nearest(engine.get());
+	bilinear(engine.get());
+	bilinearHole(engine.get());
+	otherGrid(engine.get());
+
+	return gridTestFailures() ? 1 : 0;
+}
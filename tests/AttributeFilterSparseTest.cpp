@@ -0,0 +1,203 @@
+/**
+ * WISE_Grid_Module: AttributeFilterSparseTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include <initializer_list>
+
+// With sparse storage turned on, an attribute filter keeps no cells for tiles which are all NODATA or all one value, setting a
+// cell only expands the tile it's in, and array queries read every kind of tile the same as they would the dense array.
+
+static const std::uint16_t key = WISE::GridProto::CwfgmAttributeFilter_DataKey_PC;
+static const std::size_t tileCells = (std::size_t)GridSparseArray::TILE_SIZE * GridSparseArray::TILE_SIZE;
+
+
+// The 192 x 128 grid used here is 3 x 2 tiles.  By their lower-left cell, tile (0, 0) has no data, (64, 0) holds a few other
+// values and one cell with no data, (128, 64) is all 9's, and the rest are all 7's.
+static std::int32_t expected(std::uint16_t x, std::uint16_t y) {
+	if ((x < 64) && (y < 64))			return -9999;
+	if ((x == 71) && (y == 6))			return -9999;
+	if ((x == 70) && (y == 5))			return 3;
+	if ((x == 100) && (y == 40))		return -2;
+	if ((x >= 128) && (y >= 64))		return 9;
+	return 7;
+}
+
+
+static boost::intrusive_ptr<GridTestAttributeFilter> tiled(GridTestEngine *engine, bool sparse, bool narrow, bool varied = true) {
+	auto filter = gridTestProbe(engine, key, CCWFGM_AttributeFilter::VT_I4, NumericVariant((std::int32_t)7));
+	for (std::uint16_t y = 0; y < 64; y++)
+		for (std::uint16_t x = 0; x < 64; x++)
+			filter->clearCell(x, y);
+	for (std::uint16_t y = 64; y < 128; y++)
+		for (std::uint16_t x = 128; x < 192; x++)
+			GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(x, y), NumericVariant((std::int32_t)9))));
+	if (varied) {
+		GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(70, 5), NumericVariant((std::int32_t)3))));
+		GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(100, 40), NumericVariant((std::int32_t)-2))));
+		filter->clearCell(71, 6);
+	}
+	if (narrow)
+		GRID_CHECK(SUCCEEDED(filter->SetAttribute(CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, true)));
+	if (sparse)
+		GRID_CHECK(SUCCEEDED(filter->SetAttribute(CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE, true)));
+	return filter;
+}
+
+
+static void checkValues(GridTestEngine *engine, CCWFGM_AttributeFilter *filter) {
+	for (std::uint16_t y = 0; y < engine->m_ysize; y++)
+		for (std::uint16_t x = 0; x < engine->m_xsize; x++)
+			GRID_CHECK(gridTestValue(filter, engine->cell(x, y)) == expected(x, y));
+}
+
+
+static void emptyTiles(GridTestEngine *engine) {
+	auto filter = tiled(engine, true, false);
+	GRID_CHECK(filter->sparse() != nullptr);
+	GRID_CHECK(!filter->dense());
+	if (!filter->sparse())
+		return;
+	GRID_CHECK(filter->tileKind(10, 10) == GridSparseArray::TileKind::NODATA);
+	GRID_CHECK(filter->tileKind(70, 10) == GridSparseArray::TileKind::DENSE);
+	GRID_CHECK(filter->tileKind(130, 10) == GridSparseArray::TileKind::CONSTANT);
+	GRID_CHECK(filter->tileKind(10, 70) == GridSparseArray::TileKind::CONSTANT);
+	GRID_CHECK(filter->tileKind(70, 70) == GridSparseArray::TileKind::CONSTANT);
+	GRID_CHECK(filter->tileKind(130, 70) == GridSparseArray::TileKind::CONSTANT);
+	checkValues(engine, filter.get());
+
+	// without the one varied tile nothing holds cells, and that tile holds exactly its cells and their flags
+	auto flat = tiled(engine, true, false, false);
+	GRID_CHECK(flat->sparse() != nullptr);
+	if (!flat->sparse())
+		return;
+	GRID_CHECK(flat->tileKind(70, 10) == GridSparseArray::TileKind::CONSTANT);
+	GRID_CHECK(flat->sparse()->bytes() < tileCells);
+	GRID_CHECK(filter->sparse()->bytes() - flat->sparse()->bytes() == tileCells * (sizeof(std::int32_t) + sizeof(bool)));
+}
+
+
+static void editOneTile(GridTestEngine *engine) {
+	auto filter = tiled(engine, true, false);
+	if (!filter->sparse()) {
+		GRID_CHECK(filter->sparse() != nullptr);
+		return;
+	}
+	boost::intrusive_ptr<ICWFGM_CommonBase> copy;
+	GRID_CHECK(SUCCEEDED(filter->Clone(&copy)));
+	boost::intrusive_ptr<CCWFGM_AttributeFilter> original(dynamic_cast<CCWFGM_AttributeFilter *>(copy.get()));
+	GRID_CHECK(original.get() != nullptr);
+	original->PutGridEngine(nullptr, engine);
+
+	// a CONSTANT tile gains its cells, and nothing else changes
+	std::size_t bytes = filter->sparse()->bytes();
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(100, 100), NumericVariant((std::int32_t)5))));
+	GRID_CHECK((filter->sparse() != nullptr) && (!filter->dense()));
+	if (!filter->sparse())
+		return;
+	GRID_CHECK(filter->tileKind(100, 100) == GridSparseArray::TileKind::DENSE);
+	GRID_CHECK(filter->tileKind(10, 10) == GridSparseArray::TileKind::NODATA);
+	GRID_CHECK(filter->tileKind(10, 70) == GridSparseArray::TileKind::CONSTANT);
+	GRID_CHECK(filter->tileKind(130, 70) == GridSparseArray::TileKind::CONSTANT);
+	GRID_CHECK(filter->sparse()->bytes() == bytes + tileCells * sizeof(std::int32_t));
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(100, 100)) == 5);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(101, 100)) == 7);
+
+	// a NODATA tile gains its cells and their flags, and only the one cell has data
+	bytes = filter->sparse()->bytes();
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(5, 5), NumericVariant((std::int32_t)4))));
+	GRID_CHECK(filter->tileKind(5, 5) == GridSparseArray::TileKind::DENSE);
+	GRID_CHECK(filter->sparse()->bytes() == bytes + tileCells * (sizeof(std::int32_t) + sizeof(bool)));
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(5, 5)) == 4);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(6, 5)) == -9999);
+
+	// and a DENSE tile is changed where it is, including a cell which had no data
+	bytes = filter->sparse()->bytes();
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(80, 20), NumericVariant((std::int32_t)6))));
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(71, 6), NumericVariant((std::int32_t)8))));
+	GRID_CHECK(filter->sparse()->bytes() == bytes);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(80, 20)) == 6);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(71, 6)) == 8);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(70, 5)) == 3);
+
+	// a copy made before the edits still has the original tiles
+	if (original)
+		checkValues(engine, original.get());
+
+	// a narrowed array may not hold the new value, so it goes back to a dense array in OptionType
+	auto narrowed = tiled(engine, true, true);
+	GRID_CHECK(narrowed->storageType() == CCWFGM_AttributeFilter::VT_I1);
+	GRID_CHECK(narrowed->sparse() != nullptr);
+	GRID_CHECK(SUCCEEDED(narrowed->SetAttributePoint(engine->cell(100, 100), NumericVariant((std::int32_t)70000))));
+	GRID_CHECK(narrowed->sparse() == nullptr);
+	GRID_CHECK(narrowed->dense());
+	GRID_CHECK(narrowed->storageType() == CCWFGM_AttributeFilter::VT_I4);
+	GRID_CHECK(gridTestValue(narrowed.get(), engine->cell(100, 100)) == 70000);
+	GRID_CHECK(gridTestValue(narrowed.get(), engine->cell(70, 5)) == 3);
+	GRID_CHECK(gridTestValue(narrowed.get(), engine->cell(5, 5)) == -9999);
+}
+
+
+template<typename T>
+static void spanArray(GridTestEngine *engine, CCWFGM_AttributeFilter *filter, std::uint16_t x0, std::uint16_t y0, std::uint16_t x1, std::uint16_t y1) {
+	boost::multi_array<T, 2> attribute;
+	attribute_t_2d valid;
+	GRID_CHECK(SUCCEEDED(gridTestArray(filter, engine, key, x0, y0, x1, y1, &attribute, &valid)));
+	for (std::uint16_t x = x0; x <= x1; x++)
+		for (std::uint16_t y = y0; y <= y1; y++) {
+			const std::int32_t e = expected(x, y);
+			if (e == -9999)
+				GRID_CHECK(valid[x - x0][y - y0] == grid::AttributeValue::NOT_SET);
+			else {
+				GRID_CHECK(valid[x - x0][y - y0] == grid::AttributeValue::SET);
+				GRID_CHECK(attribute[x - x0][y - y0] == (T)e);
+			}
+		}
+}
+
+
+template<typename T>
+static void spanArrays(GridTestEngine *engine, CCWFGM_AttributeFilter *filter) {
+	spanArray<T>(engine, filter, 0, 0, engine->m_xsize - 1, engine->m_ysize - 1);
+	spanArray<T>(engine, filter, 30, 3, 150, 100);				// starting and ending part way through tiles
+	spanArray<T>(engine, filter, 70, 5, 70, 5);
+}
+
+
+static void typedArrays(GridTestEngine *engine) {
+	auto sparse = tiled(engine, true, false), dense = tiled(engine, false, false), narrowed = tiled(engine, true, true);
+	GRID_CHECK(sparse->sparse() != nullptr);
+	GRID_CHECK(dense->sparse() == nullptr);
+	GRID_CHECK((narrowed->sparse() != nullptr) && (narrowed->storageType() == CCWFGM_AttributeFilter::VT_I1));
+
+	for (CCWFGM_AttributeFilter *filter : { (CCWFGM_AttributeFilter *)sparse.get(), (CCWFGM_AttributeFilter *)dense.get(), (CCWFGM_AttributeFilter *)narrowed.get() }) {
+		spanArrays<double>(engine, filter);
+		spanArrays<float>(engine, filter);
+		spanArrays<std::int32_t>(engine, filter);
+	}
+}
+
+
+int main(int argc, char *argv[]) {
+	boost::intrusive_ptr<GridTestEngine> engine(new GridTestEngine(192, 128, 25.0, 500000.0, 6000000.0));
+
+	emptyTiles(engine.get());
+	editOneTile(engine.get());
+	typedArrays(engine.get());
+
+	return gridTestFailures() ? 1 : 0;
+}
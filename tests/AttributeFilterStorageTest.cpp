@@ -0,0 +1,87 @@
+/**
+ * WISE_Grid_Module: AttributeFilterStorageTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include <memory>
+
+// The storage settings of an attribute filter are saved with it, don't change the values it holds, and changing them marks
+// the filter as needing to be saved.
+
+static const std::uint16_t key = WISE::GridProto::CwfgmAttributeFilter_DataKey_PC;
+
+
+static bool storageSetting(CCWFGM_AttributeFilter *filter, std::uint16_t option) {
+	PolymorphicAttribute value;
+	if (FAILED(filter->GetAttribute(option, &value)))
+		return false;
+	try {
+		return std::get<bool>(value);
+	}
+	catch (std::bad_variant_access &) {
+		return false;
+	}
+}
+
+
+static void roundTrip(GridTestEngine *engine, std::uint16_t option, bool zip) {
+	auto filter = gridTestFilter(engine, key, 7);
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(0, 0), NumericVariant((std::int32_t)1))));
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(5, 3), NumericVariant((std::int32_t)-3))));
+	GRID_CHECK(SUCCEEDED(filter->SetAttribute(option, true)));
+	GRID_CHECK(storageSetting(filter.get(), option));
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(0, 0)) == 1);
+	GRID_CHECK(gridTestValue(filter.get(), engine->cell(5, 3)) == -3);
+
+	std::unique_ptr<WISE::GridProto::CwfgmAttributeFilter> proto(filter->serialize(gridTestOptions(zip)));
+	GRID_CHECK(proto.get() != nullptr);
+	if (option == CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE)
+		GRID_CHECK(proto->binary().has_narrowstorage() && proto->binary().narrowstorage());
+	else
+		GRID_CHECK(proto->binary().has_sparsestorage() && proto->binary().sparsestorage());
+
+	auto loaded = gridTestLoad<CCWFGM_AttributeFilter>(engine, *proto);
+
+	GRID_CHECK(storageSetting(loaded.get(), option));
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(0, 0)) == 1);
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(5, 3)) == -3);
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(11, 9)) == 7);
+
+	// turning it back off is a change to save, and leaves the values alone
+	GRID_CHECK(!loaded->isdirty().value_or(true));
+	GRID_CHECK(SUCCEEDED(loaded->SetAttribute(option, false)));
+	GRID_CHECK(loaded->isdirty().value_or(false));
+	GRID_CHECK(!storageSetting(loaded.get(), option));
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(5, 3)) == -3);
+
+	// and the field is left out, so older files load the same as before
+	proto.reset(loaded->serialize(gridTestOptions(zip)));
+	GRID_CHECK(!proto->binary().has_narrowstorage());
+	GRID_CHECK(!proto->binary().has_sparsestorage());
+}
+
+
+int main(int argc, char *argv[]) {
+	boost::intrusive_ptr<GridTestEngine> engine(new GridTestEngine(12, 10, 25.0, 500000.0, 6000000.0));
+
+	roundTrip(engine.get(), CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, true);
+	roundTrip(engine.get(), CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, false);
+	roundTrip(engine.get(), CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE, true);
+	roundTrip(engine.get(), CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE, false);
+
+	return gridTestFailures() ? 1 : 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * WISE_Grid_Module: AttributeFilterTileTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include "GridTile.h"
+#include <cmath>
+#include <memory>
+
+// A tile cut from an attribute filter loads as a filter of its own, holding the same values at the same places, and
+// remembers where it was cut from.  A tile which doesn't fit the grid it claims to come from is refused.
+
+static const std::uint16_t key = WISE::GridProto::CwfgmAttributeFilter_DataKey_PC;
+
+
+static GridTile upperRightTile(GridTestEngine *engine) {
+	std::vector<GridTile> tiles = PartitionGridTiles(engine->m_xsize, engine->m_ysize, engine->m_xllcorner, engine->m_yllcorner,
+		engine->m_resolution, 6, 1);
+	GRID_CHECK(tiles.size() == 4);
+	return tiles.back();
+}
+
+
+static void roundTrip(GridTestEngine *engine, bool zip) {
+	auto filter = gridTestFilter(engine, key, 7);
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(6, 6), NumericVariant((std::int32_t)4))));		// core
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(5, 5), NumericVariant((std::int32_t)5))));		// halo
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(11, 9), NumericVariant((std::int32_t)6))));
+	GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(4, 3), NumericVariant((std::int32_t)8))));		// outside the tile
+
+	const GridTile tile = upperRightTile(engine);
+	std::unique_ptr<WISE::GridProto::CwfgmAttributeFilter> proto(filter->serializeTile(gridTestOptions(zip), tile));
+	GRID_CHECK(proto.get() != nullptr);
+	if (!proto)
+		return;
+	GRID_CHECK(proto->binary().xsize() == tile.xsize);
+	GRID_CHECK(proto->binary().ysize() == tile.ysize);
+
+	auto loaded = gridTestLoad<CCWFGM_AttributeFilter>(engine, *proto);
+
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(6, 6)) == 4);
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(5, 5)) == 5);
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(11, 9)) == 6);
+	GRID_CHECK(gridTestValue(loaded.get(), engine->cell(8, 7)) == 7);
+
+	GridTile t;
+	GRID_CHECK(loaded->GetTile(&t) == S_OK);
+	GRID_CHECK((t.column == tile.column) && (t.row == tile.row));
+	GRID_CHECK((t.x == tile.x) && (t.y == tile.y) && (t.xsize == tile.xsize) && (t.ysize == tile.ysize));
+	GRID_CHECK((t.coreX == tile.coreX) && (t.coreY == tile.coreY) && (t.coreXSize == tile.coreXSize) && (t.coreYSize == tile.coreYSize));
+	GRID_CHECK((t.fullXSize == tile.fullXSize) && (t.fullYSize == tile.fullYSize));
+	GRID_CHECK(fabs(t.xllcorner - tile.xllcorner) < 0.000001);
+	GRID_CHECK(fabs(t.yllcorner - tile.yllcorner) < 0.000001);
+	GRID_CHECK(fabs(t.resolution - tile.resolution) < 0.000001);
+
+	// a whole filter isn't a tile
+	GRID_CHECK(filter->GetTile(&t) == S_FALSE);
+}
+
+
+static void rejectsCorruptTile(GridTestEngine *engine) {
+	auto filter = gridTestFilter(engine, key, 7);
+	const GridTile tile = upperRightTile(engine);
+
+	std::unique_ptr<WISE::GridProto::CwfgmAttributeFilter> proto(filter->serializeTile(gridTestOptions(true), tile));
+	GRID_CHECK(proto.get() != nullptr);
+	if (!proto)
+		return;
+	proto->mutable_binary()->mutable_tile()->set_xoffset(tile.fullXSize);
+
+	GRID_CHECK_THROWS(gridTestLoad<CCWFGM_AttributeFilter>(engine, *proto), ISerializeProto::DeserializeError);
+
+	proto.reset(filter->serializeTile(gridTestOptions(true), tile));
+	proto->mutable_binary()->mutable_tile()->set_corexsize(tile.xsize + 1);
+	GRID_CHECK_THROWS(gridTestLoad<CCWFGM_AttributeFilter>(engine, *proto), ISerializeProto::DeserializeError);
+}
+
+
+int main(int argc, char *argv[]) {
+	boost::intrusive_ptr<GridTestEngine> engine(new GridTestEngine(12, 10, 25.0, 500000.0, 6000000.0));
+
+	roundTrip(engine.get(), true);
+	roundTrip(engine.get(), false);
+	rejectsCorruptTile(engine.get());
+
+	return gridTestFailures() ? 1 : 0;
+}
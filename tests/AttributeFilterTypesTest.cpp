@@ -0,0 +1,228 @@
+/**
+ * WISE_Grid_Module: AttributeFilterTypesTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// For every OptionType, a cell reads back exactly what was set in it however the array is held, and the typed array queries give
+// the same cells as point queries, converted to the caller's type, with cells that don't fit in it (or have no data) marked as not set.
+
+static const std::uint16_t key = WISE::GridProto::CwfgmAttributeFilter_DataKey_PC;
+
+
+struct TypeCase {
+	std::uint16_t				type;
+	NumericVariant				fill;
+	std::vector<NumericVariant>	values;			// set on cells along a diagonal, including each type's extremes
+};
+
+
+static std::vector<TypeCase> typeCases() {
+	return {
+		{ CCWFGM_AttributeFilter::VT_BOOL, NumericVariant(false), { NumericVariant(true) } },
+		{ CCWFGM_AttributeFilter::VT_I1, NumericVariant((std::int8_t)-3),
+			{ NumericVariant(std::numeric_limits<std::int8_t>::min()), NumericVariant(std::numeric_limits<std::int8_t>::max()), NumericVariant((std::int8_t)0) } },
+		{ CCWFGM_AttributeFilter::VT_I2, NumericVariant((std::int16_t)1000),
+			{ NumericVariant(std::numeric_limits<std::int16_t>::min()), NumericVariant(std::numeric_limits<std::int16_t>::max()) } },
+		{ CCWFGM_AttributeFilter::VT_I4, NumericVariant((std::int32_t)-7),
+			{ NumericVariant(std::numeric_limits<std::int32_t>::min()), NumericVariant(std::numeric_limits<std::int32_t>::max()) } },
+		{ CCWFGM_AttributeFilter::VT_I8, NumericVariant((std::int64_t)5),
+			{ NumericVariant((std::int64_t)1 << 40), NumericVariant(-((std::int64_t)1 << 40)), NumericVariant((std::int64_t)std::numeric_limits<std::int32_t>::min()),
+			  NumericVariant((std::int64_t)std::numeric_limits<std::int32_t>::max() + 1) } },
+		{ CCWFGM_AttributeFilter::VT_UI1, NumericVariant((std::uint8_t)200), { NumericVariant(std::numeric_limits<std::uint8_t>::max()), NumericVariant((std::uint8_t)0) } },
+		{ CCWFGM_AttributeFilter::VT_UI2, NumericVariant((std::uint16_t)7), { NumericVariant(std::numeric_limits<std::uint16_t>::max()) } },
+		{ CCWFGM_AttributeFilter::VT_UI4, NumericVariant((std::uint32_t)9),
+			{ NumericVariant((std::uint32_t)4000000000u), NumericVariant((std::uint32_t)std::numeric_limits<std::int32_t>::max()) } },
+		{ CCWFGM_AttributeFilter::VT_UI8, NumericVariant((std::uint64_t)12), { NumericVariant((std::uint64_t)1 << 50), NumericVariant((std::uint64_t)2147483647u) } },
+		{ CCWFGM_AttributeFilter::VT_R4, NumericVariant(0.5f),
+			{ NumericVariant(-1.5f), NumericVariant(3.25e9f), NumericVariant(0.001f), NumericVariant(2147483520.0f), NumericVariant(-2147483648.0f) } },
+		{ CCWFGM_AttributeFilter::VT_R8, NumericVariant(-2.75),
+			{ NumericVariant(1e30), NumericVariant(-2147483648.5), NumericVariant(2147483647.9), NumericVariant(-0.25), NumericVariant(1.0 / 3.0) } }
+	};
+}
+
+
+static boost::intrusive_ptr<GridTestAttributeFilter> typedFilter(GridTestEngine *engine, const TypeCase &c) {
+	auto filter = gridTestProbe(engine, key, c.type, c.fill);
+	for (std::size_t i = 0; i < c.values.size(); i++)
+		GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell((std::uint16_t)(i + 1), (std::uint16_t)(i + 2)), c.values[i])));
+	filter->clearCell(0, 0);
+	filter->clearCell(engine->m_xsize - 1, engine->m_ysize - 1);
+	return filter;
+}
+
+
+// the point query at pt, as a double, or false if it has no data
+static bool pointValue(CCWFGM_AttributeFilter *filter, std::uint16_t type, const XY_Point &pt, double *d) {
+	NumericVariant value;
+	grid::AttributeValue valid;
+	const HSS_Time::WTime time(HSS_Time::WTime::GlobalMin());
+	if (FAILED(filter->GetAttributeData(nullptr, pt, time, HSS_Time::WTimeSpan(0LL), key, 0, &value, &valid, nullptr)) ||
+	    (valid == grid::AttributeValue::NOT_SET))
+		return false;
+	if (type == CCWFGM_AttributeFilter::VT_BOOL) {
+		bool b;
+		GRID_CHECK(variantToBoolean(value, &b));
+		*d = b ? 1.0 : 0.0;
+		return true;
+	}
+	GRID_CHECK(variantToDouble(value, d));
+	return true;
+}
+
+
+static double asDouble(std::uint16_t type, const NumericVariant &value) {
+	double d = -9999.0;
+	if (type == CCWFGM_AttributeFilter::VT_BOOL) {
+		bool b;
+		GRID_CHECK(variantToBoolean(value, &b));
+		d = b ? 1.0 : 0.0;
+	}
+	else
+		GRID_CHECK(variantToDouble(value, &d));
+	return d;
+}
+
+
+// every cell typedFilter() set reads back as it was set, the fill everywhere else, and the cleared cells have no data
+static void readsBack(GridTestEngine *engine, CCWFGM_AttributeFilter *filter, const TypeCase &c) {
+	double d;
+	for (std::size_t i = 0; i < c.values.size(); i++)
+		GRID_CHECK(pointValue(filter, c.type, engine->cell((std::uint16_t)(i + 1), (std::uint16_t)(i + 2)), &d) && (d == asDouble(c.type, c.values[i])));
+	GRID_CHECK(pointValue(filter, c.type, engine->cell(8, 1), &d) && (d == asDouble(c.type, c.fill)));
+	GRID_CHECK(!pointValue(filter, c.type, engine->cell(0, 0), &d));
+	GRID_CHECK(!pointValue(filter, c.type, engine->cell(engine->m_xsize - 1, engine->m_ysize - 1), &d));
+}
+
+
+static void accessors(GridTestEngine *engine) {
+	for (const TypeCase &c : typeCases()) {
+		auto filter = typedFilter(engine, c);
+		readsBack(engine, filter.get(), c);
+
+		// copies and reloaded filters bind their own accessors
+		boost::intrusive_ptr<ICWFGM_CommonBase> copy;
+		GRID_CHECK(SUCCEEDED(filter->Clone(&copy)));
+		boost::intrusive_ptr<CCWFGM_AttributeFilter> clone(dynamic_cast<CCWFGM_AttributeFilter *>(copy.get()));
+		GRID_CHECK(clone.get() != nullptr);
+		if (clone) {
+			clone->PutGridEngine(nullptr, engine);
+			readsBack(engine, clone.get(), c);
+		}
+		auto reloaded = gridTestReload(filter.get(), engine, false);
+		readsBack(engine, reloaded.get(), c);
+
+		// as do sparse and narrowed arrays, which go back to OptionType when set
+		GRID_CHECK(SUCCEEDED(filter->SetAttribute(CWFGM_GRID_ATTRIBUTE_SPARSE_STORAGE, true)));
+		readsBack(engine, filter.get(), c);
+		GRID_CHECK(SUCCEEDED(filter->SetAttribute(CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, true)));
+		readsBack(engine, filter.get(), c);
+		GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(8, 1), c.fill)));
+		readsBack(engine, filter.get(), c);
+		for (std::size_t i = 0; i < c.values.size(); i++)
+			GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell((std::uint16_t)(i + 1), (std::uint16_t)(i + 2)), c.values[i])));
+		readsBack(engine, filter.get(), c);
+
+		// and changing OptionType rebinds them to the new type
+		double d;
+		GRID_CHECK(SUCCEEDED(filter->put_OptionType(CCWFGM_AttributeFilter::VT_R8)));
+		GRID_CHECK(!pointValue(filter.get(), CCWFGM_AttributeFilter::VT_R8, engine->cell(8, 1), &d));
+		GRID_CHECK(SUCCEEDED(filter->ResetAttribute(NumericVariant(0.125))));
+		GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(3, 3), NumericVariant(-1.0e10))));
+		GRID_CHECK(pointValue(filter.get(), CCWFGM_AttributeFilter::VT_R8, engine->cell(8, 1), &d) && (d == 0.125));
+		GRID_CHECK(pointValue(filter.get(), CCWFGM_AttributeFilter::VT_R8, engine->cell(3, 3), &d) && (d == -1.0e10));
+	}
+}
+
+
+template<typename T>
+static bool fits(double d) {
+	if constexpr (std::is_integral_v<T>)
+		return (d >= (double)std::numeric_limits<T>::min()) && (d < (double)std::numeric_limits<T>::max() + 1.0);
+	else
+		return true;
+}
+
+
+template<typename T>
+static void typedArray(GridTestEngine *engine, CCWFGM_AttributeFilter *filter, std::uint16_t type, std::uint16_t x0, std::uint16_t y0,
+    std::uint16_t x1, std::uint16_t y1) {
+	boost::multi_array<T, 2> attribute;
+	attribute_t_2d valid;
+	GRID_CHECK(SUCCEEDED(gridTestArray(filter, engine, key, x0, y0, x1, y1, &attribute, &valid)));
+	for (std::uint16_t x = x0; x <= x1; x++)
+		for (std::uint16_t y = y0; y <= y1; y++) {
+			double d;
+			if ((!pointValue(filter, type, engine->cell(x, y), &d)) || (!fits<T>(d)))
+				GRID_CHECK(valid[x - x0][y - y0] == grid::AttributeValue::NOT_SET);
+			else {
+				GRID_CHECK(valid[x - x0][y - y0] == grid::AttributeValue::SET);
+				GRID_CHECK(attribute[x - x0][y - y0] == (T)d);
+			}
+		}
+}
+
+
+static void variantArray(GridTestEngine *engine, CCWFGM_AttributeFilter *filter, std::uint16_t type) {
+	NumericVariant_2d attribute;
+	attribute_t_2d valid;
+	GRID_CHECK(SUCCEEDED(gridTestArray(filter, engine, key, 0, 0, engine->m_xsize - 1, engine->m_ysize - 1, &attribute, &valid)));
+	for (std::uint16_t x = 0; x < engine->m_xsize; x++)
+		for (std::uint16_t y = 0; y < engine->m_ysize; y++) {
+			double d, e;
+			if (!pointValue(filter, type, engine->cell(x, y), &d))
+				GRID_CHECK(valid[x][y] == grid::AttributeValue::NOT_SET);
+			else {
+				GRID_CHECK(valid[x][y] == grid::AttributeValue::SET);
+				if (type == CCWFGM_AttributeFilter::VT_BOOL) {
+					bool b;
+					GRID_CHECK(variantToBoolean(attribute[x][y], &b) && ((b ? 1.0 : 0.0) == d));
+				}
+				else
+					GRID_CHECK(variantToDouble(attribute[x][y], &e) && (e == d));
+			}
+		}
+}
+
+
+static void typedArrays(GridTestEngine *engine) {
+	for (const TypeCase &c : typeCases()) {
+		auto filter = typedFilter(engine, c);
+		for (const bool whole : { true, false }) {
+			const std::uint16_t x0 = whole ? 0 : 1, y0 = whole ? 0 : 2;
+			const std::uint16_t x1 = whole ? engine->m_xsize - 1 : 6, y1 = whole ? engine->m_ysize - 1 : 7;
+			typedArray<double>(engine, filter.get(), c.type, x0, y0, x1, y1);
+			typedArray<float>(engine, filter.get(), c.type, x0, y0, x1, y1);
+			typedArray<std::int32_t>(engine, filter.get(), c.type, x0, y0, x1, y1);
+		}
+		variantArray(engine, filter.get(), c.type);
+	}
+}
+
+
+int main(int argc, char *argv[]) {
+	boost::intrusive_ptr<GridTestEngine> engine(new GridTestEngine(12, 10, 25.0, 500000.0, 6000000.0));
+
+	accessors(engine.get());
+	typedArrays(engine.get());
+
+	return gridTestFailures() ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * WISE_Grid_Module: GridArrayEncodingTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include "GridArrayEncoding.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Fuel and elevation arrays are only written encoded when the caller asks for it, and the encodings are lossless.
+
+
+static void saveIsOptIn() {
+	GRID_CHECK(!GridArrayEncoding::saveEncoded());
+	{
+		GridArrayEncodingScope scope;
+		GRID_CHECK(GridArrayEncoding::saveEncoded());
+		{
+			GridArrayEncodingScope inner(false);
+			GRID_CHECK(!GridArrayEncoding::saveEncoded());
+		}
+		GRID_CHECK(GridArrayEncoding::saveEncoded());
+	}
+	GRID_CHECK(!GridArrayEncoding::saveEncoded());
+}
+
+
+static void fuelRoundTrip() {
+	const std::uint16_t xsize = 40, ysize = 30;
+	const std::uint64_t size = (std::uint64_t)xsize * ysize;
+	std::vector<std::uint8_t> fuel(size);
+	std::unique_ptr<bool[]> valid(new bool[size]);
+	for (std::uint64_t i = 0; i < size; i++) {
+		valid[i] = ((i % 97) != 0) && ((i < 300) || (i > 340));
+		fuel[i] = valid[i] ? (std::uint8_t)((i / 13) % 5) : (std::uint8_t)-1;
+	}
+
+	const std::string encoded = GridArrayEncoding::encodeFuel(fuel.data(), valid.get(), size);
+
+	std::vector<std::uint8_t> fuel2(size);
+	std::unique_ptr<bool[]> valid2(new bool[size]);
+	GRID_CHECK(GridArrayEncoding::decodeFuel(encoded, fuel2.data(), valid2.get(), size));
+	GRID_CHECK(fuel2 == fuel);
+	GRID_CHECK(std::equal(valid.get(), valid.get() + size, valid2.get()));
+
+	// the wrong number of cells is refused rather than under- or over-filling the arrays
+	GRID_CHECK(!GridArrayEncoding::decodeFuel(encoded, fuel2.data(), valid2.get(), size - 1));
+	GRID_CHECK(!GridArrayEncoding::decodeFuel(encoded.substr(0, encoded.length() / 2), fuel2.data(), valid2.get(), size));
+}
+
+
+static void elevationRoundTrip() {
+	const std::uint16_t xsize = 40, ysize = 30;
+	const std::uint64_t size = (std::uint64_t)xsize * ysize;
+	std::vector<std::int16_t> elevation(size);
+	for (std::uint64_t i = 0; i < size; i++)
+		elevation[i] = (std::int16_t)(1200 + (std::int32_t)(i % xsize) * 3 - (std::int32_t)(i / xsize) * 7 + ((i % 11) ? 0 : -2500));
+
+	const std::string encoded = GridArrayEncoding::encodeRowDelta(elevation.data(), xsize, ysize);
+
+	std::vector<std::int16_t> elevation2(size);
+	GRID_CHECK(GridArrayEncoding::decodeRowDelta(encoded, elevation2.data(), xsize, ysize));
+	GRID_CHECK(elevation2 == elevation);
+
+	GRID_CHECK(!GridArrayEncoding::decodeRowDelta(encoded, elevation2.data(), xsize, ysize + 1));
+	GRID_CHECK(!GridArrayEncoding::decodeRowDelta(encoded.substr(1), elevation2.data(), xsize, ysize));
+}
+
+
+int main(int argc, char *argv[]) {
+	saveIsOptIn();
+	fuelRoundTrip();
+	elevationRoundTrip();
+
+	return gridTestFailures() ? 1 : 0;
+}
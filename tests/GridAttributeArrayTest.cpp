@@ -0,0 +1,159 @@
+/**
+ * WISE_Grid_Module: GridAttributeArrayTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include "GridAttributeArray.h"
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// Filling and copying a grid array on the worker threads reaches every cell, whatever share of the rows the last thread is left
+// with, and writes nothing past the end of the array.  ResetAttribute() and copying a filter, which use them, do the same.
+
+static const std::uint16_t key = WISE::GridProto::CwfgmAttributeFilter_DataKey_PC;
+static const std::size_t guard = 64;						// elements past the end of each array, which must be left alone
+static const std::uint8_t sentinel = 0xa5;
+
+// grids of one row, one column, a prime number of rows (which no thread count divides), and more rows than threads
+static const std::pair<std::uint16_t, std::uint16_t> sizes[] = { { 1, 1 }, { 37, 1 }, { 1, 37 }, { 5, 3 }, { 37, 23 }, { 257, 131 } };
+
+
+static bool guarded(const std::vector<std::uint8_t> &bytes, std::size_t used) {
+	for (std::size_t i = used; i < bytes.size(); i++)
+		if (bytes[i] != sentinel)
+			return false;
+	return true;
+}
+
+
+// a value of element_size bytes, different in every byte so a cell left partly written shows
+static void element(std::uint32_t element_size, std::size_t index, std::uint8_t *value) {
+	for (std::uint32_t b = 0; b < element_size; b++)
+		value[b] = (std::uint8_t)(index * 7 + b * 31 + 1);
+}
+
+
+static void fillArrays() {
+	for (const auto &size : sizes) {
+		const std::size_t cells = (std::size_t)size.first * size.second;
+		for (std::uint32_t element_size : { 1u, 2u, 4u, 8u }) {
+			std::vector<std::uint8_t> array((cells + guard) * element_size, sentinel), nodata(cells + guard, sentinel);
+			std::uint8_t value[8];
+			element(element_size, 3, value);
+
+			FillAttributeArray(array.data(), element_size, value, reinterpret_cast<bool *>(nodata.data()), true, size.first, size.second);
+			std::size_t wrong = 0;
+			for (std::size_t i = 0; i < cells; i++)
+				if ((memcmp(&array[i * element_size], value, element_size)) || (!reinterpret_cast<bool *>(nodata.data())[i]))
+					wrong++;
+			GRID_CHECK(wrong == 0);
+			GRID_CHECK(guarded(array, cells * element_size));
+			GRID_CHECK(guarded(nodata, cells));
+
+			// either array can be left out
+			std::fill(nodata.begin(), nodata.end(), sentinel);
+			FillAttributeArray(nullptr, element_size, value, reinterpret_cast<bool *>(nodata.data()), false, size.first, size.second);
+			GRID_CHECK(std::count(nodata.begin(), nodata.begin() + cells, (std::uint8_t)false) == (std::ptrdiff_t)cells);
+			GRID_CHECK(guarded(nodata, cells));
+			std::fill(array.begin(), array.end(), sentinel);
+			FillAttributeArray(array.data(), element_size, value, nullptr, false, size.first, size.second);
+			GRID_CHECK(memcmp(&array[(cells - 1) * element_size], value, element_size) == 0);
+			GRID_CHECK(guarded(array, cells * element_size));
+		}
+	}
+}
+
+
+static void copyArrays() {
+	for (const auto &size : sizes) {
+		const std::size_t cells = (std::size_t)size.first * size.second;
+		for (std::uint32_t element_size : { 1u, 2u, 4u, 8u }) {
+			std::vector<std::uint8_t> src(cells * element_size), src_nodata(cells);
+			for (std::size_t i = 0; i < cells; i++) {
+				element(element_size, i, &src[i * element_size]);
+				src_nodata[i] = (i % 3) == 0;
+			}
+			std::vector<std::uint8_t> dest((cells + guard) * element_size, sentinel), dest_nodata(cells + guard, sentinel);
+
+			CopyAttributeArray(dest.data(), src.data(), element_size, reinterpret_cast<bool *>(dest_nodata.data()),
+				reinterpret_cast<const bool *>(src_nodata.data()), size.first, size.second);
+			GRID_CHECK(memcmp(dest.data(), src.data(), cells * element_size) == 0);
+			GRID_CHECK(memcmp(dest_nodata.data(), src_nodata.data(), cells) == 0);
+			GRID_CHECK(guarded(dest, cells * element_size));
+			GRID_CHECK(guarded(dest_nodata, cells));
+		}
+	}
+}
+
+
+// ResetAttribute() fills the whole of every type of array, over any cells set or cleared before, and a copy of the filter has all of it
+static void resetFilter() {
+	static const std::pair<std::uint16_t, NumericVariant> fills[] = {
+		{ CCWFGM_AttributeFilter::VT_BOOL, NumericVariant(true) },
+		{ CCWFGM_AttributeFilter::VT_I1, NumericVariant((std::int8_t)-9) },
+		{ CCWFGM_AttributeFilter::VT_UI2, NumericVariant((std::uint16_t)40000) },
+		{ CCWFGM_AttributeFilter::VT_I4, NumericVariant((std::int32_t)-123456) },
+		{ CCWFGM_AttributeFilter::VT_R4, NumericVariant(6.5f) },
+		{ CCWFGM_AttributeFilter::VT_I8, NumericVariant((std::int64_t)3000000) },
+		{ CCWFGM_AttributeFilter::VT_R8, NumericVariant(-0.375) }
+	};
+
+	for (const auto &size : sizes) {
+		boost::intrusive_ptr<GridTestEngine> engine(new GridTestEngine(size.first, size.second, 25.0, 500000.0, 6000000.0));
+		for (const auto &fill : fills) {
+			double d = 1.0;
+			if (fill.first != CCWFGM_AttributeFilter::VT_BOOL)
+				GRID_CHECK(variantToDouble(fill.second, &d));
+
+			auto filter = gridTestProbe(engine.get(), key, fill.first, NumericVariant((std::int8_t)0));
+			GRID_CHECK(SUCCEEDED(filter->SetAttributePoint(engine->cell(0, 0), NumericVariant((std::int8_t)1))));
+			filter->clearCell(size.first - 1, size.second - 1);
+			GRID_CHECK(SUCCEEDED(filter->ResetAttribute(fill.second)));
+
+			boost::intrusive_ptr<ICWFGM_CommonBase> copy;
+			GRID_CHECK(SUCCEEDED(filter->Clone(&copy)));
+			boost::intrusive_ptr<CCWFGM_AttributeFilter> clone(dynamic_cast<CCWFGM_AttributeFilter *>(copy.get()));
+			GRID_CHECK(clone.get() != nullptr);
+			if (clone)
+				clone->PutGridEngine(nullptr, engine.get());
+
+			for (CCWFGM_AttributeFilter *f : { (CCWFGM_AttributeFilter *)filter.get(), clone.get() }) {
+				if (!f)
+					continue;
+				boost::multi_array<double, 2> attribute;
+				attribute_t_2d valid;
+				GRID_CHECK(SUCCEEDED(gridTestArray(f, engine.get(), key, 0, 0, size.first - 1, size.second - 1, &attribute, &valid)));
+				std::size_t wrong = 0;
+				for (std::uint16_t x = 0; x < size.first; x++)
+					for (std::uint16_t y = 0; y < size.second; y++)
+						if ((valid[x][y] != grid::AttributeValue::SET) || (attribute[x][y] != d))
+							wrong++;
+				GRID_CHECK(wrong == 0);
+			}
+		}
+	}
+}
+
+
+int main(int argc, char *argv[]) {
+	fillArrays();
+	copyArrays();
+	resetFilter();
+
+	return gridTestFailures() ? 1 : 0;
+}
@@ -0,0 +1,216 @@
+/**
+ * WISE_Grid_Module: GridTestSupport.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "CWFGM_AttributeFilter.h"
+#include "GridCom_ext.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <boost/intrusive_ptr.hpp>
+
+/**
+ * Shared pieces of the grid library's tests.  Each test is a plain executable which returns non-zero if any GRID_CHECK()
+ * failed, so it runs under ctest without a test framework.
+ */
+
+inline int &gridTestFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+#define GRID_CHECK(cond)	do { if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); gridTestFailures()++; } } while (0)
+
+#define GRID_CHECK_THROWS(expr, type)	do { bool thrown = false; try { expr; } catch (type &) { thrown = true; } \
+											 if (!thrown) { fprintf(stderr, "%s:%d: expected %s from: %s\n", __FILE__, __LINE__, #type, #expr); gridTestFailures()++; } } while (0)
+
+
+/**
+ * Stand-in for the grid at the bottom of a layer stack, so filters can be set up without importing a landscape.  It only
+ * answers the geometry queries the filters make, and gives m_attribute for every attribute query which reaches it, counting
+ * them in m_attributeQueries so a test can tell which queries a filter passed down rather than answering itself.
+ */
+class GridTestEngine : public ICWFGM_GridEngine {
+public:
+	GridTestEngine(std::uint16_t xsize, std::uint16_t ysize, double resolution, double xllcorner, double yllcorner)
+		: m_xsize(xsize), m_ysize(ysize), m_resolution(resolution), m_xllcorner(xllcorner), m_yllcorner(yllcorner),
+		  m_attribute((std::int32_t)-55), m_attributeQueries(0) { }
+
+	virtual NO_THROW HRESULT Clone(boost::intrusive_ptr<ICWFGM_CommonBase> *newObject) const	{ return E_NOTIMPL; }
+
+	virtual HRESULT MT_Lock(Layer *layerThread, bool exclusive, std::uint16_t obtain) override	{ return S_OK; }
+
+	virtual HRESULT GetAttribute(Layer *layerThread, std::uint16_t option, PolymorphicAttribute *value) override {
+		if (!value)									return E_POINTER;
+		switch (option) {
+			case CWFGM_GRID_ATTRIBUTE_PLOTRESOLUTION:	*value = m_resolution; return S_OK;
+			case CWFGM_GRID_ATTRIBUTE_XLLCORNER:		*value = m_xllcorner; return S_OK;
+			case CWFGM_GRID_ATTRIBUTE_YLLCORNER:		*value = m_yllcorner; return S_OK;
+		}
+		return E_INVALIDARG;
+	}
+
+	virtual HRESULT GetDimensions(Layer *layerThread, std::uint16_t *x_dim, std::uint16_t *y_dim) override {
+		if ((!x_dim) || (!y_dim))					return E_POINTER;
+		*x_dim = m_xsize;
+		*y_dim = m_ysize;
+		return S_OK;
+	}
+
+	virtual HRESULT GetAttributeData(Layer *layerThread, const XY_Point &pt, const HSS_Time::WTime &time, const HSS_Time::WTimeSpan &timeSpan, std::uint16_t option,
+	    std::uint64_t optionFlags, NumericVariant *attribute, grid::AttributeValue *attribute_valid, XY_Rectangle *cache_bbox) override {
+		m_attributeQueries++;
+		if ((!attribute) || (!attribute_valid))		return E_POINTER;
+		*attribute = m_attribute;
+		*attribute_valid = grid::AttributeValue::SET;
+		return S_OK;
+	}
+
+	using ICWFGM_GridEngine::GetAttributeDataArray;			// the typed versions convert this one's output
+	virtual HRESULT GetAttributeDataArray(Layer *layerThread, const XY_Point &min_pt, const XY_Point &max_pt, double scale, const HSS_Time::WTime &time,
+	    const HSS_Time::WTimeSpan &timeSpan, std::uint16_t option, std::uint64_t optionFlags, NumericVariant_2d *attribute, attribute_t_2d *attribute_valid) override {
+		m_attributeQueries++;
+		if ((!attribute) || (!attribute_valid))		return E_POINTER;
+		std::fill_n(attribute->data(), attribute->num_elements(), m_attribute);
+		std::fill_n(attribute_valid->data(), attribute_valid->num_elements(), grid::AttributeValue::SET);
+		return S_OK;
+	}
+
+	/**
+		World location of the centre of cell (x, y), counted from the lower-left cell.
+	*/
+	XY_Point cell(std::uint16_t x, std::uint16_t y) const {
+		return XY_Point(m_xllcorner + ((double)x + 0.5) * m_resolution, m_yllcorner + ((double)y + 0.5) * m_resolution);
+	}
+
+	std::uint16_t	m_xsize, m_ysize;
+	double			m_resolution, m_xllcorner, m_yllcorner;
+	NumericVariant	m_attribute;
+	std::uint32_t	m_attributeQueries;
+};
+
+
+/**
+ * Attribute filter which shows how its array is held, so a test can check that the storage options actually change it rather
+ * than only that the values survive.
+ */
+class GridTestAttributeFilter : public CCWFGM_AttributeFilter {
+public:
+	std::uint16_t storageType() const						{ return m_storageType; }
+	double storageScale() const								{ return m_storageScale; }
+	bool dense() const										{ return m_array_i1 != nullptr; }
+	const GridSparseArray *sparse() const					{ return m_sparse.get(); }
+	GridSparseArray::TileKind tileKind(std::uint16_t x, std::uint16_t y) const	{ return m_sparse->span(arrayIndex(x, y), 1).kind; }
+
+	/**
+		Marks cell (x, y) as having no data.  The array must be dense, and have a nodata array (as ResetAttribute() leaves it).
+	*/
+	void clearCell(std::uint16_t x, std::uint16_t y) {
+		if (m_array_nodata)
+			m_array_nodata[arrayIndex(x, y)] = true;
+		discardDeferred();
+	}
+};
+
+
+inline SerializeProtoOptions gridTestOptions(bool zip) {
+	SerializeProtoOptions options;
+	options.setFileVersion(2);
+	options.setZipOutput(zip);
+	return options;
+}
+
+
+/**
+	Loads proto into a new filter of class Filter, on engine if there is one.
+*/
+template<class Filter, class Proto>
+inline boost::intrusive_ptr<Filter> gridTestLoad(GridTestEngine *engine, const Proto &proto) {
+	boost::intrusive_ptr<Filter> loaded(new Filter());
+	if (engine)
+		loaded->PutGridEngine(nullptr, engine);
+	loaded->deserialize(proto, nullptr, "filter");
+	return loaded;
+}
+
+
+/**
+	Saves filter, zipped or not, and loads the result into a new filter on engine.
+*/
+template<class Filter>
+inline boost::intrusive_ptr<Filter> gridTestReload(Filter *filter, GridTestEngine *engine, bool zip) {
+	std::unique_ptr<google::protobuf::Message> proto(filter->serialize(gridTestOptions(zip)));
+	return gridTestLoad<Filter>(engine, *proto);
+}
+
+
+/**
+	A filter on engine holding a VT_I4 grid, with every cell set to fill.
+*/
+inline boost::intrusive_ptr<CCWFGM_AttributeFilter> gridTestFilter(GridTestEngine *engine, std::uint16_t key, std::int32_t fill) {
+	boost::intrusive_ptr<CCWFGM_AttributeFilter> filter(new CCWFGM_AttributeFilter());
+	filter->PutGridEngine(nullptr, engine);
+	filter->put_OptionKey(key);
+	filter->put_OptionType(CCWFGM_AttributeFilter::VT_I4);
+	filter->ResetAttribute(NumericVariant(fill));
+	return filter;
+}
+
+
+/**
+	A GridTestAttributeFilter on engine holding a grid of type, with every cell set to fill.
+*/
+inline boost::intrusive_ptr<GridTestAttributeFilter> gridTestProbe(GridTestEngine *engine, std::uint16_t key, std::uint16_t type, const NumericVariant &fill) {
+	boost::intrusive_ptr<GridTestAttributeFilter> filter(new GridTestAttributeFilter());
+	filter->PutGridEngine(nullptr, engine);
+	filter->put_OptionKey(key);
+	filter->put_OptionType(type);
+	filter->ResetAttribute(fill);
+	return filter;
+}
+
+
+/**
+	The value of the cell of filter at pt, or fallback if it has no data there.
+*/
+inline std::int32_t gridTestValue(CCWFGM_AttributeFilter *filter, const XY_Point &pt, std::int32_t fallback = -9999) {
+	NumericVariant value;
+	grid::AttributeValue valid;
+	if (FAILED(filter->GetAttributePoint(pt, &value, &valid)) || (valid != grid::AttributeValue::SET))
+		return fallback;
+	std::int32_t v;
+	if (!variantToInt32(value, &v))
+		return fallback;
+	return v;
+}
+
+
+/**
+	Queries option from filter for cells (x0, y0) to (x1, y1) of engine, inclusive, sizing attribute and valid to fit.
+*/
+template<typename T>
+inline HRESULT gridTestArray(ICWFGM_GridEngine *filter, GridTestEngine *engine, std::uint16_t option, std::uint16_t x0, std::uint16_t y0,
+    std::uint16_t x1, std::uint16_t y1, boost::multi_array<T, 2> *attribute, attribute_t_2d *valid) {
+	attribute->resize(boost::extents[x1 - x0 + 1][y1 - y0 + 1]);
+	valid->resize(boost::extents[x1 - x0 + 1][y1 - y0 + 1]);
+	const HSS_Time::WTime time(HSS_Time::WTime::GlobalMin());
+	return filter->GetAttributeDataArray(nullptr, engine->cell(x0, y0), engine->cell(x1, y1), engine->m_resolution, time, HSS_Time::WTimeSpan(0LL),
+		option, 0, attribute, valid);
+}
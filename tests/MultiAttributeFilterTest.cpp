@@ -0,0 +1,135 @@
+/**
+ * WISE_Grid_Module: MultiAttributeFilterTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include "CWFGM_MultiAttributeFilter.h"
+#include <memory>
+
+// A multi-band filter answers queries for its bands' option keys from those bands, and passes every other query down to the
+// layer below it, the same as a stack of single attribute filters would.  Its storage and sampling settings are saved with it.
+
+static const std::uint16_t pc = WISE::GridProto::CwfgmAttributeFilter_DataKey_PC,
+						   cbh = WISE::GridProto::CwfgmAttributeFilter_DataKey_CBH,
+						   pdf = WISE::GridProto::CwfgmAttributeFilter_DataKey_PDF;
+
+
+static std::int32_t attributeValue(ICWFGM_GridEngine *filter, std::uint16_t option, const XY_Point &pt) {
+	NumericVariant value;
+	grid::AttributeValue valid;
+	std::int32_t v;
+	const HSS_Time::WTime time(HSS_Time::WTime::GlobalMin());
+	if (FAILED(filter->GetAttributeData(nullptr, pt, time, HSS_Time::WTimeSpan(0LL), option, 0, &value, &valid, nullptr)) ||
+	    (valid != grid::AttributeValue::SET) || (!variantToInt32(value, &v)))
+		return -9999;
+	return v;
+}
+
+
+static boost::intrusive_ptr<CCWFGM_MultiAttributeFilter> twoBands(GridTestEngine *engine) {
+	boost::intrusive_ptr<CCWFGM_MultiAttributeFilter> filter(new CCWFGM_MultiAttributeFilter());
+	filter->PutGridEngine(nullptr, engine);
+	GRID_CHECK(SUCCEEDED(filter->AddBand(pc, CCWFGM_AttributeFilter::VT_I4)));
+	GRID_CHECK(SUCCEEDED(filter->AddBand(cbh, CCWFGM_AttributeFilter::VT_I4)));
+	GRID_CHECK(SUCCEEDED(filter->ResetBand(pc, NumericVariant((std::int32_t)40))));
+	GRID_CHECK(SUCCEEDED(filter->ResetBand(cbh, NumericVariant((std::int32_t)7))));
+	GRID_CHECK(SUCCEEDED(filter->SetBandPoint(pc, engine->cell(3, 2), NumericVariant((std::int32_t)90))));
+	GRID_CHECK(SUCCEEDED(filter->SetBandPoint(cbh, engine->cell(11, 9), NumericVariant((std::int32_t)-2))));
+	return filter;
+}
+
+
+static void pointQueries(GridTestEngine *engine, CCWFGM_MultiAttributeFilter *filter) {
+	const std::uint32_t queries = engine->m_attributeQueries;
+	GRID_CHECK(attributeValue(filter, pc, engine->cell(3, 2)) == 90);
+	GRID_CHECK(attributeValue(filter, pc, engine->cell(4, 2)) == 40);
+	GRID_CHECK(attributeValue(filter, cbh, engine->cell(11, 9)) == -2);
+	GRID_CHECK(attributeValue(filter, cbh, engine->cell(0, 0)) == 7);
+	GRID_CHECK(engine->m_attributeQueries == queries);
+
+	// an option with no band comes from the layer below
+	GRID_CHECK(attributeValue(filter, pdf, engine->cell(3, 2)) == -55);
+	GRID_CHECK(engine->m_attributeQueries == queries + 1);
+}
+
+
+static void arrayQueries(GridTestEngine *engine, CCWFGM_MultiAttributeFilter *filter) {
+	const std::uint32_t queries = engine->m_attributeQueries;
+	int32_t_2d values;
+	attribute_t_2d valid;
+	GRID_CHECK(gridTestArray(filter, engine, pc, 2, 1, 5, 3, &values, &valid) == S_OK);
+	GRID_CHECK(engine->m_attributeQueries == queries);
+	for (std::uint16_t y = 1; y <= 3; y++)
+		for (std::uint16_t x = 2; x <= 5; x++) {
+			GRID_CHECK(valid[x - 2][y - 1] == grid::AttributeValue::SET);
+			GRID_CHECK(values[x - 2][y - 1] == (((x == 3) && (y == 2)) ? 90 : 40));
+		}
+
+	NumericVariant_2d variants;
+	GRID_CHECK(gridTestArray(filter, engine, cbh, 10, 8, 11, 9, &variants, &valid) == S_OK);
+	GRID_CHECK(engine->m_attributeQueries == queries);
+	std::int32_t v;
+	GRID_CHECK(variantToInt32(variants[1][1], &v) && (v == -2));
+	GRID_CHECK(variantToInt32(variants[0][0], &v) && (v == 7));
+
+	GRID_CHECK(gridTestArray(filter, engine, pdf, 2, 1, 5, 3, &values, &valid) == S_OK);
+	GRID_CHECK(engine->m_attributeQueries == queries + 1);
+	GRID_CHECK((values[0][0] == -55) && (values[3][2] == -55));
+}
+
+
+static void removedBand(GridTestEngine *engine) {
+	auto filter = twoBands(engine);
+	GRID_CHECK(SUCCEEDED(filter->RemoveBand(cbh)));
+	GRID_CHECK(filter->RemoveBand(cbh) == E_INVALIDARG);
+
+	const std::uint32_t queries = engine->m_attributeQueries;
+	GRID_CHECK(attributeValue(filter.get(), cbh, engine->cell(11, 9)) == -55);
+	GRID_CHECK(attributeValue(filter.get(), pc, engine->cell(3, 2)) == 90);
+	GRID_CHECK(engine->m_attributeQueries == queries + 1);
+}
+
+
+static void reload(GridTestEngine *engine) {
+	auto filter = twoBands(engine);
+	GRID_CHECK(SUCCEEDED(filter->SetAttribute(CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, true)));
+	GRID_CHECK(SUCCEEDED(filter->SetAttribute(CWFGM_GRID_ATTRIBUTE_SAMPLING, (std::uint16_t)CWFGM_GRID_SAMPLING_BILINEAR)));
+
+	auto loaded = gridTestReload(filter.get(), engine, true);
+	std::uint32_t count;
+	GRID_CHECK(SUCCEEDED(loaded->GetBandCount(&count)) && (count == 2));
+	pointQueries(engine, loaded.get());
+	arrayQueries(engine, loaded.get());
+
+	PolymorphicAttribute setting;
+	GRID_CHECK(SUCCEEDED(loaded->GetAttribute(CWFGM_GRID_ATTRIBUTE_NARROW_STORAGE, &setting)) && (std::get<bool>(setting)));
+	GRID_CHECK(SUCCEEDED(loaded->GetAttribute(CWFGM_GRID_ATTRIBUTE_SAMPLING, &setting)) &&
+		(std::get<std::uint16_t>(setting) == CWFGM_GRID_SAMPLING_BILINEAR));
+}
+
+
+int main(int argc, char *argv[]) {
+	boost::intrusive_ptr<GridTestEngine> engine(new GridTestEngine(12, 10, 25.0, 500000.0, 6000000.0));
+
+	auto filter = twoBands(engine.get());
+	pointQueries(engine.get(), filter.get());
+	arrayQueries(engine.get(), filter.get());
+	removedBand(engine.get());
+	reload(engine.get());
+
+	return gridTestFailures() ? 1 : 0;
+}
@@ -0,0 +1,368 @@
+/**
+ * WISE_Grid_Module: TemporalAttributeFilterTest.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GridTestSupport.h"
+#include "CWFGM_TemporalAttributeFilter.h"
+#include "doubleBuilder.h"
+#include <memory>
+#include <vector>
+
+// Caching sun rise and set times is off unless asked for, and the tile size it's cached over is saved with the filter.  Daily and
+// seasonal options are found from their indexes as they were by walking the lists, however the lists have been edited.
+
+
+/**
+	Temporal filter which can be asked for options directly, and can answer them the way it did before they were indexed, by
+	walking the lists.
+*/
+class GridTestTemporalFilter : public CCWFGM_TemporalAttributeFilter {
+public:
+	DailyAttribute *option(const WTime &time, bool autocreate)			{ return findOption(time, autocreate); }
+	SeasonalAttribute *seasonOption(const WTimeSpan &time, std::uint16_t option, bool autocreate, bool accept_earlier)
+																		{ return findSeasonOption(time, option, autocreate, accept_earlier); }
+	bool dailyIndexed()													{ rebuildIndex(); return !m_dailyIndex.empty(); }
+
+	/**
+		Adds a daily entry starting offset after the start of time's local day, as only a file could, keeping the list in order and
+		after any entry with the same start.
+	*/
+	DailyAttribute *addDaily(const WTime &time, const WTimeSpan &offset) {
+		DailyAttribute *day = findOption(time, true);
+		DailyAttribute *da = new DailyAttribute(m_timeManager);
+		da->m_localStartTime = day->m_localStartTime + offset;
+		DailyAttribute *where = m_attributes.LH_Head();
+		while ((where->LN_Succ()) && (where->m_localStartTime <= da->m_localStartTime))
+			where = where->LN_Succ();
+		m_attributes.Insert(da, where->LN_Pred());
+		invalidateIndex();
+		return da;
+	}
+
+	DailyAttribute *linearOption(const WTime &_time) const {
+		WTime lstime(_time, WTIME_FORMAT_AS_LOCAL | WTIME_FORMAT_WITHDST, 1);
+		lstime.PurgeToDay(0);
+		WTime time(0ULL, m_timeManager);
+		time.SetTime(lstime);
+
+		DailyAttribute *ao = m_attributes.LH_Head();
+		while (ao->LN_Succ()) {
+			if (ao->m_localStartTime == time)
+				return ao;
+			if (ao->m_localStartTime > time)
+				break;
+			ao = ao->LN_Succ();
+		}
+		return nullptr;
+	}
+
+	SeasonalAttribute *linearSeasonOption(const WTimeSpan &wtime, std::uint16_t option, bool accept_earlier) const {
+		SeasonalAttribute *found = nullptr, *lastfound = nullptr;
+		WTimeSpan wtime2(wtime);
+		wtime2.PurgeToDay();
+
+		SeasonalAttribute *ao = m_conditions.LH_Head();
+		while (ao->LN_Succ()) {
+			if ((ao->m_localStartDate == wtime) || (ao->m_localStartDate == wtime2)) {
+				found = ao;
+				break;
+			}
+			if (ao->m_localStartDate > wtime2)
+				break;
+			if ((option == CWFGM_SCENARIO_OPTION_GRASSPHENOLOGY) || (option == CWFGM_SCENARIO_OPTION_GREENUP)) {
+				if (ao->m_optionFlagsSet & (1 << option))
+					lastfound = ao;
+			}
+			else if (option == FUELCOM_ATTRIBUTE_CURINGDEGREE) {
+				if (ao->m_bits & TEMPORAL_BITS_CURING_DEGREE_EFFECTIVE)
+					lastfound = ao;
+			}
+			ao = ao->LN_Succ();
+		}
+
+		if (found) {
+			if ((option == CWFGM_SCENARIO_OPTION_GRASSPHENOLOGY) || (option == CWFGM_SCENARIO_OPTION_GREENUP))
+				if (found->m_optionFlagsSet & (1 << option))
+					return found;
+			if (option == FUELCOM_ATTRIBUTE_CURINGDEGREE)
+				if (found->m_bits & TEMPORAL_BITS_CURING_DEGREE_EFFECTIVE)
+					return found;
+		}
+		if ((accept_earlier) && (lastfound))
+			return lastfound;
+		return found;
+	}
+
+	/**
+		True if both lists are in order of their start times, with no start time repeated unless allowRepeats.
+	*/
+	bool ordered(bool allowRepeats) const {
+		const DailyAttribute *da = m_attributes.LH_Head();
+		while ((da->LN_Succ()) && (da->LN_Succ()->LN_Succ())) {
+			if ((da->m_localStartTime > da->LN_Succ()->m_localStartTime) || ((!allowRepeats) && (da->m_localStartTime == da->LN_Succ()->m_localStartTime)))
+				return false;
+			da = da->LN_Succ();
+		}
+		const SeasonalAttribute *sa = m_conditions.LH_Head();
+		while ((sa->LN_Succ()) && (sa->LN_Succ()->LN_Succ())) {
+			if (sa->m_localStartDate >= sa->LN_Succ()->m_localStartDate)
+				return false;
+			sa = sa->LN_Succ();
+		}
+		return true;
+	}
+
+	std::uint32_t dailyCount()											{ return m_attributes.GetCount(); }
+	std::uint32_t seasonalCount()										{ return m_conditions.GetCount(); }
+};
+
+
+static double solarCacheTile(CCWFGM_TemporalAttributeFilter *filter) {
+	PolymorphicAttribute value;
+	if (FAILED(filter->GetAttribute(CWFGM_GRID_ATTRIBUTE_SOLAR_CACHE_TILE, &value)))
+		return -1.0;
+	try {
+		return std::get<double>(value);
+	}
+	catch (std::bad_variant_access &) {
+		return -1.0;
+	}
+}
+
+
+static void offByDefault() {
+	boost::intrusive_ptr<CCWFGM_TemporalAttributeFilter> filter(new CCWFGM_TemporalAttributeFilter());
+	GRID_CHECK(solarCacheTile(filter.get()) == 0.0);
+
+	std::unique_ptr<WISE::GridProto::TemporalCondition> proto(filter->serialize(gridTestOptions(false)));
+	GRID_CHECK(!proto->has_solarcachetile());
+
+	GRID_CHECK(filter->SetAttribute(CWFGM_GRID_ATTRIBUTE_SOLAR_CACHE_TILE, -1.0) == E_INVALIDARG);
+	GRID_CHECK(solarCacheTile(filter.get()) == 0.0);
+	GRID_CHECK(!filter->isdirty().value_or(true));
+}
+
+
+static void roundTrip() {
+	boost::intrusive_ptr<CCWFGM_TemporalAttributeFilter> filter(new CCWFGM_TemporalAttributeFilter());
+	GRID_CHECK(SUCCEEDED(filter->SetAttribute(CWFGM_GRID_ATTRIBUTE_SOLAR_CACHE_TILE, 500.0)));
+	GRID_CHECK(filter->isdirty().value_or(false));
+	GRID_CHECK(solarCacheTile(filter.get()) == 500.0);
+
+	std::unique_ptr<WISE::GridProto::TemporalCondition> proto(filter->serialize(gridTestOptions(false)));
+	GRID_CHECK(proto->has_solarcachetile());
+
+	auto loaded = gridTestLoad<CCWFGM_TemporalAttributeFilter>(nullptr, *proto);
+	GRID_CHECK(solarCacheTile(loaded.get()) == 500.0);
+
+	// a file without the field turns caching off, whatever was set before loading
+	proto->clear_solarcachetile();
+	loaded->deserialize(*proto, nullptr, "temporal");
+	GRID_CHECK(solarCacheTile(loaded.get()) == 0.0);
+
+	// and a negative size is treated as not caching
+	proto->set_allocated_solarcachetile(DoubleBuilder().withValue(-25.0).forProtobuf(false));
+	loaded->deserialize(*proto, nullptr, "temporal");
+	GRID_CHECK(solarCacheTile(loaded.get()) == 0.0);
+}
+
+
+static const std::uint16_t seasonalOptions[] = { CWFGM_SCENARIO_OPTION_GRASSPHENOLOGY, CWFGM_SCENARIO_OPTION_GREENUP, FUELCOM_ATTRIBUTE_CURINGDEGREE };
+
+
+// every hour from start for the given number of days finds the same daily entry from the index as from the list
+static void sameDaily(GridTestTemporalFilter *filter, const WTime &start, std::int32_t days) {
+	std::uint32_t wrong = 0;
+	for (std::int32_t hour = 0; hour < days * 24; hour++) {
+		const WTime time(start + WTimeSpan(0, hour, 0, 0));
+		if (filter->option(time, false) != filter->linearOption(time))
+			wrong++;
+	}
+	GRID_CHECK(wrong == 0);
+}
+
+
+// every day of the year, at midnight and part way through, finds the same seasonal entry, for every option, whether or not an
+// earlier entry is accepted
+static void sameSeasonal(GridTestTemporalFilter *filter) {
+	std::uint32_t wrong = 0;
+	for (std::int32_t day = 0; day <= 366; day++)
+		for (const WTimeSpan &time : { WTimeSpan(day, 0, 0, 0), WTimeSpan(day, 13, 0, 0) })
+			for (std::uint16_t option : seasonalOptions)
+				for (bool accept_earlier : { false, true })
+					if (filter->seasonOption(time, option, false, accept_earlier) != filter->linearSeasonOption(time, option, accept_earlier))
+						wrong++;
+	GRID_CHECK(wrong == 0);
+}
+
+
+static void dailyIndex() {
+	// standard time, a zone west of GMT with daylight savings, and one far enough east that local midnight is the day before in GMT
+	static const std::int32_t zones[][2] = { { 0, 0 }, { -7, 1 }, { 12, 1 } };
+
+	for (const auto &zone : zones) {
+		WorldLocation location;
+		location.m_timezone(WTimeSpan(0, zone[0], 0, 0));
+		if (zone[1]) {
+			location.m_startDST(WTimeSpan(70, 0, 0, 0));
+			location.m_endDST(WTimeSpan(300, 0, 0, 0));
+			location.m_amtDST(WTimeSpan(0, zone[1], 0, 0));
+		}
+		WTimeManager tm(location);
+		ICWFGM_CommonData data;
+		data.m_timeManager = &tm;
+
+		boost::intrusive_ptr<GridTestTemporalFilter> filter(new GridTestTemporalFilter());
+		filter->PutCommonData(nullptr, &data);
+		const WTime start(WTime::GlobalMin(&tm) + WTimeSpan(10, 0, 0, 0));
+
+		// made out of order, including on the days daylight savings starts and ends, they're listed in order and indexed by day
+		for (std::int32_t day : { 300, 69, 70, 71, 20, 299, 301, 150, 20, 70 })
+			GRID_CHECK(filter->option(start + WTimeSpan(day - 10, 12, 0, 0), true) != nullptr);
+		GRID_CHECK(filter->dailyCount() == 8);
+		GRID_CHECK(filter->ordered(false));
+		GRID_CHECK(filter->dailyIndexed());
+		sameDaily(filter.get(), start, 320);
+
+		// a day with a second entry, or one which doesn't start at midnight, can't be indexed by day so is searched instead
+		filter->addDaily(start + WTimeSpan(60, 12, 0, 0), WTimeSpan(0LL));
+		GRID_CHECK(filter->ordered(true));
+		GRID_CHECK(!filter->dailyIndexed());
+		sameDaily(filter.get(), start, 320);
+
+		boost::intrusive_ptr<GridTestTemporalFilter> shifted(new GridTestTemporalFilter());
+		shifted->PutCommonData(nullptr, &data);
+		for (std::int32_t day : { 20, 70, 300 })
+			shifted->option(start + WTimeSpan(day - 10, 12, 0, 0), true);
+		shifted->addDaily(start + WTimeSpan(60, 12, 0, 0), WTimeSpan(0, 1, 0, 0));
+		shifted->addDaily(start + WTimeSpan(100, 12, 0, 0), WTimeSpan(0, 23, 0, 0));
+		GRID_CHECK(!shifted->dailyIndexed());
+		sameDaily(shifted.get(), start, 320);
+
+		// as are entries too few for the days they span
+		boost::intrusive_ptr<GridTestTemporalFilter> sparse(new GridTestTemporalFilter());
+		sparse->PutCommonData(nullptr, &data);
+		for (std::int32_t day : { 0, 3000, 6000, 1500 })
+			sparse->option(start + WTimeSpan(day, 12, 0, 0), true);
+		GRID_CHECK(sparse->ordered(false));
+		GRID_CHECK(!sparse->dailyIndexed());
+		sameDaily(sparse.get(), start + WTimeSpan(1490, 0, 0, 0), 20);
+		sameDaily(sparse.get(), start + WTimeSpan(5990, 0, 0, 0), 20);
+
+		// and removing the extra entry lets the day index be used again
+		std::uint16_t count;
+		GRID_CHECK(SUCCEEDED(filter->Count(CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_RH, &count)) && (count == 9));
+		for (std::uint16_t i = 0; i < count; i++) {
+			WTimeVariant t;
+			GRID_CHECK(SUCCEEDED(filter->TimeAtIndex(CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_RH, i, &t)));
+			GRID_CHECK(filter->option(std::get<WTime>(t), false) == filter->linearOption(std::get<WTime>(t)));
+		}
+		for (std::uint16_t i = 1; i < count; i++) {
+			WTimeVariant a, b;
+			filter->TimeAtIndex(CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_RH, i - 1, &a);
+			filter->TimeAtIndex(CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_RH, i, &b);
+			if (std::get<WTime>(a) == std::get<WTime>(b)) {
+				GRID_CHECK(SUCCEEDED(filter->DeleteIndex(CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_RH, i)));
+				break;
+			}
+		}
+		GRID_CHECK(filter->dailyCount() == 8);
+		GRID_CHECK(filter->dailyIndexed());
+		sameDaily(filter.get(), start, 320);
+	}
+}
+
+
+// option's value on day, as a curing degree or 0 or 1 for a flag, -1 if it isn't set, or -2 if there's no entry for it
+static double seasonalValue(CCWFGM_TemporalAttributeFilter *filter, std::uint16_t option, std::int32_t day) {
+	PolymorphicAttribute value;
+	bool valid;
+	if (FAILED(filter->GetOptionKey(option, WTimeSpan(day, 0, 0, 0), &value, &valid)))
+		return -2.0;
+	if (!valid)
+		return -1.0;
+	try {
+		if (option == FUELCOM_ATTRIBUTE_CURINGDEGREE)
+			return std::get<double>(value);
+		return std::get<bool>(value) ? 1.0 : 0.0;
+	}
+	catch (std::bad_variant_access &) {
+		return -3.0;
+	}
+}
+
+
+static void seasonalIndex() {
+	boost::intrusive_ptr<GridTestTemporalFilter> filter(new GridTestTemporalFilter());
+	GRID_CHECK(filter->seasonalCount() == 1);						// the default entry, at the start of the year
+
+	// made out of order, and twice for some days, they're listed in order with one entry per day
+	for (std::int32_t day : { 200, 40, 300, 120, 40, 365, 1, 200, 0 })
+		GRID_CHECK(filter->seasonOption(WTimeSpan(day, 0, 0, 0), FUELCOM_ATTRIBUTE_CURINGDEGREE, true, false) != nullptr);
+	GRID_CHECK(filter->seasonalCount() == 7);
+	GRID_CHECK(filter->ordered(false));
+	sameSeasonal(filter.get());
+
+	// setting options on only some days gives each option its own breakpoints
+	GRID_CHECK(SUCCEEDED(filter->SetOptionKey(FUELCOM_ATTRIBUTE_CURINGDEGREE, WTimeSpan(40, 0, 0, 0), 30.0, true)));
+	GRID_CHECK(SUCCEEDED(filter->SetOptionKey(FUELCOM_ATTRIBUTE_CURINGDEGREE, WTimeSpan(200, 0, 0, 0), 85.0, true)));
+	GRID_CHECK(SUCCEEDED(filter->SetOptionKey(CWFGM_SCENARIO_OPTION_GREENUP, WTimeSpan(120, 0, 0, 0), true, true)));
+	GRID_CHECK(SUCCEEDED(filter->SetOptionKey(CWFGM_SCENARIO_OPTION_GRASSPHENOLOGY, WTimeSpan(1, 0, 0, 0), false, true)));
+	GRID_CHECK(SUCCEEDED(filter->SetOptionKey(CWFGM_SCENARIO_OPTION_GRASSPHENOLOGY, WTimeSpan(300, 0, 0, 0), true, true)));
+	GRID_CHECK(SUCCEEDED(filter->SetOptionKey(FUELCOM_ATTRIBUTE_CURINGDEGREE, WTimeSpan(250, 0, 0, 0), 90.0, true)));		// a new day
+	GRID_CHECK(filter->seasonalCount() == 8);
+	GRID_CHECK(filter->ordered(false));
+	sameSeasonal(filter.get());
+	GRID_CHECK(filter->seasonOption(WTimeSpan(230, 0, 0, 0), FUELCOM_ATTRIBUTE_CURINGDEGREE, false, true) ==
+		filter->seasonOption(WTimeSpan(200, 0, 0, 0), FUELCOM_ATTRIBUTE_CURINGDEGREE, false, false));
+
+	// clearing an option takes its breakpoint away, but not the entry
+	GRID_CHECK(SUCCEEDED(filter->ClearOptionKey(FUELCOM_ATTRIBUTE_CURINGDEGREE, WTimeSpan(200, 0, 0, 0))));
+	GRID_CHECK(SUCCEEDED(filter->ClearOptionKey(CWFGM_SCENARIO_OPTION_GREENUP, WTimeSpan(120, 0, 0, 0))));
+	GRID_CHECK(filter->seasonalCount() == 8);
+	sameSeasonal(filter.get());
+	GRID_CHECK(filter->seasonOption(WTimeSpan(230, 0, 0, 0), FUELCOM_ATTRIBUTE_CURINGDEGREE, false, true) ==
+		filter->seasonOption(WTimeSpan(40, 0, 0, 0), FUELCOM_ATTRIBUTE_CURINGDEGREE, false, false));
+
+	// and deleting entries takes them all away
+	for (std::uint16_t index : { 2, 0, 4 }) {
+		GRID_CHECK(SUCCEEDED(filter->DeleteIndex(FUELCOM_ATTRIBUTE_CURINGDEGREE, index)));
+		GRID_CHECK(filter->ordered(false));
+		sameSeasonal(filter.get());
+	}
+	GRID_CHECK(filter->seasonalCount() == 5);
+
+	// a copy indexes its own lists
+	boost::intrusive_ptr<ICWFGM_CommonBase> copy;
+	GRID_CHECK(SUCCEEDED(filter->Clone(&copy)));
+	CCWFGM_TemporalAttributeFilter *clone = dynamic_cast<CCWFGM_TemporalAttributeFilter *>(copy.get());
+	GRID_CHECK(clone != nullptr);
+	for (std::uint16_t option : seasonalOptions)
+		for (std::int32_t day : { 0, 1, 120, 200, 250, 365 }) {
+			GRID_CHECK((clone != nullptr) && (seasonalValue(filter.get(), option, day) == seasonalValue(clone, option, day)));
+		}
+}
+
+
+int main(int argc, char *argv[]) {
+	offByDefault();
+	roundTrip();
+	dailyIndex();
+	seasonalIndex();
+
+	return gridTestFailures() ? 1 : 0;
+}